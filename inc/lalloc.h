@@ -1,233 +1,921 @@
-/*
-BSD 3-Clause License
-
-Copyright (c) 2024, Franco Bucafusco
-All rights reserved.
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions are met:
-
-* Redistributions of source code must retain the above copyright notice, this
-  list of conditions and the following disclaimer.
-
-* Redistributions in binary form must reproduce the above copyright notice,
-  this list of conditions and the following disclaimer in the documentation
-  and/or other materials provided with the distribution.
-
-* Neither the name of the copyright holder nor the names of its
-  contributors may be used to endorse or promote products derived from
-  this software without specific prior written permission.
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
-FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
-DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
-CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
-OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-*/
-
-#pragma once
-
-#include <string.h>
-#include <stddef.h>
-#include <stdint.h>
-#include <stdbool.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/* Project dependant configuration : the user should create this file in its project */
-#include "lalloc_config.h"
-
-#define LALLOC_VERSION           100
-
-/* DEFAULT VALUES: can be changed in  lalloc_config.h =========================================================================== */
-
-#ifndef LALLOC_ASSERT
-#define LALLOC_ASSERT(a)
-#endif
-
-/**
-   @brief it defines the alignment required to access the data.
-          e.g 2 -> the first byte of any block will be aligned with an address multiple of 2
-          options are 1, 2, 4 and 8.
- */
-#ifndef LALLOC_ALIGNMENT
-#define LALLOC_ALIGNMENT         4
-#endif
-
-/**
-   @brief defines the maximum ammount of byte of the pool for each instance.
- */
-#ifndef LALLOC_MAX_BYTES
-#define LALLOC_MAX_BYTES         0xFFFF
-#endif
-
-/**
-    @brief When commiting an allocated space, the commited block might be splitted.  
-           At its left will have an allocated block and at its right may have a free block or not.
-           It might have a free block if a lalloc_free operation occured before the commit operation, and the freed block was
-           the adjacent to this new splitted block. 
-           
-           1: the join operation will happen on every lalloc_commit call.
-           0: the join operation wont happen when lalloc_commit is called.
-*/
-#ifndef LALLOC_ALLOW_JOINING_WHEN_COMMITTING
-#define LALLOC_ALLOW_JOINING_WHEN_COMMITTING    1  
-#endif
-
-/* CONDITIONALS ========================================================================================================== */
-
-/**
-   @brief   If lalloc_config.h defines LALLOC_CRITICAL_START, LALLOC_CRITICAL_END
-            LALLOC_THREAD_SAFE is defined as 2, meaning that the critical section mechanism will be based on other mechanism than mutex ( disable/enable isr, e.g. )
-            In this case, the RAM footprint will include the mutex object handle.
- */
-#if defined(LALLOC_CRITICAL_START) && defined(LALLOC_CRITICAL_END)
-#define LALLOC_THREAD_SAFE       2
-#endif
-
-/**
-   @brief   If lalloc_config.h defines LALLOC_MUTEX_INIT, LALLOC_MUTEX_LOCK, LALLOC_MUTEX_UNLOCK
-            LALLOC_THREAD_SAFE is defined as 1, meaning that the critical section mechanism will be based on mutex.
-            In this case, the RAM footptinf will include the mutex object handle.
- */
-#if defined(LALLOC_MUTEX_INIT)&&defined(LALLOC_MUTEX_LOCK)&&defined(LALLOC_MUTEX_UNLOCK)&&defined(LALLOC_MUTEX_TYPE)
-#define LALLOC_THREAD_SAFE       1
-#define LALLOC_CRITICAL_INIT     LALLOC_MUTEX_INIT(obj->din.mutex)
-#define LALLOC_CRITICAL_START    LALLOC_MUTEX_LOCK(obj->din.mutex)
-#define LALLOC_CRITICAL_END      LALLOC_MUTEX_UNLOCK(obj->din.mutex)
-#endif
-
-/**
-   @brief   Based on LALLOC_MAX_BYTES it defines the data type for the indexing of bytes and blocks
-*/
-#if defined(LALLOC_MAX_BYTES) && !defined(LALLOC_IDX_TYPE)
-#if( LALLOC_MAX_BYTES<=0xFF )
-#define LALLOC_IDX_TYPE                uint8_t
-#elif( LALLOC_MAX_BYTES<=0xFFFF )
-#define LALLOC_IDX_TYPE                uint16_t
-#elif( LALLOC_MAX_BYTES<=0xFFFFFFFF )
-#define LALLOC_IDX_TYPE                uint32_t
-#endif
-#endif
-
-/**
-   @brief   LALLOC_IDX_INVALID
-            defines the invalid value for all the variables or members of type LALLOC_IDX_TYPE
-*/
-#define LALLOC_IDX_INVALID              ((LALLOC_IDX_TYPE)(~((LALLOC_IDX_TYPE)0)))
-
-#if LALLOC_ALIGNMENT==1
-/* alignment 1 is meant to be used on 8 bit architectures and, most likely, in platforms with
-   small amout of ram only in conjuntion with LALLOC_MAX_BYTES<=0xFF.
-   If you need more bytes in the pool use LALLOC_ALIGNMENT==2 instead, because it will avoid using more
-   memory per allocated block */
-#define LALLOC_ALIGN_TYPE                uint8_t
-#elif LALLOC_ALIGNMENT==2
-#define LALLOC_ALIGN_TYPE                uint16_t
-#elif LALLOC_ALIGNMENT==4
-#define LALLOC_ALIGN_TYPE                uint32_t
-#elif LALLOC_ALIGNMENT==8
-#define LALLOC_ALIGN_TYPE                uint64_t
-#else
-#error "LALLOC_ALIGN_TYPE: ALIGNMENT not supported"
-#endif
-
-/**
-   @brief   LALLOC_SIZE_ROUND_UP
-            rounds up the size to the next multiple of the size of the type passed as parameter
-*/
-#define LALLOC_SIZE_ROUND_UP( TYPE, SIZE) ((sizeof(TYPE) == 1) ? (SIZE) : ( (SIZE) + (sizeof(TYPE) - 1) ) & ~(sizeof(TYPE) - 1))
-
-/**
-   @brief General macros for adjusting sizes and addresses
-*/
-#define LALLOC_ALIGN_ROUND_UP(SIZE)     LALLOC_SIZE_ROUND_UP( LALLOC_ALIGN_TYPE , SIZE  )
-
-/* STRUCTURES ============================================================================================================ */
-typedef struct
-{
-    LALLOC_IDX_TYPE flist;              // Index (in bytes) to the first block to be freed (1st byte of the header). Points to the block with the largest size.
-    LALLOC_IDX_TYPE alist;              // Index (in bytes) to the first block to be allocated (1st byte of the header).
-    LALLOC_IDX_TYPE alloc_block;        // Allocated block, which can be calculated by looking at flist to see if it has the "free" bit or not.
-    LALLOC_IDX_TYPE allocated_blocks;   // Count of allocated blocks. It avoids having to iterate through the alist elements.
-
-#if LALLOC_THREAD_SAFE==1
-    LALLOC_MUTEX_TYPE mutex;            // Mutex to ensure thread safety, if enabled.
-#endif
-} lalloc_dyn_t;
-
-typedef struct
-{
-    uint8_t*            pool;       // Points to the RAM memory area where data will be stored.
-    LALLOC_IDX_TYPE     size;       // Size of the memory area pointed to by "pool."
-    lalloc_dyn_t*       dyn;        // Pointer to the RAM area to store dynamic variables of the queue.
-} lalloc_t;
-
-/* FUNCTIONAL MACROS ===================================================================================================== */
-#ifndef LALLOC_RAM_ATTRIBUTES
-#define LALLOC_RAM_ATTRIBUTES
-#endif
-
-#ifndef LALLOC_ROM_ATTRIBUTES
-#define LALLOC_ROM_ATTRIBUTES           const
-#endif
-
-#ifndef LALLOC_CONST_OBJ_ATTRIBUTES
-#define LALLOC_CONST_OBJ_ATTRIBUTES     LALLOC_ROM_ATTRIBUTES
-#endif
-
-#ifndef LALLOC_T
-#define LALLOC_T LALLOC_CONST_OBJ_ATTRIBUTES lalloc_t
-#endif
-
-/**
-   @brief declares a static object that can be declared in any scope of execution
- */
-#define LALLOC_DECLARE(NAME,SIZE  )                                                                   \
-lalloc_dyn_t         NAME##_Data;                                                                     \
-LALLOC_ALIGN_TYPE    NAME##_pool[LALLOC_SIZE_ROUND_UP(LALLOC_ALIGN_TYPE,SIZE) / LALLOC_ALIGNMENT ];   \
-lalloc_t             LALLOC_ROM_ATTRIBUTES NAME =                                                     \
-{                                                                                                     \
-    .pool     = (uint8_t*) NAME##_pool,                                                               \
-    .size     = sizeof(NAME##_pool),                                                                  \
-    .dyn      = &(NAME##_Data),                                                                       \
-};
-
-/** methods  ---------------------------------------------------------------------------  **/
-
-/* User interfaces */
-void lalloc_init( LALLOC_T * obj );
-void lalloc_alloc( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
-void lalloc_alloc_revert( LALLOC_T * obj );
-bool lalloc_commit( LALLOC_T * obj, LALLOC_IDX_TYPE size );
-bool lalloc_free_first( LALLOC_T * obj ) ;
-bool lalloc_free( LALLOC_T * obj, void *addr );
-bool lalloc_free_last( LALLOC_T * obj );
-void lalloc_get_first( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
-void lalloc_get_n( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE n );
-void lalloc_get_last( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
-bool lalloc_is_full( LALLOC_T * obj );
-bool lalloc_is_empty( LALLOC_T * obj );
-LALLOC_IDX_TYPE lalloc_get_free_space ( LALLOC_T * obj );
-char lalloc_dest_belongs( LALLOC_T * obj, void *addr );
-LALLOC_IDX_TYPE lalloc_get_alloc_count ( LALLOC_T * obj );
-
-void* lalloc_ctor( LALLOC_IDX_TYPE size );
-void lalloc_dtor( void* this_ );
-
-#ifdef __cplusplus
-}
-#endif
-
-
-
-/* v1.00 */
-
-
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Project dependant configuration : the user should create this file in its project */
+#include "lalloc_config.h"
+
+#define LALLOC_VERSION           100
+
+/* DEFAULT VALUES: can be changed in  lalloc_config.h =========================================================================== */
+
+#ifndef LALLOC_ASSERT
+#define LALLOC_ASSERT(a)
+#endif
+
+/**
+   @brief it defines the alignment required to access the data.
+          e.g 2 -> the first byte of any block will be aligned with an address multiple of 2
+          options are 1, 2, 4 and 8.
+ */
+#ifndef LALLOC_ALIGNMENT
+#define LALLOC_ALIGNMENT         4
+#endif
+
+/**
+   @brief defines the maximum ammount of byte of the pool for each instance.
+ */
+#ifndef LALLOC_MAX_BYTES
+#define LALLOC_MAX_BYTES         0xFFFF
+#endif
+
+/**
+    @brief When commiting an allocated space, the commited block might be splitted.  
+           At its left will have an allocated block and at its right may have a free block or not.
+           It might have a free block if a lalloc_free operation occured before the commit operation, and the freed block was
+           the adjacent to this new splitted block. 
+           
+           1: the join operation will happen on every lalloc_commit call.
+           0: the join operation wont happen when lalloc_commit is called.
+*/
+#ifndef LALLOC_ALLOW_JOINING_WHEN_COMMITTING
+#define LALLOC_ALLOW_JOINING_WHEN_COMMITTING    1  
+#endif
+
+/**
+   @brief   Options for LALLOC_ENGINE
+            LALLOC_ENGINE_LISTS: (src/lalloc.c) blocks are kept in a free and an allocated list. Any block can be freed and the
+                                 freed blocks are joined with their free neighbours.
+            LALLOC_ENGINE_BIP:   (src/lalloc_bip.c) bipartite ring buffer for strict FIFO traffic. The frames are bumped one after
+                                 the other with a small header holding their size. Commit and lalloc_free_first are O(1) and the
+                                 free space is always contiguous (at most in two regions), so there is no fragmentation.
+                                 Only the oldest frame can be freed, lalloc_free_last is not available and LALLOC_FLIST_POLICY,
+                                 LALLOC_BLOCK_BITMAP and LALLOC_ALLOC_RING_SIZE are not used.
+ */
+#define LALLOC_ENGINE_LISTS      0
+#define LALLOC_ENGINE_BIP        1
+
+#ifndef LALLOC_ENGINE
+#define LALLOC_ENGINE            LALLOC_ENGINE_LISTS
+#endif
+
+/**
+   @brief   Options for LALLOC_FLIST_POLICY
+            LALLOC_FLIST_SORTED: the free blocks are kept in one list sorted by size (biggest first).
+                                 Inserting a block walks the list, O(n) on the number of free blocks.
+            LALLOC_FLIST_TLSF:   the free blocks are kept in a two level segregated fit index (TLSF like).
+                                 Insert, remove and "largest block" lookup are O(1) at the cost of
+                                 some extra RAM in lalloc_dyn_t.
+                                 The returned "largest block" is the biggest one known of the highest
+                                 non empty size class, so it might differ in less than 1/LALLOC_TLSF_SL_COUNT
+                                 of its size from the real largest block.
+            LALLOC_FLIST_LAZY:   the free blocks are kept unsorted, O(1) insertion. The largest block is cached and it
+                                 is searched again (O(n)) only when the cached block is consumed or splitted.
+                                 It fits FIFO traffic, where the freed blocks are mostly joined into the biggest one.
+ */
+#define LALLOC_FLIST_SORTED      0
+#define LALLOC_FLIST_TLSF        1
+#define LALLOC_FLIST_LAZY        2
+
+#ifndef LALLOC_FLIST_POLICY
+#define LALLOC_FLIST_POLICY      LALLOC_FLIST_SORTED
+#endif
+
+/**
+   @brief   log2 of the number of second level classes each power of two size range is splitted into.
+            Only used with LALLOC_FLIST_POLICY==LALLOC_FLIST_TLSF. Options are 1, 2 and 3.
+ */
+#ifndef LALLOC_TLSF_SL_LOG2
+#define LALLOC_TLSF_SL_LOG2      2
+#endif
+
+/**
+   @brief   1: each instance keeps a side bitmap with one bit per LALLOC_ALIGNMENT bytes of the pool, marking where blocks start.
+               Any address within a block can be resolved to its block in O(pool/32) worst case, and O(1) in practice.
+               Used by lalloc_free when LALLOC_FREE_ANY==1. The RAM footprint increases in (pool size / LALLOC_ALIGNMENT) / 8 bytes.
+            0: no bitmap, lalloc_free with LALLOC_FREE_ANY==1 searches the block through the allocated list.
+ */
+#ifndef LALLOC_BLOCK_BITMAP
+#define LALLOC_BLOCK_BITMAP      0
+#endif
+
+/**
+   @brief   >0: each instance keeps a ring with the indexes of the allocated blocks, from the oldest to the newest one.
+                lalloc_get_n becomes O(1). It is updated on every commit and free: O(1) for the oldest and newest blocks,
+                O(n) for the blocks in the middle.
+                It also limits the number of allocated blocks: lalloc_commit fails when the ring is full.
+            0:  lalloc_get_n walks the allocated list.
+ */
+#ifndef LALLOC_ALLOC_RING_SIZE
+#define LALLOC_ALLOC_RING_SIZE   0
+#endif
+
+/**
+   @brief   1: single producer / single consumer mode. The instance is shared by two contexts (e.g. an ISR and a thread)
+               without critical sections:
+               - the producer alone calls lalloc_alloc, lalloc_alloc_revert and lalloc_commit.
+               - the consumer alone calls lalloc_get_first, lalloc_get_n, lalloc_free_first and lalloc_free (only with
+                 the address of the first element).
+               Both sides only share two counters through acquire/release atomics (LALLOC_ATOMIC_LOAD/STORE).
+               The consumer just releases the oldest element, the producer moves the released blocks to the free list on
+               its next lalloc_alloc or lalloc_commit call.
+               It requires LALLOC_ALLOW_QUEUED_FREES==1 and a power of two LALLOC_ALLOC_RING_SIZE.
+               lalloc_free_last is not available and the rest of the API must not be called while both sides are running.
+            0: every call is protected with LALLOC_CRITICAL_START/END.
+ */
+#ifndef LALLOC_SPSC
+#define LALLOC_SPSC              0
+#endif
+
+/**
+   @brief   1: lalloc_free does not take the critical section. It just pushes the block onto a lock free stack (an atomic
+               LIFO with the links kept in the payload of the freed blocks), so many contexts can free at the same time
+               without contending with the owner of the pool.
+               The blocks are moved to the free list (unlinked, merged and inserted in a single pass) when the queue is
+               drained: by lalloc_alloc, lalloc_alloc_max, lalloc_reserve, lalloc_commit_and_alloc, lalloc_maintain and
+               the calls that read the allocated blocks (lalloc_get_*, lalloc_free_first*, lalloc_iter_begin, ...).
+               Until then, the freed blocks still count as allocated. lalloc_commit does not drain the queue.
+               lalloc_free checks the header of the block, and the one of the next block, and returns false without
+               writing anything when addr is not a committed block. It also returns false for a block that is already
+               queued: a mark in the block header, set with LALLOC_ATOMIC_CAS, which adds up to LALLOC_ALIGNMENT bytes to
+               the header of every block. If a block is freed twice and reused in between, the link kept in its payload
+               is lost. The drain then frees the rest of the queued blocks by walking the allocated list, and counts it in
+               the free_failures statistic.
+               It requires LALLOC_FREE_ANY==0, and LALLOC_MIN_PAYLOAD_SIZE defaults to the size of LALLOC_IDX_TYPE.
+            0: lalloc_free moves the block to the free list within the critical section.
+ */
+#ifndef LALLOC_DEFERRED_FREE
+#define LALLOC_DEFERRED_FREE     0
+#endif
+
+/**
+   @brief   1: lazy coalescing. The freed blocks are only flagged as free and added to the free list, they are not joined
+               with their free neighbours (LALLOC_ALLOW_JOINING_WHEN_COMMITTING has no effect), so lalloc_free and
+               lalloc_commit do a bounded amount of work.
+               The adjacent free blocks are merged in bounded steps by lalloc_maintain( obj, budget ), e.g. from the idle
+               loop. lalloc_alloc merges blocks on demand only when the largest free block is smaller than
+               LALLOC_LAZY_COALESCING_MIN_ALLOC, and lalloc_alloc_max and lalloc_reserve when it is smaller than max.
+               Until the blocks are merged, lalloc_get_free_space reports the largest unmerged block.
+            0: the blocks are joined with their free neighbours when they are freed.
+ */
+#ifndef LALLOC_LAZY_COALESCING
+#define LALLOC_LAZY_COALESCING   0
+#endif
+
+/**
+   @brief   With LALLOC_LAZY_COALESCING==1, lalloc_alloc merges free blocks until one of them has at least this size.
+ */
+#ifndef LALLOC_LAZY_COALESCING_MIN_ALLOC
+#define LALLOC_LAZY_COALESCING_MIN_ALLOC     64
+#endif
+
+/**
+   @brief   1: lalloc_compact_step is available. It slides the allocated blocks towards the start of the pool, so the free
+               space left between them ends up in a single block. Every move is notified to the owner of the block through
+               a callback. The blocks pinned with lalloc_pin, the reservations and the blocks that do not fit in the budget
+               of the call are not moved.
+               Any address of a movable block, including the ones kept in lalloc_iter_t, is only valid until the next
+               lalloc_compact_step call. The blocks used by other contexts while the compaction runs must be pinned.
+               The RAM footprint increases in LALLOC_COMPACTION_PINS + 3 indexes.
+            0: the blocks never move.
+ */
+#ifndef LALLOC_COMPACTION
+#define LALLOC_COMPACTION        0
+#endif
+
+/**
+   @brief   With LALLOC_COMPACTION==1, maximum number of blocks pinned at the same time.
+ */
+#ifndef LALLOC_COMPACTION_PINS
+#define LALLOC_COMPACTION_PINS   4
+#endif
+
+/**
+   @brief   1: each instance keeps its occupancy and fragmentation figures (lalloc_stats_t), updated every time a block
+               enters or leaves the free list or the allocated list. lalloc_get_stats returns a snapshot of them in O(1).
+               The RAM footprint increases in sizeof( lalloc_stats_t ).
+            0: no statistics.
+ */
+#ifndef LALLOC_STATS
+#define LALLOC_STATS             0
+#endif
+
+/**
+   @brief   1: the calls that allocate, commit or free blocks are timed from their entry to their exit with
+               LALLOC_PROFILE_CYCLES() (see lalloc_priv.h), and each operation (LALLOC_OP_*) keeps a log2 histogram of its
+               latency in the instance. They are read with lalloc_profile_get and lalloc_profile_dump.
+               Each sample is recorded after the call, within a short critical section of its own. With LALLOC_SPSC==1
+               it takes no critical section, each operation is only recorded by the side that owns it.
+               The RAM footprint increases in LALLOC_OP_COUNT * sizeof( lalloc_profile_op_t ).
+            0: the hooks are empty.
+ */
+#ifndef LALLOC_PROFILE
+#define LALLOC_PROFILE           0
+#endif
+
+/**
+   @brief   With LALLOC_PROFILE==1, number of bins of each latency histogram. The bin 0 counts the calls that took less than
+            one cycle, the bin n the ones that took [2^(n-1), 2^n) cycles and the last bin also the longer ones.
+ */
+#ifndef LALLOC_PROFILE_BINS
+#define LALLOC_PROFILE_BINS      24
+#endif
+
+/**
+   @brief   1: the critical sections wrapped with LALLOC_CS_PROFILE_START/END are timed with LALLOC_PROFILE_CYCLES(), from
+               the moment the lock is taken until it is released (e.g. the time the interrupts are masked). The maximum and
+               a log2 histogram are kept for each call site (function and line), up to LALLOC_CS_PROFILE_SITES sites.
+               They are read with lalloc_cs_get. lalloc_config.h enables it by wrapping its own primitives, e.g.:
+               #define LALLOC_CRITICAL_START   LALLOC_CS_PROFILE_START( __disable_irq() )
+               #define LALLOC_CRITICAL_END     LALLOC_CS_PROFILE_END( __enable_irq() )
+               The profiler state is global, so the wrapped critical sections must exclude each other (interrupt masking on
+               a single core, or one lock shared by every instance).
+            0: LALLOC_CS_PROFILE_START/END just expand to the primitive they wrap.
+ */
+#ifndef LALLOC_CS_PROFILE
+#define LALLOC_CS_PROFILE        0
+#endif
+
+/**
+   @brief   With LALLOC_CS_PROFILE==1, maximum number of call sites. The samples of the sites that do not fit are only
+            counted (lalloc_cs_get).
+ */
+#ifndef LALLOC_CS_PROFILE_SITES
+#define LALLOC_CS_PROFILE_SITES  64
+#endif
+
+/**
+   @brief   1: each instance reports its events (LALLOC_EV_*) to the callback set with lalloc_trace_set, so the traffic of
+               a device can be captured and replayed later (e.g. test/bench/bench_replay.c). The callback is called within
+               the critical section, right after the event, so it must be short and it must not call the instance.
+               lalloc_trace_encode packs an event in a record of up to LALLOC_TRACE_RECORD_MAX bytes, and
+               lalloc_trace_decode unpacks it. The time between the events is taken with LALLOC_PROFILE_CYCLES().
+               With LALLOC_DEFERRED_FREE==1 the frees are reported when the queue is drained, from the newest one.
+               Not available with LALLOC_SPSC==1.
+            0: no trace.
+ */
+#ifndef LALLOC_TRACE
+#define LALLOC_TRACE             0
+#endif
+
+/**
+   @brief   Options for LALLOC_MUTEX, a ready-made per-instance lock. Each instance keeps its own mutex in lalloc_dyn_t, so
+            independent instances do not contend with each other. lalloc_init (and lalloc_ctor) initializes it and
+            lalloc_deinit (and lalloc_dtor) releases it.
+            LALLOC_MUTEX_NONE:      lalloc_config.h provides the critical section: LALLOC_CRITICAL_START/END, or its own
+                                    LALLOC_MUTEX_TYPE, LALLOC_MUTEX_INIT, LALLOC_MUTEX_LOCK, LALLOC_MUTEX_UNLOCK (and optionally
+                                    LALLOC_MUTEX_DEINIT), which take the mutex field of the instance.
+            LALLOC_MUTEX_PTHREAD:   POSIX pthread_mutex_t.
+            LALLOC_MUTEX_C11:       C11 mtx_t (<threads.h>).
+            LALLOC_MUTEX_SPIN:      C11 atomic_bool spinlock, see lalloc_spin_lock. It never puts the thread to sleep, so
+                                    it suits critical sections shorter than a context switch. It must not be taken by an
+                                    ISR that can preempt a holder.
+            lalloc_config.h must not define LALLOC_CRITICAL_START/END with an adapter.
+ */
+#define LALLOC_MUTEX_NONE        0
+#define LALLOC_MUTEX_PTHREAD     1
+#define LALLOC_MUTEX_C11         2
+#define LALLOC_MUTEX_SPIN        3
+
+#ifndef LALLOC_MUTEX
+#define LALLOC_MUTEX             LALLOC_MUTEX_NONE
+#endif
+
+/**
+   @brief   With LALLOC_MUTEX_SPIN, a waiting thread pauses 1, 2, 4... times between two reads of the lock, up to
+            LALLOC_SPIN_BACKOFF_MAX. From then on it yields the CPU (LALLOC_SPIN_YIELD) after each round of pauses.
+ */
+#ifndef LALLOC_SPIN_BACKOFF_MAX
+#define LALLOC_SPIN_BACKOFF_MAX  64
+#endif
+
+/**
+   @brief   1: lalloc_get_free_space, lalloc_get_alloc_count, lalloc_is_full, lalloc_is_empty, lalloc_get_stats and
+               lalloc_get_status do not take the critical section. Every call that changes the instance publishes a
+               lalloc_status_t before leaving its critical section, and the readers copy it with a sequence counter
+               (a latch: two copies, so there is always a stable one and a reader never waits, even if it preempts the
+               writer). The cost is the copy of lalloc_status_t twice per call.
+               The readers get the state left by the last call. With LALLOC_DEFERRED_FREE==1 the queued blocks are
+               counted as allocated until the next call drains the queue.
+               Only for LALLOC_ENGINE_LISTS, without LALLOC_SPSC (its readers are lock free already).
+            0: the readers take the critical section.
+ */
+#ifndef LALLOC_SEQLOCK
+#define LALLOC_SEQLOCK           0
+#endif
+
+/**
+   @brief   1: lalloc_sharded_t spreads the traffic of many threads over several instances (shards) made with
+               lalloc_ctor, so each shard needs its own lock (LALLOC_MUTEX). A reservation is taken from the shard of the
+               caller (LALLOC_SHARD_HINT() modulo the number of shards), or from the next ones when it does not fit.
+               The commits and the frees go to the shard whose pool holds the address.
+               Only for LALLOC_ENGINE_LISTS, without LALLOC_SPSC.
+            0: no sharded front end.
+ */
+#ifndef LALLOC_SHARDED
+#define LALLOC_SHARDED           0
+#endif
+
+/**
+   @brief   1: lalloc_cache_t keeps the small blocks freed by a thread (up to LALLOC_CACHE_SMALL bytes of payload) and
+               hands them back to its next reservations of a size that fits, without taking the critical section.
+               The commit of a cached block takes a single critical section, with no free list search: the block is
+               moved to the newest place of the allocated list with the committed size.
+               The cached blocks are not freed: they stay allocated in the instance until they are reused or the cache
+               is flushed, so lalloc_get_alloc_count, lalloc_get_n, lalloc_get_first, lalloc_get_last, the iterator and
+               lalloc_dest_belongs report them as allocated.
+               It is flushed with a single lalloc_free_batch when it holds more than LALLOC_CACHE_BUDGET bytes, or with
+               lalloc_cache_flush. Each cache is used by a single thread. Only for LALLOC_ENGINE_LISTS, without
+               LALLOC_SPSC, LALLOC_COMPACTION (it would move the cached blocks) nor LALLOC_ALLOW_QUEUED_FREES
+               (lalloc_free_first would free the cached blocks).
+            0: no cache.
+ */
+#ifndef LALLOC_THREAD_CACHE
+#define LALLOC_THREAD_CACHE      0
+#endif
+
+/**
+   @brief   LALLOC_THREAD_CACHE sizing: blocks kept by each cache, largest payload cached, and bytes of payload a cache
+            can hold before it is flushed.
+ */
+#ifndef LALLOC_CACHE_SLOTS
+#define LALLOC_CACHE_SLOTS       8
+#endif
+
+#ifndef LALLOC_CACHE_SMALL
+#define LALLOC_CACHE_SMALL       64
+#endif
+
+#ifndef LALLOC_CACHE_BUDGET
+#define LALLOC_CACHE_BUDGET      256
+#endif
+
+/* CONDITIONALS ========================================================================================================== */
+
+/**
+   @brief   mutex primitives of the LALLOC_MUTEX adapters
+ */
+#if LALLOC_MUTEX==LALLOC_MUTEX_PTHREAD
+#include <pthread.h>
+#define LALLOC_MUTEX_TYPE        pthread_mutex_t
+#define LALLOC_MUTEX_INIT(M)     pthread_mutex_init( &(M), NULL )
+#define LALLOC_MUTEX_DEINIT(M)   pthread_mutex_destroy( &(M) )
+#define LALLOC_MUTEX_LOCK(M)     pthread_mutex_lock( &(M) )
+#define LALLOC_MUTEX_UNLOCK(M)   pthread_mutex_unlock( &(M) )
+#elif LALLOC_MUTEX==LALLOC_MUTEX_C11
+#include <threads.h>
+#define LALLOC_MUTEX_TYPE        mtx_t
+#define LALLOC_MUTEX_INIT(M)     mtx_init( &(M), mtx_plain )
+#define LALLOC_MUTEX_DEINIT(M)   mtx_destroy( &(M) )
+#define LALLOC_MUTEX_LOCK(M)     mtx_lock( &(M) )
+#define LALLOC_MUTEX_UNLOCK(M)   mtx_unlock( &(M) )
+#elif LALLOC_MUTEX==LALLOC_MUTEX_SPIN
+#include <stdatomic.h>
+#define LALLOC_MUTEX_TYPE        atomic_bool
+#define LALLOC_MUTEX_INIT(M)     atomic_init( &(M), false )
+#define LALLOC_MUTEX_LOCK(M)     lalloc_spin_lock( &(M) )
+#define LALLOC_MUTEX_UNLOCK(M)   lalloc_spin_unlock( &(M) )
+#endif
+
+/**
+   @brief   If lalloc_config.h defines LALLOC_CRITICAL_START, LALLOC_CRITICAL_END
+            LALLOC_THREAD_SAFE is defined as 2, meaning that the critical section mechanism will be based on other mechanism than mutex ( disable/enable isr, e.g. )
+            In this case, the RAM footprint will include the mutex object handle.
+ */
+#if defined(LALLOC_CRITICAL_START) && defined(LALLOC_CRITICAL_END)
+#define LALLOC_THREAD_SAFE       2
+#endif
+
+/**
+   @brief   If lalloc_config.h defines LALLOC_MUTEX_INIT, LALLOC_MUTEX_LOCK, LALLOC_MUTEX_UNLOCK
+            LALLOC_THREAD_SAFE is defined as 1, meaning that the critical section mechanism will be based on mutex.
+            In this case, the RAM footptinf will include the mutex object handle.
+ */
+#if !defined(LALLOC_THREAD_SAFE) && defined(LALLOC_MUTEX_INIT)&&defined(LALLOC_MUTEX_LOCK)&&defined(LALLOC_MUTEX_UNLOCK)&&defined(LALLOC_MUTEX_TYPE)
+#define LALLOC_THREAD_SAFE       1
+#define LALLOC_CRITICAL_INIT     LALLOC_MUTEX_INIT(obj->dyn->mutex)
+#define LALLOC_CRITICAL_START    LALLOC_MUTEX_LOCK(obj->dyn->mutex)
+#define LALLOC_CRITICAL_END      LALLOC_MUTEX_UNLOCK(obj->dyn->mutex)
+#ifdef LALLOC_MUTEX_DEINIT
+#define LALLOC_CRITICAL_DEINIT   LALLOC_MUTEX_DEINIT(obj->dyn->mutex)
+#endif
+#endif
+
+/**
+   @brief   Based on LALLOC_MAX_BYTES it defines the data type for the indexing of bytes and blocks
+*/
+#if defined(LALLOC_MAX_BYTES) && !defined(LALLOC_IDX_TYPE)
+#if( LALLOC_MAX_BYTES<=0xFF )
+#define LALLOC_IDX_TYPE                uint8_t
+#define LALLOC_IDX_BITS                8
+#elif( LALLOC_MAX_BYTES<=0xFFFF )
+#define LALLOC_IDX_TYPE                uint16_t
+#define LALLOC_IDX_BITS                16
+#elif( LALLOC_MAX_BYTES<=0xFFFFFFFF )
+#define LALLOC_IDX_TYPE                uint32_t
+#define LALLOC_IDX_BITS                32
+#endif
+#endif
+
+/**
+   @brief   LALLOC_IDX_INVALID
+            defines the invalid value for all the variables or members of type LALLOC_IDX_TYPE
+*/
+#define LALLOC_IDX_INVALID              ((LALLOC_IDX_TYPE)(~((LALLOC_IDX_TYPE)0)))
+
+#if LALLOC_ALIGNMENT==1
+/* alignment 1 is meant to be used on 8 bit architectures and, most likely, in platforms with
+   small amout of ram only in conjuntion with LALLOC_MAX_BYTES<=0xFF.
+   If you need more bytes in the pool use LALLOC_ALIGNMENT==2 instead, because it will avoid using more
+   memory per allocated block */
+#define LALLOC_ALIGN_TYPE                uint8_t
+#elif LALLOC_ALIGNMENT==2
+#define LALLOC_ALIGN_TYPE                uint16_t
+#elif LALLOC_ALIGNMENT==4
+#define LALLOC_ALIGN_TYPE                uint32_t
+#elif LALLOC_ALIGNMENT==8
+#define LALLOC_ALIGN_TYPE                uint64_t
+#else
+#error "LALLOC_ALIGN_TYPE: ALIGNMENT not supported"
+#endif
+
+/**
+   @brief   LALLOC_SIZE_ROUND_UP
+            rounds up the size to the next multiple of the size of the type passed as parameter
+*/
+#define LALLOC_SIZE_ROUND_UP( TYPE, SIZE) ((sizeof(TYPE) == 1) ? (SIZE) : ( (SIZE) + (sizeof(TYPE) - 1) ) & ~(sizeof(TYPE) - 1))
+
+/**
+   @brief General macros for adjusting sizes and addresses
+*/
+#define LALLOC_ALIGN_ROUND_UP(SIZE)     LALLOC_SIZE_ROUND_UP( LALLOC_ALIGN_TYPE , SIZE  )
+
+/**
+   @brief   Sizes of the segregated fit index.
+            The first level splits the sizes in powers of two, and the second level splits each power of two range
+            in LALLOC_TLSF_SL_COUNT linear classes. Sizes below LALLOC_TLSF_SL_COUNT share the first level class 0.
+*/
+#if LALLOC_FLIST_POLICY==LALLOC_FLIST_TLSF
+#if !defined(LALLOC_IDX_BITS)
+#error "LALLOC_FLIST_TLSF: LALLOC_IDX_BITS must be defined along with LALLOC_IDX_TYPE"
+#endif
+#if LALLOC_TLSF_SL_LOG2 < 1 || LALLOC_TLSF_SL_LOG2 > 3
+#error "LALLOC_TLSF_SL_LOG2: value not supported"
+#endif
+#define LALLOC_TLSF_SL_COUNT            ( 1 << LALLOC_TLSF_SL_LOG2 )
+#define LALLOC_TLSF_FL_COUNT            ( LALLOC_IDX_BITS - LALLOC_TLSF_SL_LOG2 + 1 )
+#endif
+
+/* STRUCTURES ============================================================================================================ */
+
+/**
+   @brief statistics of an instance, with LALLOC_STATS==1.
+          The free blocks are the ones in the free list, including the block reserved by lalloc_alloc.
+ */
+typedef struct
+{
+    LALLOC_IDX_TYPE free_bytes;         // Sum of the sizes of the free blocks.
+    LALLOC_IDX_TYPE free_blocks;        // Number of free blocks.
+    LALLOC_IDX_TYPE largest_free;       // Size of the largest free block (lalloc_get_stats only).
+    uint64_t        free_sq_sum;        // Sum of the squared sizes of the free blocks.
+    uint8_t         fragmentation;      // 100 * ( 1 - free_sq_sum / free_bytes^2 ), 0 if the free space is a single block (lalloc_get_stats only).
+    LALLOC_IDX_TYPE used_bytes;         // Sum of the sizes of the allocated blocks.
+    LALLOC_IDX_TYPE used_blocks;        // Number of allocated blocks.
+    LALLOC_IDX_TYPE max_used_bytes;     // High water mark of used_bytes.
+    LALLOC_IDX_TYPE max_used_blocks;    // High water mark of used_blocks.
+    LALLOC_IDX_TYPE min_free_bytes;     // Low water mark of free_bytes, sampled on every commit.
+    uint32_t        alloc_failures;     // lalloc_alloc, lalloc_alloc_max, lalloc_reserve or lalloc_commit_and_alloc found no free block.
+    uint32_t        commit_failures;    // A commit failed: no reservation, a size bigger than the reservation or a full ring.
+    uint32_t        free_failures;      // LALLOC_DEFERRED_FREE==1: the queue had an entry that was not a queued block.
+} lalloc_stats_t;
+
+/**
+   @brief state of an instance published for the lock free readers, with LALLOC_SEQLOCK==1.
+ */
+typedef struct
+{
+    LALLOC_IDX_TYPE free_space;         // Size of the largest free block, as lalloc_get_free_space.
+    LALLOC_IDX_TYPE alloc_count;        // Number of allocated blocks, as lalloc_get_alloc_count.
+#if LALLOC_STATS==1
+    lalloc_stats_t  stats;              // Statistics, without largest_free and fragmentation.
+#endif
+} lalloc_status_t;
+
+/**
+   @brief operations timed with LALLOC_PROFILE==1
+ */
+#define LALLOC_OP_ALLOC                 0       // lalloc_alloc
+#define LALLOC_OP_ALLOC_MAX             1       // lalloc_alloc_max
+#define LALLOC_OP_ALLOC_REVERT          2       // lalloc_alloc_revert
+#define LALLOC_OP_COMMIT                3       // lalloc_commit
+#define LALLOC_OP_COMMIT_AND_ALLOC      4       // lalloc_commit_and_alloc
+#define LALLOC_OP_RESERVE               5       // lalloc_reserve
+#define LALLOC_OP_COMMIT_H              6       // lalloc_commit_h
+#define LALLOC_OP_REVERT_H              7       // lalloc_revert_h
+#define LALLOC_OP_FREE                  8       // lalloc_free
+#define LALLOC_OP_FREE_FIRST            9       // lalloc_free_first
+#define LALLOC_OP_FREE_LAST             10      // lalloc_free_last
+#define LALLOC_OP_FREE_BATCH            11      // lalloc_free_batch
+#define LALLOC_OP_FREE_FIRST_N          12      // lalloc_free_first_n
+#define LALLOC_OP_MAINTAIN              13      // lalloc_maintain
+#define LALLOC_OP_COMPACT_STEP          14      // lalloc_compact_step
+#define LALLOC_OP_COUNT                 15
+
+/**
+   @brief latency of one operation, with LALLOC_PROFILE==1. The times are in LALLOC_PROFILE_CYCLES() units.
+ */
+typedef struct
+{
+    uint32_t        count;                          // Number of calls.
+    uint32_t        max;                            // Longest call.
+    uint64_t        total;                          // Sum of the times of all the calls.
+    uint32_t        hist[LALLOC_PROFILE_BINS];      // Bin 0: less than 1, bin n: [2^(n-1), 2^n), the last bin includes the longer ones.
+} lalloc_profile_op_t;
+
+/**
+   @brief   callback of lalloc_profile_dump, called once per operation that was called at least once.
+
+   @param name      name of the API call (e.g. "lalloc_commit")
+   @param op        snapshot of its latency
+ */
+typedef void ( *lalloc_profile_dump_cb_t )( const char *name, const lalloc_profile_op_t *op );
+
+/**
+   @brief events reported with LALLOC_TRACE==1. The offsets are the addresses of the payloads minus the pool address.
+ */
+#define LALLOC_EV_ALLOC                 1       // lalloc_alloc. a: size of the reserved area, 0 if there was no free space.
+#define LALLOC_EV_ALLOC_MAX             2       // lalloc_alloc_max. a: max, b: size of the reserved area.
+#define LALLOC_EV_ALLOC_REVERT          3       // lalloc_alloc_revert of a reserved area.
+#define LALLOC_EV_COMMIT                4       // lalloc_commit. a: committed size, b: offset of the block.
+#define LALLOC_EV_COMMIT_AND_ALLOC      5       // lalloc_commit_and_alloc. a: committed size, b: offset of the block.
+#define LALLOC_EV_RESERVE               6       // lalloc_reserve. a: max, b: offset of the area, 0 if there was no free space.
+#define LALLOC_EV_COMMIT_H              7       // lalloc_commit_h. a: committed size, b: offset of the block.
+#define LALLOC_EV_REVERT_H              8       // lalloc_revert_h. b: offset of the area.
+#define LALLOC_EV_FREE                  9       // a block was freed, by any lalloc_free* call. b: offset of the block.
+#define LALLOC_EV_GET                   10      // lalloc_get_n and lalloc_get_first. a: n.
+#define LALLOC_EV_GET_LAST              11      // lalloc_get_last.
+#define LALLOC_EV_MOVE                  12      // lalloc_compact_step moved a block. a: new offset, b: old offset.
+
+/**
+   @brief   maximum size of a record of lalloc_trace_encode: the type and three variable length integers.
+ */
+#define LALLOC_TRACE_RECORD_MAX         16
+
+/**
+   @brief event reported with LALLOC_TRACE==1.
+ */
+typedef struct
+{
+    uint8_t         type;               // LALLOC_EV_*
+    uint32_t        delta;              // Time since the previous event of the instance, in LALLOC_PROFILE_CYCLES() units.
+    uint32_t        a;                  // Arguments, see LALLOC_EV_*. 0 if not used.
+    uint32_t        b;
+} lalloc_trace_event_t;
+
+/**
+   @brief   callback of lalloc_trace_set.
+
+   @param ctx       context given to lalloc_trace_set
+   @param ev        the event
+ */
+typedef void ( *lalloc_trace_cb_t )( void *ctx, const lalloc_trace_event_t *ev );
+
+/**
+   @brief hold time of the critical sections of one call site, with LALLOC_CS_PROFILE==1.
+          The times are in LALLOC_PROFILE_CYCLES() units.
+ */
+typedef struct
+{
+    const char*     fcn;                            // Function of the critical section.
+    uint32_t        line;                           // Line of LALLOC_CRITICAL_START.
+    uint32_t        count;                          // Number of times the critical section was taken.
+    uint32_t        max;                            // Longest hold time.
+    uint64_t        total;                          // Sum of the hold times.
+    uint32_t        hist[LALLOC_PROFILE_BINS];      // Bin 0: less than 1, bin n: [2^(n-1), 2^n), the last bin includes the longer ones.
+} lalloc_cs_site_t;
+
+/**
+   @brief   LALLOC_CS_PROFILE_START, LALLOC_CS_PROFILE_END
+            wrappers of the critical section primitives of the platform, for LALLOC_CRITICAL_START/END in lalloc_config.h.
+            The time is taken after LOCK and before UNLOCK. The call site is looked up when the critical section ends.
+ */
+#if LALLOC_CS_PROFILE==1
+#define LALLOC_CS_PROFILE_START( LOCK )     do { LOCK; lalloc_cs_enter( __func__, __LINE__ ); } while ( 0 )
+#define LALLOC_CS_PROFILE_END( UNLOCK )     do { lalloc_cs_exit(); UNLOCK; } while ( 0 )
+#else
+#define LALLOC_CS_PROFILE_START( LOCK )     LOCK
+#define LALLOC_CS_PROFILE_END( UNLOCK )     UNLOCK
+#endif
+
+typedef struct
+{
+#if LALLOC_ENGINE==LALLOC_ENGINE_BIP
+    LALLOC_IDX_TYPE a_start;            // Index (in bytes) to the oldest frame (1st byte of the header). Region A is [a_start, a_end).
+    LALLOC_IDX_TYPE a_end;              // End of region A.
+    LALLOC_IDX_TYPE b_end;              // End of region B, [0, b_end). It is used when region A reached the end of the pool. 0: not used.
+    LALLOC_IDX_TYPE last;               // Index (in bytes) to the newest frame.
+#else
+    LALLOC_IDX_TYPE flist;              // Index (in bytes) to the first block to be freed (1st byte of the header). Points to the block with the largest size (except for LALLOC_FLIST_LAZY).
+    LALLOC_IDX_TYPE alist;              // Index (in bytes) to the first block to be allocated (1st byte of the header).
+#endif
+    LALLOC_IDX_TYPE alloc_block;        // Allocated block, which can be calculated by looking at flist to see if it has the "free" bit or not.
+    LALLOC_IDX_TYPE allocated_blocks;   // Count of allocated blocks. It avoids having to iterate through the alist elements.
+
+#if LALLOC_FLIST_POLICY==LALLOC_FLIST_TLSF
+    uint32_t        fl_bitmap;                                                  // Bit n set: the first level class n has free blocks.
+    uint8_t         sl_bitmap[LALLOC_TLSF_FL_COUNT];                            // Bit m set: the class [n][m] has free blocks.
+    LALLOC_IDX_TYPE fheads[LALLOC_TLSF_FL_COUNT][LALLOC_TLSF_SL_COUNT];         // Free list for each size class.
+#endif
+
+#if LALLOC_ALLOC_RING_SIZE>0
+    LALLOC_IDX_TYPE ring[LALLOC_ALLOC_RING_SIZE];   // Allocated blocks, from ring_head (the oldest one) to allocated_blocks positions later.
+    LALLOC_IDX_TYPE ring_head;                      // Position in ring of the oldest allocated block.
+#endif
+
+#if LALLOC_SPSC==1
+    LALLOC_IDX_TYPE spsc_committed;     // Number of committed blocks (free running). Written by the producer only.
+    LALLOC_IDX_TYPE spsc_released;      // Number of blocks released by the consumer (free running). Written by the consumer only.
+#endif
+
+#if LALLOC_DEFERRED_FREE==1
+    LALLOC_IDX_TYPE deferred;           // Last block pushed by lalloc_free, LALLOC_IDX_INVALID if the queue is empty. Atomic.
+#endif
+
+#if LALLOC_LAZY_COALESCING==1
+    LALLOC_IDX_TYPE coalesce_idx;       // Block where the next coalescing step starts.
+    LALLOC_IDX_TYPE coalesce_clean;     // Bytes walked since the last merge, or since a block was freed next to a free one.
+#endif
+
+#if LALLOC_COMPACTION==1
+    LALLOC_IDX_TYPE compact_idx;                    // Block where the next compaction step starts.
+    LALLOC_IDX_TYPE compact_moved;                  // Not 0 if a block was moved or merged since the compaction started a new lap.
+    LALLOC_IDX_TYPE pins[LALLOC_COMPACTION_PINS];   // Pinned blocks, the first pin_count positions are used.
+    LALLOC_IDX_TYPE pin_count;
+#endif
+
+#if LALLOC_STATS==1
+    lalloc_stats_t  stats;              // Statistics, updated incrementally.
+#endif
+
+#if LALLOC_PROFILE==1
+    lalloc_profile_op_t profile[LALLOC_OP_COUNT];   // Latency of each operation.
+#endif
+
+#if LALLOC_TRACE==1
+    lalloc_trace_cb_t   trace_cb;       // Receiver of the events, NULL if the trace is off.
+    void*               trace_ctx;      // Context of trace_cb.
+    uint32_t            trace_time;     // Time of the last event.
+#endif
+
+#if LALLOC_SEQLOCK==1
+    uint32_t        seq;                // Even: status[0] is stable. Odd: status[1] is stable. Atomic.
+    lalloc_status_t status[2];          // State published by the last call that changed the instance.
+#endif
+
+#if LALLOC_FLIST_POLICY==LALLOC_FLIST_LAZY
+    LALLOC_IDX_TYPE flist_max;          // Cached largest free block. LALLOC_IDX_INVALID when it has to be searched again.
+    LALLOC_IDX_TYPE flist_max_size;     // No block in flist is bigger than this. It is the size of flist_max when the cache is valid.
+#endif
+
+#if LALLOC_THREAD_SAFE==1
+    LALLOC_MUTEX_TYPE mutex;            // Mutex to ensure thread safety, if enabled.
+#endif
+} lalloc_dyn_t;
+
+typedef struct
+{
+    uint8_t*            pool;       // Points to the RAM memory area where data will be stored.
+    LALLOC_IDX_TYPE     size;       // Size of the memory area pointed to by "pool."
+    lalloc_dyn_t*       dyn;        // Pointer to the RAM area to store dynamic variables of the queue.
+#if LALLOC_BLOCK_BITMAP==1
+    uint32_t*           bitmap;     // One bit per LALLOC_ALIGNMENT bytes of the pool. Set for the first granule of each block.
+#endif
+} lalloc_t;
+
+/**
+   @brief instances behind a single handle, with LALLOC_SHARDED==1. Made by lalloc_sharded_ctor.
+ */
+typedef struct
+{
+    uint8_t             count;      // Number of shards.
+    lalloc_t*           shards[];   // Instances, made by lalloc_ctor.
+} lalloc_sharded_t;
+
+/**
+   @brief cursor to iterate the allocated blocks from the oldest to the newest one.
+ */
+typedef struct
+{
+    LALLOC_IDX_TYPE block;      // Next block to be returned.
+    LALLOC_IDX_TYPE remaining;  // Number of blocks left to be returned.
+} lalloc_iter_t;
+
+/**
+   @brief reservation made with lalloc_reserve. Any number of them can be outstanding at the same time.
+ */
+typedef struct
+{
+    void*               addr;       // First byte of the reserved area. NULL if there is no reservation.
+    LALLOC_IDX_TYPE     size;       // Size of the reserved area.
+    LALLOC_IDX_TYPE     block;      // Reserved block (private).
+} lalloc_handle_t;
+
+/**
+   @brief called by lalloc_compact_step after a block was moved. The data is already at new_addr.
+          It is called within the critical section, so it must not call lalloc.
+ */
+typedef void ( *lalloc_relocate_cb_t )( void *old_addr, void *new_addr, LALLOC_IDX_TYPE size );
+
+/* FUNCTIONAL MACROS ===================================================================================================== */
+#ifndef LALLOC_RAM_ATTRIBUTES
+#define LALLOC_RAM_ATTRIBUTES
+#endif
+
+#ifndef LALLOC_ROM_ATTRIBUTES
+#define LALLOC_ROM_ATTRIBUTES           const
+#endif
+
+#ifndef LALLOC_CONST_OBJ_ATTRIBUTES
+#define LALLOC_CONST_OBJ_ATTRIBUTES     LALLOC_ROM_ATTRIBUTES
+#endif
+
+#ifndef LALLOC_T
+#define LALLOC_T LALLOC_CONST_OBJ_ATTRIBUTES lalloc_t
+#endif
+
+/**
+   @brief cache of the small blocks freed by a thread, with LALLOC_THREAD_CACHE==1. Set up by lalloc_cache_init.
+ */
+typedef struct
+{
+    LALLOC_T*           obj;                        // Instance of the blocks.
+    void*               addr[LALLOC_CACHE_SLOTS];   // Cached blocks, from the oldest one.
+    LALLOC_IDX_TYPE     size[LALLOC_CACHE_SLOTS];   // Size of each cached block.
+    LALLOC_IDX_TYPE     bytes;                      // Sum of size.
+    uint8_t             count;                      // Number of cached blocks.
+    uint32_t            hits;                       // Reservations served by the cache.
+} lalloc_cache_t;
+
+/**
+   @brief number of 32 bit words of the block bitmap for a given pool size
+ */
+#define LALLOC_BITMAP_WORDS(SIZE)       ( ( LALLOC_SIZE_ROUND_UP(LALLOC_ALIGN_TYPE,SIZE) / LALLOC_ALIGNMENT + 31 ) / 32 )
+
+#if LALLOC_BLOCK_BITMAP==1
+#define LALLOC_DECLARE_BITMAP(NAME,SIZE)    uint32_t NAME##_bitmap[ LALLOC_BITMAP_WORDS(SIZE) ];
+#define LALLOC_INIT_BITMAP(NAME)            .bitmap = NAME##_bitmap,
+#else
+#define LALLOC_DECLARE_BITMAP(NAME,SIZE)
+#define LALLOC_INIT_BITMAP(NAME)
+#endif
+
+/**
+   @brief declares a static object that can be declared in any scope of execution
+ */
+#define LALLOC_DECLARE(NAME,SIZE  )                                                                   \
+lalloc_dyn_t         NAME##_Data;                                                                     \
+LALLOC_ALIGN_TYPE    NAME##_pool[LALLOC_SIZE_ROUND_UP(LALLOC_ALIGN_TYPE,SIZE) / LALLOC_ALIGNMENT ];   \
+LALLOC_DECLARE_BITMAP(NAME,SIZE)                                                                      \
+lalloc_t             LALLOC_ROM_ATTRIBUTES NAME =                                                     \
+{                                                                                                     \
+    .pool     = (uint8_t*) NAME##_pool,                                                               \
+    .size     = sizeof(NAME##_pool),                                                                  \
+    .dyn      = &(NAME##_Data),                                                                       \
+    LALLOC_INIT_BITMAP(NAME)                                                                          \
+};
+
+/** methods  ---------------------------------------------------------------------------  **/
+
+/* User interfaces */
+void lalloc_init( LALLOC_T * obj );
+void lalloc_deinit( LALLOC_T * obj );
+void lalloc_alloc( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
+void lalloc_alloc_max( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE max );
+void lalloc_alloc_revert( LALLOC_T * obj );
+bool lalloc_commit( LALLOC_T * obj, LALLOC_IDX_TYPE size );
+bool lalloc_commit_and_alloc( LALLOC_T * obj, LALLOC_IDX_TYPE size, void **addr, LALLOC_IDX_TYPE *len );
+bool lalloc_free_first( LALLOC_T * obj ) ;
+bool lalloc_free( LALLOC_T * obj, void *addr );
+bool lalloc_free_last( LALLOC_T * obj );
+LALLOC_IDX_TYPE lalloc_free_first_n( LALLOC_T * obj, LALLOC_IDX_TYPE n );
+LALLOC_IDX_TYPE lalloc_free_batch( LALLOC_T * obj, void *const addrs[], LALLOC_IDX_TYPE n );
+bool lalloc_maintain( LALLOC_T * obj, LALLOC_IDX_TYPE budget );
+void lalloc_get_first( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
+void lalloc_get_n( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE n );
+void lalloc_get_last( LALLOC_T * obj, void **addr, LALLOC_IDX_TYPE *size );
+bool lalloc_is_full( LALLOC_T * obj );
+bool lalloc_is_empty( LALLOC_T * obj );
+LALLOC_IDX_TYPE lalloc_get_free_space ( LALLOC_T * obj );
+char lalloc_dest_belongs( LALLOC_T * obj, void *addr );
+LALLOC_IDX_TYPE lalloc_get_alloc_count ( LALLOC_T * obj );
+void lalloc_iter_begin( LALLOC_T * obj, lalloc_iter_t *it );
+bool lalloc_iter_next( LALLOC_T * obj, lalloc_iter_t *it, void **addr, LALLOC_IDX_TYPE *size );
+void lalloc_iter_end( LALLOC_T * obj, lalloc_iter_t *it );
+
+/* Reservations with handles (LALLOC_ENGINE_LISTS only) */
+bool lalloc_reserve( LALLOC_T * obj, LALLOC_IDX_TYPE max, lalloc_handle_t *h );
+bool lalloc_commit_h( LALLOC_T * obj, lalloc_handle_t *h, LALLOC_IDX_TYPE size );
+void lalloc_revert_h( LALLOC_T * obj, lalloc_handle_t *h );
+
+/* Compaction (LALLOC_ENGINE_LISTS and LALLOC_COMPACTION==1 only) */
+bool lalloc_compact_step( LALLOC_T * obj, LALLOC_IDX_TYPE max_bytes, lalloc_relocate_cb_t relocate_cb );
+bool lalloc_pin( LALLOC_T * obj, void *addr );
+bool lalloc_unpin( LALLOC_T * obj, void *addr );
+
+/* Statistics (LALLOC_ENGINE_LISTS and LALLOC_STATS==1 only) */
+void lalloc_get_stats( LALLOC_T * obj, lalloc_stats_t *stats );
+
+/* Lock free status (LALLOC_ENGINE_LISTS and LALLOC_SEQLOCK==1 only) */
+void lalloc_get_status( LALLOC_T * obj, lalloc_status_t *status );
+
+/* Sharded front end (LALLOC_ENGINE_LISTS and LALLOC_SHARDED==1 only) */
+lalloc_sharded_t* lalloc_sharded_ctor( uint8_t count, LALLOC_IDX_TYPE shard_size );
+void lalloc_sharded_dtor( lalloc_sharded_t *sh );
+bool lalloc_sharded_reserve( lalloc_sharded_t *sh, LALLOC_IDX_TYPE size, lalloc_handle_t *h );
+bool lalloc_sharded_commit_h( lalloc_sharded_t *sh, lalloc_handle_t *h, LALLOC_IDX_TYPE size );
+void lalloc_sharded_revert_h( lalloc_sharded_t *sh, lalloc_handle_t *h );
+bool lalloc_sharded_free( lalloc_sharded_t *sh, void *addr );
+LALLOC_IDX_TYPE lalloc_sharded_get_alloc_count( lalloc_sharded_t *sh );
+
+/* Thread cache of small blocks (LALLOC_ENGINE_LISTS and LALLOC_THREAD_CACHE==1 only) */
+void lalloc_cache_init( lalloc_cache_t *cache, LALLOC_T * obj );
+bool lalloc_cache_reserve( lalloc_cache_t *cache, LALLOC_IDX_TYPE size, lalloc_handle_t *h );
+bool lalloc_cache_commit_h( lalloc_cache_t *cache, lalloc_handle_t *h, LALLOC_IDX_TYPE size );
+void lalloc_cache_revert_h( lalloc_cache_t *cache, lalloc_handle_t *h );
+bool lalloc_cache_free( lalloc_cache_t *cache, void *addr );
+void lalloc_cache_flush( lalloc_cache_t *cache );
+
+/* Latency profiling (LALLOC_ENGINE_LISTS and LALLOC_PROFILE==1 only) */
+void lalloc_profile_get( LALLOC_T * obj, uint8_t op, lalloc_profile_op_t *out );
+void lalloc_profile_dump( LALLOC_T * obj, lalloc_profile_dump_cb_t cb );
+void lalloc_profile_reset( LALLOC_T * obj );
+uint32_t lalloc_profile_clock( void );
+
+/* Event trace (LALLOC_ENGINE_LISTS and LALLOC_TRACE==1 only) */
+void lalloc_trace_set( LALLOC_T * obj, lalloc_trace_cb_t cb, void *ctx );
+uint8_t lalloc_trace_encode( const lalloc_trace_event_t *ev, uint8_t *buf );
+uint8_t lalloc_trace_decode( const uint8_t *buf, uint32_t len, lalloc_trace_event_t *ev );
+
+/* Critical section profiling (LALLOC_CS_PROFILE==1 only) */
+void lalloc_cs_enter( const char *fcn, uint32_t line );
+void lalloc_cs_exit( void );
+uint32_t lalloc_cs_get( lalloc_cs_site_t *sites, uint32_t max, uint32_t *dropped );
+void lalloc_cs_reset( void );
+
+/* Spinlock of the LALLOC_MUTEX_SPIN adapter */
+#if LALLOC_MUTEX==LALLOC_MUTEX_SPIN
+void lalloc_spin_lock( atomic_bool *lock );
+void lalloc_spin_unlock( atomic_bool *lock );
+#endif
+
+void* lalloc_ctor( LALLOC_IDX_TYPE size );
+void lalloc_dtor( void* this_ );
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+/* v1.00 */
+
+
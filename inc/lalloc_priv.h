@@ -1,163 +1,446 @@
-/*
-BSD 3-Clause License
-
-Copyright (c) 2024, Franco Bucafusco
-All rights reserved.
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions are met:
-
-* Redistributions of source code must retain the above copyright notice, this
-  list of conditions and the following disclaimer.
-
-* Redistributions in binary form must reproduce the above copyright notice,
-  this list of conditions and the following disclaimer in the documentation
-  and/or other materials provided with the distribution.
-
-* Neither the name of the copyright holder nor the names of its
-  contributors may be used to endorse or promote products derived from
-  this software without specific prior written permission.
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
-FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
-DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
-CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
-OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-*/
-
-/**
-   @brief This file defines private defiitions that are use by the main module of the library and also by the unit tests.
- */
-
-#pragma once
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#include "lalloc.h"
-
-#define DEPRECATED
-
-/* ==PRIVATE MACROS==CONFIGURATION===================================================================== */
-/**
-   @brief LALLOC_FREE_ANY
-          The user can define it in lalloc_config.h
-          Defines the behavior of lalloc_free.
-          1:  addr field could be ANY address of memory granted to the user with a range from  the start or the block to start + committed size.
-              Is handy when a pointer to an allocated space is passed to other layer of processing
-              and then these layers need to deallocate the space, without having the start of the original
-              allocated area.
-              Slows down the lalloc_free function.
-          0:  addr MUST be the starting area of the memory area given to the user with lalloc_alloc
- */
-#ifndef LALLOC_FREE_ANY
-#define LALLOC_FREE_ANY 0
-#endif
-
-/**
-   @brief LALLOC_ALLOW_QUEUED_FREES
-          1: lalloc_free_first and lalloc_free_last are implemeted to remove allocations in the order they were commited
-          0: The only free function available is lalloc_free where the used must provide an address.
- */
-#ifndef LALLOC_ALLOW_QUEUED_FREES
-#define LALLOC_ALLOW_QUEUED_FREES 0
-#endif
-
-/**
-   @brief   LALLOC_MIN_PAYLOAD_SIZE
-            the user can define it in lalloc_config.h in order to avoid small allocations.
- */
-#ifndef LALLOC_MIN_PAYLOAD_SIZE
-#define LALLOC_MIN_PAYLOAD_SIZE             0
-#endif
-
-#ifndef LALLOC_INLINE
-#define LALLOC_INLINE inline
-#endif
-
-/* ==PRIVATE MACROS==CONDITIONAL===================================================================== */
-#ifndef LALLOC_CRITICAL_START
-#define LALLOC_CRITICAL_START
-#endif
-
-#ifndef LALLOC_CRITICAL_END
-#define LALLOC_CRITICAL_END
-#endif
-
-/* ==PRIVATE MACROS==FUNCTIONAL====================================================================== */
-#ifdef LALLOC_TEST
-#define LALLOC_STATIC
-#else
-#define LALLOC_STATIC   static
-#endif //LALLOC_TEST
-
-#define LALLOC_NEXT_BLOCK_IDX(idx,size)               ((idx)+(size)+lalloc_b_overhead_size)
-
-#define LALLOC_BLOCK_HEADER_SIZE                      LALLOC_ALIGN_ROUND_UP( sizeof(lalloc_block_t) )
-
-#define LALLOC_BLOCK(POOL, INDEX)                     ( ( lalloc_block_t* ) &(POOL)[(INDEX)] )
-#define LALLOC_BLOCK_DATA(POOL, INDEX)                &(POOL)[((INDEX)+lalloc_b_overhead_size)]
-#define LALLOC_BLOCK_FLAGS(POOL, INDEX)               ( LALLOC_BLOCK(POOL, INDEX)->flags )
-#define LALLOC_BLOCK_SIZE(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->blk_size )
-#define LALLOC_BLOCK_NEXT(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->next )
-#define LALLOC_BLOCK_PREV(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->prev )
-#define LALLOC_BLOCK_PREVPHYS(POOL, INDEX)            ( LALLOC_BLOCK(POOL, INDEX)->prev_phys )
-
-/* operations */
-#define LALLOC_GET_BLOCK_DATA(POOL,INDEX, DATAPTR)    (DATAPTR) = LALLOC_BLOCK_DATA( (POOL), (INDEX) )
-#define LALLOC_GET_BLOCK_SIZE(POOL,INDEX, SIZE)       (SIZE) = LALLOC_BLOCK_SIZE( (POOL), (INDEX) )
-#define LALLOC_GET_BLOCK_FLAGS(POOL,INDEX, SIZE)      (SIZE) = LALLOC_BLOCK_FLAGS( (POOL), (INDEX) )
-#define LALLOC_GET_BLOCK_NEXT(POOL,INDEX, NEXT)       (NEXT) = LALLOC_BLOCK_NEXT( (POOL), (INDEX) )
-#define LALLOC_GET_BLOCK_PREV(POOL,INDEX, PREV)       (PREV) = LALLOC_BLOCK_PREV(POOL,INDEX);
-#define LALLOC_GET_BLOCK_PREVPHYS(POOL, INDEX, PREV)  (PREV) = LALLOC_BLOCK_PREVPHYS(POOL,INDEX);
-#define LALLOC_SET_BLOCK_SIZE(POOL,INDEX, SIZE)       LALLOC_BLOCK_SIZE( (POOL), (INDEX) ) = (SIZE)
-#define LALLOC_SET_BLOCK_FLAGS(POOL,INDEX, SIZE)      LALLOC_BLOCK_FLAGS( (POOL), (INDEX) ) = (SIZE)
-#define LALLOC_SET_BLOCK_NEXT(POOL,INDEX, NEXT)       LALLOC_BLOCK_NEXT( (POOL), (INDEX) ) = (NEXT)
-#define LALLOC_SET_BLOCK_PREV(POOL,INDEX, PREV)       LALLOC_BLOCK_PREV( (POOL), (INDEX) ) = (PREV)
-#define LALLOC_SET_BLOCK_PREVPHYS(POOL, INDEX, PREV)  LALLOC_BLOCK_PREVPHYS(POOL,INDEX) = (PREV)
-
-/**
-   @brief structure for each block's block
- */
-#pragma pack(1)
-typedef struct
-{
-    LALLOC_IDX_TYPE prev;       /* Logical index to the previous block in the list     */
-    LALLOC_IDX_TYPE next;       /* Logical index to the next block in the list         */
-    LALLOC_IDX_TYPE prev_phys;  /* Physical index to the previous block in the pool    */
-    LALLOC_IDX_TYPE blk_size;   /* playload block's size                               */
-#if LALLOC_ALIGNMENT==1
-    LALLOC_IDX_TYPE flags;
-#endif
-} lalloc_block_t;
-#pragma pack()
-
-/**
-   @brief   LALLOC_FREE_BLOCK_MASK
-            defines the bit within the blk_size field of lalloc_block_t that will mark the block as free
-            NOTE: this is done for avoiding move through the free list when joining free blocks.
- */
-#define LALLOC_FREE_BLOCK_MASK       1
-#define LALLOC_USED_BLOCK_MASK       0
-
-/* private functions exposed to tests */
-void _block_list_add_before ( uint8_t* pool, LALLOC_IDX_TYPE* list_idx, LALLOC_IDX_TYPE block_idx );
-void _block_set_data ( uint8_t* pool, LALLOC_IDX_TYPE  block_idx, uint8_t* addr, LALLOC_IDX_TYPE size );
-void _block_list_add_sorted ( uint8_t* pool, LALLOC_IDX_TYPE* list_idx, LALLOC_IDX_TYPE block_idx );
-void _block_list_get_n ( uint8_t* pool, LALLOC_IDX_TYPE list_idx,  LALLOC_IDX_TYPE n, uint8_t** addr, LALLOC_IDX_TYPE* size );
-LALLOC_IDX_TYPE _block_list_remove ( uint8_t* pool, LALLOC_IDX_TYPE* block_idx );
-void _block_set( uint8_t* pool, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE size, LALLOC_IDX_TYPE next, LALLOC_IDX_TYPE prev, LALLOC_IDX_TYPE flags );
-LALLOC_IDX_TYPE _block_remove( uint8_t *pool, LALLOC_IDX_TYPE *idx );
-LALLOC_INLINE LALLOC_IDX_TYPE _block_get_next_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
-
-#ifdef __cplusplus
-}
-#endif
-
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+   @brief This file defines private defiitions that are use by the main module of the library and also by the unit tests.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lalloc.h"
+
+#define DEPRECATED
+
+/* ==PRIVATE MACROS==CONFIGURATION===================================================================== */
+/**
+   @brief LALLOC_FREE_ANY
+          The user can define it in lalloc_config.h
+          Defines the behavior of lalloc_free.
+          1:  addr field could be ANY address of memory granted to the user with a range from  the start or the block to start + committed size.
+              Is handy when a pointer to an allocated space is passed to other layer of processing
+              and then these layers need to deallocate the space, without having the start of the original
+              allocated area.
+              Slows down the lalloc_free function.
+          0:  addr MUST be the starting area of the memory area given to the user with lalloc_alloc
+ */
+#ifndef LALLOC_FREE_ANY
+#define LALLOC_FREE_ANY 0
+#endif
+
+/**
+   @brief LALLOC_ALLOW_QUEUED_FREES
+          1: lalloc_free_first and lalloc_free_last are implemeted to remove allocations in the order they were commited
+          0: The only free function available is lalloc_free where the used must provide an address.
+ */
+#ifndef LALLOC_ALLOW_QUEUED_FREES
+#define LALLOC_ALLOW_QUEUED_FREES 0
+#endif
+
+#if LALLOC_ENGINE == LALLOC_ENGINE_BIP && LALLOC_SPSC == 1
+#error "LALLOC_SPSC: it is not supported by LALLOC_ENGINE_BIP"
+#endif
+
+/**
+   @brief LALLOC_ATOMIC_LOAD, LALLOC_ATOMIC_STORE
+          Acquire load and release store of a LALLOC_IDX_TYPE variable, used with LALLOC_SPSC==1 and LALLOC_DEFERRED_FREE==1.
+          By default they are the compiler builtins that follow the C11 memory model.
+          The user can define them in lalloc_config.h (e.g. a plain access with a memory barrier on single core MCUs)
+ */
+#if LALLOC_SPSC == 1
+
+#if LALLOC_ALLOW_QUEUED_FREES == 0
+#error "LALLOC_SPSC: it requires LALLOC_ALLOW_QUEUED_FREES==1"
+#endif
+
+#if LALLOC_ALLOC_RING_SIZE == 0 || ( LALLOC_ALLOC_RING_SIZE & ( LALLOC_ALLOC_RING_SIZE - 1 ) ) != 0
+#error "LALLOC_SPSC: LALLOC_ALLOC_RING_SIZE must be a power of two"
+#endif
+
+#if defined(LALLOC_IDX_BITS) && LALLOC_ALLOC_RING_SIZE > ( 1UL << ( LALLOC_IDX_BITS - 1 ) )
+#error "LALLOC_SPSC: LALLOC_ALLOC_RING_SIZE is too big for LALLOC_IDX_TYPE"
+#endif
+
+#endif
+
+/* the ring positions and the number of allocated blocks are LALLOC_IDX_TYPE */
+#if defined(LALLOC_IDX_BITS) && LALLOC_ALLOC_RING_SIZE > ( ( 1ULL << LALLOC_IDX_BITS ) - 1 )
+#error "LALLOC_ALLOC_RING_SIZE: it is too big for LALLOC_IDX_TYPE"
+#endif
+
+#if LALLOC_LAZY_COALESCING == 1 && LALLOC_SPSC == 1
+#error "LALLOC_LAZY_COALESCING: lalloc_maintain would race with the producer in LALLOC_SPSC mode"
+#endif
+
+#if LALLOC_STATS == 1 && LALLOC_ENGINE != LALLOC_ENGINE_LISTS
+#error "LALLOC_STATS: it is only supported by LALLOC_ENGINE_LISTS"
+#endif
+
+#if LALLOC_PROFILE == 1 && LALLOC_ENGINE != LALLOC_ENGINE_LISTS
+#error "LALLOC_PROFILE: it is only supported by LALLOC_ENGINE_LISTS"
+#endif
+
+#if LALLOC_MUTEX != LALLOC_MUTEX_NONE && LALLOC_THREAD_SAFE != 1
+#error "LALLOC_MUTEX: lalloc_config.h must not define LALLOC_CRITICAL_START/END nor other mutex primitives"
+#endif
+
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN && ( LALLOC_SPIN_BACKOFF_MAX < 1 || LALLOC_SPIN_BACKOFF_MAX > 0x10000 )
+#error "LALLOC_SPIN_BACKOFF_MAX: it must be between 1 and 0x10000"
+#endif
+
+#if LALLOC_CS_PROFILE == 1 && LALLOC_THREAD_SAFE == 1
+#error "LALLOC_CS_PROFILE: it needs a critical section shared by all the instances, not a mutex per instance"
+#endif
+
+#if LALLOC_TRACE == 1 && ( LALLOC_ENGINE != LALLOC_ENGINE_LISTS || LALLOC_SPSC == 1 )
+#error "LALLOC_TRACE: it is only supported by LALLOC_ENGINE_LISTS, without LALLOC_SPSC"
+#endif
+
+#if LALLOC_SEQLOCK == 1 && ( LALLOC_ENGINE != LALLOC_ENGINE_LISTS || LALLOC_SPSC == 1 )
+#error "LALLOC_SEQLOCK: it is only supported by LALLOC_ENGINE_LISTS, without LALLOC_SPSC"
+#endif
+
+#if LALLOC_SHARDED == 1 && ( LALLOC_ENGINE != LALLOC_ENGINE_LISTS || LALLOC_SPSC == 1 )
+#error "LALLOC_SHARDED: it is only supported by LALLOC_ENGINE_LISTS, without LALLOC_SPSC"
+#endif
+
+#if LALLOC_THREAD_CACHE == 1 && ( LALLOC_ENGINE != LALLOC_ENGINE_LISTS || LALLOC_SPSC == 1 || LALLOC_COMPACTION == 1 )
+#error "LALLOC_THREAD_CACHE: it is only supported by LALLOC_ENGINE_LISTS, without LALLOC_SPSC nor LALLOC_COMPACTION"
+#endif
+
+#if LALLOC_THREAD_CACHE == 1 && LALLOC_ALLOW_QUEUED_FREES == 1
+#error "LALLOC_THREAD_CACHE: lalloc_free_first would free the blocks held by a cache (LALLOC_ALLOW_QUEUED_FREES==0)"
+#endif
+
+#if LALLOC_THREAD_CACHE == 1 && ( LALLOC_CACHE_SLOTS < 1 || LALLOC_CACHE_SLOTS > 255 )
+#error "LALLOC_CACHE_SLOTS: it must be between 1 and 255"
+#endif
+
+#if LALLOC_COMPACTION == 1 && LALLOC_SPSC == 1
+#error "LALLOC_COMPACTION: the consumer reads the blocks without the critical section in LALLOC_SPSC mode"
+#endif
+
+#if LALLOC_DEFERRED_FREE == 1
+
+#if LALLOC_ENGINE != LALLOC_ENGINE_LISTS || LALLOC_SPSC == 1
+#error "LALLOC_DEFERRED_FREE: it is only supported by LALLOC_ENGINE_LISTS, without LALLOC_SPSC"
+#endif
+
+#if LALLOC_FREE_ANY == 1
+#error "LALLOC_DEFERRED_FREE: lalloc_free must receive the address given by lalloc_alloc (LALLOC_FREE_ANY==0)"
+#endif
+
+/* the link of the queue is kept in the payload of the freed blocks */
+#ifndef LALLOC_MIN_PAYLOAD_SIZE
+#if defined(LALLOC_IDX_BITS)
+#define LALLOC_MIN_PAYLOAD_SIZE             ( LALLOC_IDX_BITS / 8 )
+#else
+#error "LALLOC_DEFERRED_FREE: LALLOC_MIN_PAYLOAD_SIZE must be defined along with LALLOC_IDX_TYPE"
+#endif
+#elif defined(LALLOC_IDX_BITS) && LALLOC_MIN_PAYLOAD_SIZE < ( LALLOC_IDX_BITS / 8 )
+#error "LALLOC_DEFERRED_FREE: LALLOC_MIN_PAYLOAD_SIZE must hold a LALLOC_IDX_TYPE"
+#endif
+
+/**
+   @brief LALLOC_ATOMIC_CAS, LALLOC_ATOMIC_XCHG
+          Compare and swap (release on success) and exchange (acquire) of a LALLOC_IDX_TYPE variable, used with
+          LALLOC_DEFERRED_FREE==1. LALLOC_ATOMIC_CAS is also used on the uint8_t queued mark of a block, and it
+          updates *EXPECTED with the current value when it fails.
+ */
+#ifndef LALLOC_ATOMIC_CAS
+#define LALLOC_ATOMIC_CAS(PTR, EXPECTED, VAL)   __atomic_compare_exchange_n( ( PTR ), ( EXPECTED ), ( VAL ), true, __ATOMIC_RELEASE, __ATOMIC_RELAXED )
+#endif
+
+#ifndef LALLOC_ATOMIC_XCHG
+#define LALLOC_ATOMIC_XCHG(PTR, VAL)        __atomic_exchange_n( ( PTR ), ( VAL ), __ATOMIC_ACQUIRE )
+#endif
+
+#endif
+
+#if LALLOC_SPSC == 1 || LALLOC_DEFERRED_FREE == 1
+
+#ifndef LALLOC_ATOMIC_LOAD
+#define LALLOC_ATOMIC_LOAD(PTR)             __atomic_load_n( ( PTR ), __ATOMIC_ACQUIRE )
+#endif
+
+#ifndef LALLOC_ATOMIC_STORE
+#define LALLOC_ATOMIC_STORE(PTR, VAL)       __atomic_store_n( ( PTR ), ( VAL ), __ATOMIC_RELEASE )
+#endif
+
+#endif
+
+/**
+   @brief LALLOC_ATOMIC_FENCE_ACQ, LALLOC_ATOMIC_FENCE_REL
+          Acquire and release fences around the copies of the status with LALLOC_SEQLOCK==1. The sequence counter is
+          a volatile uint32_t, read and written in one access.
+ */
+#if LALLOC_SEQLOCK == 1
+
+#ifndef LALLOC_ATOMIC_FENCE_ACQ
+#define LALLOC_ATOMIC_FENCE_ACQ()           __atomic_thread_fence( __ATOMIC_ACQUIRE )
+#endif
+
+#ifndef LALLOC_ATOMIC_FENCE_REL
+#define LALLOC_ATOMIC_FENCE_REL()           __atomic_thread_fence( __ATOMIC_RELEASE )
+#endif
+
+#endif
+
+/**
+   @brief   LALLOC_MIN_PAYLOAD_SIZE
+            the user can define it in lalloc_config.h in order to avoid small allocations.
+ */
+#ifndef LALLOC_MIN_PAYLOAD_SIZE
+#define LALLOC_MIN_PAYLOAD_SIZE             0
+#endif
+
+#ifndef LALLOC_INLINE
+#define LALLOC_INLINE inline
+#endif
+
+/**
+   @brief   LALLOC_FLS
+            returns the index of the most significant bit set of a non zero 32 bit value.
+            The user can define it in lalloc_config.h in order to use a specific instruction of the platform (e.g. CLZ)
+ */
+#ifndef LALLOC_FLS
+#if defined(__GNUC__) && ( __SIZEOF_INT__ == 4 )
+#define LALLOC_FLS(X)                       ( 31 - __builtin_clz( ( uint32_t )( X ) ) )
+#else
+#define LALLOC_FLS(X)                       _lalloc_fls( ( uint32_t )( X ) )
+#endif
+#endif
+
+/**
+   @brief   LALLOC_PROFILE_CYCLES()
+            free running 32 bit counter used to time the calls with LALLOC_PROFILE==1, the critical sections with
+            LALLOC_CS_PROFILE==1 and the events with LALLOC_TRACE==1.
+            The user can define it in lalloc_config.h. By default it is:
+            - x86: the time stamp counter (rdtsc).
+            - Cortex-M3/M4/M7/M33: DWT->CYCCNT. The application must enable it (TRCENA in CoreDebug->DEMCR and
+              CYCCNTENA in DWT->CTRL).
+            - other POSIX platforms: lalloc_profile_clock, in nanoseconds.
+ */
+#if ( LALLOC_PROFILE == 1 || LALLOC_CS_PROFILE == 1 || LALLOC_TRACE == 1 ) && !defined(LALLOC_PROFILE_CYCLES)
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define LALLOC_PROFILE_CYCLES()             ( ( uint32_t )__builtin_ia32_rdtsc() )
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define LALLOC_PROFILE_CYCLES()             ( *( volatile uint32_t * )0xE0001004UL )
+#elif defined(__unix__) || defined(__APPLE__)
+#define LALLOC_PROFILE_CYCLES()             lalloc_profile_clock()
+#else
+#error "LALLOC_PROFILE_CYCLES: it must be defined in lalloc_config.h for this platform"
+#endif
+#endif
+
+/**
+   @brief   LALLOC_SPIN_PAUSE(), LALLOC_SPIN_YIELD()
+            hints of the LALLOC_MUTEX_SPIN waiting loop. The user can define them in lalloc_config.h. By default:
+            - LALLOC_SPIN_PAUSE: pause on x86, yield on ARM, nothing elsewhere.
+            - LALLOC_SPIN_YIELD: sched_yield on POSIX platforms, nothing elsewhere (the thread keeps spinning).
+ */
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN && !defined(LALLOC_SPIN_PAUSE)
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define LALLOC_SPIN_PAUSE()                 __builtin_ia32_pause()
+#elif defined(__GNUC__) && ( defined(__aarch64__) || defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) )
+#define LALLOC_SPIN_PAUSE()                 __asm__ volatile( "yield" )
+#else
+#define LALLOC_SPIN_PAUSE()
+#endif
+#endif
+
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN && !defined(LALLOC_SPIN_YIELD)
+#if defined(__unix__) || defined(__APPLE__)
+#define LALLOC_SPIN_YIELD()                 sched_yield()
+#else
+#define LALLOC_SPIN_YIELD()
+#endif
+#endif
+
+/**
+   @brief   LALLOC_SHARD_HINT()
+            number that picks the shard of the caller with LALLOC_SHARDED==1, modulo the number of shards. The user can
+            define it in lalloc_config.h (e.g. sched_getcpu() on Linux, or the core id on a multicore MCU). By default
+            each thread gets the next number the first time it reserves (a thread local variable).
+ */
+#if LALLOC_SHARDED == 1 && !defined(LALLOC_SHARD_HINT)
+#if defined(__GNUC__)
+#define LALLOC_SHARD_HINT()                 _sharded_thread_hint()
+#else
+#error "LALLOC_SHARD_HINT: it must be defined in lalloc_config.h for this compiler"
+#endif
+#endif
+
+/* ==PRIVATE MACROS==CONDITIONAL===================================================================== */
+#ifndef LALLOC_CRITICAL_INIT
+#define LALLOC_CRITICAL_INIT
+#endif
+
+#ifndef LALLOC_CRITICAL_DEINIT
+#define LALLOC_CRITICAL_DEINIT
+#endif
+
+#ifndef LALLOC_CRITICAL_START
+#define LALLOC_CRITICAL_START
+#endif
+
+#ifndef LALLOC_CRITICAL_END
+#define LALLOC_CRITICAL_END
+#endif
+
+/**
+   @brief   LALLOC_SIDE_CRITICAL_START, LALLOC_SIDE_CRITICAL_END
+            critical section of the functions owned by one side with LALLOC_SPSC==1. There, each side works on its own
+            data, so they are empty.
+ */
+#if LALLOC_SPSC == 1
+#define LALLOC_SIDE_CRITICAL_START
+#define LALLOC_SIDE_CRITICAL_END
+#else
+#define LALLOC_SIDE_CRITICAL_START          LALLOC_CRITICAL_START
+#define LALLOC_SIDE_CRITICAL_END            LALLOC_CRITICAL_END
+#endif
+
+/* ==PRIVATE MACROS==FUNCTIONAL====================================================================== */
+#ifdef LALLOC_TEST
+#define LALLOC_STATIC
+#else
+#define LALLOC_STATIC   static
+#endif //LALLOC_TEST
+
+#define LALLOC_NEXT_BLOCK_IDX(idx,size)               ((idx)+(size)+lalloc_b_overhead_size)
+
+#define LALLOC_BLOCK_HEADER_SIZE                      LALLOC_ALIGN_ROUND_UP( sizeof(lalloc_block_t) )
+
+#define LALLOC_BLOCK(POOL, INDEX)                     ( ( lalloc_block_t* ) &(POOL)[(INDEX)] )
+#define LALLOC_BLOCK_DATA(POOL, INDEX)                &(POOL)[((INDEX)+lalloc_b_overhead_size)]
+#define LALLOC_BLOCK_FLAGS(POOL, INDEX)               ( LALLOC_BLOCK(POOL, INDEX)->flags )
+#define LALLOC_BLOCK_SIZE(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->blk_size )
+#define LALLOC_BLOCK_NEXT(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->next )
+#define LALLOC_BLOCK_PREV(POOL, INDEX)                ( LALLOC_BLOCK(POOL, INDEX)->prev )
+#define LALLOC_BLOCK_PREVPHYS(POOL, INDEX)            ( LALLOC_BLOCK(POOL, INDEX)->prev_phys )
+#define LALLOC_BLOCK_QUEUED(POOL, INDEX)              ( LALLOC_BLOCK(POOL, INDEX)->queued )
+
+/* block bitmap */
+#if LALLOC_BLOCK_BITMAP==1
+#define LALLOC_BITMAP_SET(OBJ, INDEX)                 _bitmap_set( (OBJ), (INDEX) )
+#define LALLOC_BITMAP_CLEAR(OBJ, INDEX)               _bitmap_clear( (OBJ), (INDEX) )
+#else
+#define LALLOC_BITMAP_SET(OBJ, INDEX)
+#define LALLOC_BITMAP_CLEAR(OBJ, INDEX)
+#endif
+
+/* operations */
+#define LALLOC_GET_BLOCK_DATA(POOL,INDEX, DATAPTR)    (DATAPTR) = LALLOC_BLOCK_DATA( (POOL), (INDEX) )
+#define LALLOC_GET_BLOCK_SIZE(POOL,INDEX, SIZE)       (SIZE) = LALLOC_BLOCK_SIZE( (POOL), (INDEX) )
+#define LALLOC_GET_BLOCK_FLAGS(POOL,INDEX, SIZE)      (SIZE) = LALLOC_BLOCK_FLAGS( (POOL), (INDEX) )
+#define LALLOC_GET_BLOCK_NEXT(POOL,INDEX, NEXT)       (NEXT) = LALLOC_BLOCK_NEXT( (POOL), (INDEX) )
+#define LALLOC_GET_BLOCK_PREV(POOL,INDEX, PREV)       (PREV) = LALLOC_BLOCK_PREV(POOL,INDEX);
+#define LALLOC_GET_BLOCK_PREVPHYS(POOL, INDEX, PREV)  (PREV) = LALLOC_BLOCK_PREVPHYS(POOL,INDEX);
+#define LALLOC_SET_BLOCK_SIZE(POOL,INDEX, SIZE)       LALLOC_BLOCK_SIZE( (POOL), (INDEX) ) = (SIZE)
+#define LALLOC_SET_BLOCK_FLAGS(POOL,INDEX, SIZE)      LALLOC_BLOCK_FLAGS( (POOL), (INDEX) ) = (SIZE)
+#define LALLOC_SET_BLOCK_NEXT(POOL,INDEX, NEXT)       LALLOC_BLOCK_NEXT( (POOL), (INDEX) ) = (NEXT)
+#define LALLOC_SET_BLOCK_PREV(POOL,INDEX, PREV)       LALLOC_BLOCK_PREV( (POOL), (INDEX) ) = (PREV)
+#define LALLOC_SET_BLOCK_PREVPHYS(POOL, INDEX, PREV)  LALLOC_BLOCK_PREVPHYS(POOL,INDEX) = (PREV)
+
+/**
+   @brief structure for each block's block
+ */
+#pragma pack(1)
+typedef struct
+{
+    LALLOC_IDX_TYPE prev;       /* Logical index to the previous block in the list     */
+    LALLOC_IDX_TYPE next;       /* Logical index to the next block in the list         */
+    LALLOC_IDX_TYPE prev_phys;  /* Physical index to the previous block in the pool    */
+    LALLOC_IDX_TYPE blk_size;   /* playload block's size                               */
+#if LALLOC_ALIGNMENT==1
+    LALLOC_IDX_TYPE flags;
+#endif
+#if LALLOC_DEFERRED_FREE==1
+    uint8_t         queued;     /* 1 from lalloc_free until the block is committed again */
+#endif
+} lalloc_block_t;
+#pragma pack()
+
+/**
+   @brief structure for each frame's header of LALLOC_ENGINE_BIP
+ */
+#pragma pack(1)
+typedef struct
+{
+    LALLOC_IDX_TYPE size;       /* playload frame's size                               */
+} lalloc_frame_t;
+#pragma pack()
+
+#define LALLOC_FRAME_HEADER_SIZE                      LALLOC_ALIGN_ROUND_UP( sizeof(lalloc_frame_t) )
+#define LALLOC_FRAME_SIZE(POOL, INDEX)                ( ( ( lalloc_frame_t* ) &(POOL)[(INDEX)] )->size )
+
+/**
+   @brief   LALLOC_FREE_BLOCK_MASK
+            defines the bit within the blk_size field of lalloc_block_t that will mark the block as free
+            NOTE: this is done for avoiding move through the free list when joining free blocks.
+ */
+#define LALLOC_FREE_BLOCK_MASK       1
+#define LALLOC_USED_BLOCK_MASK       0
+
+/* private functions exposed to tests */
+void _block_list_add_before ( uint8_t* pool, LALLOC_IDX_TYPE* list_idx, LALLOC_IDX_TYPE block_idx );
+void _block_set_data ( uint8_t* pool, LALLOC_IDX_TYPE  block_idx, uint8_t* addr, LALLOC_IDX_TYPE size );
+void _block_list_add_sorted ( uint8_t* pool, LALLOC_IDX_TYPE* list_idx, LALLOC_IDX_TYPE block_idx );
+void _block_list_get_n ( uint8_t* pool, LALLOC_IDX_TYPE list_idx,  LALLOC_IDX_TYPE n, uint8_t** addr, LALLOC_IDX_TYPE* size );
+LALLOC_IDX_TYPE _block_list_remove ( uint8_t* pool, LALLOC_IDX_TYPE* block_idx );
+void _block_set( uint8_t* pool, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE size, LALLOC_IDX_TYPE next, LALLOC_IDX_TYPE prev, LALLOC_IDX_TYPE flags );
+LALLOC_IDX_TYPE _block_remove( uint8_t *pool, LALLOC_IDX_TYPE *idx );
+LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+LALLOC_IDX_TYPE _block_get_next_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+uint8_t _lalloc_fls( uint32_t value );
+void _flist_add( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx );
+LALLOC_IDX_TYPE _flist_remove( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx );
+LALLOC_IDX_TYPE _flist_next( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx );
+LALLOC_IDX_TYPE _flist_largest( LALLOC_T *obj );
+#if LALLOC_BLOCK_BITMAP == 1
+void _bitmap_set( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx );
+void _bitmap_clear( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx );
+LALLOC_IDX_TYPE _bitmap_find_block( LALLOC_T *obj, LALLOC_IDX_TYPE idx );
+#endif
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+void _tlsf_mapping( LALLOC_IDX_TYPE size, uint8_t *fl, uint8_t *sl );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 /* v1.00 */
\ No newline at end of file
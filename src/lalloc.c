@@ -1,1052 +1,4460 @@
-/*
-BSD 3-Clause License
-
-Copyright (c) 2024, Franco Bucafusco
-All rights reserved.
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions are met:
-
-* Redistributions of source code must retain the above copyright notice, this
-  list of conditions and the following disclaimer.
-
-* Redistributions in binary form must reproduce the above copyright notice,
-  this list of conditions and the following disclaimer in the documentation
-  and/or other materials provided with the distribution.
-
-* Neither the name of the copyright holder nor the names of its
-  contributors may be used to endorse or promote products derived from
-  this software without specific prior written permission.
-
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
-FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
-DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
-CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
-OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-*/
-
-#include <stdlib.h>
-#include "lalloc.h"
-#include "lalloc_priv.h"
-
-/* CONSTANTS ============================================================================================================ */
-LALLOC_STATIC const LALLOC_IDX_TYPE lalloc_alignment = LALLOC_ALIGNMENT;
-LALLOC_STATIC const LALLOC_IDX_TYPE lalloc_invalid_index = LALLOC_IDX_INVALID;
-LALLOC_STATIC const LALLOC_IDX_TYPE lalloc_b_overhead_size = LALLOC_BLOCK_HEADER_SIZE;
-
-/* ==PRIVATE METHODS================================================================================= */
-
-/**
-    @brief sets the block information at the selected pool and block index
-
-    @param pool
-    @param idx
-    @param size
-    @param next
-    @param prev
-    @param flags
- */
-LALLOC_INLINE void _block_set( uint8_t *pool, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE size, LALLOC_IDX_TYPE next, LALLOC_IDX_TYPE prev, LALLOC_IDX_TYPE flags )
-{
-    LALLOC_SET_BLOCK_NEXT( pool, idx, next );
-    LALLOC_SET_BLOCK_PREV( pool, idx, prev );
-    LALLOC_SET_BLOCK_PREVPHYS( pool, idx, LALLOC_IDX_INVALID );
-    LALLOC_SET_BLOCK_SIZE( pool, idx, size | flags );
-}
-
-/**
-    @brief Gets the size of a block based on its index in the pool.
-    @param pool
-    @param block_idx
-    @return LALLOC_IDX_TYPE size of the block
- */
-LALLOC_INLINE LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
-{
-    LALLOC_IDX_TYPE size;
-    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
-
-#if LALLOC_ALIGNMENT == 1
-#else
-    /* clear the control flags */
-    size &= ~LALLOC_FREE_BLOCK_MASK;
-#endif
-
-    return size;
-}
-
-/**
-    @brief Tells if a block is free or not based on its index in the pool.
-
-    @param pool
-    @param block_idx
-    @return bool
- */
-LALLOC_INLINE bool _block_is_free( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
-{
-#if LALLOC_ALIGNMENT == 1
-    LALLOC_IDX_TYPE flags;
-    LALLOC_GET_BLOCK_FLAGS( pool, block_idx, flags );
-    return flags & LALLOC_FREE_BLOCK_MASK;
-#else
-    LALLOC_IDX_TYPE size;
-    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
-    return size & LALLOC_FREE_BLOCK_MASK;
-#endif
-}
-
-/**
-    @brief  overwrites the size of a block.
-            If the built version has the FREE_BLOCK_MASK flag, it will overwriten.
-            CALL _block_set_flags after
-
-    @param pool
-    @param block_idx
-    @param size
- */
-LALLOC_INLINE void _block_set_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx, LALLOC_IDX_TYPE size )
-{
-    LALLOC_SET_BLOCK_SIZE( pool, block_idx, size );
-}
-
-LALLOC_INLINE LALLOC_IDX_TYPE _block_get_prev_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
-{
-    LALLOC_IDX_TYPE prev_phy;
-    LALLOC_GET_BLOCK_PREVPHYS( pool, block_idx, prev_phy );
-    return prev_phy;
-}
-
-LALLOC_INLINE LALLOC_IDX_TYPE _block_get_next_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
-{
-    return LALLOC_NEXT_BLOCK_IDX( block_idx, _block_get_size( pool, block_idx ) );
-}
-
-/**
-    @brief  Overwrites the flags of a block.
-            This is a private lalloc operation.
-            NOT THREAD SAFE
-
-    @param pool
-    @param block_idx
-    @param newflags
-    @return LALLOC_INLINE
- */
-LALLOC_INLINE void _block_set_flags( uint8_t *pool, LALLOC_IDX_TYPE block_idx, LALLOC_IDX_TYPE newflags )
-{
-#if LALLOC_ALIGNMENT == 1
-    LALLOC_SET_BLOCK_FLAGS( pool, block_idx, newflags );
-#else
-    LALLOC_IDX_TYPE size;
-    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
-    size &= ~LALLOC_FREE_BLOCK_MASK;
-    LALLOC_SET_BLOCK_SIZE( pool, block_idx, size | newflags );
-#endif
-}
-
-/**
-   @brief  gets the block data
-
-   @param pool          memory pool
-   @param block_idx     block index of the block
-   @param addr          address of the block
-   @param size          size of the block
- */
-void _block_get_data( uint8_t *pool, LALLOC_IDX_TYPE block_idx, uint8_t **addr, LALLOC_IDX_TYPE *size )
-{
-    LALLOC_GET_BLOCK_DATA( pool, block_idx, *addr );
-    *size = _block_get_size( pool, block_idx );
-}
-
-/**
-   @brief Removes the block from one double linked list and updates the original block pointer to the next.
-          e.g
-          *idx points to a block of a list with only one element. *ids becomes LALLOC_IDX_INVALID
-          *idx points to a block of a list with more than one element. *ids becomes next block of the removed block
-
-          Externally the user must ensure that the block belongs to a well configured list.
-
-   @param pool
-   @param idx               reference to the index of the block to be removed
-                            will be updated with the next block's index or to invalid if the list is empty after the removal
-   @return LALLOC_IDX_TYPE  the original value of *idx, which now is orphan
- */
-LALLOC_IDX_TYPE _block_remove( uint8_t *pool, LALLOC_IDX_TYPE *idx )
-{
-    LALLOC_IDX_TYPE next;
-    LALLOC_IDX_TYPE prev;
-
-    LALLOC_ASSERT( ( *idx ) != LALLOC_IDX_INVALID );
-
-    LALLOC_GET_BLOCK_NEXT( pool, ( *idx ), next );
-    LALLOC_GET_BLOCK_PREV( pool, ( *idx ), prev );
-
-    /* backup */
-    LALLOC_IDX_TYPE orphan_idx = ( *idx );
-
-    if ( ( *idx ) == next ) // idx is an index for a block beloning to a list of one element
-    {
-        /* there is only one element in the list. */
-        LALLOC_ASSERT( ( *idx ) == prev ); // If there is only one, this must be true
-
-        /* mark the list as empty */
-        ( *idx ) = LALLOC_IDX_INVALID;
-    }
-    else
-    {
-        /* the list has more than one element */
-        LALLOC_SET_BLOCK_NEXT( pool, prev, next );
-        LALLOC_SET_BLOCK_PREV( pool, next, prev );
-
-        /* mark the list as the next block  */
-        ( *idx ) = next;
-    }
-
-    return orphan_idx;
-}
-
-/**
-     @brief find a block in a list by pool index.
-            idx must target ANY byte belonging to tha payload of a list's block.
-
-            If found, it returns the index block that contains the index provided (should it be the same? NO)
-            If not found, it return LALLOC_IDX_INVALID
-
-            NOT THREAD SAFE
-
-    @param pool
-    @param list
-    @param idx
-    @return LALLOC_IDX_TYPE
-*/
-LALLOC_IDX_TYPE _block_list_find_by_idx( uint8_t *pool, LALLOC_IDX_TYPE list, LALLOC_IDX_TYPE idx )
-{
-    LALLOC_IDX_TYPE next = list;
-
-    while ( 1 )
-    {
-        /* Calculates the condition for ending the loop:
-           The condition is "idx is bigger that the begining of the block && idx is less that its top boundry") */
-        LALLOC_IDX_TYPE condition = ( idx >= next );
-
-        if ( condition )
-        {
-            /* get the block size in order to compute the top boundry */
-            condition = ( idx < _block_get_next_phy( pool, next ) );
-        }
-
-        if ( condition )
-        {
-            /* found */
-            return next;
-        }
-
-        LALLOC_GET_BLOCK_NEXT( pool, next, next );
-
-        if ( next == list )
-        {
-            /* start again not found */
-            return LALLOC_IDX_INVALID;
-        }
-    }
-}
-
-/**
-   @brief   finds a block in a NON EMPTY list by payload reference.
-            returns the found relative block index or LALLOC_IDX_INVALID if not found
-            If found, it returns the index block whos payload contains the provided reference
-
-            if LALLOC_FREE_ANY==1 will finds a block within the list whose address is wihin the user area of the block.
-            if LALLOC_FREE_ANY==0 will return the block from the list, whose address matches the first byte of the user area of the block.
-            If not found, it returns LALLOC_IDX_INVALID
-            NOT THREAD SAFE
-
-   @param pool
-   @param list_idx
-   @param addr          ANY address that must point somewhere in the pool
-   @return LALLOC_IDX_TYPE
- */
-LALLOC_IDX_TYPE _block_list_find_by_ref( uint8_t *pool, LALLOC_IDX_TYPE list, uint8_t *addr )
-{
-    LALLOC_IDX_TYPE rv;
-
-    /* relativize addr to the pool.  */
-    LALLOC_IDX_TYPE idx = addr - pool;
-
-#if LALLOC_FREE_ANY == 1
-    rv = _block_list_find_by_idx( pool, list, idx );
-#else
-
-    /* addr is the user addres, that is shifted from the block address in lalloc_b_overhead_size bytes */
-    idx -= lalloc_b_overhead_size;
-
-    /* is the list the allocated list or the free list ? */
-    bool is_list_free = _block_is_free( pool, list );
-    bool is_block_free = _block_is_free( pool, idx );
-
-    if ( is_list_free == is_block_free )
-    {
-        // belongs to the same list, found
-        rv = idx;
-    }
-    else
-    {
-        // belongs to different list, not found
-        rv = LALLOC_IDX_INVALID;
-    }
-#endif
-
-    return rv;
-}
-
-/**
-   @brief   Obtains the nth element in the list
-
-   @param pool
-   @param list
-   @param n
-   @param addr
-   @param size
- */
-void _block_list_get_n( uint8_t *pool, LALLOC_IDX_TYPE list, LALLOC_IDX_TYPE n, uint8_t **addr, LALLOC_IDX_TYPE *size )
-{
-    /* TODO, very similtar to _block_list_find_by_idx but with a different search criteria.
-             Could be improved with lambdas or callbacks  */
-
-    LALLOC_IDX_TYPE i = 0;
-
-    LALLOC_IDX_TYPE next = list;
-
-    if ( LALLOC_IDX_INVALID != list )
-    {
-        /* it only searches when the list is valid */
-        while ( 1 )
-        {
-            if ( i == n )
-            {
-                /* found */
-                _block_get_data( pool, next, addr, size );
-                return;
-            }
-
-            LALLOC_GET_BLOCK_NEXT( pool, next, next );
-
-            if ( next == list )
-            {
-                /* list wrap around: not found */
-                break;
-            }
-
-            i++;
-        }
-    }
-
-    *addr = NULL;
-    *size = 0;
-
-    return;
-}
-
-/**
-   @brief   adds a block at the begining of the list.
-            block_idx: index of the block to add
-            list_idx:  reference to a list
-            note: the block must be preconfigured with the correct size and flags
-
-   @param pool
-   @param list_idx
-   @param block_idx
-*/
-void _block_list_add_before( uint8_t *pool, LALLOC_IDX_TYPE *list_idx, LALLOC_IDX_TYPE block_idx )
-{
-    LALLOC_IDX_TYPE prev;
-    LALLOC_ASSERT( block_idx != LALLOC_IDX_INVALID );
-
-    if ( LALLOC_IDX_INVALID == ( *list_idx ) )
-    {
-        /* if the list is empty, then the block is the first and must be added */
-        LALLOC_SET_BLOCK_NEXT( pool, block_idx, block_idx );
-        LALLOC_SET_BLOCK_PREV( pool, block_idx, block_idx );
-    }
-    else
-    {
-        /* the list has, at least, one block. */
-        LALLOC_GET_BLOCK_PREV( pool, ( *list_idx ), prev );
-
-        LALLOC_SET_BLOCK_NEXT( pool, block_idx, ( *list_idx ) );
-        LALLOC_SET_BLOCK_PREV( pool, block_idx, prev );
-        LALLOC_SET_BLOCK_NEXT( pool, prev, block_idx );
-        LALLOC_SET_BLOCK_PREV( pool, ( *list_idx ), block_idx );
-    }
-
-    /* the list is updated to the added block */
-    *list_idx = block_idx;
-}
-
-/**
-   @brief   adds a block into de list ordered by block size (biggest to smallest)
-            block_idx: index from the block to add
-            list_idx:  reference to a list
-            note: the block mus be preconfigured with the correct size and flags
-
-   @param pool
-   @param list_idx
-   @param block_idx
-*/
-void _block_list_add_sorted( uint8_t *pool, LALLOC_IDX_TYPE *list_idx, LALLOC_IDX_TYPE block_idx )
-{
-    LALLOC_IDX_TYPE current = *list_idx;
-
-    if ( LALLOC_IDX_INVALID == current )
-    {
-        /* if the list is empty, the block is the first */
-        _block_list_add_before( pool, &current, block_idx );
-        *list_idx = current;
-    }
-    else
-    {
-        LALLOC_IDX_TYPE size_curr;
-        LALLOC_IDX_TYPE size_new;
-        LALLOC_IDX_TYPE prev = LALLOC_IDX_INVALID;
-
-        size_new = _block_get_size( pool, block_idx );
-
-        while ( 1 )
-        {
-            size_curr = _block_get_size( pool, current );
-
-            if ( size_new > size_curr )
-            {
-                break;
-            }
-
-            prev = current;
-            LALLOC_GET_BLOCK_NEXT( pool, current, current );
-
-            if ( current == *list_idx )
-            {
-                break;
-            }
-        }
-
-        _block_list_add_before( pool, &current, block_idx );
-
-        if ( current == *list_idx )
-        {
-            *list_idx = current;
-        }
-        else
-        {
-            if ( prev != LALLOC_IDX_INVALID )
-            {
-            }
-            else
-            {
-                *list_idx = block_idx; // Update the list's start if it was the first element
-            }
-        }
-    }
-}
-
-/**
-   @brief   Removes a block from a list. This is a private lalloc operation.
-            The list is not updated unless the block to be removed is the first one.
-            WARNING: There is no validation at all that the idx belongs to a block of the given list.
-
-   @param obj
-   @param list
-   @param block_idx
-   @return LALLOC_IDX_TYPE  An orphaned block
- */
-LALLOC_IDX_TYPE _block_list_remove_block( uint8_t *pool, LALLOC_IDX_TYPE *list, LALLOC_IDX_TYPE idx )
-{
-    LALLOC_IDX_TYPE orphan_idx;
-
-    if ( *list == idx )
-    {
-        /* The source list starts with the block that is being removed, so the content of *list will be upated. */
-        orphan_idx = _block_remove( pool, list );
-
-        /* If the block is the only one in the list, list will point to LALLOC_IDX_INVALID */
-    }
-    else
-    {
-        /* this operation can fail if block_idx does not belong to *list */
-        orphan_idx = _block_remove( pool, &( idx ) );
-    }
-    return orphan_idx;
-}
-
-/**
-    @brief  Given a orphan node (a block that is not in any list)
-            this function joins it with its physical and previous physical adjacent blocks if they are free.
-            Since this block will end up being in a free list, and the adjacent blocks are free,
-            the blocks are trated as part of the list.
-
-        it returns the resultant block, with all the header updated.
-        this is an internal method for lalloc operation
-        NOT THREAD SAFE
-
-    @param obj
-    @param orphan_block         Orphan block to be joined with adjacent blocks
-    @return LALLOC_IDX_TYPE     the resultant block, also orphan
- */
-LALLOC_IDX_TYPE _block_join_adjacent( LALLOC_T *obj, LALLOC_IDX_TYPE orphan_block )
-{
-    LALLOC_IDX_TYPE prev_phy;
-    LALLOC_IDX_TYPE next_phy;
-
-    prev_phy = _block_get_prev_phy( obj->pool, orphan_block );
-    next_phy = _block_get_next_phy( obj->pool, orphan_block );
-
-    /*
-        |           |DDDDDDDDTTTTT|DDDDDDDDDDDD|
-        |  prev phy |             |  next phy  |
-        ^prev_phy   ^removed  ^   ^next_phy
-    */
-
-    if ( prev_phy != LALLOC_IDX_INVALID )
-    {
-        /* obtains the size of the previous physical block  */
-        if ( _block_is_free( obj->pool, prev_phy ) )
-        {
-            /* the previous physcal block is free. */
-            orphan_block = _block_list_remove_block( obj->pool, &( obj->dyn->flist ), prev_phy );
-        }
-        else
-        {
-            /* the block is not free, cant be merged */
-        }
-    }
-    else
-    {
-        /* the previous phy block is invalid, it means that is the first block */
-        LALLOC_ASSERT( orphan_block == 0 );
-    }
-
-    /* check right */
-    if ( next_phy != obj->size )
-    {
-        if ( _block_is_free( obj->pool, next_phy ) )
-        {
-            /* the next physcal block is free. */
-            LALLOC_IDX_TYPE temp = _block_list_remove_block( obj->pool, &( obj->dyn->flist ), next_phy );
-
-            /* ovewrite next physical */
-            next_phy = _block_get_next_phy( obj->pool, temp );
-        }
-        else
-        {
-            /* the block is not free, cant be merged */
-        }
-    }
-    else
-    {
-        /* the next block is invalid. Means that it is the last block of the cointainer. So the block is configured up to the pool's boundry */
-    }
-
-    /* repair the previous physical of the next. */
-    if ( next_phy != obj->size )
-    {
-        LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, orphan_block );
-    }
-
-    _block_set_size( obj->pool, orphan_block, next_phy - orphan_block - lalloc_b_overhead_size );
-    _block_set_flags( obj->pool, orphan_block, LALLOC_FREE_BLOCK_MASK );
-
-    return orphan_block;
-}
-
-/**
-   @brief   moves a block from the allocated list to the free list.
-            This is an internal method for lalloc operation
-            NOT THREAD SAFE
-   @param obj
-   @param addr
-   @return int
- */
-bool _block_move_from_alloc_to_free( LALLOC_T *obj, void *addr )
-{
-    bool rv;
-
-    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
-    {
-        /* Remove the addr from the alocated list. */
-        LALLOC_IDX_TYPE idx = _block_list_find_by_ref( obj->pool, obj->dyn->alist, ( uint8_t * )addr );
-
-        if ( LALLOC_IDX_INVALID != idx )
-        {
-            LALLOC_IDX_TYPE orphan_idx = _block_list_remove_block( obj->pool, &( obj->dyn->alist ), idx );
-
-            orphan_idx = _block_join_adjacent( obj, orphan_idx );
-
-            _block_list_add_sorted( obj->pool, &( obj->dyn->flist ), orphan_idx );
-
-            obj->dyn->allocated_blocks--;
-
-            rv = true;
-        }
-        else
-        {
-            rv = false;
-        }
-    }
-    else
-    {
-        rv = false;
-    }
-
-    return rv;
-}
-
-/**
-   @brief Constructs in runtime a new lalloc_t object.
-
-   @param size      pool size
-   @return void*    handler to the new lalloc_t object
- */
-void *lalloc_ctor( LALLOC_IDX_TYPE size )
-{
-    lalloc_t *rv = ( lalloc_t * )malloc( sizeof( lalloc_t ) );
-
-    if ( rv != NULL )
-    {
-        rv->size = size;
-
-        rv->pool = ( uint8_t * )malloc( rv->size );
-        // rv->pool = ( uint8_t * ) aligned_alloc( LALLOC_ALIGNMENT , rv->size );
-
-        if ( rv->pool != NULL )
-        {
-            rv->dyn = ( lalloc_dyn_t * )malloc( sizeof( lalloc_dyn_t ) );
-
-            if ( rv->dyn != NULL )
-            {
-                lalloc_init( rv );
-            }
-            else
-            {
-                free( rv->pool );
-                free( rv );
-                rv = NULL;
-            }
-        }
-        else
-        {
-            free( rv );
-            rv = NULL;
-        }
-    }
-
-    return rv;
-}
-
-void lalloc_dtor( void *me )
-{
-    free( ( ( lalloc_t * )me )->dyn );
-    free( ( ( lalloc_t * )me )->pool );
-    free( ( ( lalloc_t * )me ) );
-}
-
-/* ==PUBLIC METHODS================================================================================== */
-
-/**
-   @brief it clears the object
-
-   @param obj
- */
-void lalloc_clear( LALLOC_T *obj )
-{
-    LALLOC_CRITICAL_START;
-
-    /* initialize the object data */
-    obj->dyn->flist = 0;
-    obj->dyn->alist = LALLOC_IDX_INVALID;
-    obj->dyn->alloc_block = LALLOC_IDX_INVALID;
-    obj->dyn->allocated_blocks = 0;
-
-    /* initialice the only free block available (flist) */
-    LALLOC_IDX_TYPE block_size = obj->size - lalloc_b_overhead_size;
-    _block_set( obj->pool, obj->dyn->flist, block_size, obj->dyn->flist, obj->dyn->flist, 0 );
-    _block_set_flags( obj->pool, obj->dyn->flist, LALLOC_FREE_BLOCK_MASK );
-
-    LALLOC_CRITICAL_END;
-}
-
-/**
-   @brief initializes the object
-
-   @param obj
- */
-void lalloc_init( LALLOC_T *obj )
-{
-    lalloc_clear( obj );
-}
-
-/**
-   @brief it request a memory space to the object
-
-   @param obj       reference to obj to work with
-   @param addr      return of the address
-   @param size      return of the size of the block
- */
-void lalloc_alloc( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
-{
-    LALLOC_CRITICAL_START;
-
-    /* Take the flist element (the first) and return your information, and remove the flist block. */
-    if ( LALLOC_IDX_INVALID != obj->dyn->flist )
-    {
-        /* If the free list has some block, the first block will be the highest size one.
-           The alloc function returns the first block in the free list */
-        _block_get_data( obj->pool, obj->dyn->flist, ( uint8_t ** )addr, size );
-
-        /* when an allocation takes place, the block is mark as not free (without the bit set) */
-        _block_set_size( obj->pool, obj->dyn->flist, *size );
-        _block_set_flags( obj->pool, obj->dyn->flist, LALLOC_USED_BLOCK_MASK );
-
-        obj->dyn->alloc_block = obj->dyn->flist;
-    }
-    else
-    {
-        /* there isn't any block in the list  */
-        *addr = NULL;
-        *size = 0;
-    }
-
-    LALLOC_CRITICAL_END;
-}
-
-/**
-   @brief reverts the alloc operation
-
-   @param obj
- */
-void lalloc_alloc_revert( LALLOC_T *obj )
-{
-    LALLOC_CRITICAL_START;
-
-    if ( obj->dyn->flist != LALLOC_IDX_INVALID )
-    {
-        _block_set_flags( obj->pool, obj->dyn->flist, LALLOC_FREE_BLOCK_MASK );
-
-        obj->dyn->alloc_block = LALLOC_IDX_INVALID;
-    }
-    LALLOC_CRITICAL_END;
-}
-
-/**
-   @brief commits the previous allocated memory block
-
-   @param obj
-   @param size
-   @return int 1 if the operation success
-               0 otherwise
- */
-bool lalloc_commit( LALLOC_T *obj, LALLOC_IDX_TYPE size )
-{
-    int rv;
-
-    /* all the commited user memory areas are aligned as well */
-    size = LALLOC_ALIGN_ROUND_UP( size );
-
-#if LALLOC_MIN_PAYLOAD_SIZE > 0
-    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
-#endif
-    {
-        LALLOC_CRITICAL_START;
-
-        if ( obj->dyn->alloc_block != LALLOC_IDX_INVALID )
-        {
-            LALLOC_IDX_TYPE block_size;
-
-            /* SIZE VALIDATION */
-            block_size = _block_get_size( obj->pool, obj->dyn->alloc_block );
-            LALLOC_ASSERT( _block_is_free( obj->pool, obj->dyn->alloc_block ) == false );
-
-            if ( size <= block_size )
-            {
-                /* calculation of the new block position
-                |<-- size ------>|              |
-                |<---- block_size -------------->|
-                                    |
-                                    \new_block_idx
-                */
-
-                bool split_block = false;
-                LALLOC_IDX_TYPE new_block_size = block_size - size;
-
-                /* removes the first block in the free list and modify flist to point to the next larger block */
-                LALLOC_IDX_TYPE orphan_idx = _block_list_remove_block( obj->pool, &( obj->dyn->flist ), obj->dyn->alloc_block );
-
-                if ( new_block_size < lalloc_b_overhead_size + LALLOC_MIN_PAYLOAD_SIZE )
-                {
-                    /* the block wont be splitted */
-                    size = block_size;
-                }
-                else
-                {
-                    split_block = true;
-                }
-
-                /* set the new size of the block with the provided size*/
-                _block_set_size( obj->pool, orphan_idx, size );
-                _block_set_flags( obj->pool, orphan_idx, LALLOC_USED_BLOCK_MASK );
-
-                /* add the block to allocated list */
-                _block_list_add_before( obj->pool, &( obj->dyn->alist ), orphan_idx );
-
-                if ( split_block )
-                {
-                    /* the bigblock must be splitted */
-                    LALLOC_IDX_TYPE new_block_idx = LALLOC_NEXT_BLOCK_IDX( orphan_idx , size );
-
-                    /* You have to separate the block, and insert the new */
-                    new_block_size = new_block_size - lalloc_b_overhead_size;
-
-                    /* sets the size of the commited block */
-                    _block_set_size( obj->pool, new_block_idx, new_block_size );
-                    _block_set_flags( obj->pool, new_block_idx, LALLOC_FREE_BLOCK_MASK );
-
-                    /* next physical to the new block */
-                    LALLOC_IDX_TYPE next_physical = _block_get_next_phy( obj->pool, new_block_idx );
-
-                    /* set the previous phy to the new block */
-                    LALLOC_SET_BLOCK_PREVPHYS( obj->pool, new_block_idx, orphan_idx );
-
-                    if ( next_physical != obj->size )
-                    {
-                        /* if the next phy of the removed block is not the boundry, set the previous phy of it */
-                        LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_physical, new_block_idx );
-                    }
-
-#if LALLOC_ALLOW_JOINING_WHEN_COMMITTING==1
-                    new_block_idx = _block_join_adjacent( obj, new_block_idx );
-#endif
-
-                    /* add the block to free list */
-                    _block_list_add_sorted( obj->pool, &( obj->dyn->flist ), new_block_idx );
-                }
-
-                obj->dyn->alloc_block = LALLOC_IDX_INVALID;
-
-                obj->dyn->allocated_blocks++;
-
-                rv = true;
-            }
-            else
-            {
-                /* the user wants to allocate a buffer bigger than the max.
-                   WARNING: did the user fill the buffer beyond block_size? if yes, KATAPUM */
-                rv = false;
-            }
-        }
-        else
-        {
-            /* there is no previous allocation */
-            rv = false;
-        }
-        LALLOC_CRITICAL_END;
-    }
-#if LALLOC_MIN_PAYLOAD_SIZE > 0
-    else
-    {
-        /* the commited size is less than de minimum */
-        rv = false;
-    }
-#endif
-
-    return rv;
-}
-
-#if LALLOC_ALLOW_QUEUED_FREES == 1
-/**
-   @brief it frees up the last added block
-
-   @param obj
-   @return int
- */
-bool lalloc_free_last( LALLOC_T *obj )
-{
-    bool rv;
-
-    LALLOC_CRITICAL_START;
-
-    /* calculate the index of the 1st byte of the payload */
-    LALLOC_IDX_TYPE idx = obj->dyn->alist + lalloc_b_overhead_size;
-
-    rv = _block_move_from_alloc_to_free( obj, &( obj->pool[idx] ) );
-
-    LALLOC_CRITICAL_END;
-
-    return rv;
-}
-
-/* it frees up the first added block */
-bool lalloc_free_first( LALLOC_T *obj )
-{
-    bool rv;
-    LALLOC_IDX_TYPE idx;
-
-    LALLOC_CRITICAL_START;
-
-    /* calculate the index of the 1st byte of the payload */
-    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
-    {
-        LALLOC_GET_BLOCK_PREV( obj->pool, obj->dyn->alist, idx );
-
-        ( idx ) = LALLOC_BLOCK_PREV( obj->pool, obj->dyn->alist );
-
-        idx += lalloc_b_overhead_size;
-
-        rv = _block_move_from_alloc_to_free( obj, &( obj->pool[idx] ) );
-    }
-    else
-    {
-        rv = false;
-    }
-
-    LALLOC_CRITICAL_END;
-
-    return rv;
-}
-#endif
-
-/**
-   @brief Frees up the block of a given address.
-
-          which payload includes addr memory address. *
-          lalloc_free(0) must behaves just like lalloc_free_first()
-          if the operation was ok, it return 1. 0 otherwise
-
-   @param obj
-   @param addr
-   @return int
- */
-bool lalloc_free( LALLOC_T *obj, void *addr )
-{
-    bool rv;
-    bool in_global_range = ( uint8_t * )addr >= obj->pool && ( uint8_t * )addr < obj->pool + obj->size;
-
-    if ( in_global_range )
-    {
-        LALLOC_CRITICAL_START;
-        // TODO OPTIMIZATION FOR #if LALLOC_ALLOW_QUEUED_FREES==1 AND FREE ANY COMBINATIONS. ALIST IS NOT NEEDED IN SOME CASES.
-        rv = _block_move_from_alloc_to_free( obj, addr );
-        LALLOC_CRITICAL_END;
-    }
-    else
-    {
-        rv = false;
-    }
-
-    return rv;
-}
-
-/**
-   @brief gets the free space of the object
-
-   @param obj
-   @return LALLOC_IDX_TYPE
- */
-LALLOC_IDX_TYPE lalloc_get_free_space( LALLOC_T *obj )
-{
-    LALLOC_IDX_TYPE size;
-    uint8_t *pdata_dummmy;
-
-    LALLOC_CRITICAL_START;
-
-    if ( LALLOC_IDX_INVALID != obj->dyn->flist )
-    {
-        /* if the free list is not empty, the information returned is its first block's size */
-        _block_get_data( obj->pool, obj->dyn->flist, &pdata_dummmy, &size );
-    }
-    else
-    {
-        /* full, free=0 */
-        size = 0;
-    }
-
-    LALLOC_CRITICAL_END;
-
-    return size;
-}
-
-/**
-   @brief returns if the obj is full or not
-
-   @param obj
-   @return true
-   @return false
- */
-bool lalloc_is_full( LALLOC_T *obj ) // TODO: NON TESTED
-{
-    LALLOC_IDX_TYPE cnt = lalloc_get_free_space( obj );
-    return ( cnt == 0 );
-}
-
-/**
-   @brief returns if the obj is empty or not
-
-   @param obj
-   @return true
-   @return false
- */
-bool lalloc_is_empty( LALLOC_T *obj ) // TODO: NON TESTED
-{
-    LALLOC_IDX_TYPE cnt = lalloc_get_alloc_count( obj );
-    return ( cnt == 0 );
-}
-
-/**
-   @brief returns 1 if the object hasn't allocated some space
-
-   @param obj
-   @return true
-   @return false
- */
-bool lalloc_is_none_allocated( LALLOC_T *obj ) // TODO: NON TESTED
-{
-    return ( obj->dyn->alloc_block == LALLOC_IDX_INVALID );
-}
-
-/* returns the allocated packet count */
-LALLOC_IDX_TYPE lalloc_get_alloc_count( LALLOC_T *obj )
-{
-    LALLOC_IDX_TYPE n;
-
-    LALLOC_CRITICAL_START;
-
-    n = obj->dyn->allocated_blocks;
-
-    LALLOC_CRITICAL_END;
-
-    return n;
-}
-
-/**
-   @brief Gets the nth  logical allocated element
-          |ELEM0|->|ELEM1|->|ELEM2|->....->|ELEMn|->....->|ELEM0|
-   @param obj
-   @param addr
-   @param size
-   @param n
- */
-void lalloc_get_n( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE n )
-{
-    LALLOC_CRITICAL_START;
-
-    /* the alocated list is sorted backwards, so the 0 element is the last. */
-    LALLOC_IDX_TYPE cnt = obj->dyn->allocated_blocks;
-
-    n = cnt - n - 1;
-
-    _block_list_get_n( obj->pool, obj->dyn->alist, n, ( uint8_t ** )addr, size );
-
-    LALLOC_CRITICAL_END;
-}
-
-/* v1.00 */
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#if ( LALLOC_PROFILE == 1 || LALLOC_CS_PROFILE == 1 || LALLOC_TRACE == 1 ) && ( defined(__unix__) || defined(__APPLE__) )
+#include <time.h>
+#endif
+
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN && ( defined(__unix__) || defined(__APPLE__) )
+#include <sched.h>
+#endif
+
+#if LALLOC_ENGINE == LALLOC_ENGINE_LISTS
+
+/* CONSTANTS ============================================================================================================ */
+LALLOC_STATIC const LALLOC_IDX_TYPE lalloc_b_overhead_size = LALLOC_BLOCK_HEADER_SIZE;
+
+/* ==PRIVATE METHODS================================================================================= */
+
+/**
+    @brief sets the block information at the selected pool and block index
+
+    @param pool
+    @param idx
+    @param size
+    @param next
+    @param prev
+    @param flags
+ */
+LALLOC_INLINE void _block_set( uint8_t *pool, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE size, LALLOC_IDX_TYPE next, LALLOC_IDX_TYPE prev, LALLOC_IDX_TYPE flags )
+{
+    LALLOC_SET_BLOCK_NEXT( pool, idx, next );
+    LALLOC_SET_BLOCK_PREV( pool, idx, prev );
+    LALLOC_SET_BLOCK_PREVPHYS( pool, idx, LALLOC_IDX_INVALID );
+    LALLOC_SET_BLOCK_SIZE( pool, idx, size | flags );
+}
+
+/**
+    @brief Gets the size of a block based on its index in the pool.
+    @param pool
+    @param block_idx
+    @return LALLOC_IDX_TYPE size of the block
+ */
+LALLOC_INLINE LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE size;
+    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
+
+#if LALLOC_ALIGNMENT == 1
+#else
+    /* clear the control flags */
+    size &= ~LALLOC_FREE_BLOCK_MASK;
+#endif
+
+    return size;
+}
+
+/**
+    @brief Tells if a block is free or not based on its index in the pool.
+
+    @param pool
+    @param block_idx
+    @return bool
+ */
+LALLOC_INLINE bool _block_is_free( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
+{
+#if LALLOC_ALIGNMENT == 1
+    LALLOC_IDX_TYPE flags;
+    LALLOC_GET_BLOCK_FLAGS( pool, block_idx, flags );
+    return flags & LALLOC_FREE_BLOCK_MASK;
+#else
+    LALLOC_IDX_TYPE size;
+    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
+    return size & LALLOC_FREE_BLOCK_MASK;
+#endif
+}
+
+/**
+    @brief  Tells if a used block is a reservation made by lalloc_reserve.
+            Those blocks are not linked in any list, so their links are invalid.
+
+    @param pool
+    @param block_idx
+    @return bool
+ */
+LALLOC_INLINE bool _block_is_reserved( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
+{
+    return LALLOC_BLOCK_NEXT( pool, block_idx ) == LALLOC_IDX_INVALID;
+}
+
+/**
+    @brief  overwrites the size of a block.
+            If the built version has the FREE_BLOCK_MASK flag, it will overwriten.
+            CALL _block_set_flags after
+
+    @param pool
+    @param block_idx
+    @param size
+ */
+LALLOC_INLINE void _block_set_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx, LALLOC_IDX_TYPE size )
+{
+    LALLOC_SET_BLOCK_SIZE( pool, block_idx, size );
+}
+
+LALLOC_INLINE LALLOC_IDX_TYPE _block_get_prev_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE prev_phy;
+    LALLOC_GET_BLOCK_PREVPHYS( pool, block_idx, prev_phy );
+    return prev_phy;
+}
+
+LALLOC_INLINE LALLOC_IDX_TYPE _block_get_next_phy( uint8_t *pool, LALLOC_IDX_TYPE block_idx )
+{
+    return LALLOC_NEXT_BLOCK_IDX( block_idx, _block_get_size( pool, block_idx ) );
+}
+
+/**
+    @brief  Overwrites the flags of a block.
+            This is a private lalloc operation.
+            NOT THREAD SAFE
+
+    @param pool
+    @param block_idx
+    @param newflags
+    @return LALLOC_INLINE
+ */
+LALLOC_INLINE void _block_set_flags( uint8_t *pool, LALLOC_IDX_TYPE block_idx, LALLOC_IDX_TYPE newflags )
+{
+#if LALLOC_ALIGNMENT == 1
+    LALLOC_SET_BLOCK_FLAGS( pool, block_idx, newflags );
+#else
+    LALLOC_IDX_TYPE size;
+    LALLOC_GET_BLOCK_SIZE( pool, block_idx, size );
+    size &= ~LALLOC_FREE_BLOCK_MASK;
+    LALLOC_SET_BLOCK_SIZE( pool, block_idx, size | newflags );
+#endif
+}
+
+/**
+   @brief  gets the block data
+
+   @param pool          memory pool
+   @param block_idx     block index of the block
+   @param addr          address of the block
+   @param size          size of the block
+ */
+void _block_get_data( uint8_t *pool, LALLOC_IDX_TYPE block_idx, uint8_t **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_GET_BLOCK_DATA( pool, block_idx, *addr );
+    *size = _block_get_size( pool, block_idx );
+}
+
+/**
+   @brief Removes the block from one double linked list and updates the original block pointer to the next.
+          e.g
+          *idx points to a block of a list with only one element. *ids becomes LALLOC_IDX_INVALID
+          *idx points to a block of a list with more than one element. *ids becomes next block of the removed block
+
+          Externally the user must ensure that the block belongs to a well configured list.
+
+   @param pool
+   @param idx               reference to the index of the block to be removed
+                            will be updated with the next block's index or to invalid if the list is empty after the removal
+   @return LALLOC_IDX_TYPE  the original value of *idx, which now is orphan
+ */
+LALLOC_IDX_TYPE _block_remove( uint8_t *pool, LALLOC_IDX_TYPE *idx )
+{
+    LALLOC_IDX_TYPE next;
+    LALLOC_IDX_TYPE prev;
+
+    LALLOC_ASSERT( ( *idx ) != LALLOC_IDX_INVALID );
+
+    LALLOC_GET_BLOCK_NEXT( pool, ( *idx ), next );
+    LALLOC_GET_BLOCK_PREV( pool, ( *idx ), prev );
+
+    /* backup */
+    LALLOC_IDX_TYPE orphan_idx = ( *idx );
+
+    if ( ( *idx ) == next ) // idx is an index for a block beloning to a list of one element
+    {
+        /* there is only one element in the list. */
+        LALLOC_ASSERT( ( *idx ) == prev ); // If there is only one, this must be true
+
+        /* mark the list as empty */
+        ( *idx ) = LALLOC_IDX_INVALID;
+    }
+    else
+    {
+        /* the list has more than one element */
+        LALLOC_SET_BLOCK_NEXT( pool, prev, next );
+        LALLOC_SET_BLOCK_PREV( pool, next, prev );
+
+        /* mark the list as the next block  */
+        ( *idx ) = next;
+    }
+
+    return orphan_idx;
+}
+
+#if LALLOC_BLOCK_BITMAP == 1
+/**
+   @brief   marks the first granule of a block in the block bitmap.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+ */
+void _bitmap_set( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE granule = block_idx / LALLOC_ALIGNMENT;
+    obj->bitmap[granule / 32] |= ( uint32_t )1 << ( granule % 32 );
+}
+
+/**
+   @brief   unmarks the first granule of a block in the block bitmap (e.g. the block was joined to other one).
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+ */
+void _bitmap_clear( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE granule = block_idx / LALLOC_ALIGNMENT;
+    obj->bitmap[granule / 32] &= ~( ( uint32_t )1 << ( granule % 32 ) );
+}
+
+/**
+   @brief   finds the block that contains a pool index, by looking for the closest block start at or before it.
+            The bitmap is scanned one word at a time, so the worst case is O(pool/32) and it is
+            O(1) when the block starts within the same 32 granules.
+            NOT THREAD SAFE
+
+   @param obj
+   @param idx               any index of the pool (header or payload)
+   @return LALLOC_IDX_TYPE  the index of the block
+ */
+LALLOC_IDX_TYPE _bitmap_find_block( LALLOC_T *obj, LALLOC_IDX_TYPE idx )
+{
+    LALLOC_IDX_TYPE granule = idx / LALLOC_ALIGNMENT;
+    LALLOC_IDX_TYPE word = granule / 32;
+
+    /* only the granules at or before idx */
+    uint32_t bits = obj->bitmap[word] & ( 0xFFFFFFFFUL >> ( 31 - ( granule % 32 ) ) );
+
+    while ( bits == 0 )
+    {
+        if ( word == 0 )
+        {
+            /* can't happen on a consistent object, the first block always starts at 0 */
+            return LALLOC_IDX_INVALID;
+        }
+
+        word--;
+        bits = obj->bitmap[word];
+    }
+
+    return ( ( LALLOC_IDX_TYPE )( word * 32 ) + LALLOC_FLS( bits ) ) * LALLOC_ALIGNMENT;
+}
+#endif
+
+/**
+     @brief find a block in a list by pool index.
+            idx must target ANY byte belonging to tha payload of a list's block.
+
+            If found, it returns the index block that contains the index provided (should it be the same? NO)
+            If not found, it return LALLOC_IDX_INVALID
+
+            NOT THREAD SAFE
+
+    @param pool
+    @param list
+    @param idx
+    @return LALLOC_IDX_TYPE
+*/
+LALLOC_IDX_TYPE _block_list_find_by_idx( uint8_t *pool, LALLOC_IDX_TYPE list, LALLOC_IDX_TYPE idx )
+{
+    LALLOC_IDX_TYPE next = list;
+
+    while ( 1 )
+    {
+        /* Calculates the condition for ending the loop:
+           The condition is "idx is bigger that the begining of the block && idx is less that its top boundry") */
+        LALLOC_IDX_TYPE condition = ( idx >= next );
+
+        if ( condition )
+        {
+            /* get the block size in order to compute the top boundry */
+            condition = ( idx < _block_get_next_phy( pool, next ) );
+        }
+
+        if ( condition )
+        {
+            /* found */
+            return next;
+        }
+
+        LALLOC_GET_BLOCK_NEXT( pool, next, next );
+
+        if ( next == list )
+        {
+            /* start again not found */
+            return LALLOC_IDX_INVALID;
+        }
+    }
+}
+
+/**
+   @brief   finds a block in a NON EMPTY list by payload reference.
+            returns the found relative block index or LALLOC_IDX_INVALID if not found
+            If found, it returns the index block whos payload contains the provided reference
+
+            if LALLOC_FREE_ANY==1 will finds a block within the list whose address is wihin the user area of the block.
+                                  With LALLOC_BLOCK_BITMAP==1 the block is resolved with the bitmap, and it is found if it
+                                  is an allocated block (the list must be the allocated list).
+            if LALLOC_FREE_ANY==0 will return the block from the list, whose address matches the first byte of the user area of the block.
+            If not found, it returns LALLOC_IDX_INVALID
+            NOT THREAD SAFE
+
+   @param obj
+   @param list_idx
+   @param addr          ANY address that must point somewhere in the pool
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_IDX_TYPE _block_list_find_by_ref( LALLOC_T *obj, LALLOC_IDX_TYPE list, uint8_t *addr )
+{
+    LALLOC_IDX_TYPE rv;
+    uint8_t *pool = obj->pool;
+
+    /* relativize addr to the pool.  */
+    LALLOC_IDX_TYPE idx = addr - pool;
+
+#if LALLOC_FREE_ANY == 1
+#if LALLOC_BLOCK_BITMAP == 1
+    rv = _bitmap_find_block( obj, idx );
+
+    if ( LALLOC_IDX_INVALID != rv && ( _block_is_free( pool, rv ) || rv == obj->dyn->alloc_block || _block_is_reserved( pool, rv ) ) )
+    {
+        /* the free blocks and the reserved ones are not in the allocated list */
+        rv = LALLOC_IDX_INVALID;
+    }
+#else
+    rv = _block_list_find_by_idx( pool, list, idx );
+#endif
+#else
+
+    /* addr is the user addres, that is shifted from the block address in lalloc_b_overhead_size bytes */
+    idx -= lalloc_b_overhead_size;
+
+    /* is the list the allocated list or the free list ? */
+    bool is_list_free = _block_is_free( pool, list );
+    bool is_block_free = _block_is_free( pool, idx );
+
+    if ( is_list_free == is_block_free && ( is_block_free || !_block_is_reserved( pool, idx ) ) )
+    {
+        // belongs to the same list, found
+        rv = idx;
+    }
+    else
+    {
+        // belongs to different list, not found
+        rv = LALLOC_IDX_INVALID;
+    }
+#endif
+
+    return rv;
+}
+
+/**
+   @brief   Obtains the nth element in the list
+
+   @param pool
+   @param list
+   @param n
+   @param addr
+   @param size
+ */
+void _block_list_get_n( uint8_t *pool, LALLOC_IDX_TYPE list, LALLOC_IDX_TYPE n, uint8_t **addr, LALLOC_IDX_TYPE *size )
+{
+    /* TODO, very similtar to _block_list_find_by_idx but with a different search criteria.
+             Could be improved with lambdas or callbacks  */
+
+    LALLOC_IDX_TYPE i = 0;
+
+    LALLOC_IDX_TYPE next = list;
+
+    if ( LALLOC_IDX_INVALID != list )
+    {
+        /* it only searches when the list is valid */
+        while ( 1 )
+        {
+            if ( i == n )
+            {
+                /* found */
+                _block_get_data( pool, next, addr, size );
+                return;
+            }
+
+            LALLOC_GET_BLOCK_NEXT( pool, next, next );
+
+            if ( next == list )
+            {
+                /* list wrap around: not found */
+                break;
+            }
+
+            i++;
+        }
+    }
+
+    *addr = NULL;
+    *size = 0;
+
+    return;
+}
+
+/**
+   @brief   adds a block at the begining of the list.
+            block_idx: index of the block to add
+            list_idx:  reference to a list
+            note: the block must be preconfigured with the correct size and flags
+
+   @param pool
+   @param list_idx
+   @param block_idx
+*/
+void _block_list_add_before( uint8_t *pool, LALLOC_IDX_TYPE *list_idx, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE prev;
+    LALLOC_ASSERT( block_idx != LALLOC_IDX_INVALID );
+
+    if ( LALLOC_IDX_INVALID == ( *list_idx ) )
+    {
+        /* if the list is empty, then the block is the first and must be added */
+        LALLOC_SET_BLOCK_NEXT( pool, block_idx, block_idx );
+        LALLOC_SET_BLOCK_PREV( pool, block_idx, block_idx );
+    }
+    else
+    {
+        /* the list has, at least, one block. */
+        LALLOC_GET_BLOCK_PREV( pool, ( *list_idx ), prev );
+
+        LALLOC_SET_BLOCK_NEXT( pool, block_idx, ( *list_idx ) );
+        LALLOC_SET_BLOCK_PREV( pool, block_idx, prev );
+        LALLOC_SET_BLOCK_NEXT( pool, prev, block_idx );
+        LALLOC_SET_BLOCK_PREV( pool, ( *list_idx ), block_idx );
+    }
+
+    /* the list is updated to the added block */
+    *list_idx = block_idx;
+}
+
+/**
+   @brief   adds a block into de list ordered by block size (biggest to smallest)
+            block_idx: index from the block to add
+            list_idx:  reference to a list
+            note: the block mus be preconfigured with the correct size and flags
+
+   @param pool
+   @param list_idx
+   @param block_idx
+*/
+void _block_list_add_sorted( uint8_t *pool, LALLOC_IDX_TYPE *list_idx, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE current = *list_idx;
+
+    if ( LALLOC_IDX_INVALID == current )
+    {
+        /* if the list is empty, the block is the first */
+        _block_list_add_before( pool, &current, block_idx );
+        *list_idx = current;
+    }
+    else
+    {
+        LALLOC_IDX_TYPE size_curr;
+        LALLOC_IDX_TYPE size_new;
+        LALLOC_IDX_TYPE prev = LALLOC_IDX_INVALID;
+
+        size_new = _block_get_size( pool, block_idx );
+
+        while ( 1 )
+        {
+            size_curr = _block_get_size( pool, current );
+
+            if ( size_new > size_curr )
+            {
+                break;
+            }
+
+            prev = current;
+            LALLOC_GET_BLOCK_NEXT( pool, current, current );
+
+            if ( current == *list_idx )
+            {
+                break;
+            }
+        }
+
+        _block_list_add_before( pool, &current, block_idx );
+
+        if ( current == *list_idx )
+        {
+            *list_idx = current;
+        }
+        else
+        {
+            if ( prev != LALLOC_IDX_INVALID )
+            {
+            }
+            else
+            {
+                *list_idx = block_idx; // Update the list's start if it was the first element
+            }
+        }
+    }
+}
+
+/**
+   @brief   Removes a block from a list. This is a private lalloc operation.
+            The list is not updated unless the block to be removed is the first one.
+            WARNING: There is no validation at all that the idx belongs to a block of the given list.
+
+   @param obj
+   @param list
+   @param block_idx
+   @return LALLOC_IDX_TYPE  An orphaned block
+ */
+LALLOC_IDX_TYPE _block_list_remove_block( uint8_t *pool, LALLOC_IDX_TYPE *list, LALLOC_IDX_TYPE idx )
+{
+    LALLOC_IDX_TYPE orphan_idx;
+
+    if ( *list == idx )
+    {
+        /* The source list starts with the block that is being removed, so the content of *list will be upated. */
+        orphan_idx = _block_remove( pool, list );
+
+        /* If the block is the only one in the list, list will point to LALLOC_IDX_INVALID */
+    }
+    else
+    {
+        /* this operation can fail if block_idx does not belong to *list */
+        orphan_idx = _block_remove( pool, &( idx ) );
+    }
+    return orphan_idx;
+}
+
+/**
+   @brief   portable version of LALLOC_FLS, used when the compiler does not provide a count leading zeros builtin.
+
+   @param value     non zero value
+   @return uint8_t  index of the most significant bit set
+ */
+uint8_t _lalloc_fls( uint32_t value )
+{
+    uint8_t rv = 0;
+
+    while ( value >>= 1 )
+    {
+        rv++;
+    }
+
+    return rv;
+}
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+/**
+   @brief   computes the size class (first and second level indexes) of the segregated lists for a given block size.
+
+   @param size      payload size of the block
+   @param fl        first level index
+   @param sl        second level index
+ */
+void _tlsf_mapping( LALLOC_IDX_TYPE size, uint8_t *fl, uint8_t *sl )
+{
+    if ( size < LALLOC_TLSF_SL_COUNT )
+    {
+        /* small sizes, linear classes */
+        *fl = 0;
+        *sl = ( uint8_t ) size;
+    }
+    else
+    {
+        uint8_t msb = LALLOC_FLS( size );
+
+        *fl = msb - LALLOC_TLSF_SL_LOG2 + 1;
+        *sl = ( uint8_t )( ( size >> ( msb - LALLOC_TLSF_SL_LOG2 ) ) - LALLOC_TLSF_SL_COUNT );
+    }
+}
+
+/**
+   @brief   returns the head of the highest non empty size class, or LALLOC_IDX_INVALID if there are no free blocks.
+            O(1)
+
+   @param obj
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_INLINE LALLOC_IDX_TYPE _tlsf_find_largest( LALLOC_T *obj )
+{
+    uint8_t fl;
+    uint8_t sl;
+
+    if ( obj->dyn->fl_bitmap == 0 )
+    {
+        return LALLOC_IDX_INVALID;
+    }
+
+    fl = LALLOC_FLS( obj->dyn->fl_bitmap );
+    sl = LALLOC_FLS( obj->dyn->sl_bitmap[fl] );
+
+    return obj->dyn->fheads[fl][sl];
+}
+#endif
+
+#if LALLOC_STATS == 1
+/**
+   @brief   accounts a block that enters (sign>0) or leaves the free list.
+            NOT THREAD SAFE
+
+   @param obj
+   @param size
+   @param sign
+ */
+LALLOC_INLINE void _stats_free( LALLOC_T *obj, LALLOC_IDX_TYPE size, int sign )
+{
+    lalloc_stats_t *stats = &obj->dyn->stats;
+
+    if ( sign > 0 )
+    {
+        stats->free_bytes += size;
+        stats->free_blocks++;
+        stats->free_sq_sum += ( uint64_t )size * size;
+    }
+    else
+    {
+        stats->free_bytes -= size;
+        stats->free_blocks--;
+        stats->free_sq_sum -= ( uint64_t )size * size;
+    }
+}
+
+/**
+   @brief   accounts a block that enters (sign>0) or leaves the allocated list.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @param sign
+ */
+LALLOC_INLINE void _stats_used( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx, int sign )
+{
+    lalloc_stats_t *stats = &obj->dyn->stats;
+    LALLOC_IDX_TYPE size = _block_get_size( obj->pool, block_idx );
+
+    if ( sign > 0 )
+    {
+        stats->used_bytes += size;
+        stats->used_blocks++;
+
+        if ( stats->used_bytes > stats->max_used_bytes )
+        {
+            stats->max_used_bytes = stats->used_bytes;
+        }
+
+        if ( stats->used_blocks > stats->max_used_blocks )
+        {
+            stats->max_used_blocks = stats->used_blocks;
+        }
+
+        if ( stats->free_bytes < stats->min_free_bytes )
+        {
+            stats->min_free_bytes = stats->free_bytes;
+        }
+    }
+    else
+    {
+        stats->used_bytes -= size;
+        stats->used_blocks--;
+    }
+}
+
+#define LALLOC_STATS_FREE( OBJ, SIZE, SIGN )        _stats_free( OBJ, SIZE, SIGN )
+#define LALLOC_STATS_USED( OBJ, IDX, SIGN )         _stats_used( OBJ, IDX, SIGN )
+#define LALLOC_STATS_INC( OBJ, FIELD )              ( ( OBJ )->dyn->stats.FIELD++ )
+#else
+#define LALLOC_STATS_FREE( OBJ, SIZE, SIGN )
+#define LALLOC_STATS_USED( OBJ, IDX, SIGN )
+#define LALLOC_STATS_INC( OBJ, FIELD )
+#endif
+
+#if LALLOC_PROFILE == 1
+/**
+   @brief   adds the latency of a call to the histogram of its operation.
+
+   @param obj
+   @param op        LALLOC_OP_*
+   @param cycles    time taken by the call
+ */
+void _profile_record( LALLOC_T *obj, uint8_t op, uint32_t cycles )
+{
+    lalloc_profile_op_t *prof = &obj->dyn->profile[op];
+    uint8_t bin = ( cycles == 0 ) ? 0 : ( uint8_t )( LALLOC_FLS( cycles ) + 1 );
+
+    if ( bin >= LALLOC_PROFILE_BINS )
+    {
+        bin = LALLOC_PROFILE_BINS - 1;
+    }
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    prof->count++;
+    prof->total += cycles;
+    prof->hist[bin]++;
+
+    if ( cycles > prof->max )
+    {
+        prof->max = cycles;
+    }
+
+    LALLOC_SIDE_CRITICAL_END;
+}
+
+#define LALLOC_PROFILE_ENTER                        uint32_t profile_start = LALLOC_PROFILE_CYCLES()
+#define LALLOC_PROFILE_EXIT( OBJ, OP )              _profile_record( OBJ, OP, ( uint32_t )( LALLOC_PROFILE_CYCLES() - profile_start ) )
+#else
+#define LALLOC_PROFILE_ENTER
+#define LALLOC_PROFILE_EXIT( OBJ, OP )
+#endif
+
+#if LALLOC_TRACE == 1
+/**
+   @brief   reports an event to the trace callback. NOT THREAD SAFE
+
+   @param obj
+   @param type      LALLOC_EV_*
+   @param a
+   @param b
+ */
+void _trace_emit( LALLOC_T *obj, uint8_t type, uint32_t a, uint32_t b )
+{
+    if ( obj->dyn->trace_cb != NULL )
+    {
+        lalloc_trace_event_t ev;
+        uint32_t now = LALLOC_PROFILE_CYCLES();
+
+        ev.type = type;
+        ev.delta = now - obj->dyn->trace_time;
+        ev.a = a;
+        ev.b = b;
+
+        obj->dyn->trace_time = now;
+
+        obj->dyn->trace_cb( obj->dyn->trace_ctx, &ev );
+    }
+}
+
+#define LALLOC_TRACE_EVENT( OBJ, TYPE, A, B )       _trace_emit( OBJ, TYPE, ( uint32_t )( A ), ( uint32_t )( B ) )
+#define LALLOC_TRACE_OFFSET( OBJ, IDX )             ( ( IDX ) + lalloc_b_overhead_size )
+#else
+#define LALLOC_TRACE_EVENT( OBJ, TYPE, A, B )
+#endif
+
+#if LALLOC_SEQLOCK == 1
+/**
+   @brief   publishes the state of the instance for the lock free readers. Each copy is written while the sequence
+            counter points the readers to the other one. To be called at the end of the critical section of every
+            call that changes the instance.
+            NOT THREAD SAFE
+
+   @param obj
+ */
+void _seq_publish( LALLOC_T *obj )
+{
+    volatile uint32_t *seq = &obj->dyn->seq;
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+    lalloc_status_t status;
+
+    status.free_space = ( largest != LALLOC_IDX_INVALID ) ? _block_get_size( obj->pool, largest ) : 0;
+    status.alloc_count = obj->dyn->allocated_blocks;
+#if LALLOC_STATS == 1
+    status.stats = obj->dyn->stats;
+#endif
+
+    /* odd: the readers take status[1] */
+    *seq = *seq + 1;
+    LALLOC_ATOMIC_FENCE_REL();
+    obj->dyn->status[0] = status;
+    LALLOC_ATOMIC_FENCE_REL();
+
+    /* even: the readers take status[0] */
+    *seq = *seq + 1;
+    LALLOC_ATOMIC_FENCE_REL();
+    obj->dyn->status[1] = status;
+}
+
+#define LALLOC_SEQ_PUBLISH( OBJ )                   _seq_publish( OBJ )
+#else
+#define LALLOC_SEQ_PUBLISH( OBJ )
+#endif
+
+/**
+   @brief   adds an orphan block to the free blocks index, based on the selected LALLOC_FLIST_POLICY.
+            After the call, obj->dyn->flist points to the largest free block.
+            note: the block must be preconfigured with the correct size and flags
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+ */
+void _flist_add( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_STATS_FREE( obj, _block_get_size( obj->pool, block_idx ), 1 );
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    uint8_t fl;
+    uint8_t sl;
+    LALLOC_IDX_TYPE size = _block_get_size( obj->pool, block_idx );
+    LALLOC_IDX_TYPE *head;
+
+    _tlsf_mapping( size, &fl, &sl );
+
+    head = &( obj->dyn->fheads[fl][sl] );
+
+    if ( LALLOC_IDX_INVALID == ( *head ) || size >= _block_get_size( obj->pool, *head ) )
+    {
+        /* the block is the biggest known one of its class, it becomes the head */
+        _block_list_add_before( obj->pool, head, block_idx );
+    }
+    else
+    {
+        /* the head is kept, the block is added right after it */
+        LALLOC_IDX_TYPE next;
+        LALLOC_GET_BLOCK_NEXT( obj->pool, *head, next );
+        _block_list_add_before( obj->pool, &next, block_idx );
+    }
+
+    obj->dyn->sl_bitmap[fl] |= ( uint8_t )( 1U << sl );
+    obj->dyn->fl_bitmap |= ( 1UL << fl );
+
+    obj->dyn->flist = _tlsf_find_largest( obj );
+#elif LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+    LALLOC_IDX_TYPE size = _block_get_size( obj->pool, block_idx );
+
+    _block_list_add_before( obj->pool, &( obj->dyn->flist ), block_idx );
+
+    if ( size >= obj->dyn->flist_max_size )
+    {
+        /* no block in the list is bigger than this one, even if the cache was invalid */
+        obj->dyn->flist_max = block_idx;
+        obj->dyn->flist_max_size = size;
+    }
+#else
+    _block_list_add_sorted( obj->pool, &( obj->dyn->flist ), block_idx );
+#endif
+}
+
+/**
+   @brief   removes a block from the free blocks index, based on the selected LALLOC_FLIST_POLICY.
+            The size of the block must be the same it had when it was added.
+            After the call, obj->dyn->flist points to the largest free block.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @return LALLOC_IDX_TYPE  the orphan block
+ */
+LALLOC_IDX_TYPE _flist_remove( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE orphan_idx;
+
+    LALLOC_STATS_FREE( obj, _block_get_size( obj->pool, block_idx ), -1 );
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    uint8_t fl;
+    uint8_t sl;
+    LALLOC_IDX_TYPE *head;
+
+    _tlsf_mapping( _block_get_size( obj->pool, block_idx ), &fl, &sl );
+
+    head = &( obj->dyn->fheads[fl][sl] );
+
+    orphan_idx = _block_list_remove_block( obj->pool, head, block_idx );
+
+    if ( LALLOC_IDX_INVALID == ( *head ) )
+    {
+        /* the class is empty now */
+        obj->dyn->sl_bitmap[fl] &= ( uint8_t )~( 1U << sl );
+
+        if ( obj->dyn->sl_bitmap[fl] == 0 )
+        {
+            obj->dyn->fl_bitmap &= ~( 1UL << fl );
+        }
+    }
+
+    obj->dyn->flist = _tlsf_find_largest( obj );
+#else
+    orphan_idx = _block_list_remove_block( obj->pool, &( obj->dyn->flist ), block_idx );
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+    if ( LALLOC_IDX_INVALID == obj->dyn->flist )
+    {
+        /* empty list, nothing to search */
+        obj->dyn->flist_max = LALLOC_IDX_INVALID;
+        obj->dyn->flist_max_size = 0;
+    }
+    else if ( orphan_idx == obj->dyn->flist_max )
+    {
+        /* the cached block is gone, flist_max_size is kept as an upper bound */
+        obj->dyn->flist_max = LALLOC_IDX_INVALID;
+    }
+#endif
+#endif
+
+    return orphan_idx;
+}
+
+/**
+   @brief   returns the largest free block or LALLOC_IDX_INVALID if there is no free block.
+            With LALLOC_FLIST_LAZY the list is searched only if the cached block is no longer valid.
+            NOT THREAD SAFE
+
+   @param obj
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_IDX_TYPE _flist_largest( LALLOC_T *obj )
+{
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+    if ( LALLOC_IDX_INVALID == obj->dyn->flist_max && LALLOC_IDX_INVALID != obj->dyn->flist )
+    {
+        LALLOC_IDX_TYPE block = obj->dyn->flist;
+        LALLOC_IDX_TYPE max = block;
+        LALLOC_IDX_TYPE max_size = _block_get_size( obj->pool, block );
+
+        while ( 1 )
+        {
+            LALLOC_GET_BLOCK_NEXT( obj->pool, block, block );
+
+            if ( block == obj->dyn->flist )
+            {
+                break;
+            }
+
+            LALLOC_IDX_TYPE size = _block_get_size( obj->pool, block );
+
+            if ( size > max_size )
+            {
+                max = block;
+                max_size = size;
+            }
+        }
+
+        obj->dyn->flist_max = max;
+        obj->dyn->flist_max_size = max_size;
+    }
+
+    return obj->dyn->flist_max;
+#else
+    return obj->dyn->flist;
+#endif
+}
+
+/**
+   @brief   iterates the free blocks, starting from obj->dyn->flist.
+            With LALLOC_FLIST_TLSF, the blocks are returned class by class, from the highest to the lowest.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx         current free block
+   @return LALLOC_IDX_TYPE  next free block or LALLOC_IDX_INVALID when there are no more blocks
+ */
+LALLOC_IDX_TYPE _flist_next( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE next;
+
+    LALLOC_GET_BLOCK_NEXT( obj->pool, block_idx, next );
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    uint8_t fl;
+    uint8_t sl;
+    uint32_t mask;
+
+    _tlsf_mapping( _block_get_size( obj->pool, block_idx ), &fl, &sl );
+
+    if ( next != obj->dyn->fheads[fl][sl] )
+    {
+        return next;
+    }
+
+    /* the class was completely iterated, look for a lower non empty class within the same first level */
+    mask = obj->dyn->sl_bitmap[fl] & ( ( 1U << sl ) - 1 );
+
+    if ( mask == 0 )
+    {
+        /* look for a lower first level */
+        mask = obj->dyn->fl_bitmap & ( ( 1UL << fl ) - 1 );
+
+        if ( mask == 0 )
+        {
+            return LALLOC_IDX_INVALID;
+        }
+
+        fl = LALLOC_FLS( mask );
+        mask = obj->dyn->sl_bitmap[fl];
+    }
+
+    sl = LALLOC_FLS( mask );
+
+    return obj->dyn->fheads[fl][sl];
+#else
+    return ( next == obj->dyn->flist ) ? LALLOC_IDX_INVALID : next;
+#endif
+}
+
+/**
+    @brief  a block was merged into another one, so it is not the start of a block anymore.
+            The cursors of the incremental steps that pointed to it are moved to the block that absorbed it.
+            NOT THREAD SAFE
+
+    @param obj
+    @param gone     merged block
+    @param into     block that absorbed it
+ */
+LALLOC_INLINE void _block_forget( LALLOC_T *obj, LALLOC_IDX_TYPE gone, LALLOC_IDX_TYPE into )
+{
+#if LALLOC_LAZY_COALESCING == 1
+    if ( obj->dyn->coalesce_idx == gone )
+    {
+        obj->dyn->coalesce_idx = into;
+    }
+#endif
+
+#if LALLOC_COMPACTION == 1
+    if ( obj->dyn->compact_idx == gone )
+    {
+        obj->dyn->compact_idx = into;
+    }
+#endif
+
+    ( void ) obj;
+    ( void ) gone;
+    ( void ) into;
+}
+
+/**
+    @brief  Given a orphan node (a block that is not in any list)
+            this function joins it with its physical and previous physical adjacent blocks if they are free.
+            Since this block will end up being in a free list, and the adjacent blocks are free,
+            the blocks are trated as part of the list.
+
+        it returns the resultant block, with all the header updated.
+        this is an internal method for lalloc operation
+        NOT THREAD SAFE
+
+    @param obj
+    @param orphan_block         Orphan block to be joined with adjacent blocks
+    @return LALLOC_IDX_TYPE     the resultant block, also orphan
+ */
+LALLOC_IDX_TYPE _block_join_adjacent( LALLOC_T *obj, LALLOC_IDX_TYPE orphan_block )
+{
+    LALLOC_IDX_TYPE prev_phy;
+    LALLOC_IDX_TYPE next_phy;
+
+    prev_phy = _block_get_prev_phy( obj->pool, orphan_block );
+    next_phy = _block_get_next_phy( obj->pool, orphan_block );
+
+#if LALLOC_LAZY_COALESCING == 1
+    /* the block is not merged here, _coalesce_step will do it. The next lap of the pool is requested if it has a free neighbour */
+    if ( ( prev_phy != LALLOC_IDX_INVALID && _block_is_free( obj->pool, prev_phy ) ) ||
+            ( next_phy != obj->size && _block_is_free( obj->pool, next_phy ) ) )
+    {
+        obj->dyn->coalesce_clean = 0;
+    }
+
+    _block_set_flags( obj->pool, orphan_block, LALLOC_FREE_BLOCK_MASK );
+
+    return orphan_block;
+#else
+
+    /*
+        |           |DDDDDDDDTTTTT|DDDDDDDDDDDD|
+        |  prev phy |             |  next phy  |
+        ^prev_phy   ^removed  ^   ^next_phy
+    */
+
+    if ( prev_phy != LALLOC_IDX_INVALID )
+    {
+        /* obtains the size of the previous physical block  */
+        if ( _block_is_free( obj->pool, prev_phy ) )
+        {
+            /* the previous physcal block is free. */
+            LALLOC_BITMAP_CLEAR( obj, orphan_block );
+            _block_forget( obj, orphan_block, prev_phy );
+            orphan_block = _flist_remove( obj, prev_phy );
+        }
+        else
+        {
+            /* the block is not free, cant be merged */
+        }
+    }
+    else
+    {
+        /* the previous phy block is invalid, it means that is the first block */
+        LALLOC_ASSERT( orphan_block == 0 );
+    }
+
+    /* check right */
+    if ( next_phy != obj->size )
+    {
+        if ( _block_is_free( obj->pool, next_phy ) )
+        {
+            /* the next physcal block is free. */
+            LALLOC_IDX_TYPE temp = _flist_remove( obj, next_phy );
+            LALLOC_BITMAP_CLEAR( obj, temp );
+            _block_forget( obj, temp, orphan_block );
+
+            /* ovewrite next physical */
+            next_phy = _block_get_next_phy( obj->pool, temp );
+        }
+        else
+        {
+            /* the block is not free, cant be merged */
+        }
+    }
+    else
+    {
+        /* the next block is invalid. Means that it is the last block of the cointainer. So the block is configured up to the pool's boundry */
+    }
+
+    /* repair the previous physical of the next. */
+    if ( next_phy != obj->size )
+    {
+        LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, orphan_block );
+    }
+
+    _block_set_size( obj->pool, orphan_block, next_phy - orphan_block - lalloc_b_overhead_size );
+    _block_set_flags( obj->pool, orphan_block, LALLOC_FREE_BLOCK_MASK );
+
+    return orphan_block;
+#endif
+}
+
+#if LALLOC_LAZY_COALESCING == 1
+/**
+   @brief   merges the physically adjacent free blocks, walking the pool from obj->dyn->coalesce_idx.
+            Each visited block costs one unit of budget. The walk stops when the budget is spent, when a whole lap of the
+            pool was walked without merging anything, or when a merged block reaches need bytes.
+            Only the blocks flagged as free are merged: the reservations and the allocated blocks are not touched.
+            NOT THREAD SAFE
+
+   @param obj
+   @param budget        maximum number of visited blocks
+   @param need          the walk stops when a merged block has at least this size
+   @return true         there might be adjacent free blocks left
+   @return false        the last lap of the pool did not find adjacent free blocks
+ */
+bool _coalesce_step( LALLOC_T *obj, LALLOC_IDX_TYPE budget, LALLOC_IDX_TYPE need )
+{
+    LALLOC_IDX_TYPE idx = obj->dyn->coalesce_idx;
+
+    while ( obj->dyn->coalesce_clean < obj->size && budget > 0 )
+    {
+        LALLOC_IDX_TYPE next_phy = _block_get_next_phy( obj->pool, idx );
+
+        budget--;
+
+        if ( next_phy != obj->size && _block_is_free( obj->pool, idx ) && _block_is_free( obj->pool, next_phy ) )
+        {
+            /* the next block is absorbed, the cursor stays to absorb the following one too */
+            _flist_remove( obj, idx );
+            _flist_remove( obj, next_phy );
+            LALLOC_BITMAP_CLEAR( obj, next_phy );
+            _block_forget( obj, next_phy, idx );
+
+            next_phy = _block_get_next_phy( obj->pool, next_phy );
+
+            if ( next_phy != obj->size )
+            {
+                LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, idx );
+            }
+
+            _block_set_size( obj->pool, idx, next_phy - idx - lalloc_b_overhead_size );
+            _block_set_flags( obj->pool, idx, LALLOC_FREE_BLOCK_MASK );
+            _flist_add( obj, idx );
+
+            obj->dyn->coalesce_clean = 0;
+
+            if ( _block_get_size( obj->pool, idx ) >= need )
+            {
+                break;
+            }
+        }
+        else
+        {
+            LALLOC_IDX_TYPE step = next_phy - idx;
+
+            /* saturated at the size of the pool, which means a clean lap */
+            obj->dyn->coalesce_clean = ( obj->size - obj->dyn->coalesce_clean > step ) ? obj->dyn->coalesce_clean + step : obj->size;
+
+            idx = ( next_phy == obj->size ) ? 0 : next_phy;
+        }
+    }
+
+    obj->dyn->coalesce_idx = idx;
+
+    return obj->dyn->coalesce_clean < obj->size;
+}
+
+/**
+   @brief   merges free blocks, without a budget, only if the largest free block is smaller than need.
+            NOT THREAD SAFE
+
+   @param obj
+   @param need
+ */
+void _coalesce_for( LALLOC_T *obj, LALLOC_IDX_TYPE need )
+{
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+
+    if ( LALLOC_IDX_INVALID == largest || _block_get_size( obj->pool, largest ) < need )
+    {
+        _coalesce_step( obj, LALLOC_IDX_INVALID, need );
+    }
+}
+
+#define LALLOC_COALESCE_FOR( OBJ, NEED )    _coalesce_for( OBJ, NEED )
+#else
+#define LALLOC_COALESCE_FOR( OBJ, NEED )
+#endif
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+/**
+   @brief   position in the ring of the nth oldest allocated block.
+
+   @param obj
+   @param n
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_INLINE LALLOC_IDX_TYPE _ring_pos( LALLOC_T *obj, LALLOC_IDX_TYPE n )
+{
+    uint32_t pos = ( uint32_t )obj->dyn->ring_head + n;
+
+    return ( LALLOC_IDX_TYPE )( ( pos >= LALLOC_ALLOC_RING_SIZE ) ? pos - LALLOC_ALLOC_RING_SIZE : pos );
+}
+
+/**
+   @brief   adds the newest allocated block to the ring.
+            It must be called before incrementing allocated_blocks.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+ */
+void _ring_push( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    obj->dyn->ring[_ring_pos( obj, obj->dyn->allocated_blocks )] = block_idx;
+}
+
+/**
+   @brief   removes an allocated block from the ring, keeping the order of the rest.
+            O(1) for the oldest and the newest blocks. Otherwise the shortest side of the ring is shifted.
+            It must be called before decrementing allocated_blocks.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+ */
+void _ring_remove( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE cnt = obj->dyn->allocated_blocks;
+    LALLOC_IDX_TYPE i;
+
+    /* look for the block, starting from both ends */
+    for ( i = 0; i < cnt; i++ )
+    {
+        if ( obj->dyn->ring[_ring_pos( obj, i )] == block_idx )
+        {
+            break;
+        }
+
+        if ( obj->dyn->ring[_ring_pos( obj, cnt - i - 1 )] == block_idx )
+        {
+            i = cnt - i - 1;
+            break;
+        }
+    }
+
+    LALLOC_ASSERT( i < cnt );
+
+    if ( i < cnt / 2 )
+    {
+        /* closer to the oldest, the older blocks are shifted one position */
+        for ( ; i > 0; i-- )
+        {
+            obj->dyn->ring[_ring_pos( obj, i )] = obj->dyn->ring[_ring_pos( obj, i - 1 )];
+        }
+
+        obj->dyn->ring_head = _ring_pos( obj, 1 );
+    }
+    else
+    {
+        /* closer to the newest, the newer blocks are shifted one position */
+        for ( ; i < cnt - 1; i++ )
+        {
+            obj->dyn->ring[_ring_pos( obj, i )] = obj->dyn->ring[_ring_pos( obj, i + 1 )];
+        }
+    }
+}
+
+#if LALLOC_COMPACTION == 1
+/**
+   @brief   replaces an allocated block of the ring by the new index of the block, when it was moved.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @param new_idx
+ */
+void _ring_replace( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx, LALLOC_IDX_TYPE new_idx )
+{
+    LALLOC_IDX_TYPE i;
+
+    for ( i = 0; i < obj->dyn->allocated_blocks; i++ )
+    {
+        if ( obj->dyn->ring[_ring_pos( obj, i )] == block_idx )
+        {
+            obj->dyn->ring[_ring_pos( obj, i )] = new_idx;
+            break;
+        }
+    }
+}
+#endif
+#endif
+
+#if LALLOC_COMPACTION == 1
+/**
+   @brief   position of a block in the table of pinned blocks.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @return LALLOC_IDX_TYPE  position, LALLOC_IDX_INVALID if the block is not pinned
+ */
+LALLOC_IDX_TYPE _pin_find( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE i;
+
+    for ( i = 0; i < obj->dyn->pin_count; i++ )
+    {
+        if ( obj->dyn->pins[i] == block_idx )
+        {
+            return i;
+        }
+    }
+
+    return LALLOC_IDX_INVALID;
+}
+
+/**
+   @brief   unpins a block, if it was pinned.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @return true if the block was pinned
+ */
+bool _pin_drop( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE i = ( obj->dyn->pin_count > 0 ) ? _pin_find( obj, block_idx ) : LALLOC_IDX_INVALID;
+
+    if ( i != LALLOC_IDX_INVALID )
+    {
+        /* the order does not matter, the last one takes its place */
+        obj->dyn->pins[i] = obj->dyn->pins[--obj->dyn->pin_count];
+    }
+
+    return i != LALLOC_IDX_INVALID;
+}
+
+#define LALLOC_PIN_DROP( OBJ, IDX )         _pin_drop( OBJ, IDX )
+#else
+#define LALLOC_PIN_DROP( OBJ, IDX )
+#endif
+
+/**
+   @brief   tells if an index of the pool is the header of a committed block, checking it against the block that follows
+            it: the next block is the end of the pool, or a whole header that points back to it. The block that precedes
+            it is not checked.
+            Those fields do not change while the block is allocated, so lalloc_free can check an address with
+            LALLOC_DEFERRED_FREE==1 without the critical section. It does not tell the block reserved by lalloc_alloc.
+
+   @param obj
+   @param block_idx     any index of the pool
+   @return bool
+ */
+bool _block_is_committed( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    bool rv = false;
+
+    if ( block_idx % LALLOC_ALIGNMENT == 0 && block_idx <= obj->size - lalloc_b_overhead_size &&
+            !_block_is_free( obj->pool, block_idx ) && !_block_is_reserved( obj->pool, block_idx ) )
+    {
+        LALLOC_IDX_TYPE next_phy = _block_get_next_phy( obj->pool, block_idx );
+
+        if ( next_phy == obj->size )
+        {
+            rv = true;
+        }
+        else if ( next_phy > block_idx && next_phy <= obj->size - lalloc_b_overhead_size )
+        {
+            rv = LALLOC_BLOCK_PREVPHYS( obj->pool, next_phy ) == block_idx;
+        }
+    }
+
+    return rv;
+}
+
+/**
+   @brief   removes the block of a given address from the allocated list.
+            This is an internal method for lalloc operation
+            NOT THREAD SAFE
+   @param obj
+   @param addr
+   @return LALLOC_IDX_TYPE  the orphan block, LALLOC_IDX_INVALID if addr is not an allocated block
+ */
+LALLOC_IDX_TYPE _block_alloc_unlink( LALLOC_T *obj, void *addr )
+{
+    LALLOC_IDX_TYPE orphan_idx = LALLOC_IDX_INVALID;
+
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        /* Remove the addr from the alocated list. */
+        LALLOC_IDX_TYPE idx = _block_list_find_by_ref( obj, obj->dyn->alist, ( uint8_t * )addr );
+
+        if ( LALLOC_IDX_INVALID != idx )
+        {
+            orphan_idx = _block_list_remove_block( obj->pool, &( obj->dyn->alist ), idx );
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+            _ring_remove( obj, orphan_idx );
+#endif
+
+            /* a freed block is not pinned anymore */
+            LALLOC_PIN_DROP( obj, orphan_idx );
+            LALLOC_STATS_USED( obj, orphan_idx, -1 );
+            LALLOC_TRACE_EVENT( obj, LALLOC_EV_FREE, 0, LALLOC_TRACE_OFFSET( obj, orphan_idx ) );
+
+            obj->dyn->allocated_blocks--;
+        }
+    }
+
+    return orphan_idx;
+}
+
+/**
+   @brief   moves a block from the allocated list to the free list.
+            This is an internal method for lalloc operation
+            NOT THREAD SAFE
+   @param obj
+   @param addr
+   @return int
+ */
+bool _block_move_from_alloc_to_free( LALLOC_T *obj, void *addr )
+{
+    LALLOC_IDX_TYPE orphan_idx = _block_alloc_unlink( obj, addr );
+
+    if ( LALLOC_IDX_INVALID != orphan_idx )
+    {
+        _flist_add( obj, _block_join_adjacent( obj, orphan_idx ) );
+    }
+
+    return LALLOC_IDX_INVALID != orphan_idx;
+}
+
+/**
+   @brief   adds an orphan block to a chain of blocks to be freed by _batch_flush.
+            The blocks of the chain are flagged as free, linked by their next index, and their previous index is
+            invalid (a free block in the free list always has a valid one).
+            NOT THREAD SAFE
+
+   @param obj
+   @param idx
+   @param chain     first block of the chain, LALLOC_IDX_INVALID if it is empty
+ */
+void _batch_push( LALLOC_T *obj, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE *chain )
+{
+    LALLOC_SET_BLOCK_NEXT( obj->pool, idx, *chain );
+    LALLOC_SET_BLOCK_PREV( obj->pool, idx, LALLOC_IDX_INVALID );
+    _block_set_flags( obj->pool, idx, LALLOC_FREE_BLOCK_MASK );
+
+    *chain = idx;
+}
+
+/**
+   @brief   moves a chain of blocks made with _batch_push to the free list.
+            Each run of physically adjacent blocks of the chain is merged in a single pass, joined with the free
+            blocks around it, and added to the free list once.
+            NOT THREAD SAFE
+
+   @param obj
+   @param chain
+ */
+void _batch_flush( LALLOC_T *obj, LALLOC_IDX_TYPE chain )
+{
+    while ( chain != LALLOC_IDX_INVALID )
+    {
+        LALLOC_IDX_TYPE idx = chain;
+        LALLOC_IDX_TYPE prev_phy;
+        LALLOC_IDX_TYPE next_phy;
+
+        LALLOC_GET_BLOCK_NEXT( obj->pool, idx, chain );
+
+#if LALLOC_LAZY_COALESCING == 0
+        if ( !_block_is_free( obj->pool, idx ) )
+        {
+            /* it was merged in the run of a previous block of the chain */
+            continue;
+        }
+
+        prev_phy = _block_get_prev_phy( obj->pool, idx );
+
+        if ( prev_phy != LALLOC_IDX_INVALID &&
+                _block_is_free( obj->pool, prev_phy ) && LALLOC_BLOCK_PREV( obj->pool, prev_phy ) == LALLOC_IDX_INVALID )
+        {
+            /* it is not the first block of its run, it will be merged when the first one is reached */
+            continue;
+        }
+
+        /* the rest of the run is merged into its first block. The merged headers are flagged as used, so they are skipped */
+        next_phy = _block_get_next_phy( obj->pool, idx );
+
+        while ( next_phy != obj->size &&
+                _block_is_free( obj->pool, next_phy ) && LALLOC_BLOCK_PREV( obj->pool, next_phy ) == LALLOC_IDX_INVALID )
+        {
+            _block_set_flags( obj->pool, next_phy, LALLOC_USED_BLOCK_MASK );
+            LALLOC_BITMAP_CLEAR( obj, next_phy );
+            _block_forget( obj, next_phy, idx );
+
+            next_phy = _block_get_next_phy( obj->pool, next_phy );
+        }
+
+        if ( next_phy != obj->size )
+        {
+            LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, idx );
+        }
+
+        _block_set_size( obj->pool, idx, next_phy - idx - lalloc_b_overhead_size );
+        _block_set_flags( obj->pool, idx, LALLOC_FREE_BLOCK_MASK );
+#else
+        ( void ) prev_phy;
+        ( void ) next_phy;
+#endif
+
+        /* the run is joined with the free blocks around it, which are already in the free list */
+        _flist_add( obj, _block_join_adjacent( obj, idx ) );
+    }
+}
+
+#if LALLOC_DEFERRED_FREE == 1
+/**
+   @brief   frees the queued blocks that _deferred_drain could not reach: the allocated blocks with the queued mark set.
+            It walks the whole allocated list, so it only runs when the queue has an entry that is not a queued block.
+            NOT THREAD SAFE
+
+   @param obj
+   @param chain     chain of _batch_push where the blocks are added
+ */
+void _deferred_recover( LALLOC_T *obj, LALLOC_IDX_TYPE *chain )
+{
+    LALLOC_IDX_TYPE n = obj->dyn->allocated_blocks;
+    LALLOC_IDX_TYPE idx = obj->dyn->alist;
+
+    while ( n-- > 0 )
+    {
+        LALLOC_IDX_TYPE next;
+
+        LALLOC_GET_BLOCK_NEXT( obj->pool, idx, next );
+
+        if ( LALLOC_BLOCK_QUEUED( obj->pool, idx ) == 1 )
+        {
+            _batch_push( obj, _block_alloc_unlink( obj, obj->pool + idx + lalloc_b_overhead_size ), chain );
+        }
+
+        idx = next;
+    }
+}
+
+/**
+   @brief   moves the blocks queued by lalloc_free to the free list, with a single coalescing pass.
+            The whole queue is taken at once, lalloc_free can keep pushing meanwhile.
+            lalloc_free only queues committed blocks, but the link kept in the payload of a block is lost if the block is
+            freed twice and reused in between. When an entry is not a queued block, the rest of the blocks are found
+            in the allocated list, and it is counted in the free_failures statistic.
+            NOT THREAD SAFE
+
+   @param obj
+ */
+void _deferred_drain( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE chain = LALLOC_IDX_INVALID;
+    LALLOC_IDX_TYPE idx;
+
+    if ( LALLOC_ATOMIC_LOAD( &obj->dyn->deferred ) == LALLOC_IDX_INVALID )
+    {
+        /* nothing was freed */
+        return;
+    }
+
+    idx = LALLOC_ATOMIC_XCHG( &obj->dyn->deferred, LALLOC_IDX_INVALID );
+
+    while ( idx != LALLOC_IDX_INVALID )
+    {
+        uint8_t *addr = obj->pool + idx + lalloc_b_overhead_size;
+        LALLOC_IDX_TYPE next;
+
+        if ( _block_is_committed( obj, idx ) && idx != obj->dyn->alloc_block && LALLOC_BLOCK_QUEUED( obj->pool, idx ) == 1 )
+        {
+            /* the link is read before the block is touched */
+            memcpy( &next, addr, sizeof( next ) );
+
+            idx = _block_alloc_unlink( obj, addr );
+        }
+        else
+        {
+            idx = LALLOC_IDX_INVALID;
+        }
+
+        if ( idx == LALLOC_IDX_INVALID )
+        {
+            /* the link that led here cannot be trusted */
+            LALLOC_STATS_INC( obj, free_failures );
+            _deferred_recover( obj, &chain );
+            break;
+        }
+
+        _batch_push( obj, idx, &chain );
+
+        idx = next;
+    }
+
+    _batch_flush( obj, chain );
+
+    /* the getters drain the queue too, the lock free readers see it */
+    LALLOC_SEQ_PUBLISH( obj );
+}
+
+#define LALLOC_DEFERRED_DRAIN( OBJ )        _deferred_drain( OBJ )
+#else
+#define LALLOC_DEFERRED_DRAIN( OBJ )
+#endif
+
+/**
+   @brief   splits a block that is not in any list, keeping size bytes for it. The rest becomes a new free block.
+            If the rest is too small to be a block, the block is not splitted.
+            NOT THREAD SAFE
+
+   @param obj
+   @param idx               block to be splitted
+   @param size              aligned size to keep, not bigger than the size of the block
+   @return LALLOC_IDX_TYPE  the final size of the block
+ */
+LALLOC_IDX_TYPE _block_split( LALLOC_T *obj, LALLOC_IDX_TYPE idx, LALLOC_IDX_TYPE size )
+{
+    LALLOC_IDX_TYPE block_size = _block_get_size( obj->pool, idx );
+    LALLOC_IDX_TYPE new_block_size = block_size - size;
+
+    /* calculation of the new block position
+    |<-- size ------>|              |
+    |<---- block_size -------------->|
+                        |
+                        \new_block_idx
+    */
+    if ( new_block_size < lalloc_b_overhead_size + LALLOC_MIN_PAYLOAD_SIZE )
+    {
+        /* the block wont be splitted */
+        return block_size;
+    }
+
+    /* set the new size of the block with the provided size, keeping its flags */
+    LALLOC_IDX_TYPE flags = _block_is_free( obj->pool, idx ) ? LALLOC_FREE_BLOCK_MASK : LALLOC_USED_BLOCK_MASK;
+    _block_set_size( obj->pool, idx, size );
+    _block_set_flags( obj->pool, idx, flags );
+
+    LALLOC_IDX_TYPE new_block_idx = LALLOC_NEXT_BLOCK_IDX( idx, size );
+
+    /* You have to separate the block, and insert the new */
+    new_block_size = new_block_size - lalloc_b_overhead_size;
+
+    /* sets the size of the new block */
+    _block_set_size( obj->pool, new_block_idx, new_block_size );
+    _block_set_flags( obj->pool, new_block_idx, LALLOC_FREE_BLOCK_MASK );
+    LALLOC_BITMAP_SET( obj, new_block_idx );
+
+    /* next physical to the new block */
+    LALLOC_IDX_TYPE next_physical = _block_get_next_phy( obj->pool, new_block_idx );
+
+    /* set the previous phy to the new block */
+    LALLOC_SET_BLOCK_PREVPHYS( obj->pool, new_block_idx, idx );
+
+    if ( next_physical != obj->size )
+    {
+        /* if the next phy of the removed block is not the boundry, set the previous phy of it */
+        LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_physical, new_block_idx );
+    }
+
+#if LALLOC_ALLOW_JOINING_WHEN_COMMITTING==1
+    new_block_idx = _block_join_adjacent( obj, new_block_idx );
+#endif
+
+    /* add the block to free list */
+    _flist_add( obj, new_block_idx );
+
+    return size;
+}
+
+/**
+   @brief   commits a block that is not in any list: it is shrunk to size and it is added to the allocated list.
+            NOT THREAD SAFE
+
+   @param obj
+   @param orphan_idx
+   @param size              aligned size to commit, not bigger than the size of the block
+ */
+void _block_commit( LALLOC_T *obj, LALLOC_IDX_TYPE orphan_idx, LALLOC_IDX_TYPE size )
+{
+    _block_set_flags( obj->pool, orphan_idx, LALLOC_USED_BLOCK_MASK );
+    _block_split( obj, orphan_idx, size );
+
+#if LALLOC_DEFERRED_FREE == 1
+    /* the block can be freed again */
+    LALLOC_BLOCK_QUEUED( obj->pool, orphan_idx ) = 0;
+#endif
+
+    /* add the block to allocated list */
+    _block_list_add_before( obj->pool, &( obj->dyn->alist ), orphan_idx );
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+    _ring_push( obj, orphan_idx );
+#endif
+
+    obj->dyn->allocated_blocks++;
+
+    LALLOC_STATS_USED( obj, orphan_idx, 1 );
+
+#if LALLOC_SPSC == 1
+    /* publishes the block (and the ring entry) to the consumer */
+    LALLOC_ATOMIC_STORE( &obj->dyn->spsc_committed, ( LALLOC_IDX_TYPE )( obj->dyn->spsc_committed + 1 ) );
+#endif
+}
+
+#if LALLOC_SPSC == 1
+/**
+   @brief   moves the blocks released by the consumer to the free list.
+            The released blocks are always the oldest ones, from ring_head on.
+            PRODUCER SIDE ONLY
+
+   @param obj
+ */
+void _spsc_reclaim( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE released = LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_released );
+
+    /* committed - allocated_blocks is the number of blocks already reclaimed */
+    while ( ( LALLOC_IDX_TYPE )( obj->dyn->spsc_committed - obj->dyn->allocated_blocks ) != released )
+    {
+        LALLOC_IDX_TYPE orphan_idx = _block_list_remove_block( obj->pool, &( obj->dyn->alist ), obj->dyn->ring[obj->dyn->ring_head] );
+
+        LALLOC_STATS_USED( obj, orphan_idx, -1 );
+
+        orphan_idx = _block_join_adjacent( obj, orphan_idx );
+
+        _flist_add( obj, orphan_idx );
+
+        obj->dyn->ring_head = _ring_pos( obj, 1 );
+        obj->dyn->allocated_blocks--;
+    }
+}
+#endif
+
+/**
+   @brief Constructs in runtime a new lalloc_t object.
+
+   @param size      pool size
+   @return void*    handler to the new lalloc_t object
+ */
+void *lalloc_ctor( LALLOC_IDX_TYPE size )
+{
+    lalloc_t *rv = ( lalloc_t * )malloc( sizeof( lalloc_t ) );
+
+    if ( rv != NULL )
+    {
+        rv->size = size;
+
+        rv->pool = ( uint8_t * )malloc( rv->size );
+        // rv->pool = ( uint8_t * ) aligned_alloc( LALLOC_ALIGNMENT , rv->size );
+
+        if ( rv->pool != NULL )
+        {
+            rv->dyn = ( lalloc_dyn_t * )malloc( sizeof( lalloc_dyn_t ) );
+
+#if LALLOC_BLOCK_BITMAP == 1
+            if ( rv->dyn != NULL )
+            {
+                rv->bitmap = ( uint32_t * )malloc( LALLOC_BITMAP_WORDS( size ) * sizeof( uint32_t ) );
+
+                if ( rv->bitmap == NULL )
+                {
+                    free( rv->dyn );
+                    rv->dyn = NULL;
+                }
+            }
+#endif
+
+            if ( rv->dyn != NULL )
+            {
+                lalloc_init( rv );
+            }
+            else
+            {
+                free( rv->pool );
+                free( rv );
+                rv = NULL;
+            }
+        }
+        else
+        {
+            free( rv );
+            rv = NULL;
+        }
+    }
+
+    return rv;
+}
+
+void lalloc_dtor( void *me )
+{
+    lalloc_deinit( ( lalloc_t * )me );
+
+#if LALLOC_BLOCK_BITMAP == 1
+    free( ( ( lalloc_t * )me )->bitmap );
+#endif
+    free( ( ( lalloc_t * )me )->dyn );
+    free( ( ( lalloc_t * )me )->pool );
+    free( ( ( lalloc_t * )me ) );
+}
+
+/* ==PUBLIC METHODS================================================================================== */
+
+/**
+   @brief it clears the object
+
+   @param obj
+ */
+void lalloc_clear( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_START;
+
+    /* initialize the object data */
+    obj->dyn->flist = LALLOC_IDX_INVALID;
+    obj->dyn->alist = LALLOC_IDX_INVALID;
+    obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+    obj->dyn->allocated_blocks = 0;
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+    obj->dyn->ring_head = 0;
+#endif
+
+#if LALLOC_DEFERRED_FREE == 1
+    obj->dyn->deferred = LALLOC_IDX_INVALID;
+#endif
+
+#if LALLOC_LAZY_COALESCING == 1
+    obj->dyn->coalesce_idx = 0;
+    obj->dyn->coalesce_clean = obj->size;
+#endif
+
+#if LALLOC_COMPACTION == 1
+    obj->dyn->compact_idx = 0;
+    obj->dyn->compact_moved = 0;
+    obj->dyn->pin_count = 0;
+#endif
+
+#if LALLOC_SPSC == 1
+    obj->dyn->spsc_committed = 0;
+    obj->dyn->spsc_released = 0;
+#endif
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    obj->dyn->fl_bitmap = 0;
+    memset( obj->dyn->sl_bitmap, 0, sizeof( obj->dyn->sl_bitmap ) );
+    memset( obj->dyn->fheads, 0xFF, sizeof( obj->dyn->fheads ) );  /* LALLOC_IDX_INVALID */
+#endif
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+    obj->dyn->flist_max = LALLOC_IDX_INVALID;
+    obj->dyn->flist_max_size = 0;
+#endif
+
+#if LALLOC_STATS == 1
+    memset( &obj->dyn->stats, 0, sizeof( obj->dyn->stats ) );
+#endif
+
+    /* initialice the only free block available (flist) */
+    LALLOC_IDX_TYPE block_size = obj->size - lalloc_b_overhead_size;
+    _block_set( obj->pool, 0, block_size, 0, 0, 0 );
+    _block_set_flags( obj->pool, 0, LALLOC_FREE_BLOCK_MASK );
+    _flist_add( obj, 0 );
+
+#if LALLOC_STATS == 1
+    obj->dyn->stats.min_free_bytes = obj->dyn->stats.free_bytes;
+#endif
+
+#if LALLOC_BLOCK_BITMAP == 1
+    memset( obj->bitmap, 0, LALLOC_BITMAP_WORDS( obj->size ) * sizeof( uint32_t ) );
+    LALLOC_BITMAP_SET( obj, 0 );
+#endif
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief initializes the object and its critical section (the mutex with LALLOC_MUTEX). With a mutex, it must be
+          called once before the object is shared, lalloc_clear empties it afterwards.
+
+   @param obj
+ */
+void lalloc_init( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_INIT;
+
+#if LALLOC_SEQLOCK == 1
+    obj->dyn->seq = 0;
+#endif
+
+    lalloc_clear( obj );
+
+#if LALLOC_TRACE == 1
+    obj->dyn->trace_cb = NULL;
+#endif
+
+#if LALLOC_PROFILE == 1
+    lalloc_profile_reset( obj );
+#endif
+}
+
+/**
+   @brief releases the resources of the critical section of the object (the mutex with LALLOC_MUTEX).
+          The object must not be used after it, unless lalloc_init is called again.
+
+   @param obj
+ */
+void lalloc_deinit( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_DEINIT;
+}
+
+/**
+   @brief   makes a free block the reservation of lalloc_alloc. The block stays in the free list, marked as used.
+            NOT THREAD SAFE
+
+   @param obj
+   @param idx
+   @param addr      return of the address
+   @param size      return of the size of the block
+ */
+void _block_reserve( LALLOC_T *obj, LALLOC_IDX_TYPE idx, void **addr, LALLOC_IDX_TYPE *size )
+{
+    _block_get_data( obj->pool, idx, ( uint8_t ** )addr, size );
+
+    /* when an allocation takes place, the block is mark as not free (without the bit set) */
+    _block_set_flags( obj->pool, idx, LALLOC_USED_BLOCK_MASK );
+
+    obj->dyn->alloc_block = idx;
+}
+
+/**
+   @brief it request a memory space to the object
+
+   @param obj       reference to obj to work with
+   @param addr      return of the address
+   @param size      return of the size of the block
+ */
+void lalloc_alloc( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_SPSC == 1
+    _spsc_reclaim( obj );
+#endif
+
+    LALLOC_COALESCE_FOR( obj, LALLOC_LAZY_COALESCING_MIN_ALLOC );
+
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+
+    /* Take the flist element (the first) and return your information, and remove the flist block. */
+    if ( LALLOC_IDX_INVALID != largest )
+    {
+        /* If the free list has some block, the first block will be the highest size one.
+           The alloc function returns the first block in the free list */
+        _block_reserve( obj, largest, addr, size );
+    }
+    else
+    {
+        /* there isn't any block in the list  */
+        *addr = NULL;
+        *size = 0;
+
+        LALLOC_STATS_INC( obj, alloc_failures );
+    }
+
+    LALLOC_TRACE_EVENT( obj, LALLOC_EV_ALLOC, *size, 0 );
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_SIDE_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_ALLOC );
+}
+
+/**
+   @brief Like lalloc_alloc, but the reservation is capped to max bytes. The largest free block is splitted up front
+          and the rest of it goes back to the free list, so lalloc_get_free_space and the other reservations
+          see it while the area is being filled.
+
+   @param obj
+   @param addr  address of the reserved area, NULL if there is no free space
+   @param size  size of the reserved area, up to max (aligned)
+   @param max   maximum size of the reserved area
+ */
+void lalloc_alloc_max( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE max )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_SPSC == 1
+    _spsc_reclaim( obj );
+#endif
+
+    LALLOC_COALESCE_FOR( obj, max );
+
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+
+    if ( LALLOC_IDX_INVALID != largest )
+    {
+        if ( max < _block_get_size( obj->pool, largest ) )
+        {
+            /* the block is marked as used before splitting it, so the rest is not joined back to it */
+            _flist_remove( obj, largest );
+            _block_set_flags( obj->pool, largest, LALLOC_USED_BLOCK_MASK );
+            _block_split( obj, largest, LALLOC_ALIGN_ROUND_UP( max ) );
+            _flist_add( obj, largest );
+        }
+
+        _block_reserve( obj, largest, addr, size );
+    }
+    else
+    {
+        /* there isn't any block in the list  */
+        *addr = NULL;
+        *size = 0;
+
+        LALLOC_STATS_INC( obj, alloc_failures );
+    }
+
+    LALLOC_TRACE_EVENT( obj, LALLOC_EV_ALLOC_MAX, max, *size );
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_SIDE_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_ALLOC_MAX );
+}
+
+/**
+   @brief reverts the alloc operation
+
+   @param obj
+ */
+void lalloc_alloc_revert( LALLOC_T *obj )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    LALLOC_IDX_TYPE idx = obj->dyn->alloc_block;
+
+    if ( idx != LALLOC_IDX_INVALID )
+    {
+        LALLOC_IDX_TYPE prev_phy = _block_get_prev_phy( obj->pool, idx );
+        LALLOC_IDX_TYPE next_phy = _block_get_next_phy( obj->pool, idx );
+
+        if ( ( prev_phy != LALLOC_IDX_INVALID && _block_is_free( obj->pool, prev_phy ) ) ||
+                ( next_phy != obj->size && _block_is_free( obj->pool, next_phy ) ) )
+        {
+            /* the block was splitted by lalloc_alloc_max, it is joined again with the free blocks around it */
+            _flist_add( obj, _block_join_adjacent( obj, _flist_remove( obj, idx ) ) );
+        }
+        else
+        {
+            /* the reserved block never left the free list, it is just marked as free again */
+            _block_set_flags( obj->pool, idx, LALLOC_FREE_BLOCK_MASK );
+        }
+
+        obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+
+        LALLOC_TRACE_EVENT( obj, LALLOC_EV_ALLOC_REVERT, 0, 0 );
+    }
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_SIDE_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_ALLOC_REVERT );
+}
+
+/**
+   @brief   commits the reservation of lalloc_alloc with an aligned size. NOT THREAD SAFE
+
+   @param obj
+   @param size
+   @return true if the operation success
+ */
+bool _alloc_block_commit( LALLOC_T *obj, LALLOC_IDX_TYPE size )
+{
+    bool rv;
+
+    if ( obj->dyn->alloc_block != LALLOC_IDX_INVALID
+#if LALLOC_ALLOC_RING_SIZE > 0
+            && obj->dyn->allocated_blocks < LALLOC_ALLOC_RING_SIZE
+#endif
+       )
+    {
+        LALLOC_IDX_TYPE block_size;
+
+        /* SIZE VALIDATION */
+        block_size = _block_get_size( obj->pool, obj->dyn->alloc_block );
+        LALLOC_ASSERT( _block_is_free( obj->pool, obj->dyn->alloc_block ) == false );
+
+        if ( size <= block_size )
+        {
+            /* removes the reserved block from the free list, and commits it */
+            _block_commit( obj, _flist_remove( obj, obj->dyn->alloc_block ), size );
+
+            obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+
+            rv = true;
+        }
+        else
+        {
+            /* the user wants to allocate a buffer bigger than the max.
+               WARNING: did the user fill the buffer beyond block_size? if yes, KATAPUM */
+            rv = false;
+        }
+    }
+    else
+    {
+        /* there is no previous allocation (or the ring of allocated blocks is full) */
+        rv = false;
+    }
+
+    if ( !rv )
+    {
+        LALLOC_STATS_INC( obj, commit_failures );
+    }
+
+    return rv;
+}
+
+/**
+   @brief commits the previous allocated memory block
+
+   @param obj
+   @param size
+   @return int 1 if the operation success
+               0 otherwise
+ */
+bool lalloc_commit( LALLOC_T *obj, LALLOC_IDX_TYPE size )
+{
+    LALLOC_PROFILE_ENTER;
+
+    int rv;
+
+    /* all the commited user memory areas are aligned as well */
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
+#endif
+    {
+        LALLOC_SIDE_CRITICAL_START;
+
+#if LALLOC_SPSC == 1
+        /* makes room in the ring */
+        _spsc_reclaim( obj );
+#endif
+
+#if LALLOC_TRACE == 1
+        LALLOC_IDX_TYPE idx = obj->dyn->alloc_block;
+#endif
+
+        rv = _alloc_block_commit( obj, size );
+
+        if ( rv )
+        {
+            LALLOC_TRACE_EVENT( obj, LALLOC_EV_COMMIT, size, LALLOC_TRACE_OFFSET( obj, idx ) );
+        }
+
+        LALLOC_SEQ_PUBLISH( obj );
+        LALLOC_SIDE_CRITICAL_END;
+    }
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    else
+    {
+        /* the commited size is less than de minimum */
+        rv = false;
+    }
+#endif
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_COMMIT );
+
+    return rv;
+}
+
+/**
+   @brief commits the previous allocated memory block and reserves the next one in a single critical section.
+          The rest of the committed block, right after it, becomes the new reservation. If the block was not
+          splitted, the largest free block is reserved instead, like lalloc_alloc does.
+
+   @param obj
+   @param size  size of the block to commit
+   @param addr  address of the new reserved area, NULL if there is no free space or the commit failed
+   @param len   size of the new reserved area
+   @return true if the block was committed. Otherwise the current reservation is kept.
+ */
+bool lalloc_commit_and_alloc( LALLOC_T *obj, LALLOC_IDX_TYPE size, void **addr, LALLOC_IDX_TYPE *len )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv = false;
+
+    /* all the commited user memory areas are aligned as well */
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+    *addr = NULL;
+    *len = 0;
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
+#endif
+    {
+        LALLOC_SIDE_CRITICAL_START;
+
+        LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_SPSC == 1
+        /* makes room in the ring */
+        _spsc_reclaim( obj );
+#endif
+
+        LALLOC_IDX_TYPE idx = obj->dyn->alloc_block;
+        LALLOC_IDX_TYPE block_size = ( idx != LALLOC_IDX_INVALID ) ? _block_get_size( obj->pool, idx ) : 0;
+
+        rv = _alloc_block_commit( obj, size );
+
+        if ( rv )
+        {
+            LALLOC_IDX_TYPE next;
+
+            LALLOC_TRACE_EVENT( obj, LALLOC_EV_COMMIT_AND_ALLOC, size, LALLOC_TRACE_OFFSET( obj, idx ) );
+
+            if ( _block_get_size( obj->pool, idx ) != block_size )
+            {
+                /* the block was splitted, the rest of it is already in the free list */
+                next = _block_get_next_phy( obj->pool, idx );
+            }
+            else
+            {
+                next = _flist_largest( obj );
+            }
+
+            if ( next != LALLOC_IDX_INVALID )
+            {
+                _block_reserve( obj, next, addr, len );
+            }
+            else
+            {
+                LALLOC_STATS_INC( obj, alloc_failures );
+            }
+        }
+
+        LALLOC_SEQ_PUBLISH( obj );
+        LALLOC_SIDE_CRITICAL_END;
+    }
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_COMMIT_AND_ALLOC );
+
+    return rv;
+}
+
+/**
+   @brief Reserves an area of up to max bytes, taken from the largest free block. Unlike lalloc_alloc, the
+          area is carved from the free list right away, so any number of reservations can be outstanding at
+          the same time (e.g. one per producer), and the rest of the pool stays available for the others.
+          The reservation ends with lalloc_commit_h or lalloc_revert_h.
+
+   @param obj
+   @param max       maximum size of the area
+   @param h         handle of the reservation. h->addr and h->size hold the reserved area.
+   @return true     the area was reserved
+   @return false    there is no free space
+ */
+bool lalloc_reserve( LALLOC_T *obj, LALLOC_IDX_TYPE max, lalloc_handle_t *h )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv;
+
+    max = LALLOC_ALIGN_ROUND_UP( max );
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_SPSC == 1
+    _spsc_reclaim( obj );
+#endif
+
+    LALLOC_COALESCE_FOR( obj, max );
+
+    LALLOC_IDX_TYPE idx = _flist_largest( obj );
+
+    if ( idx != LALLOC_IDX_INVALID && idx == obj->dyn->alloc_block )
+    {
+        /* the block reserved by lalloc_alloc stays in the free list, the next largest one is taken */
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+        LALLOC_IDX_TYPE block = obj->dyn->flist;
+
+        idx = LALLOC_IDX_INVALID;
+
+        while ( block != LALLOC_IDX_INVALID )
+        {
+            if ( block != obj->dyn->alloc_block &&
+                    ( idx == LALLOC_IDX_INVALID || _block_get_size( obj->pool, block ) > _block_get_size( obj->pool, idx ) ) )
+            {
+                idx = block;
+            }
+
+            block = _flist_next( obj, block );
+        }
+#else
+        idx = _flist_next( obj, idx );
+#endif
+    }
+
+    if ( idx != LALLOC_IDX_INVALID )
+    {
+        LALLOC_IDX_TYPE size = _block_get_size( obj->pool, idx );
+
+        _flist_remove( obj, idx );
+        _block_set_flags( obj->pool, idx, LALLOC_USED_BLOCK_MASK );
+
+        /* the block is not linked to any list */
+        LALLOC_SET_BLOCK_NEXT( obj->pool, idx, LALLOC_IDX_INVALID );
+        LALLOC_SET_BLOCK_PREV( obj->pool, idx, LALLOC_IDX_INVALID );
+
+        /* the rest of the block goes back to the free list */
+        size = _block_split( obj, idx, ( max < size ) ? max : size );
+
+        h->block = idx;
+        h->addr = LALLOC_BLOCK_DATA( obj->pool, idx );
+        h->size = size;
+
+        rv = true;
+
+        LALLOC_TRACE_EVENT( obj, LALLOC_EV_RESERVE, max, LALLOC_TRACE_OFFSET( obj, idx ) );
+    }
+    else
+    {
+        h->block = LALLOC_IDX_INVALID;
+        h->addr = NULL;
+        h->size = 0;
+
+        rv = false;
+
+        LALLOC_STATS_INC( obj, alloc_failures );
+        LALLOC_TRACE_EVENT( obj, LALLOC_EV_RESERVE, max, 0 );
+    }
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_SIDE_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_RESERVE );
+
+    return rv;
+}
+
+/**
+   @brief commits a reservation made with lalloc_reserve. The unused part of the area goes back to the free list.
+
+   @param obj
+   @param h
+   @param size      size to commit, up to h->size
+   @return true     the block was committed, the handle is released
+   @return false    invalid handle or size (or the ring of allocated blocks is full), the reservation is kept
+ */
+bool lalloc_commit_h( LALLOC_T *obj, lalloc_handle_t *h, LALLOC_IDX_TYPE size )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv = false;
+
+    /* all the commited user memory areas are aligned as well */
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
+#endif
+    {
+        LALLOC_SIDE_CRITICAL_START;
+
+#if LALLOC_SPSC == 1
+        _spsc_reclaim( obj );
+#endif
+
+        if ( h->block != LALLOC_IDX_INVALID && size <= _block_get_size( obj->pool, h->block )
+#if LALLOC_ALLOC_RING_SIZE > 0
+                && obj->dyn->allocated_blocks < LALLOC_ALLOC_RING_SIZE
+#endif
+           )
+        {
+            LALLOC_ASSERT( _block_is_reserved( obj->pool, h->block ) );
+
+            _block_commit( obj, h->block, size );
+
+            LALLOC_TRACE_EVENT( obj, LALLOC_EV_COMMIT_H, size, LALLOC_TRACE_OFFSET( obj, h->block ) );
+
+            h->block = LALLOC_IDX_INVALID;
+            h->addr = NULL;
+            h->size = 0;
+
+            rv = true;
+        }
+        else
+        {
+            LALLOC_STATS_INC( obj, commit_failures );
+        }
+
+        LALLOC_SEQ_PUBLISH( obj );
+        LALLOC_SIDE_CRITICAL_END;
+    }
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_COMMIT_H );
+
+    return rv;
+}
+
+/**
+   @brief reverts a reservation made with lalloc_reserve. The area goes back to the free list.
+
+   @param obj
+   @param h
+ */
+void lalloc_revert_h( LALLOC_T *obj, lalloc_handle_t *h )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_SIDE_CRITICAL_START;
+
+    if ( h->block != LALLOC_IDX_INVALID )
+    {
+        LALLOC_ASSERT( _block_is_reserved( obj->pool, h->block ) );
+
+        LALLOC_TRACE_EVENT( obj, LALLOC_EV_REVERT_H, 0, LALLOC_TRACE_OFFSET( obj, h->block ) );
+
+        _flist_add( obj, _block_join_adjacent( obj, h->block ) );
+
+        h->block = LALLOC_IDX_INVALID;
+        h->addr = NULL;
+        h->size = 0;
+    }
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_SIDE_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_REVERT_H );
+}
+
+#if LALLOC_COMPACTION == 1
+/**
+   @brief   tells if a block can be moved by the compaction: it is allocated, committed and not pinned.
+            NOT THREAD SAFE
+
+   @param obj
+   @param block_idx
+   @return bool
+ */
+bool _compact_is_movable( LALLOC_T *obj, LALLOC_IDX_TYPE block_idx )
+{
+    return !_block_is_free( obj->pool, block_idx ) && block_idx != obj->dyn->alloc_block &&
+           !_block_is_reserved( obj->pool, block_idx ) && _pin_find( obj, block_idx ) == LALLOC_IDX_INVALID;
+}
+
+/**
+   @brief   moves an allocated block to the start of the free block right before it, so the free block ends up right
+            after it, with the same size. The free block leaves the free list, the caller adds it back.
+            NOT THREAD SAFE
+
+   @param obj
+   @param free_idx          free block
+   @param block_idx         allocated block, the next physical block of free_idx
+   @return LALLOC_IDX_TYPE  the new index of the free block
+ */
+LALLOC_IDX_TYPE _compact_move( LALLOC_T *obj, LALLOC_IDX_TYPE free_idx, LALLOC_IDX_TYPE block_idx )
+{
+    LALLOC_IDX_TYPE free_size = _block_get_size( obj->pool, free_idx );
+    LALLOC_IDX_TYPE block_size = _block_get_size( obj->pool, block_idx );
+    LALLOC_IDX_TYPE prev_phy = _block_get_prev_phy( obj->pool, free_idx );
+    LALLOC_IDX_TYPE next_phy = _block_get_next_phy( obj->pool, block_idx );
+    LALLOC_IDX_TYPE prev;
+    LALLOC_IDX_TYPE next;
+
+    _flist_remove( obj, free_idx );
+
+    /* header and payload, the areas might overlap */
+    memmove( obj->pool + free_idx, obj->pool + block_idx, lalloc_b_overhead_size + block_size );
+    LALLOC_SET_BLOCK_PREVPHYS( obj->pool, free_idx, prev_phy );
+
+    /* the neighbours in the allocated list point to the new index */
+    LALLOC_GET_BLOCK_PREV( obj->pool, free_idx, prev );
+    LALLOC_GET_BLOCK_NEXT( obj->pool, free_idx, next );
+
+    if ( next == block_idx )
+    {
+        /* it is the only allocated block */
+        LALLOC_SET_BLOCK_NEXT( obj->pool, free_idx, free_idx );
+        LALLOC_SET_BLOCK_PREV( obj->pool, free_idx, free_idx );
+    }
+    else
+    {
+        LALLOC_SET_BLOCK_NEXT( obj->pool, prev, free_idx );
+        LALLOC_SET_BLOCK_PREV( obj->pool, next, free_idx );
+    }
+
+    if ( obj->dyn->alist == block_idx )
+    {
+        obj->dyn->alist = free_idx;
+    }
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+    _ring_replace( obj, block_idx, free_idx );
+#endif
+
+    _block_forget( obj, block_idx, free_idx );
+    LALLOC_BITMAP_CLEAR( obj, block_idx );
+
+    /* the free block goes right after the moved one */
+    block_idx = LALLOC_NEXT_BLOCK_IDX( free_idx, block_size );
+
+    _block_set_size( obj->pool, block_idx, free_size );
+    _block_set_flags( obj->pool, block_idx, LALLOC_FREE_BLOCK_MASK );
+    LALLOC_SET_BLOCK_PREVPHYS( obj->pool, block_idx, free_idx );
+    LALLOC_BITMAP_SET( obj, block_idx );
+
+    if ( next_phy != obj->size )
+    {
+        LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, block_idx );
+    }
+
+    return block_idx;
+}
+
+/**
+   @brief Slides the allocated blocks towards the start of the pool, a bounded amount of work per call, so the free
+          space between them is gathered in a single block. Each move is notified through relocate_cb.
+          The pool is walked from where the previous call stopped. Each visited block costs its header size of the
+          budget, and each moved block its header and its payload. Adjacent free blocks are merged on the way.
+          The blocks pinned with lalloc_pin, the reservations and the blocks bigger than max_bytes are not moved.
+
+   @param obj
+   @param max_bytes     budget of the call, in bytes
+   @param relocate_cb   called after each move, it can be NULL
+   @return true         the compaction is not finished, lalloc_compact_step should be called again
+   @return false        a whole lap of the pool was walked without moving or merging anything
+ */
+bool lalloc_compact_step( LALLOC_T *obj, LALLOC_IDX_TYPE max_bytes, lalloc_relocate_cb_t relocate_cb )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv = true;
+    LALLOC_IDX_TYPE budget = max_bytes;
+
+    LALLOC_CRITICAL_START;
+
+    /* the queued blocks can not be moved */
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    LALLOC_IDX_TYPE idx = obj->dyn->compact_idx;
+
+    while ( budget >= lalloc_b_overhead_size )
+    {
+        LALLOC_IDX_TYPE next_phy = _block_get_next_phy( obj->pool, idx );
+
+        budget -= lalloc_b_overhead_size;
+
+        if ( next_phy == obj->size )
+        {
+            /* end of the lap */
+            rv = ( obj->dyn->compact_moved != 0 );
+            obj->dyn->compact_moved = 0;
+            idx = 0;
+            break;
+        }
+
+        if ( !_block_is_free( obj->pool, idx ) )
+        {
+            idx = next_phy;
+        }
+        else if ( _block_is_free( obj->pool, next_phy ) )
+        {
+            /* two free blocks, the next one is absorbed */
+            LALLOC_IDX_TYPE size = _block_get_size( obj->pool, idx ) + lalloc_b_overhead_size + _block_get_size( obj->pool, next_phy );
+
+            _flist_remove( obj, idx );
+            _flist_remove( obj, next_phy );
+            LALLOC_BITMAP_CLEAR( obj, next_phy );
+            _block_forget( obj, next_phy, idx );
+
+            next_phy = _block_get_next_phy( obj->pool, next_phy );
+
+            if ( next_phy != obj->size )
+            {
+                LALLOC_SET_BLOCK_PREVPHYS( obj->pool, next_phy, idx );
+            }
+
+            _block_set_size( obj->pool, idx, size );
+            _block_set_flags( obj->pool, idx, LALLOC_FREE_BLOCK_MASK );
+            _flist_add( obj, idx );
+
+            obj->dyn->compact_moved = 1;
+        }
+        else if ( _compact_is_movable( obj, next_phy ) && _block_get_size( obj->pool, next_phy ) <= max_bytes - lalloc_b_overhead_size )
+        {
+            LALLOC_IDX_TYPE size = _block_get_size( obj->pool, next_phy );
+
+            if ( size > budget )
+            {
+                /* the next call will move it */
+                break;
+            }
+
+            budget -= size;
+
+            LALLOC_IDX_TYPE free_idx = _compact_move( obj, idx, next_phy );
+
+            _flist_add( obj, free_idx );
+
+#if LALLOC_LAZY_COALESCING == 1
+            /* the free block might be next to another free block now */
+            obj->dyn->coalesce_clean = 0;
+#endif
+
+            if ( relocate_cb != NULL )
+            {
+                relocate_cb( LALLOC_BLOCK_DATA( obj->pool, next_phy ), LALLOC_BLOCK_DATA( obj->pool, idx ), size );
+            }
+
+            LALLOC_TRACE_EVENT( obj, LALLOC_EV_MOVE, LALLOC_TRACE_OFFSET( obj, idx ), LALLOC_TRACE_OFFSET( obj, next_phy ) );
+
+            obj->dyn->compact_moved = 1;
+            idx = free_idx;
+        }
+        else
+        {
+            /* the free block stays, the walk goes on after the block that can not be moved */
+            idx = next_phy;
+        }
+    }
+
+    obj->dyn->compact_idx = idx;
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_COMPACT_STEP );
+
+    return rv;
+}
+
+/**
+   @brief Pins an allocated block, so lalloc_compact_step does not move it.
+          A block is unpinned when it is freed.
+
+   @param obj
+   @param addr      address of the block, as returned by lalloc_alloc
+   @return true     the block is pinned
+   @return false    addr is not an allocated block, or there are LALLOC_COMPACTION_PINS pinned blocks already
+ */
+bool lalloc_pin( LALLOC_T *obj, void *addr )
+{
+    bool rv = false;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    LALLOC_IDX_TYPE idx = ( obj->dyn->alist != LALLOC_IDX_INVALID ) ? _block_list_find_by_ref( obj, obj->dyn->alist, ( uint8_t * )addr ) : LALLOC_IDX_INVALID;
+
+    if ( idx != LALLOC_IDX_INVALID && idx != obj->dyn->alloc_block )
+    {
+        if ( _pin_find( obj, idx ) != LALLOC_IDX_INVALID )
+        {
+            rv = true;
+        }
+        else if ( obj->dyn->pin_count < LALLOC_COMPACTION_PINS )
+        {
+            obj->dyn->pins[obj->dyn->pin_count++] = idx;
+            rv = true;
+        }
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Unpins a block pinned with lalloc_pin.
+
+   @param obj
+   @param addr      address of the block, as returned by lalloc_alloc
+   @return true     the block was pinned
+ */
+bool lalloc_unpin( LALLOC_T *obj, void *addr )
+{
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_IDX_TYPE idx = ( obj->dyn->alist != LALLOC_IDX_INVALID ) ? _block_list_find_by_ref( obj, obj->dyn->alist, ( uint8_t * )addr ) : LALLOC_IDX_INVALID;
+
+    rv = ( idx != LALLOC_IDX_INVALID ) && _pin_drop( obj, idx );
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+#endif
+
+#if LALLOC_ALLOW_QUEUED_FREES == 1
+#if LALLOC_SPSC == 0
+/**
+   @brief it frees up the last added block
+
+   @param obj
+   @return int
+ */
+bool lalloc_free_last( LALLOC_T *obj )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    /* calculate the index of the 1st byte of the payload */
+    LALLOC_IDX_TYPE idx = obj->dyn->alist + lalloc_b_overhead_size;
+
+    rv = _block_move_from_alloc_to_free( obj, &( obj->pool[idx] ) );
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_FREE_LAST );
+
+    return rv;
+}
+
+#endif
+
+/* it frees up the first added block */
+bool lalloc_free_first( LALLOC_T *obj )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv;
+
+#if LALLOC_SPSC == 1
+    LALLOC_IDX_TYPE released = obj->dyn->spsc_released;
+
+    if ( LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_committed ) != released )
+    {
+        /* the producer will move it to the free list */
+        LALLOC_ATOMIC_STORE( &obj->dyn->spsc_released, ( LALLOC_IDX_TYPE )( released + 1 ) );
+        rv = true;
+    }
+    else
+    {
+        rv = false;
+    }
+#else
+    LALLOC_IDX_TYPE idx;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    /* calculate the index of the 1st byte of the payload */
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        LALLOC_GET_BLOCK_PREV( obj->pool, obj->dyn->alist, idx );
+
+        ( idx ) = LALLOC_BLOCK_PREV( obj->pool, obj->dyn->alist );
+
+        idx += lalloc_b_overhead_size;
+
+        rv = _block_move_from_alloc_to_free( obj, &( obj->pool[idx] ) );
+    }
+    else
+    {
+        rv = false;
+    }
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+#endif
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_FREE_FIRST );
+
+    return rv;
+}
+#endif
+
+/**
+   @brief Frees up the block of a given address.
+
+          which payload includes addr memory address. *
+          lalloc_free(0) must behaves just like lalloc_free_first()
+          if the operation was ok, it return 1. 0 otherwise
+
+   @param obj
+   @param addr
+   @return int
+ */
+bool lalloc_free( LALLOC_T *obj, void *addr )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv;
+    bool in_global_range = ( uint8_t * )addr >= obj->pool && ( uint8_t * )addr < obj->pool + obj->size;
+
+    if ( in_global_range )
+    {
+#if LALLOC_SPSC == 1
+        uint8_t *first;
+        LALLOC_IDX_TYPE size;
+
+        /* the consumer can only release the oldest element */
+        lalloc_get_first( obj, ( void ** )&first, &size );
+
+#if LALLOC_FREE_ANY == 1
+        rv = ( first != NULL && ( uint8_t * )addr >= first && ( uint8_t * )addr < first + size ) ? lalloc_free_first( obj ) : false;
+#else
+        rv = ( first != NULL && ( uint8_t * )addr == first ) ? lalloc_free_first( obj ) : false;
+#endif
+#elif LALLOC_DEFERRED_FREE == 1
+        LALLOC_IDX_TYPE idx = ( uint8_t * )addr - obj->pool;
+
+        uint8_t queued = 1;
+
+        /* only the payload of a committed block is queued, nothing is written otherwise */
+        if ( idx >= lalloc_b_overhead_size && _block_is_committed( obj, idx - lalloc_b_overhead_size ) &&
+                _block_get_size( obj->pool, idx - lalloc_b_overhead_size ) >= sizeof( LALLOC_IDX_TYPE ) &&
+                idx - lalloc_b_overhead_size != LALLOC_ATOMIC_LOAD( &obj->dyn->alloc_block ) )
+        {
+            queued = 0;
+
+            /* marks the block as queued, a block that is already queued is not pushed twice (the CAS is weak, it is
+               retried while the mark is clear) */
+            while ( !LALLOC_ATOMIC_CAS( &LALLOC_BLOCK_QUEUED( obj->pool, idx - lalloc_b_overhead_size ), &queued, 1 ) && queued == 0 )
+            {
+            }
+        }
+
+        if ( queued == 0 )
+        {
+            LALLOC_IDX_TYPE head = LALLOC_ATOMIC_LOAD( &obj->dyn->deferred );
+
+            /* pushes the block onto the queue, the link to the previous top is kept in its payload */
+            do
+            {
+                memcpy( addr, &head, sizeof( head ) );
+            }
+            while ( !LALLOC_ATOMIC_CAS( &obj->dyn->deferred, &head, ( LALLOC_IDX_TYPE )( idx - lalloc_b_overhead_size ) ) );
+
+            rv = true;
+        }
+        else
+        {
+            rv = false;
+        }
+#else
+        LALLOC_CRITICAL_START;
+        // TODO OPTIMIZATION FOR #if LALLOC_ALLOW_QUEUED_FREES==1 AND FREE ANY COMBINATIONS. ALIST IS NOT NEEDED IN SOME CASES.
+        rv = _block_move_from_alloc_to_free( obj, addr );
+        LALLOC_SEQ_PUBLISH( obj );
+        LALLOC_CRITICAL_END;
+#endif
+    }
+    else
+    {
+        rv = false;
+    }
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_FREE );
+
+    return rv;
+}
+
+/**
+   @brief Housekeeping of the object, to be called when the system is idle.
+          With LALLOC_DEFERRED_FREE==1 it moves the blocks queued by lalloc_free to the free list.
+          With LALLOC_LAZY_COALESCING==1 it merges adjacent free blocks, visiting up to budget blocks of the pool.
+
+   @param obj
+   @param budget    maximum number of blocks visited by the coalescing step
+   @return true     there might be adjacent free blocks left, lalloc_maintain should be called again
+   @return false    there is nothing left to do
+ */
+bool lalloc_maintain( LALLOC_T *obj, LALLOC_IDX_TYPE budget )
+{
+    LALLOC_PROFILE_ENTER;
+
+    bool rv = false;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_LAZY_COALESCING == 1
+    rv = _coalesce_step( obj, budget, LALLOC_IDX_INVALID );
+#else
+    ( void ) budget;
+#endif
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_MAINTAIN );
+
+    return rv;
+}
+
+/**
+   @brief Frees up the blocks of n given addresses in a single critical section. The blocks are unlinked first,
+          then each run of physically adjacent blocks is merged once, and each resulting block is added to the free
+          list once.
+
+   @param obj
+   @param addrs
+   @param n
+   @return LALLOC_IDX_TYPE  number of freed blocks. The addresses that do not belong to an allocated block are skipped.
+ */
+LALLOC_IDX_TYPE lalloc_free_batch( LALLOC_T *obj, void *const addrs[], LALLOC_IDX_TYPE n )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_IDX_TYPE rv = 0;
+    LALLOC_IDX_TYPE i;
+
+#if LALLOC_SPSC == 1
+    /* the consumer releases the blocks one by one, the producer merges them */
+    for ( i = 0; i < n; i++ )
+    {
+        if ( lalloc_free( obj, addrs[i] ) )
+        {
+            rv++;
+        }
+    }
+#else
+    LALLOC_IDX_TYPE chain = LALLOC_IDX_INVALID;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    for ( i = 0; i < n; i++ )
+    {
+        if ( ( uint8_t * )addrs[i] >= obj->pool && ( uint8_t * )addrs[i] < obj->pool + obj->size )
+        {
+            LALLOC_IDX_TYPE idx = _block_alloc_unlink( obj, addrs[i] );
+
+            if ( idx != LALLOC_IDX_INVALID )
+            {
+                _batch_push( obj, idx, &chain );
+                rv++;
+            }
+        }
+    }
+
+    _batch_flush( obj, chain );
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+#endif
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_FREE_BATCH );
+
+    return rv;
+}
+
+#if LALLOC_ALLOW_QUEUED_FREES == 1
+/**
+   @brief Frees up the n oldest blocks in a single critical section. The blocks are unlinked first, then each run of
+          physically adjacent blocks is merged once, and each resulting block is added to the free list once.
+
+   @param obj
+   @param n
+   @return LALLOC_IDX_TYPE  number of freed blocks
+ */
+LALLOC_IDX_TYPE lalloc_free_first_n( LALLOC_T *obj, LALLOC_IDX_TYPE n )
+{
+    LALLOC_PROFILE_ENTER;
+
+    LALLOC_IDX_TYPE rv;
+
+#if LALLOC_SPSC == 1
+    LALLOC_IDX_TYPE released = obj->dyn->spsc_released;
+    LALLOC_IDX_TYPE count = ( LALLOC_IDX_TYPE )( LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_committed ) - released );
+
+    rv = ( n < count ) ? n : count;
+
+    /* the producer will move them to the free list */
+    LALLOC_ATOMIC_STORE( &obj->dyn->spsc_released, ( LALLOC_IDX_TYPE )( released + rv ) );
+#else
+    LALLOC_IDX_TYPE chain = LALLOC_IDX_INVALID;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    for ( rv = 0; rv < n && obj->dyn->alist != LALLOC_IDX_INVALID; rv++ )
+    {
+        /* the oldest block is the previous one of the head */
+        LALLOC_IDX_TYPE idx = LALLOC_BLOCK_PREV( obj->pool, obj->dyn->alist );
+
+        idx = _block_list_remove_block( obj->pool, &( obj->dyn->alist ), idx );
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+        _ring_remove( obj, idx );
+#endif
+
+        LALLOC_PIN_DROP( obj, idx );
+        LALLOC_STATS_USED( obj, idx, -1 );
+        LALLOC_TRACE_EVENT( obj, LALLOC_EV_FREE, 0, LALLOC_TRACE_OFFSET( obj, idx ) );
+
+        obj->dyn->allocated_blocks--;
+
+        _batch_push( obj, idx, &chain );
+    }
+
+    _batch_flush( obj, chain );
+
+    LALLOC_SEQ_PUBLISH( obj );
+    LALLOC_CRITICAL_END;
+#endif
+
+    LALLOC_PROFILE_EXIT( obj, LALLOC_OP_FREE_FIRST_N );
+
+    return rv;
+}
+#endif
+
+#if LALLOC_STATS == 1
+/**
+   @brief Takes a snapshot of the statistics of the object. O(1), except for LALLOC_FLIST_LAZY when the cached largest
+          block has to be searched again.
+          With LALLOC_SPSC==1 it must be called by the producer.
+
+   @param obj
+   @param stats
+ */
+void lalloc_get_stats( LALLOC_T *obj, lalloc_stats_t *stats )
+{
+#if LALLOC_SEQLOCK == 1
+    lalloc_status_t status;
+
+    lalloc_get_status( obj, &status );
+
+    *stats = status.stats;
+    stats->largest_free = status.free_space;
+#else
+    LALLOC_SIDE_CRITICAL_START;
+
+    *stats = obj->dyn->stats;
+
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+
+    stats->largest_free = ( largest != LALLOC_IDX_INVALID ) ? _block_get_size( obj->pool, largest ) : 0;
+
+    LALLOC_SIDE_CRITICAL_END;
+#endif
+
+    uint64_t free_sq = ( uint64_t )stats->free_bytes * stats->free_bytes;
+
+    if ( free_sq == 0 )
+    {
+        stats->fragmentation = 0;
+    }
+    else if ( free_sq < ( ( uint64_t )1 << 57 ) )
+    {
+        stats->fragmentation = ( uint8_t )( 100 - ( stats->free_sq_sum * 100 ) / free_sq );
+    }
+    else
+    {
+        /* 100 * free_sq_sum could overflow */
+        stats->fragmentation = ( uint8_t )( 100 - stats->free_sq_sum / ( free_sq / 100 ) );
+    }
+}
+#endif
+
+#if LALLOC_PROFILE == 1
+/* names of the LALLOC_OP_* operations, for lalloc_profile_dump */
+static const char *const lalloc_op_names[LALLOC_OP_COUNT] =
+{
+    "lalloc_alloc",
+    "lalloc_alloc_max",
+    "lalloc_alloc_revert",
+    "lalloc_commit",
+    "lalloc_commit_and_alloc",
+    "lalloc_reserve",
+    "lalloc_commit_h",
+    "lalloc_revert_h",
+    "lalloc_free",
+    "lalloc_free_first",
+    "lalloc_free_last",
+    "lalloc_free_batch",
+    "lalloc_free_first_n",
+    "lalloc_maintain",
+    "lalloc_compact_step",
+};
+
+/**
+   @brief Takes a snapshot of the latency of one operation.
+
+   @param obj
+   @param op        LALLOC_OP_*
+   @param out
+ */
+void lalloc_profile_get( LALLOC_T *obj, uint8_t op, lalloc_profile_op_t *out )
+{
+    if ( op < LALLOC_OP_COUNT )
+    {
+        LALLOC_SIDE_CRITICAL_START;
+        *out = obj->dyn->profile[op];
+        LALLOC_SIDE_CRITICAL_END;
+    }
+    else
+    {
+        memset( out, 0, sizeof( *out ) );
+    }
+}
+
+/**
+   @brief Reports the latency of every operation that was called at least once. The callback is called out of the
+          critical section, with a snapshot of each operation.
+
+   @param obj
+   @param cb
+ */
+void lalloc_profile_dump( LALLOC_T *obj, lalloc_profile_dump_cb_t cb )
+{
+    lalloc_profile_op_t op;
+    uint8_t i;
+
+    for ( i = 0; i < LALLOC_OP_COUNT; i++ )
+    {
+        lalloc_profile_get( obj, i, &op );
+
+        if ( op.count > 0 )
+        {
+            cb( lalloc_op_names[i], &op );
+        }
+    }
+}
+
+/**
+   @brief Clears the histograms of all the operations.
+
+   @param obj
+ */
+void lalloc_profile_reset( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_START;
+    memset( obj->dyn->profile, 0, sizeof( obj->dyn->profile ) );
+    LALLOC_CRITICAL_END;
+}
+#endif
+
+#if LALLOC_TRACE == 1
+/**
+   @brief Sets the receiver of the events of the instance (see LALLOC_EV_*). The delta of the first event is
+          measured from this call.
+
+   @param obj
+   @param cb        called within the critical section after each event, NULL to stop the trace
+   @param ctx       passed to cb
+ */
+void lalloc_trace_set( LALLOC_T *obj, lalloc_trace_cb_t cb, void *ctx )
+{
+    LALLOC_CRITICAL_START;
+    obj->dyn->trace_cb = cb;
+    obj->dyn->trace_ctx = ctx;
+    obj->dyn->trace_time = LALLOC_PROFILE_CYCLES();
+    LALLOC_CRITICAL_END;
+}
+#endif
+
+#if LALLOC_SEQLOCK == 1
+/**
+   @brief Copies the state published by the last call that changed the object, without the critical section.
+          It only retries if a writer published a new state during the copy, so it never waits for a writer that
+          it preempted (e.g. from an ISR).
+
+   @param obj
+   @param status
+ */
+void lalloc_get_status( LALLOC_T *obj, lalloc_status_t *status )
+{
+    volatile uint32_t *seq = &obj->dyn->seq;
+    uint32_t start;
+
+    do
+    {
+        start = *seq;
+        LALLOC_ATOMIC_FENCE_ACQ();
+
+        /* the writer is not touching this copy */
+        *status = obj->dyn->status[start & 1];
+
+        LALLOC_ATOMIC_FENCE_ACQ();
+    }
+    while ( *seq != start );
+}
+#endif
+
+/**
+   @brief gets the free space of the object
+
+   @param obj
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_IDX_TYPE lalloc_get_free_space( LALLOC_T *obj )
+{
+#if LALLOC_SEQLOCK == 1
+    lalloc_status_t status;
+
+    lalloc_get_status( obj, &status );
+
+    return status.free_space;
+#else
+    LALLOC_IDX_TYPE size;
+    uint8_t *pdata_dummmy;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    LALLOC_IDX_TYPE largest = _flist_largest( obj );
+
+    if ( LALLOC_IDX_INVALID != largest )
+    {
+        /* if the free list is not empty, the information returned is its largest block's size */
+        _block_get_data( obj->pool, largest, &pdata_dummmy, &size );
+    }
+    else
+    {
+        /* full, free=0 */
+        size = 0;
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return size;
+#endif
+}
+
+/**
+   @brief returns if the obj is full or not
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_full( LALLOC_T *obj ) // TODO: NON TESTED
+{
+    LALLOC_IDX_TYPE cnt = lalloc_get_free_space( obj );
+    return ( cnt == 0 );
+}
+
+/**
+   @brief returns if the obj is empty or not
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_empty( LALLOC_T *obj ) // TODO: NON TESTED
+{
+    LALLOC_IDX_TYPE cnt = lalloc_get_alloc_count( obj );
+    return ( cnt == 0 );
+}
+
+/**
+   @brief returns 1 if the object hasn't allocated some space
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_none_allocated( LALLOC_T *obj ) // TODO: NON TESTED
+{
+    return ( obj->dyn->alloc_block == LALLOC_IDX_INVALID );
+}
+
+/* returns the allocated packet count */
+LALLOC_IDX_TYPE lalloc_get_alloc_count( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE n;
+
+#if LALLOC_SPSC == 1
+    /* the committed elements not released by the consumer yet */
+    n = LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_committed ) - LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_released );
+#elif LALLOC_SEQLOCK == 1
+    lalloc_status_t status;
+
+    lalloc_get_status( obj, &status );
+
+    n = status.alloc_count;
+#else
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    n = obj->dyn->allocated_blocks;
+
+    LALLOC_CRITICAL_END;
+#endif
+
+    return n;
+}
+
+/**
+   @brief Gets the nth  logical allocated element
+          |ELEM0|->|ELEM1|->|ELEM2|->....->|ELEMn|->....->|ELEM0|
+   @param obj
+   @param addr
+   @param size
+   @param n
+ */
+void lalloc_get_n( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE n )
+{
+#if LALLOC_SPSC == 1
+    LALLOC_IDX_TYPE released = obj->dyn->spsc_released;
+
+    /* the consumer sees the ring from its own position */
+    if ( n < ( LALLOC_IDX_TYPE )( LALLOC_ATOMIC_LOAD( &obj->dyn->spsc_committed ) - released ) )
+    {
+        _block_get_data( obj->pool, obj->dyn->ring[( LALLOC_IDX_TYPE )( released + n ) % LALLOC_ALLOC_RING_SIZE], ( uint8_t ** )addr, size );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+#else
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+    /* the ring is sorted from the oldest to the newest */
+    if ( n < obj->dyn->allocated_blocks )
+    {
+        _block_get_data( obj->pool, obj->dyn->ring[_ring_pos( obj, n )], ( uint8_t ** )addr, size );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+#else
+    /* the alocated list is sorted backwards, so the 0 element is the last. */
+    LALLOC_IDX_TYPE cnt = obj->dyn->allocated_blocks;
+
+    _block_list_get_n( obj->pool, obj->dyn->alist, cnt - n - 1, ( uint8_t ** )addr, size );
+#endif
+
+    LALLOC_TRACE_EVENT( obj, LALLOC_EV_GET, n, 0 );
+
+    LALLOC_CRITICAL_END;
+#endif
+}
+
+/**
+   @brief Gets the oldest allocated element (the next one to be freed in FIFO order). O(1)
+          The allocated list is circular, so the oldest element is the previous of its head.
+
+   @param obj
+   @param addr      address of the element, NULL if there is no allocated element
+   @param size      size of the element, 0 if there is no allocated element
+ */
+void lalloc_get_first( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+#if LALLOC_SPSC == 1
+    lalloc_get_n( obj, addr, size, 0 );
+#else
+    LALLOC_IDX_TYPE idx;
+
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        LALLOC_GET_BLOCK_PREV( obj->pool, obj->dyn->alist, idx );
+
+        _block_get_data( obj->pool, idx, ( uint8_t ** )addr, size );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+
+    LALLOC_TRACE_EVENT( obj, LALLOC_EV_GET, 0, 0 );
+
+    LALLOC_CRITICAL_END;
+#endif
+}
+
+/**
+   @brief Gets the newest allocated element. O(1)
+          The newest element is the head of the allocated list.
+
+   @param obj
+   @param addr      address of the element, NULL if there is no allocated element
+   @param size      size of the element, 0 if there is no allocated element
+ */
+void lalloc_get_last( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        _block_get_data( obj->pool, obj->dyn->alist, ( uint8_t ** )addr, size );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+
+    LALLOC_TRACE_EVENT( obj, LALLOC_EV_GET_LAST, 0, 0 );
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Returns 1 if addr is an allocated element of obj. That is, an address that lalloc_free accepts.
+          The check is done with the pool range and the block header, without walking any list:
+          the header must be linked with its physical neighbours, and the block must be allocated and committed.
+          With LALLOC_FREE_ANY==1 and no LALLOC_BLOCK_BITMAP, any address of the payload is accepted,
+          so the allocated list must be walked.
+
+   @param obj
+   @param addr
+   @return char     1 if it belongs, 0 otherwise
+ */
+char lalloc_dest_belongs( LALLOC_T *obj, void *addr )
+{
+    char rv = 0;
+    LALLOC_IDX_TYPE idx;
+    LALLOC_IDX_TYPE block;
+
+    /* the first payload address of the pool follows the first header */
+    if ( ( uint8_t * )addr >= obj->pool + lalloc_b_overhead_size && ( uint8_t * )addr < obj->pool + obj->size )
+    {
+        idx = ( uint8_t * )addr - obj->pool;
+
+        LALLOC_CRITICAL_START;
+
+        LALLOC_DEFERRED_DRAIN( obj );
+
+#if LALLOC_BLOCK_BITMAP == 1
+        block = _bitmap_find_block( obj, idx );
+
+#if LALLOC_FREE_ANY == 0
+        if ( block + lalloc_b_overhead_size != idx )
+        {
+            /* not the first byte of the payload */
+            block = LALLOC_IDX_INVALID;
+        }
+#endif
+#elif LALLOC_FREE_ANY == 1
+        block = ( obj->dyn->alist != LALLOC_IDX_INVALID ) ? _block_list_find_by_idx( obj->pool, obj->dyn->alist, idx ) : LALLOC_IDX_INVALID;
+#else
+        block = idx - lalloc_b_overhead_size;
+
+        /* the header must be consistent with its physical neighbours */
+        if ( _block_is_committed( obj, block ) )
+        {
+            LALLOC_IDX_TYPE prev_phy;
+
+            LALLOC_GET_BLOCK_PREVPHYS( obj->pool, block, prev_phy );
+
+            if ( prev_phy == LALLOC_IDX_INVALID ? block != 0 : !( prev_phy < block && _block_get_next_phy( obj->pool, prev_phy ) == block ) )
+            {
+                block = LALLOC_IDX_INVALID;
+            }
+        }
+        else
+        {
+            block = LALLOC_IDX_INVALID;
+        }
+#endif
+
+        /* the free blocks and the reserved ones are not allocated elements */
+        if ( block != LALLOC_IDX_INVALID && !_block_is_free( obj->pool, block ) && block != obj->dyn->alloc_block &&
+                !_block_is_reserved( obj->pool, block ) )
+        {
+            rv = 1;
+        }
+
+        LALLOC_CRITICAL_END;
+    }
+
+    return rv;
+}
+
+/**
+   @brief Starts an iteration through the allocated blocks, from the oldest to the newest one.
+          The blocks committed after this call are not iterated.
+          While iterating, only the last block returned by lalloc_iter_next can be freed.
+
+   @param obj
+   @param it        cursor to be initialized
+ */
+void lalloc_iter_begin( LALLOC_T *obj, lalloc_iter_t *it )
+{
+    LALLOC_CRITICAL_START;
+
+    LALLOC_DEFERRED_DRAIN( obj );
+
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        /* the oldest block is the previous of the newest one */
+        LALLOC_GET_BLOCK_PREV( obj->pool, obj->dyn->alist, it->block );
+    }
+    else
+    {
+        it->block = LALLOC_IDX_INVALID;
+    }
+
+    it->remaining = obj->dyn->allocated_blocks;
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Gets the block under the cursor and moves the cursor to the next newer block. O(1)
+
+   @param obj
+   @param it
+   @param addr      address of the block, NULL when the iteration ended
+   @param size      size of the block, 0 when the iteration ended
+   @return true     a block was returned
+   @return false    the iteration ended
+ */
+bool lalloc_iter_next( LALLOC_T *obj, lalloc_iter_t *it, void **addr, LALLOC_IDX_TYPE *size )
+{
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    if ( it->remaining > 0 )
+    {
+        _block_get_data( obj->pool, it->block, ( uint8_t ** )addr, size );
+
+        /* the cursor moves before the block is returned, so the user can free it */
+        LALLOC_GET_BLOCK_PREV( obj->pool, it->block, it->block );
+        it->remaining--;
+
+        rv = true;
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+
+        rv = false;
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Ends an iteration. lalloc_iter_next won't return more blocks for this cursor.
+
+   @param obj
+   @param it
+ */
+void lalloc_iter_end( LALLOC_T *obj, lalloc_iter_t *it )
+{
+    ( void ) obj;
+
+    it->block = LALLOC_IDX_INVALID;
+    it->remaining = 0;
+}
+
+#if LALLOC_SHARDED == 1
+#if defined(__GNUC__)
+/**
+   @brief   default LALLOC_SHARD_HINT(): each thread gets the next number the first time it is called.
+
+   @return uint32_t
+ */
+uint32_t _sharded_thread_hint( void )
+{
+    static uint32_t next;
+    static __thread uint32_t hint;
+    static __thread bool assigned;
+
+    if ( !assigned )
+    {
+        hint = __atomic_fetch_add( &next, 1, __ATOMIC_RELAXED );
+        assigned = true;
+    }
+
+    return hint;
+}
+#endif
+
+/**
+   @brief   finds the shard whose pool holds an address.
+
+   @param sh
+   @param addr
+   @return lalloc_t*    NULL if no shard holds addr
+ */
+lalloc_t *_sharded_find( lalloc_sharded_t *sh, void *addr )
+{
+    uint8_t i;
+
+    for ( i = 0; i < sh->count; i++ )
+    {
+        lalloc_t *obj = sh->shards[i];
+
+        if ( ( uint8_t * )addr >= obj->pool && ( uint8_t * )addr < obj->pool + obj->size )
+        {
+            return obj;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+   @brief Makes count instances of shard_size bytes each, with lalloc_ctor, behind a single handle.
+
+   @param count             number of shards, at least 1
+   @param shard_size        size of the pool of each shard
+   @return lalloc_sharded_t*    NULL if there is no memory
+ */
+lalloc_sharded_t *lalloc_sharded_ctor( uint8_t count, LALLOC_IDX_TYPE shard_size )
+{
+    lalloc_sharded_t *sh = NULL;
+    uint8_t i;
+
+    if ( count > 0 )
+    {
+        sh = ( lalloc_sharded_t * )malloc( sizeof( lalloc_sharded_t ) + count * sizeof( lalloc_t * ) );
+    }
+
+    if ( sh != NULL )
+    {
+        sh->count = 0;
+
+        for ( i = 0; i < count; i++ )
+        {
+            sh->shards[i] = ( lalloc_t * )lalloc_ctor( shard_size );
+
+            if ( sh->shards[i] == NULL )
+            {
+                lalloc_sharded_dtor( sh );
+                return NULL;
+            }
+
+            sh->count++;
+        }
+    }
+
+    return sh;
+}
+
+/**
+   @brief Destroys the shards and the handle.
+
+   @param sh
+ */
+void lalloc_sharded_dtor( lalloc_sharded_t *sh )
+{
+    uint8_t i;
+
+    for ( i = 0; i < sh->count; i++ )
+    {
+        lalloc_dtor( sh->shards[i] );
+    }
+
+    free( sh );
+}
+
+/**
+   @brief Reserves size bytes in the shard of the caller (LALLOC_SHARD_HINT()). If it does not fit, the next shards are
+          tried in order. Unlike lalloc_reserve, the area is never shorter than size.
+          The reservation ends with lalloc_sharded_commit_h or lalloc_sharded_revert_h.
+
+   @param sh
+   @param size      size of the area
+   @param h         handle of the reservation
+   @return true     the area was reserved
+   @return false    no shard has a free block of size bytes
+ */
+bool lalloc_sharded_reserve( lalloc_sharded_t *sh, LALLOC_IDX_TYPE size, lalloc_handle_t *h )
+{
+    uint8_t home = ( uint8_t )( LALLOC_SHARD_HINT() % sh->count );
+    uint8_t i;
+
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+    for ( i = 0; i < sh->count; i++ )
+    {
+        lalloc_t *obj = sh->shards[( home + i ) % sh->count];
+
+#if LALLOC_SEQLOCK == 1 && LALLOC_DEFERRED_FREE == 0
+        /* a full shard is skipped without taking its lock. The queued frees are only seen by lalloc_reserve. */
+        if ( lalloc_get_free_space( obj ) < size )
+        {
+            continue;
+        }
+#endif
+
+        if ( lalloc_reserve( obj, size, h ) )
+        {
+            if ( h->size >= size )
+            {
+                return true;
+            }
+
+            /* another thread took the space in the meanwhile */
+            lalloc_revert_h( obj, h );
+        }
+    }
+
+    h->block = LALLOC_IDX_INVALID;
+    h->addr = NULL;
+    h->size = 0;
+
+    return false;
+}
+
+/**
+   @brief Commits size bytes of a reservation made with lalloc_sharded_reserve, in the shard that holds it.
+
+   @param sh
+   @param h
+   @param size
+   @return true     the block was committed
+   @return false    there is no reservation, or size is bigger than it
+ */
+bool lalloc_sharded_commit_h( lalloc_sharded_t *sh, lalloc_handle_t *h, LALLOC_IDX_TYPE size )
+{
+    lalloc_t *obj = _sharded_find( sh, h->addr );
+
+    return ( obj != NULL ) ? lalloc_commit_h( obj, h, size ) : false;
+}
+
+/**
+   @brief Reverts a reservation made with lalloc_sharded_reserve.
+
+   @param sh
+   @param h
+ */
+void lalloc_sharded_revert_h( lalloc_sharded_t *sh, lalloc_handle_t *h )
+{
+    lalloc_t *obj = _sharded_find( sh, h->addr );
+
+    if ( obj != NULL )
+    {
+        lalloc_revert_h( obj, h );
+    }
+}
+
+/**
+   @brief Frees a block in the shard whose pool holds addr, from any thread.
+
+   @param sh
+   @param addr
+   @return true     the block was freed
+   @return false    addr is not an allocated block of any shard
+ */
+bool lalloc_sharded_free( lalloc_sharded_t *sh, void *addr )
+{
+    lalloc_t *obj = _sharded_find( sh, addr );
+
+    return ( obj != NULL ) ? lalloc_free( obj, addr ) : false;
+}
+
+/**
+   @brief returns the allocated block count of all the shards.
+
+   @param sh
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_IDX_TYPE lalloc_sharded_get_alloc_count( lalloc_sharded_t *sh )
+{
+    LALLOC_IDX_TYPE n = 0;
+    uint8_t i;
+
+    for ( i = 0; i < sh->count; i++ )
+    {
+        n += lalloc_get_alloc_count( sh->shards[i] );
+    }
+
+    return n;
+}
+#endif
+
+#if LALLOC_THREAD_CACHE == 1
+/**
+   @brief   frees the n oldest blocks of the cache in a single critical section.
+
+   @param cache
+   @param n
+ */
+void _cache_flush_oldest( lalloc_cache_t *cache, uint8_t n )
+{
+    uint8_t i;
+
+    lalloc_free_batch( cache->obj, cache->addr, n );
+
+    for ( i = 0; i < n; i++ )
+    {
+        cache->bytes -= cache->size[i];
+    }
+
+    cache->count -= n;
+
+    memmove( &cache->addr[0], &cache->addr[n], cache->count * sizeof( cache->addr[0] ) );
+    memmove( &cache->size[0], &cache->size[n], cache->count * sizeof( cache->size[0] ) );
+}
+
+/**
+   @brief   adds a block to the cache. When the cache gets over LALLOC_CACHE_BUDGET bytes, or it is full, the oldest
+            blocks are flushed down to half of it, so the next flush takes a while.
+
+   @param cache
+   @param addr
+   @param size      size of the block
+ */
+void _cache_push( lalloc_cache_t *cache, void *addr, LALLOC_IDX_TYPE size )
+{
+    uint8_t n = 0;
+    LALLOC_IDX_TYPE bytes = 0;
+
+    cache->addr[cache->count] = addr;
+    cache->size[cache->count] = size;
+    cache->bytes += size;
+    cache->count++;
+
+    if ( cache->bytes > LALLOC_CACHE_BUDGET || cache->count == LALLOC_CACHE_SLOTS )
+    {
+        while ( n < cache->count && ( cache->bytes - bytes > LALLOC_CACHE_BUDGET / 2 || cache->count - n > LALLOC_CACHE_SLOTS / 2 ) )
+        {
+            bytes += cache->size[n];
+            n++;
+        }
+
+        _cache_flush_oldest( cache, n );
+    }
+}
+
+/**
+   @brief Sets up an empty cache of the small blocks freed by the calling thread.
+
+   @param cache
+   @param obj
+ */
+void lalloc_cache_init( lalloc_cache_t *cache, LALLOC_T *obj )
+{
+    cache->obj = obj;
+    cache->bytes = 0;
+    cache->count = 0;
+    cache->hits = 0;
+}
+
+/**
+   @brief Reserves an area of up to size bytes. The smallest cached block that fits is handed back, without the
+          critical section. Otherwise it is lalloc_reserve on the instance.
+          The reservation ends with lalloc_cache_commit_h or lalloc_cache_revert_h.
+
+   @param cache
+   @param size      maximum size of the area
+   @param h         handle of the reservation. h->addr and h->size hold the reserved area.
+   @return true     the area was reserved
+   @return false    there is no free space
+ */
+bool lalloc_cache_reserve( lalloc_cache_t *cache, LALLOC_IDX_TYPE size, lalloc_handle_t *h )
+{
+    LALLOC_IDX_TYPE need = LALLOC_ALIGN_ROUND_UP( size );
+    uint8_t best = LALLOC_CACHE_SLOTS;
+    uint8_t i;
+
+    /* the newest one wins a tie, it is more likely to be in the CPU cache */
+    for ( i = cache->count; i-- > 0; )
+    {
+        if ( cache->size[i] >= need && ( best == LALLOC_CACHE_SLOTS || cache->size[i] < cache->size[best] ) )
+        {
+            best = i;
+        }
+    }
+
+    if ( best == LALLOC_CACHE_SLOTS )
+    {
+        return lalloc_reserve( cache->obj, size, h );
+    }
+
+    /* a cached block is still allocated, its handle has no reserved block */
+    h->block = LALLOC_IDX_INVALID;
+    h->addr = cache->addr[best];
+    h->size = cache->size[best];
+
+    cache->bytes -= cache->size[best];
+    cache->count--;
+
+    memmove( &cache->addr[best], &cache->addr[best + 1], ( cache->count - best ) * sizeof( cache->addr[0] ) );
+    memmove( &cache->size[best], &cache->size[best + 1], ( cache->count - best ) * sizeof( cache->size[0] ) );
+
+    cache->hits++;
+
+    return true;
+}
+
+/**
+   @brief Commits size bytes of a reservation made with lalloc_cache_reserve. A block taken from the cache is still in
+          the allocated list, behind the blocks committed since it was cached. In a single critical section, it is
+          unlinked and committed again, so it becomes the newest block with the committed size, and the rest of it goes
+          back to the free list.
+
+   @param cache
+   @param h
+   @param size
+   @return true     the block was committed
+   @return false    there is no reservation, or size is bigger than it
+ */
+bool lalloc_cache_commit_h( lalloc_cache_t *cache, lalloc_handle_t *h, LALLOC_IDX_TYPE size )
+{
+    LALLOC_T *obj = cache->obj;
+    bool rv;
+
+    if ( h->block == LALLOC_IDX_INVALID && h->addr != NULL )
+    {
+        /* all the commited user memory areas are aligned as well */
+        size = LALLOC_ALIGN_ROUND_UP( size );
+
+        rv = ( size > 0 && size <= h->size );
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+        rv = rv && size >= LALLOC_MIN_PAYLOAD_SIZE;
+#endif
+
+        if ( rv )
+        {
+            LALLOC_IDX_TYPE idx;
+
+            LALLOC_CRITICAL_START;
+
+            idx = _block_alloc_unlink( obj, h->addr );
+
+            if ( idx != LALLOC_IDX_INVALID )
+            {
+                _block_commit( obj, idx, size );
+
+                /* the trace sees a free and a new reservation */
+                LALLOC_TRACE_EVENT( obj, LALLOC_EV_RESERVE, h->size, LALLOC_TRACE_OFFSET( obj, idx ) );
+                LALLOC_TRACE_EVENT( obj, LALLOC_EV_COMMIT_H, size, LALLOC_TRACE_OFFSET( obj, idx ) );
+            }
+
+            LALLOC_SEQ_PUBLISH( obj );
+            LALLOC_CRITICAL_END;
+
+            rv = ( idx != LALLOC_IDX_INVALID );
+
+            h->addr = NULL;
+            h->size = 0;
+        }
+    }
+    else
+    {
+        rv = lalloc_commit_h( obj, h, size );
+    }
+
+    return rv;
+}
+
+/**
+   @brief Reverts a reservation made with lalloc_cache_reserve. A block taken from the cache goes back to it.
+
+   @param cache
+   @param h
+ */
+void lalloc_cache_revert_h( lalloc_cache_t *cache, lalloc_handle_t *h )
+{
+    if ( h->block == LALLOC_IDX_INVALID && h->addr != NULL )
+    {
+        _cache_push( cache, h->addr, h->size );
+
+        h->addr = NULL;
+        h->size = 0;
+    }
+    else
+    {
+        lalloc_revert_h( cache->obj, h );
+    }
+}
+
+/**
+   @brief Frees a block. A small one (up to LALLOC_CACHE_SMALL bytes) is kept by the cache, without the critical
+          section, the rest are freed with lalloc_free.
+          addr must be the first byte of a committed block. A block that is already cached is rejected.
+
+   @param cache
+   @param addr
+   @return true     the block was cached or freed
+   @return false    addr is not a committed block of the instance, or it is already cached
+ */
+bool lalloc_cache_free( lalloc_cache_t *cache, void *addr )
+{
+    LALLOC_T *obj = cache->obj;
+
+    if ( ( uint8_t * )addr < obj->pool + lalloc_b_overhead_size || ( uint8_t * )addr >= obj->pool + obj->size )
+    {
+        return false;
+    }
+
+    LALLOC_IDX_TYPE idx = ( LALLOC_IDX_TYPE )( ( uint8_t * )addr - obj->pool ) - lalloc_b_overhead_size;
+    LALLOC_IDX_TYPE size;
+    uint8_t i;
+
+    /* a block freed twice would be handed to two owners */
+    for ( i = 0; i < cache->count; i++ )
+    {
+        if ( cache->addr[i] == addr )
+        {
+            return false;
+        }
+    }
+
+    /* the header of a committed block does not change until it is freed */
+    if ( !_block_is_committed( obj, idx ) )
+    {
+        return false;
+    }
+
+#if LALLOC_DEFERRED_FREE == 1
+    if ( LALLOC_ATOMIC_LOAD( &LALLOC_BLOCK_QUEUED( obj->pool, idx ) ) != 0 )
+    {
+        /* already queued by lalloc_free */
+        return false;
+    }
+#endif
+
+    size = _block_get_size( obj->pool, idx );
+
+    if ( size > LALLOC_CACHE_SMALL )
+    {
+        return lalloc_free( obj, addr );
+    }
+
+    _cache_push( cache, addr, size );
+
+    return true;
+}
+
+/**
+   @brief Frees every cached block in a single critical section. To be called before the thread ends, or before the
+          instance is cleared.
+
+   @param cache
+ */
+void lalloc_cache_flush( lalloc_cache_t *cache )
+{
+    if ( cache->count > 0 )
+    {
+        _cache_flush_oldest( cache, cache->count );
+    }
+}
+#endif
+
+#endif
+
+/* ==ENGINE INDEPENDENT============================================================================== */
+
+#if ( LALLOC_PROFILE == 1 || LALLOC_CS_PROFILE == 1 || LALLOC_TRACE == 1 ) && ( defined(__unix__) || defined(__APPLE__) )
+/**
+   @brief Monotonic clock in nanoseconds (wrapping at 32 bits), a LALLOC_PROFILE_CYCLES() source for the platforms
+          without a cycle counter.
+
+   @return uint32_t
+ */
+uint32_t lalloc_profile_clock( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint32_t )( ( uint64_t )ts.tv_sec * 1000000000ULL + ( uint64_t )ts.tv_nsec );
+}
+#endif
+
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN
+/**
+   @brief Takes the spinlock of LALLOC_MUTEX_SPIN. A waiting thread only reads the lock, so it does not steal the cache
+          line from the holder, and it tries to take it again when it sees it released. Between two reads it pauses
+          with an exponential backoff up to LALLOC_SPIN_BACKOFF_MAX pauses, then it yields the CPU after each round.
+
+   @param lock
+ */
+void lalloc_spin_lock( atomic_bool *lock )
+{
+    uint32_t backoff = 1;
+
+    while ( atomic_exchange_explicit( lock, true, memory_order_acquire ) )
+    {
+        while ( atomic_load_explicit( lock, memory_order_relaxed ) )
+        {
+            uint32_t i;
+
+            for ( i = 0; i < backoff; i++ )
+            {
+                LALLOC_SPIN_PAUSE();
+            }
+
+            if ( backoff < LALLOC_SPIN_BACKOFF_MAX )
+            {
+                backoff <<= 1;
+            }
+            else
+            {
+                LALLOC_SPIN_YIELD();
+            }
+        }
+    }
+}
+
+/**
+   @brief Releases the spinlock of LALLOC_MUTEX_SPIN.
+
+   @param lock
+ */
+void lalloc_spin_unlock( atomic_bool *lock )
+{
+    atomic_store_explicit( lock, false, memory_order_release );
+}
+#endif
+
+#if LALLOC_TRACE == 1
+/**
+   @brief   writes a variable length integer, 7 bits per byte, the least significant first.
+
+   @param buf
+   @param value
+   @return uint8_t  number of bytes written
+ */
+uint8_t _trace_put_varint( uint8_t *buf, uint32_t value )
+{
+    uint8_t len = 0;
+
+    while ( value >= 0x80 )
+    {
+        buf[len++] = ( uint8_t )( value | 0x80 );
+        value >>= 7;
+    }
+
+    buf[len++] = ( uint8_t )value;
+
+    return len;
+}
+
+/**
+   @brief   reads a variable length integer written by _trace_put_varint.
+
+   @param buf
+   @param len       bytes available
+   @param value
+   @return uint8_t  number of bytes read, 0 if the integer is truncated or too long
+ */
+uint8_t _trace_get_varint( const uint8_t *buf, uint32_t len, uint32_t *value )
+{
+    uint8_t i;
+
+    *value = 0;
+
+    for ( i = 0; i < len && i < 5; i++ )
+    {
+        *value |= ( uint32_t )( buf[i] & 0x7F ) << ( 7 * i );
+
+        if ( ( buf[i] & 0x80 ) == 0 )
+        {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+   @brief Packs an event in a record: a byte with the type and the flags of the arguments that are not 0, followed by
+          the delta and those arguments as variable length integers. Small sizes and short deltas take a byte each.
+
+   @param ev
+   @param buf       room for LALLOC_TRACE_RECORD_MAX bytes
+   @return uint8_t  size of the record
+ */
+uint8_t lalloc_trace_encode( const lalloc_trace_event_t *ev, uint8_t *buf )
+{
+    uint8_t len = 1;
+
+    buf[0] = ev->type & 0x3F;
+
+    len += _trace_put_varint( &buf[len], ev->delta );
+
+    if ( ev->a != 0 )
+    {
+        buf[0] |= 0x40;
+        len += _trace_put_varint( &buf[len], ev->a );
+    }
+
+    if ( ev->b != 0 )
+    {
+        buf[0] |= 0x80;
+        len += _trace_put_varint( &buf[len], ev->b );
+    }
+
+    return len;
+}
+
+/**
+   @brief Unpacks a record written by lalloc_trace_encode.
+
+   @param buf
+   @param len       bytes available
+   @param ev
+   @return uint8_t  size of the record, 0 if it is truncated
+ */
+uint8_t lalloc_trace_decode( const uint8_t *buf, uint32_t len, lalloc_trace_event_t *ev )
+{
+    uint8_t pos = 1;
+    uint8_t n;
+
+    if ( len == 0 )
+    {
+        return 0;
+    }
+
+    ev->type = buf[0] & 0x3F;
+    ev->a = 0;
+    ev->b = 0;
+
+    n = _trace_get_varint( &buf[pos], len - pos, &ev->delta );
+    pos += n;
+
+    if ( n != 0 && ( buf[0] & 0x40 ) != 0 )
+    {
+        n = _trace_get_varint( &buf[pos], len - pos, &ev->a );
+        pos += n;
+    }
+
+    if ( n != 0 && ( buf[0] & 0x80 ) != 0 )
+    {
+        n = _trace_get_varint( &buf[pos], len - pos, &ev->b );
+        pos += n;
+    }
+
+    return ( n != 0 ) ? pos : 0;
+}
+#endif
+
+#if LALLOC_CS_PROFILE == 1
+/* call sites seen so far, and the critical section that is running */
+static lalloc_cs_site_t lalloc_cs_sites[LALLOC_CS_PROFILE_SITES];
+static uint32_t lalloc_cs_site_count;
+static uint32_t lalloc_cs_dropped;
+static const char *lalloc_cs_fcn;
+static uint32_t lalloc_cs_line;
+static uint32_t lalloc_cs_start;
+
+/**
+   @brief Starts timing a critical section. Called by LALLOC_CS_PROFILE_START right after the lock is taken.
+
+   @param fcn
+   @param line
+ */
+void lalloc_cs_enter( const char *fcn, uint32_t line )
+{
+    lalloc_cs_fcn = fcn;
+    lalloc_cs_line = line;
+    lalloc_cs_start = LALLOC_PROFILE_CYCLES();
+}
+
+/**
+   @brief Ends timing a critical section and adds it to its call site. Called by LALLOC_CS_PROFILE_END right before
+          the lock is released.
+ */
+void lalloc_cs_exit( void )
+{
+    uint32_t cycles = ( uint32_t )( LALLOC_PROFILE_CYCLES() - lalloc_cs_start );
+    uint8_t bin = ( cycles == 0 ) ? 0 : ( uint8_t )( LALLOC_FLS( cycles ) + 1 );
+    lalloc_cs_site_t *site = NULL;
+    uint32_t i;
+
+    if ( bin >= LALLOC_PROFILE_BINS )
+    {
+        bin = LALLOC_PROFILE_BINS - 1;
+    }
+
+    if ( lalloc_cs_fcn == NULL )
+    {
+        /* lalloc_cs_reset runs within this critical section, it is not recorded */
+        return;
+    }
+
+    /* __func__ is a static array, its address identifies the function */
+    for ( i = 0; i < lalloc_cs_site_count; i++ )
+    {
+        if ( lalloc_cs_sites[i].line == lalloc_cs_line && lalloc_cs_sites[i].fcn == lalloc_cs_fcn )
+        {
+            site = &lalloc_cs_sites[i];
+            break;
+        }
+    }
+
+    if ( site == NULL && lalloc_cs_site_count < LALLOC_CS_PROFILE_SITES )
+    {
+        site = &lalloc_cs_sites[lalloc_cs_site_count++];
+        site->fcn = lalloc_cs_fcn;
+        site->line = lalloc_cs_line;
+    }
+
+    if ( site != NULL )
+    {
+        site->count++;
+        site->total += cycles;
+        site->hist[bin]++;
+
+        if ( cycles > site->max )
+        {
+            site->max = cycles;
+        }
+    }
+    else
+    {
+        lalloc_cs_dropped++;
+    }
+}
+
+/**
+   @brief Takes a snapshot of the call sites, in the order they were first seen.
+
+   @param sites
+   @param max           size of sites
+   @param dropped       return of the number of samples of the sites that did not fit. It can be NULL.
+   @return uint32_t     number of call sites copied
+ */
+uint32_t lalloc_cs_get( lalloc_cs_site_t *sites, uint32_t max, uint32_t *dropped )
+{
+    uint32_t count;
+
+    LALLOC_CRITICAL_START;
+
+    count = ( lalloc_cs_site_count < max ) ? lalloc_cs_site_count : max;
+    memcpy( sites, lalloc_cs_sites, count * sizeof( lalloc_cs_site_t ) );
+
+    if ( dropped != NULL )
+    {
+        *dropped = lalloc_cs_dropped;
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return count;
+}
+
+/**
+   @brief Forgets every call site.
+ */
+void lalloc_cs_reset( void )
+{
+    LALLOC_CRITICAL_START;
+
+    memset( lalloc_cs_sites, 0, sizeof( lalloc_cs_sites ) );
+    lalloc_cs_site_count = 0;
+    lalloc_cs_dropped = 0;
+    lalloc_cs_fcn = NULL;
+
+    LALLOC_CRITICAL_END;
+}
+#endif
+
+/* v1.00 */
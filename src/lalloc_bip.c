@@ -0,0 +1,848 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#if LALLOC_ENGINE == LALLOC_ENGINE_BIP
+
+/* Bipartite ring buffer engine.
+
+   The frames are stored one after the other, each one with a header holding its payload size:
+
+   |<---------------------------------------- pool ---------------------------------------->|
+   | B: [0, b_end)           |  free  | A: [a_start, a_end)                       |  free   |
+     newest frames                      oldest frames
+
+   New frames are appended to region A until it reaches the end of the pool. From there, they are
+   appended to region B at the beginning of the pool, up to a_start. When region A gets empty,
+   region B becomes region A.
+   A reservation is always the biggest contiguous space, and it is not marked in the pool:
+   alloc_block keeps its position until it is committed or reverted. */
+
+/* CONSTANTS ============================================================================================================ */
+LALLOC_STATIC const LALLOC_IDX_TYPE lalloc_bip_header_size = LALLOC_FRAME_HEADER_SIZE;
+
+/* ==PRIVATE MACROS================================================================================== */
+#define LALLOC_BIP_SIZE(POOL, IDX)          LALLOC_FRAME_SIZE( POOL, IDX )
+#define LALLOC_BIP_DATA(POOL, IDX)          ( ( POOL ) + ( IDX ) + lalloc_bip_header_size )
+#define LALLOC_BIP_ALIGN_DOWN(SIZE)         ( ( ( SIZE ) / LALLOC_ALIGNMENT ) * LALLOC_ALIGNMENT )
+
+/* ==PRIVATE METHODS================================================================================= */
+
+/**
+   @brief   gets the position and the payload size of the biggest contiguous free space.
+            NOT THREAD SAFE
+
+   @param obj
+   @param pos               position of the space (where the header of the new frame goes)
+   @return LALLOC_IDX_TYPE  payload size, 0 if there is no room for a frame
+ */
+LALLOC_IDX_TYPE _bip_largest( LALLOC_T *obj, LALLOC_IDX_TYPE *pos )
+{
+    LALLOC_IDX_TYPE space;
+
+    if ( obj->dyn->b_end != 0 )
+    {
+        /* region B grows up to the oldest frame */
+        *pos = obj->dyn->b_end;
+        space = obj->dyn->a_start - obj->dyn->b_end;
+    }
+    else if ( obj->size - obj->dyn->a_end >= obj->dyn->a_start )
+    {
+        /* after region A */
+        *pos = obj->dyn->a_end;
+        space = obj->size - obj->dyn->a_end;
+    }
+    else
+    {
+        /* before region A, it would start region B */
+        *pos = 0;
+        space = obj->dyn->a_start;
+    }
+
+    space = LALLOC_BIP_ALIGN_DOWN( space );
+
+    return ( space > lalloc_bip_header_size ) ? space - lalloc_bip_header_size : 0;
+}
+
+/**
+   @brief   position of the frame that follows a given one, in FIFO order.
+            NOT THREAD SAFE
+
+   @param obj
+   @param idx
+   @return LALLOC_IDX_TYPE
+ */
+static inline LALLOC_IDX_TYPE _bip_next( LALLOC_T *obj, LALLOC_IDX_TYPE idx )
+{
+    idx += lalloc_bip_header_size + LALLOC_BIP_SIZE( obj->pool, idx );
+
+    /* the frames of region B follow the last one of region A */
+    return ( idx == obj->dyn->a_end && obj->dyn->b_end != 0 ) ? 0 : idx;
+}
+
+/**
+   @brief   gets the nth frame, in FIFO order. O(n)
+            NOT THREAD SAFE
+
+   @param obj
+   @param n
+   @return LALLOC_IDX_TYPE  position of the frame, LALLOC_IDX_INVALID if there is no such frame
+ */
+LALLOC_IDX_TYPE _bip_get_n( LALLOC_T *obj, LALLOC_IDX_TYPE n )
+{
+    LALLOC_IDX_TYPE idx = obj->dyn->a_start;
+
+    if ( n >= obj->dyn->allocated_blocks )
+    {
+        return LALLOC_IDX_INVALID;
+    }
+
+    while ( n-- > 0 )
+    {
+        idx = _bip_next( obj, idx );
+    }
+
+    return idx;
+}
+
+/**
+   @brief   releases the oldest frame. O(1)
+            NOT THREAD SAFE
+
+   @param obj
+   @return true
+   @return false    there is no frame
+ */
+bool _bip_free_first( LALLOC_T *obj )
+{
+    if ( obj->dyn->allocated_blocks == 0 )
+    {
+        return false;
+    }
+
+    obj->dyn->a_start += lalloc_bip_header_size + LALLOC_BIP_SIZE( obj->pool, obj->dyn->a_start );
+    obj->dyn->allocated_blocks--;
+
+    if ( obj->dyn->a_start == obj->dyn->a_end )
+    {
+        if ( obj->dyn->b_end != 0 )
+        {
+            /* region A is empty, region B becomes region A */
+            obj->dyn->a_start = 0;
+            obj->dyn->a_end = obj->dyn->b_end;
+            obj->dyn->b_end = 0;
+        }
+        else if ( obj->dyn->alloc_block == LALLOC_IDX_INVALID )
+        {
+            /* the pool is empty, start over to have all the pool contiguous */
+            obj->dyn->a_start = 0;
+            obj->dyn->a_end = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+   @brief Constructs in runtime a new lalloc_t object.
+
+   @param size      pool size
+   @return void*    handler to the new lalloc_t object
+ */
+void *lalloc_ctor( LALLOC_IDX_TYPE size )
+{
+    lalloc_t *rv = ( lalloc_t * )malloc( sizeof( lalloc_t ) );
+
+    if ( rv != NULL )
+    {
+        rv->size = size;
+
+        rv->pool = ( uint8_t * )malloc( rv->size );
+
+        if ( rv->pool != NULL )
+        {
+            rv->dyn = ( lalloc_dyn_t * )malloc( sizeof( lalloc_dyn_t ) );
+
+            if ( rv->dyn != NULL )
+            {
+                lalloc_init( rv );
+            }
+            else
+            {
+                free( rv->pool );
+                free( rv );
+                rv = NULL;
+            }
+        }
+        else
+        {
+            free( rv );
+            rv = NULL;
+        }
+    }
+
+    return rv;
+}
+
+void lalloc_dtor( void *me )
+{
+    lalloc_deinit( ( lalloc_t * )me );
+
+    free( ( ( lalloc_t * )me )->dyn );
+    free( ( ( lalloc_t * )me )->pool );
+    free( ( ( lalloc_t * )me ) );
+}
+
+/* ==PUBLIC METHODS================================================================================== */
+
+/**
+   @brief it clears the object
+
+   @param obj
+ */
+void lalloc_clear( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_START;
+
+    obj->dyn->a_start = 0;
+    obj->dyn->a_end = 0;
+    obj->dyn->b_end = 0;
+    obj->dyn->last = LALLOC_IDX_INVALID;
+    obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+    obj->dyn->allocated_blocks = 0;
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief initializes the object and its critical section (the mutex with LALLOC_MUTEX). With a mutex, it must be
+          called once before the object is shared, lalloc_clear empties it afterwards.
+
+   @param obj
+ */
+void lalloc_init( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_INIT;
+
+    lalloc_clear( obj );
+}
+
+/**
+   @brief releases the resources of the critical section of the object (the mutex with LALLOC_MUTEX).
+          The object must not be used after it, unless lalloc_init is called again.
+
+   @param obj
+ */
+void lalloc_deinit( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_DEINIT;
+}
+
+/**
+   @brief   reserves the largest contiguous free area. NOT THREAD SAFE
+
+   @param obj
+   @param addr
+   @param size
+ */
+void _bip_alloc( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_IDX_TYPE pos;
+
+    *size = _bip_largest( obj, &pos );
+
+    if ( *size > 0 )
+    {
+        *addr = LALLOC_BIP_DATA( obj->pool, pos );
+        obj->dyn->alloc_block = pos;
+    }
+    else
+    {
+        /* there isn't room for a frame */
+        *addr = NULL;
+        obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+    }
+}
+
+/**
+   @brief it request a memory space to the object. It is the biggest contiguous free space.
+
+   @param obj       reference to obj to work with
+   @param addr      return of the address
+   @param size      return of the size of the block
+ */
+void lalloc_alloc( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_CRITICAL_START;
+
+    _bip_alloc( obj, addr, size );
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Like lalloc_alloc, but the reserved size is capped to max bytes.
+          The free space of a bip buffer is not splitted, the cap only limits the reported size.
+
+   @param obj
+   @param addr
+   @param size
+   @param max
+ */
+void lalloc_alloc_max( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE max )
+{
+    lalloc_alloc( obj, addr, size );
+
+    if ( *size > max )
+    {
+        *size = LALLOC_ALIGN_ROUND_UP( max );
+    }
+}
+
+/**
+   @brief reverts the alloc operation
+
+   @param obj
+ */
+void lalloc_alloc_revert( LALLOC_T *obj )
+{
+    LALLOC_CRITICAL_START;
+
+    obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+
+    if ( obj->dyn->allocated_blocks == 0 )
+    {
+        /* the pool is empty, start over to have all the pool contiguous */
+        obj->dyn->a_start = 0;
+        obj->dyn->a_end = 0;
+    }
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief   commits the reserved area with an aligned size. NOT THREAD SAFE
+
+   @param obj
+   @param size
+   @return true if the operation success
+ */
+bool _bip_commit( LALLOC_T *obj, LALLOC_IDX_TYPE size )
+{
+    bool rv = false;
+    LALLOC_IDX_TYPE pos = obj->dyn->alloc_block;
+
+    if ( pos != LALLOC_IDX_INVALID )
+    {
+        /* region A keeps growing while region B is not used (frees might have moved region B to A) */
+        bool in_a = ( pos == obj->dyn->a_end && obj->dyn->b_end == 0 );
+        LALLOC_IDX_TYPE limit = in_a ? obj->size : obj->dyn->a_start;
+
+        if ( lalloc_bip_header_size + size <= LALLOC_BIP_ALIGN_DOWN( limit - pos ) )
+        {
+            LALLOC_BIP_SIZE( obj->pool, pos ) = size;
+
+            if ( in_a )
+            {
+                obj->dyn->a_end = pos + lalloc_bip_header_size + size;
+            }
+            else if ( obj->dyn->a_start == obj->dyn->a_end )
+            {
+                /* region A is empty, the frame starts it again from the beginning */
+                obj->dyn->a_start = 0;
+                obj->dyn->a_end = pos + lalloc_bip_header_size + size;
+            }
+            else
+            {
+                obj->dyn->b_end = pos + lalloc_bip_header_size + size;
+            }
+
+            obj->dyn->last = pos;
+            obj->dyn->alloc_block = LALLOC_IDX_INVALID;
+            obj->dyn->allocated_blocks++;
+
+            rv = true;
+        }
+    }
+
+    return rv;
+}
+
+/**
+   @brief commits the previous allocated memory block. O(1)
+
+   @param obj
+   @param size
+   @return int 1 if the operation success
+               0 otherwise
+ */
+bool lalloc_commit( LALLOC_T *obj, LALLOC_IDX_TYPE size )
+{
+    bool rv = false;
+
+    /* all the commited user memory areas are aligned as well */
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
+#endif
+    {
+        LALLOC_CRITICAL_START;
+
+        rv = _bip_commit( obj, size );
+
+        LALLOC_CRITICAL_END;
+    }
+
+    return rv;
+}
+
+/**
+   @brief commits the reserved frame and reserves the largest free area for the next one, in a single critical
+          section. O(1)
+
+   @param obj
+   @param size  size of the frame to commit
+   @param addr  address of the new reserved area, NULL if there is no free space or the commit failed
+   @param len   size of the new reserved area
+   @return true if the frame was committed. Otherwise the current reservation is kept.
+ */
+bool lalloc_commit_and_alloc( LALLOC_T *obj, LALLOC_IDX_TYPE size, void **addr, LALLOC_IDX_TYPE *len )
+{
+    bool rv = false;
+
+    /* all the commited user memory areas are aligned as well */
+    size = LALLOC_ALIGN_ROUND_UP( size );
+
+    *addr = NULL;
+    *len = 0;
+
+#if LALLOC_MIN_PAYLOAD_SIZE > 0
+    if ( size >= LALLOC_MIN_PAYLOAD_SIZE )
+#endif
+    {
+        LALLOC_CRITICAL_START;
+
+        rv = _bip_commit( obj, size );
+
+        if ( rv )
+        {
+            _bip_alloc( obj, addr, len );
+        }
+
+        LALLOC_CRITICAL_END;
+    }
+
+    return rv;
+}
+
+/* it frees up the first added frame. O(1) */
+bool lalloc_free_first( LALLOC_T *obj )
+{
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    rv = _bip_free_first( obj );
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief   frees up the frame of a given address, if it is the oldest one. NOT THREAD SAFE
+
+   @param obj
+   @param addr
+   @return true if the frame was freed
+ */
+bool _bip_free( LALLOC_T *obj, void *addr )
+{
+    bool rv = false;
+
+    if ( obj->dyn->allocated_blocks > 0 )
+    {
+        uint8_t *first = LALLOC_BIP_DATA( obj->pool, obj->dyn->a_start );
+
+#if LALLOC_FREE_ANY == 1
+        if ( ( uint8_t * )addr >= first && ( uint8_t * )addr < first + LALLOC_BIP_SIZE( obj->pool, obj->dyn->a_start ) )
+#else
+        if ( ( uint8_t * )addr == first )
+#endif
+        {
+            rv = _bip_free_first( obj );
+        }
+    }
+
+    return rv;
+}
+
+/**
+   @brief Frees up the frame of a given address. Only the oldest frame can be freed.
+          With LALLOC_FREE_ANY==1 the address can be any one of its payload.
+
+   @param obj
+   @param addr
+   @return int
+ */
+bool lalloc_free( LALLOC_T *obj, void *addr )
+{
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    rv = _bip_free( obj, addr );
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Housekeeping of the object, to be called when the system is idle. Nothing is deferred in a bip buffer.
+
+   @param obj
+   @param budget
+   @return false    there is nothing left to do
+ */
+bool lalloc_maintain( LALLOC_T *obj, LALLOC_IDX_TYPE budget )
+{
+    ( void ) obj;
+    ( void ) budget;
+
+    return false;
+}
+
+/**
+   @brief Frees up the n oldest frames in a single critical section. O(n)
+
+   @param obj
+   @param n
+   @return LALLOC_IDX_TYPE  number of freed frames
+ */
+LALLOC_IDX_TYPE lalloc_free_first_n( LALLOC_T *obj, LALLOC_IDX_TYPE n )
+{
+    LALLOC_IDX_TYPE rv = 0;
+
+    LALLOC_CRITICAL_START;
+
+    while ( rv < n && _bip_free_first( obj ) )
+    {
+        rv++;
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Frees up the frames of n given addresses in a single critical section.
+          As in lalloc_free, each frame must be the oldest one when it is freed, so the addresses must be in FIFO order.
+
+   @param obj
+   @param addrs
+   @param n
+   @return LALLOC_IDX_TYPE  number of freed frames
+ */
+LALLOC_IDX_TYPE lalloc_free_batch( LALLOC_T *obj, void *const addrs[], LALLOC_IDX_TYPE n )
+{
+    LALLOC_IDX_TYPE rv = 0;
+    LALLOC_IDX_TYPE i;
+
+    LALLOC_CRITICAL_START;
+
+    for ( i = 0; i < n; i++ )
+    {
+        if ( _bip_free( obj, addrs[i] ) )
+        {
+            rv++;
+        }
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief gets the biggest contiguous free space.
+
+   @param obj
+   @return LALLOC_IDX_TYPE
+ */
+LALLOC_IDX_TYPE lalloc_get_free_space( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE pos;
+
+    LALLOC_CRITICAL_START;
+
+    size = _bip_largest( obj, &pos );
+
+    LALLOC_CRITICAL_END;
+
+    return size;
+}
+
+/**
+   @brief returns if the obj is full or not
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_full( LALLOC_T *obj )
+{
+    return ( lalloc_get_free_space( obj ) == 0 );
+}
+
+/**
+   @brief returns if the obj is empty or not
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_empty( LALLOC_T *obj )
+{
+    return ( lalloc_get_alloc_count( obj ) == 0 );
+}
+
+/**
+   @brief returns 1 if the object hasn't allocated some space
+
+   @param obj
+   @return true
+   @return false
+ */
+bool lalloc_is_none_allocated( LALLOC_T *obj )
+{
+    return ( obj->dyn->alloc_block == LALLOC_IDX_INVALID );
+}
+
+/* returns the allocated packet count */
+LALLOC_IDX_TYPE lalloc_get_alloc_count( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE n;
+
+    LALLOC_CRITICAL_START;
+
+    n = obj->dyn->allocated_blocks;
+
+    LALLOC_CRITICAL_END;
+
+    return n;
+}
+
+/**
+   @brief Gets the nth logical allocated element, 0 is the oldest one. O(n)
+
+   @param obj
+   @param addr
+   @param size
+   @param n
+ */
+void lalloc_get_n( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size, LALLOC_IDX_TYPE n )
+{
+    LALLOC_CRITICAL_START;
+
+    LALLOC_IDX_TYPE idx = _bip_get_n( obj, n );
+
+    if ( idx != LALLOC_IDX_INVALID )
+    {
+        *addr = LALLOC_BIP_DATA( obj->pool, idx );
+        *size = LALLOC_BIP_SIZE( obj->pool, idx );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Gets the oldest allocated element. O(1)
+
+   @param obj
+   @param addr      address of the element, NULL if there is no allocated element
+   @param size      size of the element, 0 if there is no allocated element
+ */
+void lalloc_get_first( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    lalloc_get_n( obj, addr, size, 0 );
+}
+
+/**
+   @brief Gets the newest allocated element. O(1)
+
+   @param obj
+   @param addr      address of the element, NULL if there is no allocated element
+   @param size      size of the element, 0 if there is no allocated element
+ */
+void lalloc_get_last( LALLOC_T *obj, void **addr, LALLOC_IDX_TYPE *size )
+{
+    LALLOC_CRITICAL_START;
+
+    if ( obj->dyn->allocated_blocks > 0 )
+    {
+        *addr = LALLOC_BIP_DATA( obj->pool, obj->dyn->last );
+        *size = LALLOC_BIP_SIZE( obj->pool, obj->dyn->last );
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+    }
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Returns 1 if addr is an allocated element of obj. O(n)
+          With LALLOC_FREE_ANY==1 any address of its payload is accepted.
+
+   @param obj
+   @param addr
+   @return char     1 if it belongs, 0 otherwise
+ */
+char lalloc_dest_belongs( LALLOC_T *obj, void *addr )
+{
+    char rv = 0;
+    LALLOC_IDX_TYPE n;
+    LALLOC_IDX_TYPE idx;
+
+    LALLOC_CRITICAL_START;
+
+    idx = obj->dyn->a_start;
+
+    for ( n = 0; n < obj->dyn->allocated_blocks; n++ )
+    {
+        uint8_t *data = LALLOC_BIP_DATA( obj->pool, idx );
+
+#if LALLOC_FREE_ANY == 1
+        if ( ( uint8_t * )addr >= data && ( uint8_t * )addr < data + LALLOC_BIP_SIZE( obj->pool, idx ) )
+#else
+        if ( ( uint8_t * )addr == data )
+#endif
+        {
+            rv = 1;
+            break;
+        }
+
+        idx = _bip_next( obj, idx );
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Starts an iteration through the allocated frames, from the oldest to the newest one.
+          While iterating, only the last frame returned by lalloc_iter_next can be freed.
+
+   @param obj
+   @param it        cursor to be initialized
+ */
+void lalloc_iter_begin( LALLOC_T *obj, lalloc_iter_t *it )
+{
+    LALLOC_CRITICAL_START;
+
+    it->block = obj->dyn->a_start;
+    it->remaining = obj->dyn->allocated_blocks;
+
+    LALLOC_CRITICAL_END;
+}
+
+/**
+   @brief Gets the frame under the cursor and moves the cursor to the next newer frame. O(1)
+
+   @param obj
+   @param it
+   @param addr      address of the frame, NULL when the iteration ended
+   @param size      size of the frame, 0 when the iteration ended
+   @return true     a frame was returned
+   @return false    the iteration ended
+ */
+bool lalloc_iter_next( LALLOC_T *obj, lalloc_iter_t *it, void **addr, LALLOC_IDX_TYPE *size )
+{
+    bool rv;
+
+    LALLOC_CRITICAL_START;
+
+    if ( it->remaining > 0 )
+    {
+        *addr = LALLOC_BIP_DATA( obj->pool, it->block );
+        *size = LALLOC_BIP_SIZE( obj->pool, it->block );
+
+        it->block = _bip_next( obj, it->block );
+        it->remaining--;
+
+        rv = true;
+    }
+    else
+    {
+        *addr = NULL;
+        *size = 0;
+
+        rv = false;
+    }
+
+    LALLOC_CRITICAL_END;
+
+    return rv;
+}
+
+/**
+   @brief Ends an iteration. lalloc_iter_next won't return more frames for this cursor.
+
+   @param obj
+   @param it
+ */
+void lalloc_iter_end( LALLOC_T *obj, lalloc_iter_t *it )
+{
+    ( void ) obj;
+
+    it->block = LALLOC_IDX_INVALID;
+    it->remaining = 0;
+}
+
+#endif
+
+/* v1.00 */
@@ -0,0 +1,227 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Thread cache benchmark: 1, 2, 4 and 8 threads reserve, commit and free small frames (up to LALLOC_CACHE_SMALL bytes)
+   on a shared instance behind the pthread mutex adapter, first straight on the instance, then each thread through its
+   own lalloc_cache_t. The same total number of operations is split among the threads.
+   For each thread count it reports the total Mops/s (an operation is a reserve and commit, or a free), and for the
+   cached run the share of the reservations served by the cache. Those take the lock once, for the commit, instead of
+   twice. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#define BENCH_THREADS_MAX   8
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_OPS           4000000
+#define BENCH_LIVE          16
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+typedef struct
+{
+    uint32_t        seed;
+    uint32_t        ops;
+    bool            cached;
+    uint32_t        reserves;
+    uint32_t        hits;
+    uint32_t        failed;
+} bench_worker_t;
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* keeps up to BENCH_LIVE frames of its own and frees a random one of them */
+static void *bench_worker( void *arg )
+{
+    bench_worker_t *ctx = ( bench_worker_t * )arg;
+    lalloc_cache_t cache;
+    uint8_t *live[BENCH_LIVE];
+    uint32_t count = 0;
+    uint32_t ops = 0;
+
+    lalloc_cache_init( &cache, &bench_alloc );
+
+    while ( ops < ctx->ops )
+    {
+        lalloc_handle_t h;
+
+        ctx->seed ^= ctx->seed << 13;
+        ctx->seed ^= ctx->seed >> 17;
+        ctx->seed ^= ctx->seed << 5;
+
+        if ( count < BENCH_LIVE && ( ctx->seed & 1 ) )
+        {
+            LALLOC_IDX_TYPE frame_size = 1 + ( ctx->seed >> 1 ) % LALLOC_CACHE_SMALL;
+            bool reserved = ctx->cached ? lalloc_cache_reserve( &cache, frame_size, &h ) : lalloc_reserve( &bench_alloc, frame_size, &h );
+
+            ctx->reserves++;
+
+            if ( reserved && h.size >= frame_size )
+            {
+                /* lalloc_commit_h clears the handle */
+                live[count++] = h.addr;
+                memset( h.addr, ( uint8_t )ops, frame_size );
+
+                if ( ctx->cached )
+                {
+                    lalloc_cache_commit_h( &cache, &h, frame_size );
+                }
+                else
+                {
+                    lalloc_commit_h( &bench_alloc, &h, frame_size );
+                }
+            }
+            else
+            {
+                if ( reserved && ctx->cached )
+                {
+                    lalloc_cache_revert_h( &cache, &h );
+                }
+                else if ( reserved )
+                {
+                    lalloc_revert_h( &bench_alloc, &h );
+                }
+
+                ctx->failed++;
+            }
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = ( ctx->seed >> 1 ) % count;
+
+            if ( ctx->cached )
+            {
+                lalloc_cache_free( &cache, live[k] );
+            }
+            else
+            {
+                lalloc_free( &bench_alloc, live[k] );
+            }
+
+            live[k] = live[--count];
+        }
+
+        ops++;
+    }
+
+    while ( count > 0 )
+    {
+        if ( ctx->cached )
+        {
+            lalloc_cache_free( &cache, live[--count] );
+        }
+        else
+        {
+            lalloc_free( &bench_alloc, live[--count] );
+        }
+    }
+
+    lalloc_cache_flush( &cache );
+    ctx->hits = cache.hits;
+
+    return NULL;
+}
+
+int main( void )
+{
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+    pthread_t threads[BENCH_THREADS_MAX];
+    bench_worker_t workers[BENCH_THREADS_MAX];
+    uint32_t c;
+    int cached;
+
+    printf( "cache: %u slots, blocks up to %u bytes, budget %u bytes\n", LALLOC_CACHE_SLOTS, LALLOC_CACHE_SMALL, LALLOC_CACHE_BUDGET );
+    printf( "%8s %8s %10s %10s %8s %10s\n", "threads", "cache", "seconds", "Mops/s", "hits%", "failed" );
+
+    for ( c = 0; c < sizeof( thread_counts ) / sizeof( thread_counts[0] ); c++ )
+    {
+        for ( cached = 0; cached <= 1; cached++ )
+        {
+            uint32_t n = thread_counts[c];
+            uint32_t reserves = 0;
+            uint32_t hits = 0;
+            uint32_t failed = 0;
+            double t;
+            uint32_t w;
+
+            lalloc_init( &bench_alloc );
+
+            for ( w = 0; w < n; w++ )
+            {
+                memset( &workers[w], 0, sizeof( workers[w] ) );
+                workers[w].seed = 12345 + w;
+                workers[w].ops = BENCH_OPS / n;
+                workers[w].cached = cached;
+            }
+
+            t = bench_now();
+
+            for ( w = 0; w < n; w++ )
+            {
+                pthread_create( &threads[w], NULL, bench_worker, &workers[w] );
+            }
+
+            for ( w = 0; w < n; w++ )
+            {
+                pthread_join( threads[w], NULL );
+            }
+
+            t = bench_now() - t;
+
+            for ( w = 0; w < n; w++ )
+            {
+                reserves += workers[w].reserves;
+                hits += workers[w].hits;
+                failed += workers[w].failed;
+            }
+
+            printf( "%8u %8s %10.3f %10.2f %8.1f %10u\n", n, cached ? "yes" : "no", t, BENCH_OPS / t * 1e-6,
+                    reserves ? 100.0 * hits / reserves : 0.0, failed );
+
+            lalloc_deinit( &bench_alloc );
+        }
+    }
+
+    return 0;
+}
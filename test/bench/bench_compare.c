@@ -0,0 +1,427 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Comparative benchmark: the same variable length frame traffic goes through lalloc, glibc malloc, a fixed size block
+   pool and a byte ring buffer, each one limited to the same memory budget. A producer offers a frame per step and a
+   consumer frees them in order, but it stalls now and then, so the budget fills up and the frames that do not fit are
+   dropped. For each allocator it reports:
+   - throughput: frames offered per second, including the copy of the payload
+   - overhead: bytes of the budget taken by each stored frame beyond its payload (headers, alignment, rounding)
+   - drops: frames that did not fit in the budget
+   - occupancy: average share of the budget that holds payload while the consumer is stalled
+   The block pool must fit the biggest frame of the distribution in each block. The ring buffer stores a length in
+   front of each frame and wastes the end of the buffer when a frame does not fit before wrapping.
+   malloc is charged with malloc_usable_size plus its chunk header, its own metadata and the free memory it keeps are
+   not charged, so its figures are a lower bound. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <time.h>
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#define BENCH_BUDGET        0x10000
+#define BENCH_FRAMES        2000000
+#define BENCH_QUEUE_MAX     ( BENCH_BUDGET / 8 )
+#define BENCH_RING_HEADER   4
+
+LALLOC_DECLARE( bench_alloc, BENCH_BUDGET );
+
+/* frames queued for the consumer, from the oldest */
+static struct
+{
+    uint8_t *data;
+    uint32_t cost;
+    uint32_t size;
+} bench_queue[BENCH_QUEUE_MAX];
+
+static uint32_t bench_queue_head;
+static uint32_t bench_queue_count;
+static uint32_t bench_seed;
+
+static uint32_t bench_random( uint32_t min, uint32_t max )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+
+    return min + bench_seed % ( max - min + 1 );
+}
+
+/* FRAME SIZE DISTRIBUTIONS ============================================================================================ */
+
+static uint32_t bench_dist_fixed( void )
+{
+    return 128;
+}
+
+static uint32_t bench_dist_uniform( void )
+{
+    return bench_random( 16, 512 );
+}
+
+/* mostly short frames (acknowledges, telemetry) and some of the size of an ethernet frame */
+static uint32_t bench_dist_bimodal( void )
+{
+    return ( bench_random( 0, 9 ) < 8 ) ? bench_random( 16, 64 ) : bench_random( 512, 1500 );
+}
+
+static const struct
+{
+    const char *name;
+    uint32_t ( *size )( void );
+    uint32_t max;
+} bench_dists[] =
+{
+    { "fixed 128",       bench_dist_fixed,   128 },
+    { "uniform 16-512",  bench_dist_uniform, 512 },
+    { "bimodal 16-1500", bench_dist_bimodal, 1500 },
+};
+
+/* ALLOCATORS ========================================================================================================== */
+
+/* lalloc: the frame is committed in the largest free block */
+static void lalloc_bench_init( uint32_t max_frame )
+{
+    ( void )max_frame;
+    lalloc_init( &bench_alloc );
+}
+
+static uint8_t *lalloc_bench_alloc( uint32_t size, uint32_t *cost )
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE len;
+
+    lalloc_alloc( &bench_alloc, ( void ** )&data, &len );
+
+    if ( data == NULL || len < size )
+    {
+        lalloc_alloc_revert( &bench_alloc );
+        return NULL;
+    }
+
+    lalloc_commit( &bench_alloc, size );
+    *cost = LALLOC_ALIGN_ROUND_UP( size ) + LALLOC_BLOCK_HEADER_SIZE;
+
+    return data;
+}
+
+static void lalloc_bench_free( uint8_t *data )
+{
+    ( void )data;
+    lalloc_free_first( &bench_alloc );
+}
+
+/* glibc malloc, the usable size and the chunk header of each frame are charged to the budget */
+static uint32_t malloc_used;
+
+static void malloc_bench_init( uint32_t max_frame )
+{
+    ( void )max_frame;
+    malloc_used = 0;
+}
+
+static uint8_t *malloc_bench_alloc( uint32_t size, uint32_t *cost )
+{
+    uint8_t *data = malloc( size );
+
+    if ( data == NULL )
+    {
+        return NULL;
+    }
+
+    *cost = malloc_usable_size( data ) + sizeof( size_t );
+
+    if ( malloc_used + *cost > BENCH_BUDGET )
+    {
+        free( data );
+        return NULL;
+    }
+
+    malloc_used += *cost;
+
+    return data;
+}
+
+static void malloc_bench_free( uint8_t *data )
+{
+    malloc_used -= malloc_usable_size( data ) + sizeof( size_t );
+    free( data );
+}
+
+/* fixed size block pool: each block fits the biggest frame, the free blocks are kept in a stack */
+static uint8_t pool_mem[BENCH_BUDGET];
+static uint8_t *pool_free[BENCH_BUDGET / 16];
+static uint32_t pool_free_count;
+static uint32_t pool_block;
+
+static void pool_bench_init( uint32_t max_frame )
+{
+    uint32_t i;
+
+    pool_block = ( max_frame + 3 ) & ~3U;
+    pool_free_count = 0;
+
+    for ( i = 0; i + pool_block <= BENCH_BUDGET; i += pool_block )
+    {
+        pool_free[pool_free_count++] = &pool_mem[i];
+    }
+}
+
+static uint8_t *pool_bench_alloc( uint32_t size, uint32_t *cost )
+{
+    if ( pool_free_count == 0 || size > pool_block )
+    {
+        return NULL;
+    }
+
+    *cost = pool_block;
+
+    return pool_free[--pool_free_count];
+}
+
+static void pool_bench_free( uint8_t *data )
+{
+    pool_free[pool_free_count++] = data;
+}
+
+/* byte ring buffer: each frame is contiguous, with its length in front. A frame that does not fit at the end of the
+   buffer goes to the start, and the end is skipped until the oldest frames get there. */
+static uint8_t ring_mem[BENCH_BUDGET];
+static uint32_t ring_head;
+static uint32_t ring_tail;
+static uint32_t ring_end;
+static bool ring_wrapped;
+
+static void ring_bench_init( uint32_t max_frame )
+{
+    ( void )max_frame;
+    ring_head = 0;
+    ring_tail = 0;
+    ring_end = 0;
+    ring_wrapped = false;
+}
+
+static uint8_t *ring_bench_alloc( uint32_t size, uint32_t *cost )
+{
+    uint32_t need = BENCH_RING_HEADER + ( ( size + 3 ) & ~3U );
+    uint8_t *data;
+
+    if ( !ring_wrapped && ring_tail + need > BENCH_BUDGET )
+    {
+        if ( need > ring_head )
+        {
+            return NULL;
+        }
+
+        ring_end = ring_tail;
+        ring_tail = 0;
+        ring_wrapped = true;
+    }
+    else if ( ring_wrapped && ring_tail + need > ring_head )
+    {
+        return NULL;
+    }
+
+    data = &ring_mem[ring_tail];
+    memcpy( data, &need, BENCH_RING_HEADER );
+    ring_tail += need;
+    *cost = need;
+
+    return data + BENCH_RING_HEADER;
+}
+
+static void ring_bench_free( uint8_t *data )
+{
+    uint32_t need;
+
+    ( void )data;
+
+    memcpy( &need, &ring_mem[ring_head], BENCH_RING_HEADER );
+    ring_head += need;
+
+    if ( ring_wrapped && ring_head == ring_end )
+    {
+        ring_head = 0;
+        ring_wrapped = false;
+    }
+
+    if ( !ring_wrapped && ring_head == ring_tail )
+    {
+        /* empty, it starts over */
+        ring_head = 0;
+        ring_tail = 0;
+    }
+}
+
+static const struct
+{
+    const char *name;
+    void ( *init )( uint32_t max_frame );
+    uint8_t *( *alloc )( uint32_t size, uint32_t *cost );
+    void ( *free )( uint8_t *data );
+} bench_allocators[] =
+{
+    { "lalloc",      lalloc_bench_init, lalloc_bench_alloc, lalloc_bench_free },
+    { "malloc",      malloc_bench_init, malloc_bench_alloc, malloc_bench_free },
+    { "block pool",  pool_bench_init,   pool_bench_alloc,   pool_bench_free },
+    { "ring buffer", ring_bench_init,   ring_bench_alloc,   ring_bench_free },
+};
+
+/* HARNESS ============================================================================================================= */
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_consume( uint32_t a )
+{
+    bench_allocators[a].free( bench_queue[bench_queue_head].data );
+    bench_queue_head = ( bench_queue_head + 1 ) % BENCH_QUEUE_MAX;
+    bench_queue_count--;
+}
+
+/* the same traffic for every allocator: the seed is reset for each run */
+static void bench_run( uint32_t a, uint32_t d )
+{
+    uint64_t cost_sum = 0;
+    uint64_t size_sum = 0;
+    uint64_t held_sum = 0;
+    uint64_t held_samples = 0;
+    uint32_t held = 0;
+    uint32_t stored = 0;
+    uint32_t dropped = 0;
+    uint32_t stall = 0;
+    uint32_t i;
+    double t;
+
+    bench_seed = 12345;
+    bench_queue_head = 0;
+    bench_queue_count = 0;
+
+    bench_allocators[a].init( bench_dists[d].max );
+
+    t = bench_now();
+
+    for ( i = 0; i < BENCH_FRAMES; i++ )
+    {
+        uint32_t size = bench_dists[d].size();
+        uint32_t cost;
+        uint8_t *data = ( bench_queue_count < BENCH_QUEUE_MAX ) ? bench_allocators[a].alloc( size, &cost ) : NULL;
+
+        if ( data != NULL )
+        {
+            uint32_t tail = ( bench_queue_head + bench_queue_count ) % BENCH_QUEUE_MAX;
+
+            memset( data, ( uint8_t )i, size );
+
+            bench_queue[tail].data = data;
+            bench_queue[tail].cost = cost;
+            bench_queue[tail].size = size;
+            bench_queue_count++;
+
+            cost_sum += cost;
+            size_sum += size;
+            held += size;
+            stored++;
+        }
+        else
+        {
+            dropped++;
+        }
+
+        if ( stall > 0 )
+        {
+            /* the consumer is busy, the payload held shows how much of the budget is usable */
+            stall--;
+            held_sum += held;
+            held_samples++;
+        }
+        else
+        {
+            uint32_t n;
+
+            /* the consumer is a bit faster than the producer, until it stalls */
+            for ( n = 0; n < 2 && bench_queue_count > 0; n++ )
+            {
+                held -= bench_queue[bench_queue_head].size;
+                bench_consume( a );
+            }
+
+            if ( bench_random( 0, 1023 ) == 0 )
+            {
+                stall = bench_random( 100, 600 );
+            }
+        }
+    }
+
+    while ( bench_queue_count > 0 )
+    {
+        bench_consume( a );
+    }
+
+    t = bench_now() - t;
+
+    printf( "  %-12s %8.2f Mframes/s  overhead %7.1f B/frame  drops %6.2f %%  occupancy %5.1f %%\n",
+            bench_allocators[a].name, BENCH_FRAMES / t * 1e-6,
+            ( stored > 0 ) ? ( double )( cost_sum - size_sum ) / stored : 0.0,
+            100.0 * dropped / BENCH_FRAMES,
+            ( held_samples > 0 ) ? 100.0 * held_sum / held_samples / BENCH_BUDGET : 0.0 );
+}
+
+int main()
+{
+    uint32_t a;
+    uint32_t d;
+
+    printf( "%u bytes of budget, %u frames per run\n", BENCH_BUDGET, BENCH_FRAMES );
+
+    for ( d = 0; d < sizeof( bench_dists ) / sizeof( bench_dists[0] ); d++ )
+    {
+        printf( "%s\n", bench_dists[d].name );
+
+        for ( a = 0; a < sizeof( bench_allocators ) / sizeof( bench_allocators[0] ); a++ )
+        {
+            bench_run( a, d );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Lock contention benchmark: 1, 2, 4 and 8 threads, each one with its own instance, run FIFO frame traffic. With
+   LALLOC_MUTEX each instance takes only its own mutex, so the throughput should grow with the threads. With
+   BENCH_LOCKED every instance goes through one global mutex, which is what a single lock in lalloc_config.h gives.
+   For each thread count it reports the total Mops/s (an operation is a commit or a free) and the scaling against
+   one thread. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#define BENCH_THREADS_MAX   8
+#define BENCH_POOL_SIZE     0x4000
+#define BENCH_OPS           2000000
+#define BENCH_LIVE          32
+#define BENCH_FRAME_MAX     200
+
+#ifdef BENCH_LOCKED
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+typedef struct
+{
+    LALLOC_T        *obj;
+    uint32_t        seed;
+    uint32_t        ops;
+} bench_worker_t;
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* keeps up to BENCH_LIVE frames, the oldest is freed when the pool or the queue is full */
+static void *bench_worker( void *arg )
+{
+    bench_worker_t *ctx = ( bench_worker_t * )arg;
+    uint32_t count = 0;
+    uint32_t ops = 0;
+
+    while ( ops < BENCH_OPS )
+    {
+        LALLOC_IDX_TYPE size;
+        uint8_t *data;
+
+        ctx->seed ^= ctx->seed << 13;
+        ctx->seed ^= ctx->seed >> 17;
+        ctx->seed ^= ctx->seed << 5;
+
+        if ( count < BENCH_LIVE )
+        {
+            LALLOC_IDX_TYPE frame_size = 1 + ctx->seed % BENCH_FRAME_MAX;
+
+            lalloc_alloc( ctx->obj, ( void ** )&data, &size );
+
+            if ( data != NULL && size >= frame_size )
+            {
+                memset( data, ( uint8_t )ops, frame_size );
+                lalloc_commit( ctx->obj, frame_size );
+                count++;
+                ops++;
+                continue;
+            }
+
+            lalloc_alloc_revert( ctx->obj );
+        }
+
+        lalloc_free_first( ctx->obj );
+        count--;
+        ops++;
+    }
+
+    while ( count-- > 0 )
+    {
+        lalloc_free_first( ctx->obj );
+    }
+
+    ctx->ops = ops;
+
+    return NULL;
+}
+
+int main( void )
+{
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+    pthread_t threads[BENCH_THREADS_MAX];
+    bench_worker_t workers[BENCH_THREADS_MAX];
+    double base = 0;
+    uint32_t c;
+
+#ifdef BENCH_LOCKED
+    printf( "lock: one global mutex\n" );
+#else
+    printf( "lock: one mutex per instance\n" );
+#endif
+    printf( "%8s %10s %10s %8s\n", "threads", "seconds", "Mops/s", "scaling" );
+
+    for ( c = 0; c < sizeof( thread_counts ) / sizeof( thread_counts[0] ); c++ )
+    {
+        uint32_t n = thread_counts[c];
+        uint64_t ops = 0;
+        double mops;
+        double t;
+        uint32_t w;
+
+        for ( w = 0; w < n; w++ )
+        {
+            workers[w].obj = lalloc_ctor( BENCH_POOL_SIZE );
+            workers[w].seed = 12345 + w;
+            workers[w].ops = 0;
+        }
+
+        t = bench_now();
+
+        for ( w = 0; w < n; w++ )
+        {
+            pthread_create( &threads[w], NULL, bench_worker, &workers[w] );
+        }
+
+        for ( w = 0; w < n; w++ )
+        {
+            pthread_join( threads[w], NULL );
+            ops += workers[w].ops;
+        }
+
+        t = bench_now() - t;
+        mops = ops / t * 1e-6;
+
+        if ( c == 0 )
+        {
+            base = mops;
+        }
+
+        printf( "%8u %10.3f %10.2f %7.2fx\n", n, t, mops, mops / base );
+
+        for ( w = 0; w < n; w++ )
+        {
+            lalloc_dtor( ( void * )workers[w].obj );
+        }
+    }
+
+    return 0;
+}
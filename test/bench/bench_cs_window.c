@@ -0,0 +1,263 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Worst case critical section windows: adversarial fragmentation patterns are driven through one instance and the
+   time each critical section holds the lock (the time the interrupts would be masked) is reported per call site.
+   Each pattern leaves the pool fragmented in a different way and then keeps allocating and freeing on top of it.
+   On Linux the maximum also includes the preemptions of the thread while it holds the lock, the percentile is the
+   stable figure. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lalloc.h"
+
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_LIVE_MAX      8192
+#define BENCH_ROUNDS        200000
+#define BENCH_TOP_SITES     4
+
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+static uint8_t *bench_live[BENCH_LIVE_MAX];
+static uint32_t bench_live_count;
+static uint32_t bench_seed = 12345;
+static lalloc_cs_site_t bench_sites[LALLOC_CS_PROFILE_SITES];
+
+static uint32_t bench_random( uint32_t min, uint32_t max )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+
+    return min + bench_seed % ( max - min + 1 );
+}
+
+/* allocates a block of size bytes, false if there is no room for it */
+static bool bench_alloc_one( LALLOC_IDX_TYPE size )
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE len;
+
+    if ( bench_live_count == BENCH_LIVE_MAX )
+    {
+        return false;
+    }
+
+    lalloc_alloc( &bench_alloc, ( void ** )&data, &len );
+
+    if ( data == NULL || len < size )
+    {
+        lalloc_alloc_revert( &bench_alloc );
+        return false;
+    }
+
+    lalloc_commit( &bench_alloc, size );
+    bench_live[bench_live_count++] = data;
+
+    return true;
+}
+
+static void bench_free_one( uint32_t k )
+{
+    lalloc_free( &bench_alloc, bench_live[k] );
+    bench_live[k] = bench_live[--bench_live_count];
+}
+
+/* frees the live blocks at k % step == offset, keeping the order of the rest */
+static void bench_free_every( uint32_t step, uint32_t offset )
+{
+    uint32_t k;
+    uint32_t kept = 0;
+
+    for ( k = 0; k < bench_live_count; k++ )
+    {
+        if ( k % step == offset )
+        {
+            lalloc_free( &bench_alloc, bench_live[k] );
+        }
+        else
+        {
+            bench_live[kept++] = bench_live[k];
+        }
+    }
+
+    bench_live_count = kept;
+}
+
+/* random allocations and frees on top of the current layout */
+static void bench_churn( LALLOC_IDX_TYPE min, LALLOC_IDX_TYPE max )
+{
+    uint32_t i;
+
+    for ( i = 0; i < BENCH_ROUNDS; i++ )
+    {
+        if ( bench_live_count > 0 && ( bench_random( 0, 1 ) || !bench_alloc_one( bench_random( min, max ) ) ) )
+        {
+            bench_free_one( bench_random( 0, bench_live_count - 1 ) );
+        }
+
+        if ( i % 64 == 0 )
+        {
+            lalloc_maintain( &bench_alloc, 16 );
+        }
+    }
+}
+
+/* hundreds of equal fragments, every other block is free */
+static void pattern_checkerboard( void )
+{
+    while ( bench_alloc_one( 16 ) );
+    bench_free_every( 2, 0 );
+    bench_churn( 8, 24 );
+}
+
+/* fragments of every size: the sizes grow along the pool */
+static void pattern_ladder( void )
+{
+    LALLOC_IDX_TYPE size = 8;
+
+    while ( bench_alloc_one( size ) )
+    {
+        size = ( size < 256 ) ? size + 4 : 8;
+    }
+
+    bench_free_every( 2, 0 );
+    bench_churn( 8, 256 );
+}
+
+/* small blocks pinned between big holes, the big requests split them again and again */
+static void pattern_pinned( void )
+{
+    while ( bench_alloc_one( bench_random( 8, 512 ) ) );
+    bench_free_every( 1, 0 );
+
+    while ( bench_alloc_one( 8 ) && bench_alloc_one( 512 ) );
+
+    /* frees the big blocks only */
+    bench_free_every( 2, 1 );
+    bench_churn( 256, 1024 );
+}
+
+/* random sizes at high occupancy */
+static void pattern_random( void )
+{
+    while ( bench_alloc_one( bench_random( 8, 512 ) ) );
+    bench_churn( 8, 512 );
+}
+
+static const struct
+{
+    const char *name;
+    void ( *run )( void );
+} bench_patterns[] =
+{
+    { "checkerboard", pattern_checkerboard },
+    { "ladder",       pattern_ladder },
+    { "pinned",       pattern_pinned },
+    { "random",       pattern_random },
+};
+
+/* upper bound of the bin that holds the 99th percentile */
+static uint64_t bench_p99( const lalloc_cs_site_t *site )
+{
+    uint64_t acc = 0;
+    uint8_t b;
+
+    for ( b = 0; b < LALLOC_PROFILE_BINS; b++ )
+    {
+        acc += site->hist[b];
+
+        if ( acc * 100 >= ( uint64_t )site->count * 99 )
+        {
+            break;
+        }
+    }
+
+    return ( b == 0 ) ? 1 : ( ( uint64_t )1 << b );
+}
+
+int main()
+{
+    uint32_t p;
+    uint32_t worst_all = 0;
+
+    printf( "%s free list%s, critical section hold time in ns\n",
+            LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF ? "segregated fit" : LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY ? "lazy" : "sorted",
+            LALLOC_LAZY_COALESCING ? " with lazy coalescing" : "" );
+
+    for ( p = 0; p < sizeof( bench_patterns ) / sizeof( bench_patterns[0] ); p++ )
+    {
+        uint32_t count;
+        uint32_t i;
+        uint32_t n;
+
+        lalloc_init( &bench_alloc );
+        bench_live_count = 0;
+
+        lalloc_cs_reset();
+        bench_patterns[p].run();
+        count = lalloc_cs_get( bench_sites, LALLOC_CS_PROFILE_SITES, NULL );
+
+        /* the worst sites first */
+        for ( n = 0; n < count && n < BENCH_TOP_SITES; n++ )
+        {
+            for ( i = n + 1; i < count; i++ )
+            {
+                if ( bench_sites[i].max > bench_sites[n].max )
+                {
+                    lalloc_cs_site_t tmp = bench_sites[n];
+                    bench_sites[n] = bench_sites[i];
+                    bench_sites[i] = tmp;
+                }
+            }
+
+            printf( "  %-13s %-24s line %5u  count %8u  max %7u  p99 < %6llu  mean %5llu\n",
+                    ( n == 0 ) ? bench_patterns[p].name : "", bench_sites[n].fcn, bench_sites[n].line, bench_sites[n].count,
+                    bench_sites[n].max, ( unsigned long long )bench_p99( &bench_sites[n] ),
+                    ( unsigned long long )( bench_sites[n].total / bench_sites[n].count ) );
+        }
+
+        if ( count > 0 && bench_sites[0].max > worst_all )
+        {
+            worst_all = bench_sites[0].max;
+        }
+    }
+
+    printf( "worst case window: %u ns\n", worst_all );
+
+    return 0;
+}
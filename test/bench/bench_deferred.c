@@ -0,0 +1,169 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Frees from several threads: the owner of the pool commits frames of variable size and hands them to
+   BENCH_WORKERS threads, which free them by address. Every call shares one mutex.
+   Built with LALLOC_DEFERRED_FREE==1 the workers free without taking it, and the owner drains their frees. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "lalloc.h"
+
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_FRAMES        2000000UL
+#define BENCH_FRAME_MIN     16
+#define BENCH_FRAME_MAX     256
+#define BENCH_WORKERS       3
+#define BENCH_QUEUE_SIZE    64
+
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+/* frames handed from the owner to one worker */
+typedef struct
+{
+    uint8_t *frames[BENCH_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t checksum;
+    bool done;
+} bench_worker_t;
+
+static bench_worker_t bench_workers[BENCH_WORKERS];
+
+static LALLOC_IDX_TYPE bench_frame_size( uint32_t seq )
+{
+    uint32_t x = seq * 2654435761UL;
+
+    return BENCH_FRAME_MIN + ( x >> 16 ) % ( BENCH_FRAME_MAX - BENCH_FRAME_MIN + 1 );
+}
+
+static void *bench_worker( void *arg )
+{
+    bench_worker_t *ctx = ( bench_worker_t * )arg;
+    uint32_t tail = 0;
+
+    while ( 1 )
+    {
+        if ( tail == __atomic_load_n( &ctx->head, __ATOMIC_ACQUIRE ) )
+        {
+            if ( __atomic_load_n( &ctx->done, __ATOMIC_ACQUIRE ) && tail == __atomic_load_n( &ctx->head, __ATOMIC_ACQUIRE ) )
+            {
+                break;
+            }
+
+            sched_yield();
+            continue;
+        }
+
+        uint8_t *data = ctx->frames[tail % BENCH_QUEUE_SIZE];
+
+        ctx->checksum += data[0];
+        lalloc_free( &bench_alloc, data );
+
+        __atomic_store_n( &ctx->tail, ++tail, __ATOMIC_RELEASE );
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    pthread_t threads[BENCH_WORKERS];
+    struct timespec start;
+    struct timespec end;
+    uint32_t seq = 0;
+    uint32_t checksum = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    int w;
+
+    lalloc_init( &bench_alloc );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for ( w = 0; w < BENCH_WORKERS; w++ )
+    {
+        pthread_create( &threads[w], NULL, bench_worker, &bench_workers[w] );
+    }
+
+    while ( seq < BENCH_FRAMES )
+    {
+        bench_worker_t *ctx = &bench_workers[seq % BENCH_WORKERS];
+        LALLOC_IDX_TYPE frame_size = bench_frame_size( seq );
+
+        if ( ctx->head - __atomic_load_n( &ctx->tail, __ATOMIC_ACQUIRE ) == BENCH_QUEUE_SIZE )
+        {
+            sched_yield();
+            continue;
+        }
+
+        lalloc_alloc( &bench_alloc, ( void ** )&data, &size );
+
+        if ( data == NULL || size < frame_size )
+        {
+            lalloc_alloc_revert( &bench_alloc );
+            lalloc_maintain( &bench_alloc, 0 );
+            sched_yield();
+            continue;
+        }
+
+        data[0] = ( uint8_t )seq;
+        lalloc_commit( &bench_alloc, frame_size );
+
+        ctx->frames[ctx->head % BENCH_QUEUE_SIZE] = data;
+        __atomic_store_n( &ctx->head, ctx->head + 1, __ATOMIC_RELEASE );
+        seq++;
+    }
+
+    for ( w = 0; w < BENCH_WORKERS; w++ )
+    {
+        __atomic_store_n( &bench_workers[w].done, true, __ATOMIC_RELEASE );
+        pthread_join( threads[w], NULL );
+        checksum += bench_workers[w].checksum;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    double seconds = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
+
+    printf( "%s: %lu frames in %.3f s, %.2f Mframes/s (checksum %u)\n",
+            LALLOC_DEFERRED_FREE ? "deferred frees" : "locked frees", BENCH_FRAMES, seconds, BENCH_FRAMES / seconds / 1e6, checksum );
+
+    return 0;
+}
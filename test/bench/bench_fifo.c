@@ -0,0 +1,160 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* FIFO throughput in one context: frames of variable size are committed and freed in order,
+   keeping up to BENCH_DEPTH frames queued. It compares the engines (LALLOC_ENGINE).
+   With BENCH_COMMIT_AND_ALLOC the producer keeps a reservation open, and each frame is committed
+   with lalloc_commit_and_alloc, which reserves the next one in the same critical section.
+   With BENCH_DRAIN the consumer drains the whole queue when it is full, frame by frame, and with
+   BENCH_DRAIN_BATCH it does it with lalloc_free_first_n. */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "lalloc.h"
+
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_FRAMES        20000000UL
+#define BENCH_DEPTH         64
+#define BENCH_FRAME_MIN     16
+#define BENCH_FRAME_MAX     512
+
+#ifdef BENCH_LOCKED
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+static LALLOC_IDX_TYPE bench_frame_size( uint32_t seq )
+{
+    uint32_t x = seq * 2654435761UL;
+
+    return BENCH_FRAME_MIN + ( x >> 16 ) % ( BENCH_FRAME_MAX - BENCH_FRAME_MIN + 1 );
+}
+
+int main()
+{
+    uint32_t seq;
+    uint32_t checksum = 0;
+    uint32_t queued = 0;
+    uint8_t *data = NULL;
+    LALLOC_IDX_TYPE size = 0;
+    struct timespec start;
+    struct timespec end;
+
+    lalloc_init( &bench_alloc );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for ( seq = 0; seq < BENCH_FRAMES; )
+    {
+        LALLOC_IDX_TYPE frame_size = bench_frame_size( seq );
+
+#ifdef BENCH_COMMIT_AND_ALLOC
+        if ( queued < BENCH_DEPTH )
+        {
+            if ( data == NULL )
+            {
+                lalloc_alloc( &bench_alloc, ( void ** )&data, &size );
+            }
+
+            if ( data != NULL && size >= frame_size )
+            {
+                data[0] = ( uint8_t )seq;
+                lalloc_commit_and_alloc( &bench_alloc, frame_size, ( void ** )&data, &size );
+                queued++;
+                seq++;
+                continue;
+            }
+
+            /* there is no room in the open reservation, it is released so the freed frames can join it */
+            lalloc_alloc_revert( &bench_alloc );
+            data = NULL;
+        }
+#else
+        if ( queued < BENCH_DEPTH )
+        {
+            lalloc_alloc( &bench_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL && size >= frame_size )
+            {
+                data[0] = ( uint8_t )seq;
+                lalloc_commit( &bench_alloc, frame_size );
+                queued++;
+                seq++;
+                continue;
+            }
+
+            lalloc_alloc_revert( &bench_alloc );
+        }
+#endif
+
+        /* the queue is full (or there is no room): consume the oldest frame */
+        uint8_t *first;
+        LALLOC_IDX_TYPE first_size;
+
+        lalloc_get_first( &bench_alloc, ( void ** )&first, &first_size );
+        checksum += first[0];
+
+#if defined( BENCH_DRAIN_BATCH )
+        /* the whole queue is drained at once */
+        lalloc_free_first_n( &bench_alloc, queued );
+        queued = 0;
+#elif defined( BENCH_DRAIN )
+        while ( queued > 0 )
+        {
+            lalloc_free_first( &bench_alloc );
+            queued--;
+        }
+#else
+        lalloc_free_first( &bench_alloc );
+        queued--;
+#endif
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    double seconds = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
+
+#ifdef BENCH_COMMIT_AND_ALLOC
+    printf( "commit and alloc, " );
+#endif
+#if defined( BENCH_DRAIN_BATCH )
+    printf( "batch drain, " );
+#elif defined( BENCH_DRAIN )
+    printf( "drain, " );
+#endif
+    printf( "fifo %s: %lu frames in %.3f s, %.2f Mframes/s (checksum %u)\n",
+            ( LALLOC_ENGINE == LALLOC_ENGINE_BIP ) ? "bip" : "lists", BENCH_FRAMES, seconds, BENCH_FRAMES / seconds / 1e6, checksum );
+
+    return 0;
+}
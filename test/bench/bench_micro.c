@@ -0,0 +1,279 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Micro benchmarks: ns per call of lalloc_alloc + lalloc_commit, lalloc_get_n, lalloc_free (by address, in random
+   order) and lalloc_free_first, for several pool sizes and frame size distributions. Each cycle fills the pool with
+   up to BENCH_DEPTH frames, reads them all with lalloc_get_n, frees half of them by address and the rest in order.
+   The calls of each kind are timed together, so the clock is not read per call.
+   `make bench` builds it for every LALLOC_ALIGNMENT x LALLOC_MAX_BYTES combination and gathers the results.
+
+   bench_micro              one CSV row per pool, distribution and operation
+   bench_micro -H           the CSV header
+   bench_micro -j FILE      the rows are also appended to FILE as JSON objects, one per line */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lalloc.h"
+
+/* the biggest pool that LALLOC_IDX_TYPE can index */
+#define BENCH_POOL_LIMIT        ( LALLOC_MAX_BYTES - LALLOC_ALIGNMENT + 1 )
+#define BENCH_POOL( SIZE )      ( ( SIZE ) < BENCH_POOL_LIMIT ? ( SIZE ) : BENCH_POOL_LIMIT )
+
+#define BENCH_DEPTH             256
+#define BENCH_OPS               400000
+
+#define BENCH_OP_ALLOC_COMMIT   0
+#define BENCH_OP_GET_N          1
+#define BENCH_OP_FREE_ADDR      2
+#define BENCH_OP_FREE_FIRST     3
+#define BENCH_OP_COUNT          4
+
+LALLOC_DECLARE( bench_small, BENCH_POOL( 0x100 ) );
+LALLOC_DECLARE( bench_medium, BENCH_POOL( 0x1000 ) );
+LALLOC_DECLARE( bench_large, BENCH_POOL( 0x10000 ) );
+
+static LALLOC_T *const bench_pools[] = { &bench_small, &bench_medium, &bench_large };
+
+static const char *const bench_op_names[BENCH_OP_COUNT] = { "alloc_commit", "get_n", "free_addr", "free_first" };
+
+static uint32_t bench_seed = 12345;
+static uint8_t *bench_frames[BENCH_DEPTH];
+
+static uint32_t bench_random( uint32_t min, uint32_t max )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+
+    return min + bench_seed % ( max - min + 1 );
+}
+
+static uint64_t bench_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ( uint64_t )ts.tv_nsec;
+}
+
+/* frame size distributions, up to max bytes */
+static uint32_t bench_dist_fixed( uint32_t max )
+{
+    return ( 32 < max ) ? 32 : max;
+}
+
+static uint32_t bench_dist_uniform( uint32_t max )
+{
+    return bench_random( 1, ( 256 < max ) ? 256 : max );
+}
+
+/* mostly small frames and a few big ones */
+static uint32_t bench_dist_bimodal( uint32_t max )
+{
+    uint32_t size = ( bench_random( 0, 9 ) < 8 ) ? bench_random( 8, 32 ) : bench_random( 256, 1024 );
+
+    return ( size < max ) ? size : max;
+}
+
+static const struct
+{
+    const char *name;
+    uint32_t ( *size )( uint32_t max );
+} bench_dists[] =
+{
+    { "fixed",   bench_dist_fixed },
+    { "uniform", bench_dist_uniform },
+    { "bimodal", bench_dist_bimodal },
+};
+
+/* runs the cycles on one pool until BENCH_OPS frames were committed, ns and calls are accumulated per operation */
+static void bench_run( LALLOC_T *obj, uint32_t ( *dist )( uint32_t max ), uint64_t *ns, uint64_t *calls )
+{
+    /* a frame is up to an eighth of the pool, so some of them fit */
+    uint32_t max = obj->size / 8;
+    uint32_t checksum = 0;
+
+    lalloc_init( obj );
+
+    while ( calls[BENCH_OP_ALLOC_COMMIT] < BENCH_OPS )
+    {
+        LALLOC_IDX_TYPE sizes[BENCH_DEPTH];
+        LALLOC_IDX_TYPE len;
+        uint32_t count;
+        uint32_t i;
+        uint64_t t;
+
+        for ( i = 0; i < BENCH_DEPTH; i++ )
+        {
+            sizes[i] = dist( max );
+        }
+
+        t = bench_ns();
+
+        for ( count = 0; count < BENCH_DEPTH; count++ )
+        {
+            lalloc_alloc( obj, ( void ** )&bench_frames[count], &len );
+
+            if ( bench_frames[count] == NULL || len < sizes[count] )
+            {
+                break;
+            }
+
+            lalloc_commit( obj, sizes[count] );
+        }
+
+        ns[BENCH_OP_ALLOC_COMMIT] += bench_ns() - t;
+        calls[BENCH_OP_ALLOC_COMMIT] += count;
+
+        /* the frame that did not fit */
+        lalloc_alloc_revert( obj );
+
+        t = bench_ns();
+
+        for ( i = 0; i < count; i++ )
+        {
+            uint8_t *data;
+
+            lalloc_get_n( obj, ( void ** )&data, &len, i );
+            checksum += len;
+        }
+
+        ns[BENCH_OP_GET_N] += bench_ns() - t;
+        calls[BENCH_OP_GET_N] += count;
+
+        /* half of the frames, in random order */
+        for ( i = count; i > 1; i-- )
+        {
+            uint32_t k = bench_random( 0, i - 1 );
+            uint8_t *tmp = bench_frames[k];
+
+            bench_frames[k] = bench_frames[i - 1];
+            bench_frames[i - 1] = tmp;
+        }
+
+        t = bench_ns();
+
+        for ( i = 0; i < count / 2; i++ )
+        {
+            lalloc_free( obj, bench_frames[i] );
+        }
+
+        ns[BENCH_OP_FREE_ADDR] += bench_ns() - t;
+        calls[BENCH_OP_FREE_ADDR] += count / 2;
+
+        t = bench_ns();
+
+        for ( i = count / 2; i < count; i++ )
+        {
+            lalloc_free_first( obj );
+        }
+
+        ns[BENCH_OP_FREE_FIRST] += bench_ns() - t;
+        calls[BENCH_OP_FREE_FIRST] += count - count / 2;
+
+        if ( count == 0 )
+        {
+            /* the distribution does not fit in the pool */
+            break;
+        }
+    }
+
+    /* keeps the reads of lalloc_get_n */
+    if ( checksum == 0xFFFFFFFF )
+    {
+        printf( "\n" );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    FILE *json = NULL;
+    uint32_t p;
+    uint32_t d;
+    uint32_t op;
+
+    if ( argc > 1 && strcmp( argv[1], "-H" ) == 0 )
+    {
+        printf( "alignment,max_bytes,pool,distribution,operation,calls,ns_per_op\n" );
+        return 0;
+    }
+
+    if ( argc > 2 && strcmp( argv[1], "-j" ) == 0 && ( json = fopen( argv[2], "a" ) ) == NULL )
+    {
+        fprintf( stderr, "can not write %s\n", argv[2] );
+        return 1;
+    }
+
+    for ( p = 0; p < sizeof( bench_pools ) / sizeof( bench_pools[0] ); p++ )
+    {
+        /* the pools are clamped to the index type, the small ones might be the same size */
+        if ( p > 0 && bench_pools[p]->size == bench_pools[p - 1]->size )
+        {
+            continue;
+        }
+
+        for ( d = 0; d < sizeof( bench_dists ) / sizeof( bench_dists[0] ); d++ )
+        {
+            uint64_t ns[BENCH_OP_COUNT] = { 0 };
+            uint64_t calls[BENCH_OP_COUNT] = { 0 };
+
+            bench_run( bench_pools[p], bench_dists[d].size, ns, calls );
+
+            for ( op = 0; op < BENCH_OP_COUNT; op++ )
+            {
+                double ns_per_op = ( calls[op] > 0 ) ? ( double )ns[op] / calls[op] : 0;
+
+                printf( "%u,%lu,%lu,%s,%s,%llu,%.2f\n",
+                        LALLOC_ALIGNMENT, ( unsigned long )LALLOC_MAX_BYTES, ( unsigned long )bench_pools[p]->size,
+                        bench_dists[d].name, bench_op_names[op], ( unsigned long long )calls[op], ns_per_op );
+
+                if ( json != NULL )
+                {
+                    fprintf( json, "{\"alignment\": %u, \"max_bytes\": %lu, \"pool\": %lu, \"distribution\": \"%s\", "
+                             "\"operation\": \"%s\", \"calls\": %llu, \"ns_per_op\": %.2f}\n",
+                             LALLOC_ALIGNMENT, ( unsigned long )LALLOC_MAX_BYTES, ( unsigned long )bench_pools[p]->size,
+                             bench_dists[d].name, bench_op_names[op], ( unsigned long long )calls[op], ns_per_op );
+                }
+            }
+        }
+    }
+
+    if ( json != NULL )
+    {
+        fclose( json );
+    }
+
+    return 0;
+}
@@ -0,0 +1,513 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Trace replay: a workload is captured with LALLOC_TRACE==1 in a compact binary file and replayed against this build
+   of lalloc, so the same traffic (e.g. recorded on a device) can be compared across free list policies and options.
+   The file is a header ( "LALT", version, alignment, bytes of LALLOC_IDX_TYPE, 0, pool size as a little endian
+   uint32 ) followed by the records of lalloc_trace_encode.
+
+   bench_replay -c FILE     captures the synthetic workload into FILE
+   bench_replay FILE        replays FILE
+   bench_replay             captures the synthetic workload in memory and replays it
+
+   The replay maps the offsets of the trace to the blocks of this instance, so a trace can be replayed with another
+   alignment or free list policy. A block that could not be allocated here is counted as a failure and its later
+   events are skipped. The first pass is timed, the second one samples the statistics after each event. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lalloc.h"
+
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_FRAMES        200000
+#define BENCH_HANDLES       8
+#define BENCH_HEADER_SIZE   12
+#define BENCH_VERSION       1
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+static uint32_t bench_seed = 12345;
+
+/* records of the capture */
+static uint8_t *bench_trace;
+static uint32_t bench_trace_len;
+static uint32_t bench_trace_cap;
+static uint64_t bench_trace_time;
+static uint32_t bench_trace_events;
+
+/* replay state: the blocks of this instance by offset in the trace, and the open reservations */
+static uint8_t **bench_map;
+static uint32_t bench_map_size;
+static struct
+{
+    uint32_t        offset;
+    lalloc_handle_t h;
+} bench_handles[BENCH_HANDLES];
+
+static uint32_t bench_failures;
+
+static uint32_t bench_random( uint32_t min, uint32_t max )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+
+    return min + bench_seed % ( max - min + 1 );
+}
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_put32( uint8_t *buf, uint32_t value )
+{
+    buf[0] = ( uint8_t )value;
+    buf[1] = ( uint8_t )( value >> 8 );
+    buf[2] = ( uint8_t )( value >> 16 );
+    buf[3] = ( uint8_t )( value >> 24 );
+}
+
+static uint32_t bench_get32( const uint8_t *buf )
+{
+    return buf[0] | ( uint32_t )buf[1] << 8 | ( uint32_t )buf[2] << 16 | ( uint32_t )buf[3] << 24;
+}
+
+static void bench_trace_cb( void *ctx, const lalloc_trace_event_t *ev )
+{
+    ( void )ctx;
+
+    if ( bench_trace_len + LALLOC_TRACE_RECORD_MAX > bench_trace_cap )
+    {
+        bench_trace_cap = bench_trace_cap * 2 + 4096;
+        bench_trace = realloc( bench_trace, bench_trace_cap );
+    }
+
+    bench_trace_len += lalloc_trace_encode( ev, &bench_trace[bench_trace_len] );
+    bench_trace_time += ev->delta;
+    bench_trace_events++;
+}
+
+/* sizes of the frames: mostly small, a few big ones */
+static LALLOC_IDX_TYPE bench_frame_size( void )
+{
+    uint32_t r = bench_random( 0, 99 );
+
+    return ( r < 70 ) ? bench_random( 8, 64 ) : ( r < 95 ) ? bench_random( 64, 512 ) : bench_random( 512, 4096 );
+}
+
+/* synthetic traffic: frames produced with a reservation, consumed in order, some dropped out of order, and a second
+   producer with its own reservations. The backlog drifts so the pool is sometimes full. */
+static void bench_capture( void )
+{
+    uint32_t backlog = 64;
+    uint32_t i;
+
+    lalloc_init( &bench_alloc );
+
+    bench_trace_cap = 0x100000;
+    bench_trace = malloc( bench_trace_cap );
+    bench_trace_len = BENCH_HEADER_SIZE;
+    bench_trace_events = 0;
+    bench_trace_time = 0;
+
+    memcpy( bench_trace, "LALT", 4 );
+    bench_trace[4] = BENCH_VERSION;
+    bench_trace[5] = LALLOC_ALIGNMENT;
+    bench_trace[6] = sizeof( LALLOC_IDX_TYPE );
+    bench_trace[7] = 0;
+    bench_put32( &bench_trace[8], bench_alloc.size );
+
+    lalloc_trace_set( &bench_alloc, bench_trace_cb, NULL );
+
+    for ( i = 0; i < BENCH_FRAMES; i++ )
+    {
+        LALLOC_IDX_TYPE size = bench_frame_size();
+        LALLOC_IDX_TYPE len;
+        uint8_t *data;
+
+        if ( i % 1024 == 0 )
+        {
+            backlog = bench_random( 16, 512 );
+        }
+
+        if ( bench_random( 0, 9 ) < 8 )
+        {
+            lalloc_alloc( &bench_alloc, ( void ** )&data, &len );
+
+            if ( data != NULL && len >= size )
+            {
+                lalloc_commit( &bench_alloc, size );
+            }
+            else
+            {
+                lalloc_alloc_revert( &bench_alloc );
+            }
+        }
+        else
+        {
+            lalloc_handle_t h;
+
+            if ( lalloc_reserve( &bench_alloc, size, &h ) )
+            {
+                if ( h.size >= size )
+                {
+                    lalloc_commit_h( &bench_alloc, &h, size );
+                }
+                else
+                {
+                    lalloc_revert_h( &bench_alloc, &h );
+                }
+            }
+        }
+
+        /* the consumer */
+        while ( lalloc_get_alloc_count( &bench_alloc ) > backlog )
+        {
+            lalloc_get_first( &bench_alloc, ( void ** )&data, &len );
+            lalloc_free( &bench_alloc, data );
+        }
+
+        /* a frame dropped out of order */
+        if ( bench_random( 0, 99 ) < 5 && lalloc_get_alloc_count( &bench_alloc ) > 1 )
+        {
+            lalloc_get_n( &bench_alloc, ( void ** )&data, &len, bench_random( 1, lalloc_get_alloc_count( &bench_alloc ) - 1 ) );
+            lalloc_free( &bench_alloc, data );
+        }
+    }
+
+    lalloc_trace_set( &bench_alloc, NULL, NULL );
+}
+
+static lalloc_handle_t *bench_handle( uint32_t offset )
+{
+    uint32_t i;
+
+    for ( i = 0; i < BENCH_HANDLES; i++ )
+    {
+        if ( bench_handles[i].h.block != LALLOC_IDX_INVALID && bench_handles[i].offset == offset )
+        {
+            return &bench_handles[i].h;
+        }
+    }
+
+    return NULL;
+}
+
+static uint8_t **bench_slot( uint32_t offset )
+{
+    static uint8_t *dummy;
+
+    if ( offset < bench_map_size )
+    {
+        return &bench_map[offset];
+    }
+
+    dummy = NULL;
+
+    return &dummy;
+}
+
+/* one event of the trace against this instance */
+static void bench_replay_event( const lalloc_trace_event_t *ev )
+{
+    lalloc_handle_t *h;
+    LALLOC_IDX_TYPE len;
+    uint8_t *data;
+    uint32_t i;
+
+    switch ( ev->type )
+    {
+        case LALLOC_EV_ALLOC:
+            lalloc_alloc( &bench_alloc, ( void ** )&data, &len );
+            break;
+
+        case LALLOC_EV_ALLOC_MAX:
+            lalloc_alloc_max( &bench_alloc, ( void ** )&data, &len, ev->a );
+            break;
+
+        case LALLOC_EV_ALLOC_REVERT:
+            lalloc_alloc_revert( &bench_alloc );
+            break;
+
+        case LALLOC_EV_COMMIT:
+        case LALLOC_EV_COMMIT_AND_ALLOC:
+            if ( ev->type == LALLOC_EV_COMMIT ? lalloc_commit( &bench_alloc, ev->a ) :
+                    lalloc_commit_and_alloc( &bench_alloc, ev->a, ( void ** )&data, &len ) )
+            {
+                /* the committed block is the newest one */
+                lalloc_get_last( &bench_alloc, ( void ** )bench_slot( ev->b ), &len );
+            }
+            else
+            {
+                /* the reservation was smaller here */
+                lalloc_alloc_revert( &bench_alloc );
+                *bench_slot( ev->b ) = NULL;
+                bench_failures++;
+            }
+            break;
+
+        case LALLOC_EV_RESERVE:
+            for ( i = 0; i < BENCH_HANDLES && bench_handles[i].h.block != LALLOC_IDX_INVALID; i++ )
+            {
+            }
+
+            if ( ev->b != 0 && i < BENCH_HANDLES )
+            {
+                if ( lalloc_reserve( &bench_alloc, ev->a, &bench_handles[i].h ) )
+                {
+                    bench_handles[i].offset = ev->b;
+                }
+                else
+                {
+                    bench_failures++;
+                }
+            }
+            break;
+
+        case LALLOC_EV_COMMIT_H:
+            h = bench_handle( ev->b );
+            *bench_slot( ev->b ) = NULL;
+
+            if ( h != NULL )
+            {
+                data = h->addr;
+
+                if ( lalloc_commit_h( &bench_alloc, h, ev->a ) )
+                {
+                    *bench_slot( ev->b ) = data;
+                }
+                else
+                {
+                    lalloc_revert_h( &bench_alloc, h );
+                    bench_failures++;
+                }
+            }
+            break;
+
+        case LALLOC_EV_REVERT_H:
+            h = bench_handle( ev->b );
+
+            if ( h != NULL )
+            {
+                lalloc_revert_h( &bench_alloc, h );
+            }
+            break;
+
+        case LALLOC_EV_FREE:
+            if ( *bench_slot( ev->b ) != NULL )
+            {
+                lalloc_free( &bench_alloc, *bench_slot( ev->b ) );
+                *bench_slot( ev->b ) = NULL;
+            }
+            break;
+
+        case LALLOC_EV_GET:
+            lalloc_get_n( &bench_alloc, ( void ** )&data, &len, ev->a );
+            break;
+
+        case LALLOC_EV_GET_LAST:
+            lalloc_get_last( &bench_alloc, ( void ** )&data, &len );
+            break;
+
+        case LALLOC_EV_MOVE:
+            /* the block lives at another offset of the trace from now on */
+            data = *bench_slot( ev->b );
+            *bench_slot( ev->b ) = NULL;
+            *bench_slot( ev->a ) = data;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* replays the whole trace, keeping the peaks of the statistics after each event if peak is not NULL */
+static uint32_t bench_replay( lalloc_stats_t *peak )
+{
+    lalloc_trace_event_t ev;
+    lalloc_stats_t stats;
+    uint32_t pos = BENCH_HEADER_SIZE;
+    uint32_t events = 0;
+    uint32_t i;
+
+    lalloc_init( &bench_alloc );
+    memset( bench_map, 0, bench_map_size * sizeof( bench_map[0] ) );
+
+    for ( i = 0; i < BENCH_HANDLES; i++ )
+    {
+        bench_handles[i].h.block = LALLOC_IDX_INVALID;
+    }
+
+    bench_failures = 0;
+
+    while ( pos < bench_trace_len )
+    {
+        uint8_t n = lalloc_trace_decode( &bench_trace[pos], bench_trace_len - pos, &ev );
+
+        if ( n == 0 )
+        {
+            fprintf( stderr, "truncated record at byte %u\n", pos );
+            break;
+        }
+
+        pos += n;
+        events++;
+
+        bench_replay_event( &ev );
+
+        if ( peak != NULL )
+        {
+            lalloc_get_stats( &bench_alloc, &stats );
+
+            if ( stats.fragmentation > peak->fragmentation )
+            {
+                peak->fragmentation = stats.fragmentation;
+            }
+
+            if ( stats.used_bytes > peak->used_bytes )
+            {
+                peak->used_bytes = stats.used_bytes;
+            }
+
+            peak->alloc_failures = stats.alloc_failures;
+            peak->commit_failures = stats.commit_failures;
+        }
+    }
+
+    return events;
+}
+
+static bool bench_load( const char *path )
+{
+    FILE *f = fopen( path, "rb" );
+    long size;
+
+    if ( f == NULL || fseek( f, 0, SEEK_END ) != 0 || ( size = ftell( f ) ) < BENCH_HEADER_SIZE )
+    {
+        fprintf( stderr, "can not read %s\n", path );
+        return false;
+    }
+
+    rewind( f );
+
+    bench_trace_len = ( uint32_t )size;
+    bench_trace = malloc( bench_trace_len );
+
+    if ( fread( bench_trace, 1, bench_trace_len, f ) != bench_trace_len )
+    {
+        fprintf( stderr, "can not read %s\n", path );
+        return false;
+    }
+
+    fclose( f );
+
+    if ( memcmp( bench_trace, "LALT", 4 ) != 0 || bench_trace[4] != BENCH_VERSION )
+    {
+        fprintf( stderr, "%s is not a lalloc trace\n", path );
+        return false;
+    }
+
+    return true;
+}
+
+static bool bench_save( const char *path )
+{
+    FILE *f = fopen( path, "wb" );
+
+    if ( f == NULL || fwrite( bench_trace, 1, bench_trace_len, f ) != bench_trace_len )
+    {
+        fprintf( stderr, "can not write %s\n", path );
+        return false;
+    }
+
+    fclose( f );
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    lalloc_stats_t peak;
+    uint32_t events;
+    double t;
+
+    if ( argc == 3 && strcmp( argv[1], "-c" ) == 0 )
+    {
+        bench_capture();
+        printf( "captured %u events in %u bytes, %.1f ms\n", bench_trace_events, bench_trace_len, bench_trace_time * 1e-6 );
+
+        return bench_save( argv[2] ) ? 0 : 1;
+    }
+
+    if ( argc == 2 )
+    {
+        if ( !bench_load( argv[1] ) )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        bench_capture();
+    }
+
+    /* one slot per byte of the pool of the trace */
+    bench_map_size = bench_get32( &bench_trace[8] );
+    bench_map = malloc( bench_map_size * sizeof( bench_map[0] ) );
+
+    printf( "%s free list%s, trace: alignment %u, %u bit, pool of %u bytes (replayed in %u)\n",
+            LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF ? "segregated fit" : LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY ? "lazy" : "sorted",
+            LALLOC_LAZY_COALESCING ? " with lazy coalescing" : "",
+            bench_trace[5], bench_trace[6] * 8, bench_map_size, bench_alloc.size );
+
+    t = bench_now();
+    events = bench_replay( NULL );
+    t = bench_now() - t;
+
+    memset( &peak, 0, sizeof( peak ) );
+    bench_replay( &peak );
+
+    printf( "  %u events in %.1f ms: %.2f Mops/s\n", events, t * 1e3, events / t * 1e-6 );
+    printf( "  peak fragmentation %u%%, peak used %u bytes\n", peak.fragmentation, peak.used_bytes );
+    printf( "  failures: %u alloc, %u commit, %u blocks lost by the replay\n",
+            peak.alloc_failures, peak.commit_failures, bench_failures );
+
+    return 0;
+}
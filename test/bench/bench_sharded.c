@@ -0,0 +1,191 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Sharding benchmark: 1 to 16 threads reserve, commit and free frames by address, through a lalloc_sharded_t of 16
+   shards and through a single instance of the same total size (a lalloc_sharded_t of 1 shard), both with a lock per
+   instance. The same total number of operations is split among the threads. For each thread count it reports the
+   total Mops/s (an operation is a reserve and commit, or a free) of both, and the speedup of the shards. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#define BENCH_THREADS_MAX   16
+#define BENCH_SHARDS        16
+#define BENCH_SHARD_SIZE    0x4000
+#define BENCH_OPS           4000000
+#define BENCH_LIVE          16
+#define BENCH_FRAME_MAX     120
+
+typedef struct
+{
+    lalloc_sharded_t    *sh;
+    uint32_t            seed;
+    uint32_t            ops;
+    uint32_t            failed;
+} bench_worker_t;
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* keeps up to BENCH_LIVE frames of its own and frees a random one of them */
+static void *bench_worker( void *arg )
+{
+    bench_worker_t *ctx = ( bench_worker_t * )arg;
+    uint8_t *live[BENCH_LIVE];
+    uint32_t count = 0;
+    uint32_t ops = 0;
+
+    while ( ops < ctx->ops )
+    {
+        lalloc_handle_t h;
+
+        ctx->seed ^= ctx->seed << 13;
+        ctx->seed ^= ctx->seed >> 17;
+        ctx->seed ^= ctx->seed << 5;
+
+        if ( count < BENCH_LIVE && ( ctx->seed & 1 ) )
+        {
+            LALLOC_IDX_TYPE frame_size = 1 + ( ctx->seed >> 1 ) % BENCH_FRAME_MAX;
+
+            if ( lalloc_sharded_reserve( ctx->sh, frame_size, &h ) )
+            {
+                /* lalloc_sharded_commit_h clears the handle */
+                live[count++] = h.addr;
+                memset( h.addr, ( uint8_t )ops, frame_size );
+                lalloc_sharded_commit_h( ctx->sh, &h, frame_size );
+            }
+            else
+            {
+                ctx->failed++;
+            }
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = ( ctx->seed >> 1 ) % count;
+
+            lalloc_sharded_free( ctx->sh, live[k] );
+            live[k] = live[--count];
+        }
+
+        ops++;
+    }
+
+    while ( count > 0 )
+    {
+        lalloc_sharded_free( ctx->sh, live[--count] );
+    }
+
+    return NULL;
+}
+
+/* returns the Mops/s of n threads on sh */
+static double bench_run( lalloc_sharded_t *sh, uint32_t n, uint32_t *failed )
+{
+    pthread_t threads[BENCH_THREADS_MAX];
+    bench_worker_t workers[BENCH_THREADS_MAX];
+    double t;
+    uint32_t w;
+
+    for ( w = 0; w < n; w++ )
+    {
+        workers[w].sh = sh;
+        workers[w].seed = 12345 + w;
+        workers[w].ops = BENCH_OPS / n;
+        workers[w].failed = 0;
+    }
+
+    t = bench_now();
+
+    for ( w = 0; w < n; w++ )
+    {
+        pthread_create( &threads[w], NULL, bench_worker, &workers[w] );
+    }
+
+    for ( w = 0; w < n; w++ )
+    {
+        pthread_join( threads[w], NULL );
+        *failed += workers[w].failed;
+    }
+
+    t = bench_now() - t;
+
+    return BENCH_OPS / t * 1e-6;
+}
+
+int main( void )
+{
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8, 16 };
+    uint32_t c;
+
+#if LALLOC_MUTEX == LALLOC_MUTEX_SPIN
+    printf( "lock: spinlock per instance\n" );
+#else
+    printf( "lock: pthread mutex per instance\n" );
+#endif
+    printf( "%8s %12s %12s %8s %8s\n", "threads", "1 shard", "16 shards", "speedup", "failed" );
+
+    for ( c = 0; c < sizeof( thread_counts ) / sizeof( thread_counts[0] ); c++ )
+    {
+        lalloc_sharded_t *single = lalloc_sharded_ctor( 1, BENCH_SHARDS * BENCH_SHARD_SIZE );
+        lalloc_sharded_t *sharded = lalloc_sharded_ctor( BENCH_SHARDS, BENCH_SHARD_SIZE );
+        uint32_t failed = 0;
+        double mops_single;
+        double mops_sharded;
+
+        if ( single == NULL || sharded == NULL )
+        {
+            printf( "out of memory\n" );
+            return 1;
+        }
+
+        mops_single = bench_run( single, thread_counts[c], &failed );
+        mops_sharded = bench_run( sharded, thread_counts[c], &failed );
+
+        printf( "%8u %12.2f %12.2f %7.2fx %8u\n", thread_counts[c], mops_single, mops_sharded, mops_sharded / mops_single, failed );
+
+        lalloc_sharded_dtor( single );
+        lalloc_sharded_dtor( sharded );
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Lock benchmark on a shared instance: 2, 4, 8 and 16 threads reserve, commit and free frames by address on the same
+   instance, so every call goes through its lock. The same total number of operations is split among the threads. It
+   is built with:
+   - LALLOC_MUTEX_SPIN: the spinlock adapter
+   - LALLOC_MUTEX_PTHREAD: the pthread mutex adapter
+   - BENCH_NO_LOCK: no critical section. The instance cannot be shared then, so the threads run one after the other,
+     which gives the cost of the work without the lock.
+   For each thread count it reports the total Mops/s (an operation is a reserve and commit, or a free). */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+
+#define BENCH_THREADS_MAX   16
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_OPS           4000000
+#define BENCH_LIVE          16
+#define BENCH_FRAME_MAX     120
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+typedef struct
+{
+    uint32_t        seed;
+    uint32_t        ops;
+    uint32_t        failed;
+} bench_worker_t;
+
+static double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* keeps up to BENCH_LIVE frames of its own and frees a random one of them */
+static void *bench_worker( void *arg )
+{
+    bench_worker_t *ctx = ( bench_worker_t * )arg;
+    uint8_t *live[BENCH_LIVE];
+    uint32_t count = 0;
+    uint32_t ops = 0;
+
+    while ( ops < ctx->ops )
+    {
+        lalloc_handle_t h;
+
+        ctx->seed ^= ctx->seed << 13;
+        ctx->seed ^= ctx->seed >> 17;
+        ctx->seed ^= ctx->seed << 5;
+
+        if ( count < BENCH_LIVE && ( ctx->seed & 1 ) )
+        {
+            LALLOC_IDX_TYPE frame_size = 1 + ( ctx->seed >> 1 ) % BENCH_FRAME_MAX;
+
+            if ( lalloc_reserve( &bench_alloc, frame_size, &h ) && h.size >= frame_size )
+            {
+                /* lalloc_commit_h clears the handle */
+                live[count++] = h.addr;
+                memset( h.addr, ( uint8_t )ops, frame_size );
+                lalloc_commit_h( &bench_alloc, &h, frame_size );
+            }
+            else
+            {
+                /* the reserved area can be smaller than the frame */
+                if ( h.addr != NULL )
+                {
+                    lalloc_revert_h( &bench_alloc, &h );
+                }
+
+                ctx->failed++;
+            }
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = ( ctx->seed >> 1 ) % count;
+
+            lalloc_free( &bench_alloc, live[k] );
+            live[k] = live[--count];
+        }
+
+        ops++;
+    }
+
+    while ( count > 0 )
+    {
+        lalloc_free( &bench_alloc, live[--count] );
+    }
+
+    return NULL;
+}
+
+int main( void )
+{
+    static const uint32_t thread_counts[] = { 2, 4, 8, 16 };
+    pthread_t threads[BENCH_THREADS_MAX];
+    bench_worker_t workers[BENCH_THREADS_MAX];
+    uint32_t c;
+
+#if defined(BENCH_NO_LOCK)
+    printf( "lock: none, the threads run one after the other\n" );
+#elif LALLOC_MUTEX == LALLOC_MUTEX_SPIN
+    printf( "lock: spinlock, backoff up to %u pauses\n", LALLOC_SPIN_BACKOFF_MAX );
+#else
+    printf( "lock: pthread mutex\n" );
+#endif
+    printf( "%8s %10s %10s %10s\n", "threads", "seconds", "Mops/s", "failed" );
+
+    for ( c = 0; c < sizeof( thread_counts ) / sizeof( thread_counts[0] ); c++ )
+    {
+        uint32_t n = thread_counts[c];
+        uint32_t failed = 0;
+        double t;
+        uint32_t w;
+
+        lalloc_init( &bench_alloc );
+
+        for ( w = 0; w < n; w++ )
+        {
+            workers[w].seed = 12345 + w;
+            workers[w].ops = BENCH_OPS / n;
+            workers[w].failed = 0;
+        }
+
+        t = bench_now();
+
+        for ( w = 0; w < n; w++ )
+        {
+            pthread_create( &threads[w], NULL, bench_worker, &workers[w] );
+#ifdef BENCH_NO_LOCK
+            pthread_join( threads[w], NULL );
+#endif
+        }
+
+#ifndef BENCH_NO_LOCK
+        for ( w = 0; w < n; w++ )
+        {
+            pthread_join( threads[w], NULL );
+        }
+#endif
+
+        t = bench_now() - t;
+
+        for ( w = 0; w < n; w++ )
+        {
+            failed += workers[w].failed;
+        }
+
+        printf( "%8u %10.3f %10.2f %10u\n", n, t, BENCH_OPS / t * 1e-6, failed );
+
+        lalloc_deinit( &bench_alloc );
+    }
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Producer / consumer throughput: one thread commits frames of variable size and the other one
+   reads and frees them in FIFO order.
+   Built with LALLOC_SPSC==1 both sides run without critical sections, otherwise they share one mutex. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "lalloc.h"
+
+#define BENCH_POOL_SIZE     0x10000
+#define BENCH_FRAMES        5000000UL
+#define BENCH_FRAME_MIN     16
+#define BENCH_FRAME_MAX     256
+
+#ifdef BENCH_LOCKED
+pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+LALLOC_DECLARE( bench_alloc, BENCH_POOL_SIZE );
+
+static uint32_t bench_checksum;
+
+static LALLOC_IDX_TYPE bench_frame_size( uint32_t seq )
+{
+    uint32_t x = seq * 2654435761UL;
+
+    return BENCH_FRAME_MIN + ( x >> 16 ) % ( BENCH_FRAME_MAX - BENCH_FRAME_MIN + 1 );
+}
+
+static void *bench_producer( void *arg )
+{
+    uint32_t seq;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    ( void ) arg;
+
+    for ( seq = 0; seq < BENCH_FRAMES; seq++ )
+    {
+        LALLOC_IDX_TYPE frame_size = bench_frame_size( seq );
+
+        while ( 1 )
+        {
+            lalloc_alloc( &bench_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL && size >= frame_size )
+            {
+                data[0] = ( uint8_t )seq;
+                data[frame_size - 1] = ( uint8_t )seq;
+
+                if ( lalloc_commit( &bench_alloc, frame_size ) )
+                {
+                    break;
+                }
+            }
+
+            lalloc_alloc_revert( &bench_alloc );
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void *bench_consumer( void *arg )
+{
+    uint32_t seq = 0;
+    uint32_t checksum = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    ( void ) arg;
+
+    while ( seq < BENCH_FRAMES )
+    {
+        lalloc_get_first( &bench_alloc, ( void ** )&data, &size );
+
+        if ( data == NULL )
+        {
+            sched_yield();
+            continue;
+        }
+
+        checksum += data[0] + data[bench_frame_size( seq ) - 1];
+
+        lalloc_free_first( &bench_alloc );
+        seq++;
+    }
+
+    bench_checksum = checksum;
+
+    return NULL;
+}
+
+int main()
+{
+    pthread_t producer;
+    pthread_t consumer;
+    struct timespec start;
+    struct timespec end;
+
+    lalloc_init( &bench_alloc );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    pthread_create( &producer, NULL, bench_producer, NULL );
+    pthread_create( &consumer, NULL, bench_consumer, NULL );
+
+    pthread_join( producer, NULL );
+    pthread_join( consumer, NULL );
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    double seconds = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
+
+    printf( "%s: %lu frames in %.3f s, %.2f Mframes/s (checksum %u)\n",
+            LALLOC_SPSC ? "spsc lock free" : "spsc mutex", BENCH_FRAMES, seconds, BENCH_FRAMES / seconds / 1e6, bench_checksum );
+
+    return 0;
+}
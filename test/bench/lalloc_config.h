@@ -0,0 +1,60 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef LALLOC_CONFIG_H
+#define LALLOC_CONFIG_H
+
+/* configuration for the benchmarks: optimized builds, without test hooks nor asserts */
+
+#include <pthread.h>
+
+#ifndef LALLOC_ALIGNMENT
+#define LALLOC_ALIGNMENT   4
+#endif
+
+#ifndef LALLOC_MAX_BYTES
+#define LALLOC_MAX_BYTES   0xFFFFFFFF
+#endif
+
+#ifndef LALLOC_ALLOW_QUEUED_FREES
+#define LALLOC_ALLOW_QUEUED_FREES 1
+#endif
+
+#ifdef BENCH_LOCKED
+/* every call is serialized with one mutex, the time it is held is measured with LALLOC_CS_PROFILE==1 */
+extern pthread_mutex_t bench_mutex;
+
+#define LALLOC_CRITICAL_START   LALLOC_CS_PROFILE_START( pthread_mutex_lock( &bench_mutex ) )
+#define LALLOC_CRITICAL_END     LALLOC_CS_PROFILE_END( pthread_mutex_unlock( &bench_mutex ) )
+#endif
+
+#endif //LALLOC_CONFIG_H
@@ -44,8 +44,22 @@
 #define LALLOC_ASSERT(CONDITION)    if(!(CONDITION)) printf("error EN %s en linea %u", __FUNCTION__ , __LINE__   ); assert(CONDITION);
 #endif
 
+#if defined(TEST_MUTEX)
+/* the critical sections are the mutex of each instance, LALLOC_MUTEX */
+#elif defined(LALLOC_CS_PROFILE) && LALLOC_CS_PROFILE==1
+/* the critical sections are timed by the profiler of the library */
+#define LALLOC_CRITICAL_START LALLOC_CS_PROFILE_START( test_crtical_start(__FUNCTION__ , __LINE__) )
+#define LALLOC_CRITICAL_END   LALLOC_CS_PROFILE_END( test_crtical_end() )
+#else
 #define LALLOC_CRITICAL_START test_crtical_start(__FUNCTION__ , __LINE__)
 #define LALLOC_CRITICAL_END   test_crtical_end()
+#endif
+
+#if defined(LALLOC_SHARDED) && LALLOC_SHARDED==1
+/* each test thread picks its own shard */
+extern __thread uint32_t test_shard_hint;
+#define LALLOC_SHARD_HINT() test_shard_hint
+#endif
 
 #define LALLOC_INLINE
 
@@ -54,6 +68,8 @@
 /* in order to enable test code */
 #define LALLOC_TEST
 
+#ifndef LALLOC_ALLOW_QUEUED_FREES
 #define LALLOC_ALLOW_QUEUED_FREES 0
+#endif
 
 #endif //LALLOC_UART_CONFIG_H
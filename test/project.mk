@@ -12,13 +12,14 @@ SRC_FILES+=$(TESTS_BASE_PATH)support/lalloc_abstraction.c
 SRC_FILES+=$(TESTS_BASE_PATH)support/malloc_replace.c
 SRC_FILES+=$(TESTS_BASE_PATH)unity_src/unity.c
 SRC_FILES+=$(LIBS_PATH)src/lalloc.c
+SRC_FILES+=$(LIBS_PATH)src/lalloc_bip.c
 
 #COMONFLAGSFORCOMPILER&LINKER
 CFLAGS+=-D_x86_TESTS-std=gnu99
 LFLAGS+= -pthread -lm -ldl
 
 #TESTS=test3
-TESTS= test1 test2 test3 test4 test5 test6 test7
+TESTS= test1 test2 test3 test4 test5 test6 test7 test8 test9 test10 test11 test12 test13 test14 test15 test16 test17 test18 test19 test20 test21 test22 test23 test24 test25 test26 test27 test28 test29 test30 test31 test32 test33 test34 test35 test36 test37 test38 test39 test40 test41 test42 test43 test44 test45 test46 test47 test48 test49 test50 test51 test52 test53 test54 test55 test56 test57 test58 test59 test60
 
 #TEST1
 SRC_FILES_T1	+=$(TESTS_BASE_PATH)test_basic.c
@@ -60,3 +61,432 @@ CFLAGS_T6		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF
 SRC_FILES_T7	+=$(SRC_FILES_T5) 
 INC_FILES_T7	=
 CFLAGS_T7		=-DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFF
+
+#TEST8			TEST1 with the segregated fit free list
+SRC_FILES_T8	+=$(SRC_FILES_T1)
+INC_FILES_T8	=
+CFLAGS_T8		= -DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF
+
+#TEST9			TEST6 with the segregated fit free list
+SRC_FILES_T9	+=$(SRC_FILES_T5)
+INC_FILES_T9	=
+CFLAGS_T9		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF
+
+#TEST10			free list white box tests
+SRC_FILES_T10	+=$(TESTS_BASE_PATH)test_flist.c
+SRC_FILES_T10	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+INC_FILES_T10	=
+CFLAGS_T10		=-DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_TLSF_SL_LOG2=3
+
+#TEST11			TEST3 with the lazy largest block tracking
+SRC_FILES_T11	+=$(SRC_FILES_T3)
+INC_FILES_T11	=
+CFLAGS_T11		= -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY
+
+#TEST12			free list white box tests, lazy largest block tracking
+SRC_FILES_T12	+=$(SRC_FILES_T10)
+INC_FILES_T12	=
+CFLAGS_T12		=-DLALLOC_ALIGNMENT=4 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY
+
+#TEST13			TEST2 freeing by any address of the blocks, with the block bitmap
+SRC_FILES_T13	+=$(SRC_FILES_T2)
+INC_FILES_T13	=
+CFLAGS_T13		=-DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1
+
+#TEST14			TEST6 freeing by any address of the blocks, with the block bitmap
+SRC_FILES_T14	+=$(SRC_FILES_T5)
+INC_FILES_T14	=
+CFLAGS_T14		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1
+
+#TEST15			TEST1 with the ring of allocated blocks
+SRC_FILES_T15	+=$(SRC_FILES_T1)
+INC_FILES_T15	=
+CFLAGS_T15		= -DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFFFF -DLALLOC_ALLOC_RING_SIZE=8
+
+#TEST16			TEST5 with the ring of allocated blocks
+SRC_FILES_T16	+=$(SRC_FILES_T5)
+INC_FILES_T16	=
+CFLAGS_T16		=-DLALLOC_ALLOC_RING_SIZE=4096
+
+#TEST17			single producer / single consumer mode
+SRC_FILES_T17	+=$(TESTS_BASE_PATH)test_spsc.c
+SRC_FILES_T17	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+INC_FILES_T17	=
+CFLAGS_T17		=-DLALLOC_SPSC=1 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_ALLOC_RING_SIZE=64
+
+#TEST18			TEST17 without defaults
+SRC_FILES_T18	+=$(SRC_FILES_T17)
+INC_FILES_T18	=
+CFLAGS_T18		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_SPSC=1 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST19			bip buffer engine
+SRC_FILES_T19	+=$(TESTS_BASE_PATH)test_bip.c
+SRC_FILES_T19	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T19	=
+CFLAGS_T19		=-DLALLOC_ENGINE=LALLOC_ENGINE_BIP
+
+#TEST20			TEST19 without defaults
+SRC_FILES_T20	+=$(SRC_FILES_T19)
+INC_FILES_T20	=
+CFLAGS_T20		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_ENGINE=LALLOC_ENGINE_BIP
+
+#TEST21			TEST19 with 8 bit indexes, freeing by any address
+SRC_FILES_T21	+=$(SRC_FILES_T19)
+INC_FILES_T21	=
+CFLAGS_T21		=-DLALLOC_ALIGNMENT=2 -DLALLOC_MAX_BYTES=0xFF -DLALLOC_ENGINE=LALLOC_ENGINE_BIP -DLALLOC_FREE_ANY=1
+
+#TEST22			reservations with handles
+SRC_FILES_T22	+=$(TESTS_BASE_PATH)test_reserve.c
+SRC_FILES_T22	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T22	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T22	=
+CFLAGS_T22		=
+
+#TEST23			TEST22 without defaults, segregated fit free list, freeing by any address of the blocks with the bitmap
+SRC_FILES_T23	+=$(SRC_FILES_T22)
+INC_FILES_T23	=
+CFLAGS_T23		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1
+
+#TEST24			TEST22 with lazy largest block tracking and the ring of allocated blocks
+SRC_FILES_T24	+=$(SRC_FILES_T22)
+INC_FILES_T24	=
+CFLAGS_T24		=-DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST25			batch frees
+SRC_FILES_T25	+=$(TESTS_BASE_PATH)test_batch.c
+SRC_FILES_T25	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T25	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T25	=
+CFLAGS_T25		=-DLALLOC_ALLOW_QUEUED_FREES=1
+
+#TEST26			TEST25 without defaults, segregated fit free list, the bitmap and the ring of allocated blocks
+SRC_FILES_T26	+=$(SRC_FILES_T25)
+INC_FILES_T26	=
+CFLAGS_T26		=-DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=1024
+
+#TEST27			TEST25 with lazy largest block tracking
+SRC_FILES_T27	+=$(SRC_FILES_T25)
+INC_FILES_T27	=
+CFLAGS_T27		=-DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY
+
+#TEST28			deferred frees
+SRC_FILES_T28	+=$(TESTS_BASE_PATH)test_deferred.c
+SRC_FILES_T28	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T28	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T28	=
+CFLAGS_T28		=-DLALLOC_DEFERRED_FREE=1
+
+#TEST29			TEST28 without defaults, segregated fit free list, the bitmap and the ring of allocated blocks
+SRC_FILES_T29	+=$(SRC_FILES_T28)
+INC_FILES_T29	=
+CFLAGS_T29		=-DLALLOC_DEFERRED_FREE=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST30			lazy coalescing
+SRC_FILES_T30	+=$(TESTS_BASE_PATH)test_coalesce.c
+SRC_FILES_T30	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T30	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T30	=
+CFLAGS_T30		=-DLALLOC_LAZY_COALESCING=1
+
+#TEST31			TEST30 without defaults, segregated fit free list, the bitmap and the ring of allocated blocks
+SRC_FILES_T31	+=$(SRC_FILES_T30)
+INC_FILES_T31	=
+CFLAGS_T31		=-DLALLOC_LAZY_COALESCING=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST32			TEST30 with lazy largest block tracking and deferred frees
+SRC_FILES_T32	+=$(SRC_FILES_T30)
+INC_FILES_T32	=
+CFLAGS_T32		=-DLALLOC_LAZY_COALESCING=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_DEFERRED_FREE=1
+
+#TEST33			compaction
+SRC_FILES_T33	+=$(TESTS_BASE_PATH)test_compact.c
+SRC_FILES_T33	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T33	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T33	=
+CFLAGS_T33		=-DLALLOC_COMPACTION=1
+
+#TEST34			TEST33 without defaults, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T34	+=$(SRC_FILES_T33)
+INC_FILES_T34	=
+CFLAGS_T34		=-DLALLOC_COMPACTION=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST35			TEST33 with alignment 1, lazy largest block tracking, lazy coalescing and deferred frees
+SRC_FILES_T35	+=$(SRC_FILES_T33)
+INC_FILES_T35	=
+CFLAGS_T35		=-DLALLOC_COMPACTION=1 -DLALLOC_ALIGNMENT=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST36			statistics
+SRC_FILES_T36	+=$(TESTS_BASE_PATH)test_stats.c
+SRC_FILES_T36	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T36	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T36	=
+CFLAGS_T36		=-DLALLOC_STATS=1
+
+#TEST37			TEST36 without defaults, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T37	+=$(SRC_FILES_T36)
+INC_FILES_T37	=
+CFLAGS_T37		=-DLALLOC_STATS=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST38			TEST36 with lazy largest block tracking, lazy coalescing, compaction and deferred frees
+SRC_FILES_T38	+=$(SRC_FILES_T36)
+INC_FILES_T38	=
+CFLAGS_T38		=-DLALLOC_STATS=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST39			latency profiling with a fake cycle counter
+SRC_FILES_T39	+=$(TESTS_BASE_PATH)test_profile.c
+SRC_FILES_T39	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T39	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T39	=
+CFLAGS_T39		=-DLALLOC_PROFILE=1 -DLALLOC_PROFILE_CYCLES=test_profile_cycles -DTEST_PROFILE_FAKE_CYCLES -DLALLOC_ALLOW_QUEUED_FREES=1
+
+#TEST40			TEST39 without defaults, timed with lalloc_profile_clock, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T40	+=$(SRC_FILES_T39)
+INC_FILES_T40	=
+CFLAGS_T40		=-DLALLOC_PROFILE=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST41			TEST39 with the default cycle counter, lazy coalescing, compaction, statistics and deferred frees
+SRC_FILES_T41	+=$(SRC_FILES_T39)
+INC_FILES_T41	=
+CFLAGS_T41		=-DLALLOC_PROFILE=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_STATS=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST42			critical section profiling with a fake cycle counter
+SRC_FILES_T42	+=$(TESTS_BASE_PATH)test_cs_profile.c
+SRC_FILES_T42	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T42	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T42	=
+CFLAGS_T42		=-DLALLOC_CS_PROFILE=1 -DLALLOC_PROFILE_CYCLES=test_profile_cycles -DTEST_PROFILE_FAKE_CYCLES
+
+#TEST43			TEST42 with the bip buffer engine and room for 2 call sites only
+SRC_FILES_T43	+=$(TESTS_BASE_PATH)test_cs_profile.c
+SRC_FILES_T43	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T43	=
+CFLAGS_T43		=-DLALLOC_CS_PROFILE=1 -DLALLOC_PROFILE_CYCLES=test_profile_cycles -DTEST_PROFILE_FAKE_CYCLES -DLALLOC_ENGINE=LALLOC_ENGINE_BIP -DLALLOC_CS_PROFILE_SITES=2
+
+#TEST44			TEST42 without defaults, with the default cycle counter, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T44	+=$(SRC_FILES_T42)
+INC_FILES_T44	=
+CFLAGS_T44		=-DLALLOC_CS_PROFILE=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST45			event trace and replay with a fake cycle counter
+SRC_FILES_T45	+=$(TESTS_BASE_PATH)test_trace.c
+SRC_FILES_T45	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T45	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T45	=
+CFLAGS_T45		=-DLALLOC_TRACE=1 -DLALLOC_PROFILE_CYCLES=test_profile_cycles -DTEST_PROFILE_FAKE_CYCLES -DLALLOC_ALLOW_QUEUED_FREES=1
+
+#TEST46			TEST45 without defaults, with the default cycle counter, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T46	+=$(SRC_FILES_T45)
+INC_FILES_T46	=
+CFLAGS_T46		=-DLALLOC_TRACE=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST47			TEST45 with lazy largest block tracking, lazy coalescing, compaction, statistics, latency profiling and deferred frees
+SRC_FILES_T47	+=$(SRC_FILES_T45)
+INC_FILES_T47	=
+CFLAGS_T47		=-DLALLOC_TRACE=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_ALIGNMENT=2 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_STATS=1 -DLALLOC_PROFILE=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST48			per instance mutex with the pthread adapter, threads on their own instances and on a shared one
+SRC_FILES_T48	+=$(TESTS_BASE_PATH)test_mutex.c
+SRC_FILES_T48	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T48	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T48	=
+CFLAGS_T48		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD
+
+#TEST49			TEST48 with the C11 adapter, without defaults, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T49	+=$(SRC_FILES_T48)
+INC_FILES_T49	=
+CFLAGS_T49		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_C11 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST50			TEST48 with lazy largest block tracking, lazy coalescing, compaction, statistics and deferred frees
+SRC_FILES_T50	+=$(SRC_FILES_T48)
+INC_FILES_T50	=
+CFLAGS_T50		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD -DLALLOC_ALIGNMENT=2 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_STATS=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST51			TEST48 with the spinlock adapter, a short backoff so the waiting threads yield
+SRC_FILES_T51	+=$(SRC_FILES_T48)
+INC_FILES_T51	=
+CFLAGS_T51		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_SPIN -DLALLOC_SPIN_BACKOFF_MAX=4
+
+#TEST52			lock free status reads, a writer and reader threads on an instance with the pthread adapter
+SRC_FILES_T52	+=$(TESTS_BASE_PATH)test_seqlock.c
+SRC_FILES_T52	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T52	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T52	=
+CFLAGS_T52		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD -DLALLOC_SEQLOCK=1 -DLALLOC_STATS=1
+
+#TEST53			TEST52 without threads, with a reader within the critical section (trace callback), without defaults, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T53	+=$(SRC_FILES_T52)
+INC_FILES_T53	=
+CFLAGS_T53		=-DLALLOC_SEQLOCK=1 -DLALLOC_STATS=1 -DLALLOC_TRACE=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST54			TEST52 with the spinlock adapter, lazy largest block tracking, lazy coalescing, compaction and deferred frees
+SRC_FILES_T54	+=$(SRC_FILES_T52)
+INC_FILES_T54	=
+CFLAGS_T54		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_SPIN -DLALLOC_SEQLOCK=1 -DLALLOC_STATS=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST55			sharded front end: routing by caller and by address, fallback, threads on 4 shards with the pthread adapter
+SRC_FILES_T55	+=$(TESTS_BASE_PATH)test_sharded.c
+SRC_FILES_T55	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T55	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T55	=
+CFLAGS_T55		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD -DLALLOC_SHARDED=1
+
+#TEST56			TEST55 without threads, without defaults, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T56	+=$(SRC_FILES_T55)
+INC_FILES_T56	=
+CFLAGS_T56		=-DLALLOC_SHARDED=1 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST57			TEST55 with the spinlock adapter, lock free status reads, lazy largest block tracking, lazy coalescing, compaction, statistics and deferred frees
+SRC_FILES_T57	+=$(SRC_FILES_T55)
+INC_FILES_T57	=
+CFLAGS_T57		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_SPIN -DLALLOC_SHARDED=1 -DLALLOC_SEQLOCK=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_ALLOW_QUEUED_FREES=1 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_COMPACTION=1 -DLALLOC_STATS=1 -DLALLOC_DEFERRED_FREE=1
+
+#TEST58			thread cache of small blocks: hits without critical section, best fit, byte budget and single flush
+SRC_FILES_T58	+=$(TESTS_BASE_PATH)test_cache.c
+SRC_FILES_T58	+=$(TESTS_BASE_PATH)support/lalloc_tools.c
+SRC_FILES_T58	+=$(TESTS_BASE_PATH)support/random_tools.c
+INC_FILES_T58	=
+CFLAGS_T58		=-DLALLOC_THREAD_CACHE=1
+
+#TEST59			TEST58 without defaults, smaller cache, segregated fit free list, freeing by any address with the bitmap and the ring of allocated blocks
+SRC_FILES_T59	+=$(SRC_FILES_T58)
+INC_FILES_T59	=
+CFLAGS_T59		=-DLALLOC_THREAD_CACHE=1 -DLALLOC_CACHE_SLOTS=6 -DLALLOC_CACHE_SMALL=32 -DLALLOC_CACHE_BUDGET=100 -DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF -DLALLOC_FREE_ANY=1 -DLALLOC_BLOCK_BITMAP=1 -DLALLOC_ALLOC_RING_SIZE=256
+
+#TEST60			TEST58 with threads on the pthread adapter, lock free status reads, lazy largest block tracking, lazy coalescing, statistics and deferred frees
+SRC_FILES_T60	+=$(SRC_FILES_T58)
+INC_FILES_T60	=
+CFLAGS_T60		=-DTEST_MUTEX -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD -DLALLOC_THREAD_CACHE=1 -DLALLOC_SEQLOCK=1 -DLALLOC_STATS=1 -DLALLOC_ALIGNMENT=2 -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1 -DLALLOC_DEFERRED_FREE=1
+
+#BENCHMARKS		optimized builds without coverage, they use bench/lalloc_config.h
+BENCH_BASE_PATH = $(TESTS_BASE_PATH)bench/
+
+#BENCH1			producer / consumer throughput with LALLOC_SPSC
+SRC_FILES_B1	+=$(BENCH_BASE_PATH)bench_spsc.c
+CFLAGS_B1		=-DLALLOC_SPSC=1 -DLALLOC_ALLOC_RING_SIZE=1024
+
+#BENCH2			BENCH1 with both sides serialized by a mutex
+SRC_FILES_B2	+=$(SRC_FILES_B1)
+CFLAGS_B2		=-DLALLOC_ALLOC_RING_SIZE=1024 -DBENCH_LOCKED
+
+#BENCH3			FIFO traffic in one context with the lists engine
+SRC_FILES_B3	+=$(BENCH_BASE_PATH)bench_fifo.c
+CFLAGS_B3		=
+
+#BENCH4			BENCH3 with the bip buffer engine
+SRC_FILES_B4	+=$(SRC_FILES_B3)
+CFLAGS_B4		=-DLALLOC_ENGINE=LALLOC_ENGINE_BIP
+
+#BENCH5			FIFO throughput with the lists engine and locked critical sections
+SRC_FILES_B5	+=$(SRC_FILES_B3)
+CFLAGS_B5		=-DBENCH_LOCKED
+
+#BENCH6			BENCH5 committing with lalloc_commit_and_alloc
+SRC_FILES_B6	+=$(SRC_FILES_B3)
+CFLAGS_B6		=-DBENCH_LOCKED -DBENCH_COMMIT_AND_ALLOC
+
+#BENCH7			BENCH5 draining the whole queue frame by frame
+SRC_FILES_B7	+=$(SRC_FILES_B3)
+CFLAGS_B7		=-DBENCH_LOCKED -DBENCH_DRAIN
+
+#BENCH8			BENCH5 draining the whole queue with lalloc_free_first_n
+SRC_FILES_B8	+=$(SRC_FILES_B3)
+CFLAGS_B8		=-DBENCH_LOCKED -DBENCH_DRAIN_BATCH
+
+#BENCH9			frees from several threads, serialized by a mutex
+SRC_FILES_B9	+=$(BENCH_BASE_PATH)bench_deferred.c
+CFLAGS_B9		=-DBENCH_LOCKED
+
+#BENCH10		BENCH9 with the lock free queue of deferred frees
+SRC_FILES_B10	+=$(SRC_FILES_B9)
+CFLAGS_B10		=-DBENCH_LOCKED -DLALLOC_DEFERRED_FREE=1
+
+#BENCH11		worst case critical section windows under adversarial fragmentation, sorted free list
+SRC_FILES_B11	+=$(BENCH_BASE_PATH)bench_cs_window.c
+CFLAGS_B11		=-DBENCH_LOCKED -DLALLOC_CS_PROFILE=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock
+
+#BENCH12		BENCH11 with the segregated fit free list
+SRC_FILES_B12	+=$(SRC_FILES_B11)
+CFLAGS_B12		=-DBENCH_LOCKED -DLALLOC_CS_PROFILE=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF
+
+#BENCH13		BENCH11 with lazy largest block tracking and lazy coalescing
+SRC_FILES_B13	+=$(SRC_FILES_B11)
+CFLAGS_B13		=-DBENCH_LOCKED -DLALLOC_CS_PROFILE=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1
+
+#BENCH14		capture and replay of a trace, sorted free list: ops/sec, peak fragmentation and failures
+SRC_FILES_B14	+=$(BENCH_BASE_PATH)bench_replay.c
+CFLAGS_B14		=-DLALLOC_TRACE=1 -DLALLOC_STATS=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock
+
+#BENCH15		BENCH14 with the segregated fit free list
+SRC_FILES_B15	+=$(SRC_FILES_B14)
+CFLAGS_B15		=-DLALLOC_TRACE=1 -DLALLOC_STATS=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_FLIST_POLICY=LALLOC_FLIST_TLSF
+
+#BENCH16		BENCH14 with lazy largest block tracking and lazy coalescing
+SRC_FILES_B16	+=$(SRC_FILES_B14)
+CFLAGS_B16		=-DLALLOC_TRACE=1 -DLALLOC_STATS=1 -DLALLOC_PROFILE_CYCLES=lalloc_profile_clock -DLALLOC_FLIST_POLICY=LALLOC_FLIST_LAZY -DLALLOC_LAZY_COALESCING=1
+
+#BENCH17-25		ns per call of the basic operations (bench_micro.c), one per LALLOC_ALIGNMENT x LALLOC_MAX_BYTES combination.
+#				`make bench` builds and runs all of them, see BENCH_MICRO
+BENCH_MICRO		= 17 18 19 20 21 22 23 24 25
+
+SRC_FILES_B17	+=$(BENCH_BASE_PATH)bench_micro.c
+CFLAGS_B17		=-DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFF
+
+SRC_FILES_B18	+=$(SRC_FILES_B17)
+CFLAGS_B18		=-DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFFFF
+
+SRC_FILES_B19	+=$(SRC_FILES_B17)
+CFLAGS_B19		=-DLALLOC_ALIGNMENT=1 -DLALLOC_MAX_BYTES=0xFFFFFFFF
+
+SRC_FILES_B20	+=$(SRC_FILES_B17)
+CFLAGS_B20		=-DLALLOC_ALIGNMENT=2 -DLALLOC_MAX_BYTES=0xFF
+
+SRC_FILES_B21	+=$(SRC_FILES_B17)
+CFLAGS_B21		=-DLALLOC_ALIGNMENT=2 -DLALLOC_MAX_BYTES=0xFFFF
+
+SRC_FILES_B22	+=$(SRC_FILES_B17)
+CFLAGS_B22		=-DLALLOC_ALIGNMENT=2 -DLALLOC_MAX_BYTES=0xFFFFFFFF
+
+SRC_FILES_B23	+=$(SRC_FILES_B17)
+CFLAGS_B23		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFF
+
+SRC_FILES_B24	+=$(SRC_FILES_B17)
+CFLAGS_B24		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFF
+
+SRC_FILES_B25	+=$(SRC_FILES_B17)
+CFLAGS_B25		=-DLALLOC_ALIGNMENT=4 -DLALLOC_MAX_BYTES=0xFFFFFFFF
+
+#BENCH26		lalloc against glibc malloc, a fixed size block pool and a byte ring buffer at the same memory budget
+SRC_FILES_B26	+=$(BENCH_BASE_PATH)bench_compare.c
+CFLAGS_B26		=
+
+#BENCH27		independent instances on 1, 2, 4 and 8 threads, each one with its own pthread mutex (LALLOC_MUTEX)
+SRC_FILES_B27	+=$(BENCH_BASE_PATH)bench_contention.c
+CFLAGS_B27		=-DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD
+
+#BENCH28		BENCH27 with every instance behind one global mutex
+SRC_FILES_B28	+=$(SRC_FILES_B27)
+CFLAGS_B28		=-DBENCH_LOCKED
+
+#BENCH29		2 to 16 threads on a shared instance with the spinlock adapter (LALLOC_MUTEX_SPIN)
+SRC_FILES_B29	+=$(BENCH_BASE_PATH)bench_shared_lock.c
+CFLAGS_B29		=-DLALLOC_MUTEX=LALLOC_MUTEX_SPIN
+
+#BENCH30		BENCH29 with the pthread mutex adapter
+SRC_FILES_B30	+=$(SRC_FILES_B29)
+CFLAGS_B30		=-DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD
+
+#BENCH31		BENCH29 without critical section, the threads run one after the other
+SRC_FILES_B31	+=$(SRC_FILES_B29)
+CFLAGS_B31		=-DBENCH_NO_LOCK
+
+#BENCH32		1 to 16 threads on 16 shards against a single instance of the same size, pthread mutex per instance
+SRC_FILES_B32	+=$(BENCH_BASE_PATH)bench_sharded.c
+CFLAGS_B32		=-DLALLOC_SHARDED=1 -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD
+
+#BENCH33		BENCH32 with the spinlock adapter and lock free status reads, so the full shards are skipped without locking
+SRC_FILES_B33	+=$(SRC_FILES_B32)
+CFLAGS_B33		=-DLALLOC_SHARDED=1 -DLALLOC_MUTEX=LALLOC_MUTEX_SPIN -DLALLOC_SEQLOCK=1
+
+#BENCH34		1, 2, 4 and 8 threads on a shared instance with the pthread mutex adapter, small frames with and without a thread cache
+SRC_FILES_B34	+=$(BENCH_BASE_PATH)bench_cache.c
+CFLAGS_B34		=-DLALLOC_THREAD_CACHE=1 -DLALLOC_ALLOW_QUEUED_FREES=0 -DLALLOC_MUTEX=LALLOC_MUTEX_PTHREAD
@@ -35,6 +35,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "unity.h"
 
 int isr_dis = 0;
+/* number of critical sections taken, so a test can check the ones that are skipped */
+int test_critical_count = 0;
 void test_assert( bool condition, const char *fcn, int line_ )
 {
     if ( condition )
@@ -54,6 +56,7 @@ void test_crtical_start( const char *fcn, int line_ )
     static int lastline = 0;
 
     isr_dis++;
+    test_critical_count++;
 
     if ( isr_dis >= 2 )
     {
@@ -75,3 +78,13 @@ void test_crtical_end( void )
 {
     isr_dis--;
 }
+
+/* fake cycle counter for LALLOC_PROFILE_CYCLES: every read advances it test_cycles_step */
+uint32_t test_cycles = 0;
+uint32_t test_cycles_step = 0;
+
+uint32_t test_profile_cycles( void )
+{
+    test_cycles += test_cycles_step;
+    return test_cycles;
+}
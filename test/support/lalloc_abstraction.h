@@ -3,3 +3,4 @@
 void test_crtical_start( const char *fcn, int line_ );
 void test_crtical_end( void );
 void test_assert( bool condition, const char *fcn, int line );
+uint32_t test_profile_cycles( void );
@@ -57,8 +57,8 @@ void lalloc_measure_framgentation( LALLOC_T *obj, float *sqbase, float *average_
             sum2 += size * size;
             n++;
 
-            LALLOC_GET_BLOCK_NEXT( obj->pool, block, block );
-            if ( block == obj->dyn->flist )
+            block = _flist_next( obj, block );
+            if ( block == LALLOC_IDX_INVALID )
             {
                 break;
             }
@@ -279,6 +279,52 @@ LALLOC_IDX_TYPE lalloc_sanity_check( LALLOC_T *obj )
         idx = prev_phy;
     }
 
+#if LALLOC_BLOCK_BITMAP == 1
+    /* every block must be resolved by the bitmap from its first and its last byte */
+    idx = 0;
+
+    while ( good1 )
+    {
+        next_phy = _block_get_next_phy( obj->pool, idx );
+
+        if ( _bitmap_find_block( obj, idx ) != idx || _bitmap_find_block( obj, next_phy - 1 ) != idx )
+        {
+            printf( "%s block bitmap does not match the block %u\n", __FUNCTION__, idx );
+            good1 = 0;
+            break;
+        }
+
+        if ( next_phy == obj->size )
+        {
+            break;
+        }
+
+        idx = next_phy;
+    }
+#endif
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+    /* the ring must hold the allocated list, from the oldest to the newest block */
+    if ( obj->dyn->alist != LALLOC_IDX_INVALID )
+    {
+        LALLOC_IDX_TYPE n;
+
+        LALLOC_GET_BLOCK_PREV( obj->pool, obj->dyn->alist, idx );
+
+        for ( n = 0; n < obj->dyn->allocated_blocks; n++ )
+        {
+            if ( obj->dyn->ring[( obj->dyn->ring_head + n ) % LALLOC_ALLOC_RING_SIZE] != idx )
+            {
+                printf( "%s ring of allocated blocks does not match the list at %u\n", __FUNCTION__, n );
+                good1 = 0;
+                break;
+            }
+
+            LALLOC_GET_BLOCK_PREV( obj->pool, idx, idx );
+        }
+    }
+#endif
+
     /* matches the number of blocks */
     if ( num_prev != num_next )
     {
@@ -303,12 +349,71 @@ LALLOC_IDX_TYPE lalloc_sanity_check( LALLOC_T *obj )
     LALLOC_IDX_TYPE start = obj->dyn->flist;
     LALLOC_IDX_TYPE prev_size;
 
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    /* with the segregated index the sizes decrease class by class, and each class bit must match its list */
+    for ( uint8_t fl = 0; fl < LALLOC_TLSF_FL_COUNT; fl++ )
+    {
+        for ( uint8_t sl = 0; sl < LALLOC_TLSF_SL_COUNT; sl++ )
+        {
+            bool bit = ( obj->dyn->sl_bitmap[fl] >> sl ) & 1;
+
+            if ( bit != ( obj->dyn->fheads[fl][sl] != LALLOC_IDX_INVALID ) )
+            {
+                printf( "%s class bitmap does not match its list\n", __FUNCTION__ );
+                good5 = 0;
+            }
+        }
+
+        if ( ( ( obj->dyn->fl_bitmap >> fl ) & 1 ) != ( obj->dyn->sl_bitmap[fl] != 0 ) )
+        {
+            printf( "%s first level bitmap does not match the second level\n", __FUNCTION__ );
+            good5 = 0;
+        }
+    }
+#endif
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_LAZY
+    /* the list is not sorted: the cached block must be the largest one and no block can exceed the bound */
+    LALLOC_IDX_TYPE max_size = 0;
+
+    for ( ; start != LALLOC_IDX_INVALID; start = _flist_next( obj, start ) )
+    {
+        size = _block_get_size( obj->pool, start );
+
+        if ( size > max_size )
+        {
+            max_size = size;
+        }
+
+        if ( size > obj->dyn->flist_max_size )
+        {
+            printf( "%s block bigger than the flist bound\n", __FUNCTION__ );
+            good5 = 0;
+        }
+    }
+
+    if ( obj->dyn->flist_max != LALLOC_IDX_INVALID && _block_get_size( obj->pool, obj->dyn->flist_max ) != max_size )
+    {
+        printf( "%s cached block is not the largest\n", __FUNCTION__ );
+        good5 = 0;
+    }
+#endif
+
     if ( start != LALLOC_IDX_INVALID )
     {
         while ( 1 )
         {
             size = _block_get_size( obj->pool, start );
 
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+            uint8_t fl;
+            uint8_t sl;
+
+            /* compare the classes instead of the sizes */
+            _tlsf_mapping( size, &fl, &sl );
+            size = fl * LALLOC_TLSF_SL_COUNT + sl;
+#endif
+
             if ( start == obj->dyn->flist )
             {
                 prev_size = size;
@@ -323,8 +428,10 @@ LALLOC_IDX_TYPE lalloc_sanity_check( LALLOC_T *obj )
                 }
             }
 
-            LALLOC_GET_BLOCK_NEXT( obj->pool, start, start );
-            if ( start == obj->dyn->flist )
+            prev_size = size;
+
+            start = _flist_next( obj, start );
+            if ( start == LALLOC_IDX_INVALID )
             {
                 break;
             }
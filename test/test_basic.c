@@ -30,6 +30,7 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <string.h>
 #include "unity.h"
 #include "lalloc.h"
 #include "lalloc_priv.h"
@@ -543,6 +544,231 @@ void test_lalloc_commit_without_alloc()
     TEST_ASSERT_EQUAL( false, rv );
 }
 
+/**
+   @brief ITERATES THE ALLOCATED BLOCKS FROM THE OLDEST TO THE NEWEST, FREEING SOME OF THEM WHILE ITERATING.
+          THE RESULT MUST MATCH lalloc_get_n.
+ */
+void test_lalloc_iter()
+{
+    int i;
+    uint8_t *data;
+    void *addr;
+    LALLOC_IDX_TYPE size;
+    lalloc_iter_t it;
+
+    LALLOC_DECLARE( test_alloc, 200 );
+
+    lalloc_init( &test_alloc );
+
+    /* empty allocator */
+    lalloc_iter_begin( &test_alloc, &it );
+    TEST_ASSERT_EQUAL( false, lalloc_iter_next( &test_alloc, &it, &addr, &size ) );
+    TEST_ASSERT_EQUAL( NULL, addr );
+    TEST_ASSERT_EQUAL( 0, size );
+    lalloc_iter_end( &test_alloc, &it );
+
+    for ( i = 0; i < 6; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+        data[0] = i;
+        lalloc_commit( &test_alloc, i + 1 );
+    }
+
+    /* iterate freeing the even blocks */
+    i = 0;
+    lalloc_iter_begin( &test_alloc, &it );
+
+    while ( lalloc_iter_next( &test_alloc, &it, &addr, &size ) )
+    {
+        TEST_ASSERT_EQUAL( i, ( ( uint8_t * )addr )[0] );
+        TEST_ASSERT_EQUAL( i + 1, size );
+
+        if ( i % 2 == 0 )
+        {
+            TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, addr ) );
+        }
+        i++;
+    }
+
+    lalloc_iter_end( &test_alloc, &it );
+    TEST_ASSERT_EQUAL( 6, i );
+    TEST_ASSERT_EQUAL( false, lalloc_iter_next( &test_alloc, &it, &addr, &size ) );
+
+    /* the odd blocks remain, in the same order */
+    TEST_ASSERT_EQUAL( 3, test_alloc.dyn->allocated_blocks );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        lalloc_get_n( &test_alloc, &addr, &size, i );
+        TEST_ASSERT_EQUAL( 2 * i + 1, ( ( uint8_t * )addr )[0] );
+        TEST_ASSERT_EQUAL( 2 * i + 2, size );
+    }
+
+    lalloc_get_n( &test_alloc, &addr, &size, 3 );
+    TEST_ASSERT_EQUAL( NULL, addr );
+    TEST_ASSERT_EQUAL( 0, size );
+}
+
+#if LALLOC_ALLOC_RING_SIZE > 0
+void _ring_check_order( LALLOC_T *obj, uint8_t *model, int cnt )
+{
+    int i;
+    void *addr;
+    LALLOC_IDX_TYPE size;
+
+    TEST_ASSERT_EQUAL( cnt, obj->dyn->allocated_blocks );
+
+    for ( i = 0; i < cnt; i++ )
+    {
+        lalloc_get_n( obj, &addr, &size, i );
+        TEST_ASSERT_EQUAL( model[i], ( ( uint8_t * )addr )[0] );
+    }
+}
+
+void _ring_free_n( LALLOC_T *obj, uint8_t *model, int *cnt, int n )
+{
+    void *addr;
+    LALLOC_IDX_TYPE size;
+
+    lalloc_get_n( obj, &addr, &size, n );
+    TEST_ASSERT_EQUAL( true, lalloc_free( obj, addr ) );
+
+    memmove( model + n, model + n + 1, *cnt - n - 1 );
+    ( *cnt )--;
+}
+
+void _ring_commit( LALLOC_T *obj, uint8_t *model, int *cnt, uint8_t tag )
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    lalloc_alloc( obj, ( void ** )&data, &size );
+    data[0] = tag;
+    TEST_ASSERT_EQUAL( true, lalloc_commit( obj, 4 ) );
+
+    model[( *cnt )++] = tag;
+}
+
+/**
+   @brief COMMITS FAIL WHEN THE RING OF ALLOCATED BLOCKS IS FULL, AND THE RING KEEPS THE ORDER
+          WHEN BLOCKS ARE FREED FROM ANY POSITION, WRAPPING AROUND.
+ */
+void test_lalloc_ring()
+{
+    int round;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint8_t model[LALLOC_ALLOC_RING_SIZE];
+    int cnt = 0;
+    uint8_t tag = 0;
+
+    LALLOC_DECLARE( test_alloc, 1000 );
+
+    lalloc_init( &test_alloc );
+
+    while ( cnt < LALLOC_ALLOC_RING_SIZE )
+    {
+        _ring_commit( &test_alloc, model, &cnt, tag++ );
+    }
+
+    /* the ring is full */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_NOT_EQUAL( NULL, data );
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, 4 ) );
+    lalloc_alloc_revert( &test_alloc );
+    _ring_check_order( &test_alloc, model, cnt );
+
+    for ( round = 0; round < 3 * LALLOC_ALLOC_RING_SIZE; round++ )
+    {
+        /* oldest, one close to the oldest, one close to the newest and the newest */
+        _ring_free_n( &test_alloc, model, &cnt, 0 );
+        _ring_check_order( &test_alloc, model, cnt );
+
+        _ring_free_n( &test_alloc, model, &cnt, 1 );
+        _ring_check_order( &test_alloc, model, cnt );
+
+        _ring_free_n( &test_alloc, model, &cnt, cnt - 2 );
+        _ring_check_order( &test_alloc, model, cnt );
+
+        _ring_free_n( &test_alloc, model, &cnt, cnt - 1 );
+        _ring_check_order( &test_alloc, model, cnt );
+
+        while ( cnt < LALLOC_ALLOC_RING_SIZE )
+        {
+            _ring_commit( &test_alloc, model, &cnt, tag++ );
+        }
+
+        _ring_check_order( &test_alloc, model, cnt );
+    }
+}
+#endif
+
+/**
+   @brief GETS THE OLDEST AND NEWEST ELEMENTS, AND CHECKS WHICH ADDRESSES BELONG TO THE ALLOCATED ELEMENTS.
+ */
+void test_lalloc_get_first_last_belongs()
+{
+    int i;
+    uint8_t *data[3];
+    uint8_t *reserved;
+    void *addr;
+    LALLOC_IDX_TYPE size;
+    uint8_t outside[4];
+
+    LALLOC_DECLARE( test_alloc, 200 );
+
+    lalloc_init( &test_alloc );
+
+    lalloc_get_first( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( NULL, addr );
+    TEST_ASSERT_EQUAL( 0, size );
+    lalloc_get_last( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( NULL, addr );
+    TEST_ASSERT_EQUAL( 0, size );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        lalloc_commit( &test_alloc, 10 + i );
+    }
+
+    lalloc_get_first( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( data[0], addr );
+    TEST_ASSERT_EQUAL( 10, size );
+    lalloc_get_last( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( data[2], addr );
+    TEST_ASSERT_EQUAL( 12, size );
+
+    /* the reserved block is not an allocated element */
+    lalloc_alloc( &test_alloc, ( void ** )&reserved, &size );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        TEST_ASSERT_EQUAL( 1, lalloc_dest_belongs( &test_alloc, data[i] ) );
+#if LALLOC_FREE_ANY == 1
+        TEST_ASSERT_EQUAL( 1, lalloc_dest_belongs( &test_alloc, data[i] + 5 ) );
+#else
+        TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, data[i] + 5 ) );
+#endif
+    }
+
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, reserved ) );
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, test_alloc.pool ) );
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, outside ) );
+
+    lalloc_alloc_revert( &test_alloc );
+
+    /* the middle one becomes a free block */
+    lalloc_free( &test_alloc, data[1] );
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, data[1] ) );
+
+    lalloc_free( &test_alloc, data[0] );
+    lalloc_get_first( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( data[2], addr );
+    lalloc_get_last( &test_alloc, &addr, &size );
+    TEST_ASSERT_EQUAL( data[2], addr );
+}
+
 uint32_t heap_test[200];
 uint32_t freecount = 0;
 
@@ -624,6 +850,11 @@ int main()
     RUN_TEST( test_lalloc_free_valid_blocks );
     RUN_TEST( test_lalloc_commit_without_alloc );
     RUN_TEST( test_lalloc_ctor_fails );
+    RUN_TEST( test_lalloc_iter );
+    RUN_TEST( test_lalloc_get_first_last_belongs );
+#if LALLOC_ALLOC_RING_SIZE > 0
+    RUN_TEST( test_lalloc_ring );
+#endif
     return 0;
 }
 #endif
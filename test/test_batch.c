@@ -0,0 +1,221 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data and functions from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+bool _block_is_free( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+
+#define BATCH_POOL_SIZE     3000
+#define BATCH_MAX           64
+#define BATCH_BLOCKS_MAX    1024
+
+/**
+   @brief both objects must have the same physical blocks, with the same state.
+ */
+void _check_same_layout( LALLOC_T *a, LALLOC_T *b )
+{
+    LALLOC_IDX_TYPE idx = 0;
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( a ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( b ) );
+    TEST_ASSERT_EQUAL( lalloc_get_alloc_count( a ), lalloc_get_alloc_count( b ) );
+    TEST_ASSERT_EQUAL( lalloc_get_free_space( a ), lalloc_get_free_space( b ) );
+
+    while ( idx < a->size )
+    {
+        TEST_ASSERT_EQUAL( _block_get_size( a->pool, idx ), _block_get_size( b->pool, idx ) );
+        TEST_ASSERT_EQUAL( _block_is_free( a->pool, idx ), _block_is_free( b->pool, idx ) );
+
+        idx += lalloc_b_overhead_size + _block_get_size( a->pool, idx );
+    }
+
+    /* the free blocks of the same size might be in different order, b continues as a copy of a */
+    memcpy( b->pool, a->pool, a->size );
+    *b->dyn = *a->dyn;
+}
+
+/**
+   @brief commits the same frame in both objects
+ */
+bool _commit_both( LALLOC_T *a, LALLOC_T *b, LALLOC_IDX_TYPE frame_size )
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    bool rv = false;
+
+    lalloc_alloc( a, ( void ** )&data, &size );
+
+    if ( data != NULL && size >= frame_size )
+    {
+        lalloc_alloc( b, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( a, frame_size ) );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( b, frame_size ) );
+        rv = true;
+    }
+    else
+    {
+        lalloc_alloc_revert( a );
+    }
+
+    return rv;
+}
+
+/**
+   @brief lalloc_free_first_n LEAVES THE POOL JUST LIKE lalloc_free_first CALLED n TIMES.
+ */
+void test_free_first_n()
+{
+    int i;
+    LALLOC_IDX_TYPE n;
+    LALLOC_IDX_TYPE k;
+
+    LALLOC_DECLARE( batch_alloc, BATCH_POOL_SIZE );
+    LALLOC_DECLARE( single_alloc, BATCH_POOL_SIZE );
+
+    lalloc_init( &batch_alloc );
+    lalloc_init( &single_alloc );
+
+    /* nothing to free */
+    TEST_ASSERT_EQUAL( 0, lalloc_free_first_n( &batch_alloc, 10 ) );
+
+    for ( i = 0; i < 5000; i++ )
+    {
+        /* fills the pool up */
+        while ( _commit_both( &batch_alloc, &single_alloc, uint32_random_range( 1, 100 ) ) )
+        {
+        }
+
+        LALLOC_IDX_TYPE count = lalloc_get_alloc_count( &batch_alloc );
+
+        n = uint32_random_range( 1, count + 2 );
+
+        TEST_ASSERT_EQUAL( n < count ? n : count, lalloc_free_first_n( &batch_alloc, n ) );
+
+        for ( k = 0; k < n; k++ )
+        {
+            lalloc_free_first( &single_alloc );
+        }
+
+        _check_same_layout( &batch_alloc, &single_alloc );
+    }
+}
+
+/**
+   @brief lalloc_free_batch LEAVES THE POOL JUST LIKE lalloc_free CALLED FOR EACH ADDRESS, IN ANY ORDER.
+ */
+void test_free_batch()
+{
+    int i;
+    LALLOC_IDX_TYPE n;
+    LALLOC_IDX_TYPE k;
+    uint8_t *addrs[BATCH_MAX];
+    LALLOC_IDX_TYPE order[BATCH_BLOCKS_MAX];
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( batch_alloc, BATCH_POOL_SIZE );
+    LALLOC_DECLARE( single_alloc, BATCH_POOL_SIZE );
+
+    lalloc_init( &batch_alloc );
+    lalloc_init( &single_alloc );
+
+    for ( i = 0; i < 5000; i++ )
+    {
+        while ( _commit_both( &batch_alloc, &single_alloc, uint32_random_range( 1, 100 ) ) )
+        {
+        }
+
+        LALLOC_IDX_TYPE count = lalloc_get_alloc_count( &batch_alloc );
+
+        n = uint32_random_range( 1, count < BATCH_MAX ? count : BATCH_MAX );
+
+        /* n different random blocks */
+        TEST_ASSERT( count <= BATCH_BLOCKS_MAX );
+
+        for ( k = 0; k < count; k++ )
+        {
+            order[k] = k;
+        }
+
+        for ( k = 0; k < n; k++ )
+        {
+            LALLOC_IDX_TYPE j = uint32_random_range( k, count - 1 );
+            LALLOC_IDX_TYPE tmp = order[k];
+
+            order[k] = order[j];
+            order[j] = tmp;
+
+            lalloc_get_n( &batch_alloc, ( void ** )&addrs[k], &size, order[k] );
+        }
+
+        LALLOC_IDX_TYPE freed = 0;
+
+        for ( k = 0; k < n; k++ )
+        {
+            /* the same block in the other object */
+            uint8_t *addr = single_alloc.pool + ( addrs[k] - batch_alloc.pool );
+
+            freed += lalloc_free( &single_alloc, addr ) ? 1 : 0;
+        }
+
+        TEST_ASSERT_EQUAL( freed, lalloc_free_batch( &batch_alloc, ( void * const * )addrs, n ) );
+
+        _check_same_layout( &batch_alloc, &single_alloc );
+    }
+
+    /* addresses out of the pool and the blocks that are already free are skipped */
+    lalloc_get_first( &batch_alloc, ( void ** )&addrs[0], &size );
+    addrs[1] = NULL;
+    addrs[2] = batch_alloc.pool + batch_alloc.size;
+    addrs[3] = addrs[0];
+    TEST_ASSERT_EQUAL( 1, lalloc_free_batch( &batch_alloc, ( void * const * )addrs, 4 ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &batch_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_free_first_n );
+    RUN_TEST( test_free_batch );
+    return 0;
+}
+#endif
@@ -0,0 +1,358 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data from lalloc_bip.c */
+extern const LALLOC_IDX_TYPE lalloc_bip_header_size;
+
+#if LALLOC_MAX_BYTES <= 0xFF
+#define BIP_POOL_SIZE       200
+#define BIP_FRAME_MAX       40
+#else
+#define BIP_POOL_SIZE       2000
+#define BIP_FRAME_MAX       300
+#endif
+
+#define BIP_MODEL_SIZE      BIP_POOL_SIZE
+
+typedef struct
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint8_t tag;
+} bip_frame_t;
+
+/* FIFO model of the committed frames */
+bip_frame_t model[BIP_MODEL_SIZE];
+uint32_t model_first;
+uint32_t model_count;
+
+void _bip_check_model( LALLOC_T *obj )
+{
+    uint32_t n;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    lalloc_iter_t it;
+
+    TEST_ASSERT_EQUAL( model_count, lalloc_get_alloc_count( obj ) );
+
+    lalloc_iter_begin( obj, &it );
+
+    for ( n = 0; n < model_count; n++ )
+    {
+        bip_frame_t *frame = &model[( model_first + n ) % BIP_MODEL_SIZE];
+
+        lalloc_get_n( obj, ( void ** )&data, &size, n );
+        TEST_ASSERT_EQUAL_PTR( frame->data, data );
+        TEST_ASSERT_EQUAL( frame->size, size );
+        TEST_ASSERT_EQUAL( frame->tag, data[0] );
+        TEST_ASSERT_EQUAL( frame->tag, data[size - 1] );
+        TEST_ASSERT_EQUAL( 1, lalloc_dest_belongs( obj, data ) );
+
+        TEST_ASSERT_EQUAL( true, lalloc_iter_next( obj, &it, ( void ** )&data, &size ) );
+        TEST_ASSERT_EQUAL_PTR( frame->data, data );
+    }
+
+    TEST_ASSERT_EQUAL( false, lalloc_iter_next( obj, &it, ( void ** )&data, &size ) );
+    lalloc_iter_end( obj, &it );
+
+    lalloc_get_n( obj, ( void ** )&data, &size, model_count );
+    TEST_ASSERT_EQUAL_PTR( NULL, data );
+
+    if ( model_count > 0 )
+    {
+        lalloc_get_last( obj, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL_PTR( model[( model_first + model_count - 1 ) % BIP_MODEL_SIZE].data, data );
+    }
+}
+
+/**
+   @brief RANDOM FIFO TRAFFIC: THE FRAMES MUST COME BACK IN ORDER, WITHOUT OVERLAPPING, THROUGH MANY WRAP AROUNDS.
+ */
+void test_bip_random_fifo()
+{
+    uint32_t i;
+    uint8_t tag = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, BIP_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    model_first = 0;
+    model_count = 0;
+
+    for ( i = 0; i < 100000; i++ )
+    {
+        if ( uint32_random_range( 0, 99 ) < 55 )
+        {
+            LALLOC_IDX_TYPE frame_size = uint32_random_range( 1, BIP_FRAME_MAX );
+
+            lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL && frame_size <= size )
+            {
+                memset( data, tag, frame_size );
+                TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, frame_size ) );
+
+                bip_frame_t *frame = &model[( model_first + model_count ) % BIP_MODEL_SIZE];
+                frame->data = data;
+                frame->size = LALLOC_ALIGN_ROUND_UP( frame_size );
+                frame->tag = tag++;
+                model_count++;
+
+                /* the tag at the end of the (aligned) frame */
+                data[frame->size - 1] = frame->tag;
+            }
+            else
+            {
+                /* it does not fit, the committed size is validated */
+                if ( data != NULL )
+                {
+                    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, size + LALLOC_ALIGNMENT ) );
+                }
+                lalloc_alloc_revert( &test_alloc );
+            }
+        }
+        else if ( model_count > 0 )
+        {
+            lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+            TEST_ASSERT_EQUAL_PTR( model[model_first].data, data );
+
+            TEST_ASSERT_EQUAL( true, lalloc_free_first( &test_alloc ) );
+
+            model_first = ( model_first + 1 ) % BIP_MODEL_SIZE;
+            model_count--;
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL( false, lalloc_free_first( &test_alloc ) );
+        }
+
+        if ( i % 64 == 0 )
+        {
+            _bip_check_model( &test_alloc );
+        }
+    }
+
+    /* drain */
+    while ( lalloc_free_first( &test_alloc ) );
+
+    /* no fragmentation: the whole pool is available again */
+    TEST_ASSERT_EQUAL( test_alloc.size - lalloc_bip_header_size, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief ONLY THE OLDEST FRAME CAN BE FREED
+ */
+void test_bip_free_only_first()
+{
+    uint8_t *data[3];
+    LALLOC_IDX_TYPE size;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, BIP_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 8 ) );
+    }
+
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[2] ) );
+#if LALLOC_FREE_ANY == 1
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] + 1 ) );
+#else
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[0] + 1 ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+#endif
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_get_alloc_count( &test_alloc ) );
+}
+
+/**
+   @brief A RESERVATION SURVIVES THE REGIONS CHANGES CAUSED BY FREES BEFORE ITS COMMIT.
+ */
+void test_bip_reservation_while_freeing()
+{
+    uint8_t *data;
+    uint8_t *first;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE frame_size = BIP_POOL_SIZE / 4;
+
+    LALLOC_DECLARE( test_alloc, BIP_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    /* three frames, then the first one is freed: the biggest space is at the end of the pool */
+    lalloc_alloc( &test_alloc, ( void ** )&first, &size );
+    lalloc_commit( &test_alloc, frame_size );
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_commit( &test_alloc, frame_size );
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_commit( &test_alloc, frame_size );
+    lalloc_free_first( &test_alloc );
+
+    /* reserve at the end, and free everything before the commit */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_NOT_NULL( data );
+    lalloc_free_first( &test_alloc );
+    lalloc_free_first( &test_alloc );
+
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 4 ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_dest_belongs( &test_alloc, data ) );
+
+    lalloc_get_first( &test_alloc, ( void ** )&first, &size );
+    TEST_ASSERT_EQUAL_PTR( data, first );
+
+    /* the next one starts region B at the beginning of the pool, if it is the biggest space */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_NOT_NULL( data );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 4 ) );
+    lalloc_get_n( &test_alloc, ( void ** )&first, &size, 1 );
+    TEST_ASSERT_EQUAL_PTR( data, first );
+
+    /* empty again: the pool starts over */
+    lalloc_free_first( &test_alloc );
+    lalloc_free_first( &test_alloc );
+    TEST_ASSERT_EQUAL( test_alloc.size - lalloc_bip_header_size, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief BACK TO BACK FRAMES WITH lalloc_commit_and_alloc ARE CONTIGUOUS, AND THE STREAM WRAPS WHEN FRAMES ARE FREED.
+ */
+void test_bip_commit_and_alloc()
+{
+    uint8_t *data;
+    uint8_t *next;
+    uint8_t *first;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE len;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, BIP_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    /* nothing to commit */
+    TEST_ASSERT_EQUAL( false, lalloc_commit_and_alloc( &test_alloc, 8, ( void ** )&next, &len ) );
+    TEST_ASSERT_NULL( next );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+    /* too big, the reservation is kept */
+    TEST_ASSERT_EQUAL( false, lalloc_commit_and_alloc( &test_alloc, size + LALLOC_ALIGNMENT, ( void ** )&next, &len ) );
+
+    for ( i = 0; data != NULL && size >= LALLOC_ALIGN_ROUND_UP( 8 ); i++ )
+    {
+        data[0] = ( uint8_t )i;
+
+        TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, 8, ( void ** )&next, &len ) );
+
+        if ( next != NULL )
+        {
+            TEST_ASSERT_EQUAL_PTR( data + LALLOC_ALIGN_ROUND_UP( 8 ) + lalloc_bip_header_size, next );
+        }
+
+        data = next;
+        size = len;
+    }
+
+    TEST_ASSERT_EQUAL( i, lalloc_get_alloc_count( &test_alloc ) );
+    lalloc_alloc_revert( &test_alloc );
+
+    /* frees the first frame, the next reservation starts over */
+    lalloc_get_first( &test_alloc, ( void ** )&first, &size );
+    TEST_ASSERT_EQUAL( 0, first[0] );
+    TEST_ASSERT_EQUAL( true, lalloc_free_first( &test_alloc ) );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL_PTR( first, data );
+}
+
+/**
+   @brief BATCH FREES: THE FRAMES ARE ONLY FREED IN FIFO ORDER.
+ */
+void test_bip_free_batch()
+{
+    uint8_t *data[6];
+    LALLOC_IDX_TYPE size;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, BIP_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    TEST_ASSERT_EQUAL( 0, lalloc_free_first_n( &test_alloc, 3 ) );
+
+    for ( i = 0; i < 6; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 8 ) );
+    }
+
+    /* the 3rd one is not the oldest when it is reached */
+    void *batch[] = { data[0], data[2], data[1] };
+
+    TEST_ASSERT_EQUAL( 2, lalloc_free_batch( &test_alloc, batch, 3 ) );
+    TEST_ASSERT_EQUAL( 4, lalloc_get_alloc_count( &test_alloc ) );
+
+    TEST_ASSERT_EQUAL( 3, lalloc_free_first_n( &test_alloc, 3 ) );
+    lalloc_get_first( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL_PTR( data[5], data[0] );
+
+    TEST_ASSERT_EQUAL( 1, lalloc_free_first_n( &test_alloc, 3 ) );
+    TEST_ASSERT_EQUAL( test_alloc.size - lalloc_bip_header_size, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_bip_random_fifo );
+    RUN_TEST( test_bip_free_only_first );
+    RUN_TEST( test_bip_reservation_while_freeing );
+    RUN_TEST( test_bip_commit_and_alloc );
+    RUN_TEST( test_bip_free_batch );
+    return 0;
+}
+#endif
@@ -0,0 +1,382 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#ifdef TEST_MUTEX
+#include <pthread.h>
+#endif
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+
+#define CACHE_POOL_SIZE         2000
+#define CACHE_ROUNDS            20000
+#define CACHE_LIVE              8
+#define CACHE_THREADS           4
+
+extern int test_critical_count;
+
+/* the critical sections are only counted by the test abstraction, not by the mutex adapters */
+#ifdef TEST_MUTEX
+#define CACHE_ASSERT_CRITICAL(EXPECTED,START)   ( void )( START )
+#else
+#define CACHE_ASSERT_CRITICAL(EXPECTED,START)   TEST_ASSERT_EQUAL( (EXPECTED), test_critical_count - (START) )
+#endif
+
+/* the queued frees and the unmerged blocks are settled, as an idle system would do */
+static void _cache_maintain( LALLOC_T *obj )
+{
+    while ( lalloc_maintain( obj, 4 ) )
+    {
+    }
+}
+
+static LALLOC_IDX_TYPE _cache_free_space( void )
+{
+    return LALLOC_ALIGN_ROUND_UP( CACHE_POOL_SIZE - LALLOC_BLOCK_HEADER_SIZE );
+}
+
+/**
+   @brief THE SMALL BLOCKS ARE KEPT BY THE CACHE AND HANDED BACK TO THE NEXT RESERVATION THAT FITS, WITHOUT A CRITICAL
+          SECTION, AND THEIR COMMIT MAKES THEM THE NEWEST BLOCK. THE BIG ONES GO STRAIGHT TO THE INSTANCE.
+ */
+void test_cache_hits()
+{
+    LALLOC_DECLARE( test_alloc, CACHE_POOL_SIZE );
+    lalloc_cache_t cache;
+    lalloc_handle_t h;
+    uint8_t *small[4];
+    uint8_t *big;
+    uint8_t *reused;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    int start;
+    uint32_t i;
+
+    lalloc_init( &test_alloc );
+    lalloc_cache_init( &cache, &test_alloc );
+
+    for ( i = 0; i < 4; i++ )
+    {
+        TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, 8 * ( i + 1 ), &h ) );
+        small[i] = h.addr;
+        TEST_ASSERT_TRUE( lalloc_cache_commit_h( &cache, &h, 8 * ( i + 1 ) ) );
+    }
+
+    TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, LALLOC_CACHE_SMALL + 40, &h ) );
+    big = h.addr;
+    TEST_ASSERT_TRUE( lalloc_cache_commit_h( &cache, &h, LALLOC_CACHE_SMALL + 40 ) );
+
+    TEST_ASSERT_EQUAL( 0, cache.hits );
+
+    /* the small blocks stay allocated in the instance */
+    start = test_critical_count;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        TEST_ASSERT_TRUE( lalloc_cache_free( &cache, small[i] ) );
+    }
+
+    CACHE_ASSERT_CRITICAL( 0, start );
+    TEST_ASSERT_EQUAL( 4, cache.count );
+    TEST_ASSERT_EQUAL( 5, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* a block is only cached once */
+    TEST_ASSERT_FALSE( lalloc_cache_free( &cache, small[0] ) );
+    TEST_ASSERT_EQUAL( 4, cache.count );
+
+    /* the big one does not */
+    start = test_critical_count;
+    TEST_ASSERT_TRUE( lalloc_cache_free( &cache, big ) );
+    CACHE_ASSERT_CRITICAL( 1, start );
+    TEST_ASSERT_EQUAL( 4, cache.count );
+    _cache_maintain( &test_alloc );
+    TEST_ASSERT_EQUAL( 4, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* a free block is not cached */
+    TEST_ASSERT_FALSE( lalloc_cache_free( &cache, big ) );
+    TEST_ASSERT_EQUAL( 4, cache.count );
+
+    /* the smallest cached block that fits */
+    start = test_critical_count;
+    TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, 12, &h ) );
+    TEST_ASSERT_EQUAL_PTR( small[1], h.addr );
+    TEST_ASSERT_TRUE( h.size >= 16 );
+    reused = h.addr;
+    memset( reused, 0x5A, 12 );
+    TEST_ASSERT_FALSE( lalloc_cache_commit_h( &cache, &h, h.size + 1 ) );
+    TEST_ASSERT_TRUE( lalloc_cache_commit_h( &cache, &h, 12 ) );
+    TEST_ASSERT_NULL( h.addr );
+    CACHE_ASSERT_CRITICAL( 1, start );
+    TEST_ASSERT_EQUAL( 1, cache.hits );
+    TEST_ASSERT_EQUAL( 3, cache.count );
+
+    /* it is the newest block */
+    lalloc_get_last( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL_PTR( reused, data );
+    lalloc_get_n( &test_alloc, ( void ** )&data, &size, 3 );
+    TEST_ASSERT_EQUAL_PTR( reused, data );
+
+    /* a reverted hit goes back to the cache */
+    TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, 5, &h ) );
+    TEST_ASSERT_EQUAL_PTR( small[0], h.addr );
+    lalloc_cache_revert_h( &cache, &h );
+    TEST_ASSERT_NULL( h.addr );
+    TEST_ASSERT_EQUAL( 3, cache.count );
+
+    /* a smaller commit splits the block, as any other commit */
+    TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, 25, &h ) );
+    TEST_ASSERT_EQUAL_PTR( small[3], h.addr );
+    TEST_ASSERT_TRUE( lalloc_cache_commit_h( &cache, &h, 8 ) );
+    lalloc_get_last( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL_PTR( small[3], data );
+    TEST_ASSERT_EQUAL( 8, size );
+    TEST_ASSERT_EQUAL( 2, cache.count );
+
+    /* nothing fits, it is a reservation on the instance */
+    start = test_critical_count;
+    TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, 8 * 4 + 1, &h ) );
+    TEST_ASSERT_TRUE( ( uint8_t * )h.addr != small[0] && ( uint8_t * )h.addr != small[2] && ( uint8_t * )h.addr != small[3] );
+    TEST_ASSERT_FALSE( lalloc_cache_free( &cache, h.addr ) );
+    lalloc_cache_revert_h( &cache, &h );
+    CACHE_ASSERT_CRITICAL( 2, start );
+    TEST_ASSERT_EQUAL( 3, cache.hits );
+
+    /* an address out of the pool is rejected */
+    TEST_ASSERT_FALSE( lalloc_cache_free( &cache, &cache ) );
+
+    /* everything goes back in a single critical section */
+    start = test_critical_count;
+    lalloc_cache_flush( &cache );
+    CACHE_ASSERT_CRITICAL( 1, start );
+    TEST_ASSERT_EQUAL( 0, cache.count );
+    TEST_ASSERT_EQUAL( 0, cache.bytes );
+
+    for ( i = 0; i < 12; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0x5A, reused[i] );
+    }
+
+    TEST_ASSERT_TRUE( lalloc_cache_free( &cache, reused ) );
+    TEST_ASSERT_TRUE( lalloc_cache_free( &cache, small[3] ) );
+    lalloc_cache_flush( &cache );
+    _cache_maintain( &test_alloc );
+
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( _cache_free_space(), lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief OVER THE BYTE BUDGET OR THE SLOTS, THE OLDEST BLOCKS ARE FLUSHED IN A SINGLE CRITICAL SECTION.
+ */
+void test_cache_budget()
+{
+    LALLOC_DECLARE( test_alloc, CACHE_POOL_SIZE );
+    lalloc_cache_t cache;
+    lalloc_handle_t h;
+    uint8_t *blocks[3 * LALLOC_CACHE_SLOTS];
+    LALLOC_IDX_TYPE sizes[] = { sizeof( LALLOC_IDX_TYPE ), LALLOC_CACHE_SMALL / 2, LALLOC_CACHE_SMALL };
+    int start;
+    int sections = 0;
+    uint32_t s;
+    uint32_t i;
+
+    lalloc_init( &test_alloc );
+    lalloc_cache_init( &cache, &test_alloc );
+
+    for ( s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); s++ )
+    {
+        for ( i = 0; i < 3 * LALLOC_CACHE_SLOTS; i++ )
+        {
+            TEST_ASSERT_TRUE( lalloc_cache_reserve( &cache, sizes[s], &h ) );
+            blocks[i] = h.addr;
+            TEST_ASSERT_TRUE( lalloc_cache_commit_h( &cache, &h, sizes[s] ) );
+        }
+
+        for ( i = 0; i < 3 * LALLOC_CACHE_SLOTS; i++ )
+        {
+            start = test_critical_count;
+
+            TEST_ASSERT_TRUE( lalloc_cache_free( &cache, blocks[i] ) );
+
+            /* at most one flush per free */
+            TEST_ASSERT_TRUE( test_critical_count - start <= 1 );
+            sections += test_critical_count - start;
+
+            TEST_ASSERT_TRUE( cache.bytes <= LALLOC_CACHE_BUDGET );
+            TEST_ASSERT_TRUE( cache.count < LALLOC_CACHE_SLOTS );
+        }
+
+        /* the cached blocks are the only ones still allocated */
+        _cache_maintain( &test_alloc );
+        TEST_ASSERT_EQUAL( cache.count, lalloc_get_alloc_count( &test_alloc ) );
+
+        lalloc_cache_flush( &cache );
+        _cache_maintain( &test_alloc );
+
+        TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+        TEST_ASSERT_EQUAL( _cache_free_space(), lalloc_get_free_space( &test_alloc ) );
+    }
+
+#ifndef TEST_MUTEX
+    /* the frees are batched */
+    TEST_ASSERT_TRUE( sections < 3 * LALLOC_CACHE_SLOTS );
+#else
+    ( void )sections;
+#endif
+}
+
+#ifdef TEST_MUTEX
+typedef struct
+{
+    LALLOC_T            *obj;
+    uint8_t             id;
+    uint32_t            errors;
+    uint32_t            hits;
+} cache_worker_t;
+
+/* small frames with a tag per frame, each thread with its own cache */
+static void *_cache_worker( void *arg )
+{
+    cache_worker_t *ctx = ( cache_worker_t * )arg;
+    lalloc_cache_t cache;
+    uint8_t *live[CACHE_LIVE];
+    LALLOC_IDX_TYPE sizes[CACHE_LIVE];
+    uint32_t count = 0;
+    uint32_t i;
+
+    lalloc_cache_init( &cache, ctx->obj );
+
+    for ( i = 0; i < CACHE_ROUNDS; i++ )
+    {
+        /* mostly small frames, a big one now and then */
+        LALLOC_IDX_TYPE frame_size = ( i % 16 == 0 ) ? LALLOC_CACHE_SMALL + 20 : sizeof( LALLOC_IDX_TYPE ) + ( i * 7 + ctx->id ) % ( LALLOC_CACHE_SMALL - sizeof( LALLOC_IDX_TYPE ) + 1 );
+        lalloc_handle_t h;
+
+        if ( count < CACHE_LIVE && ( i % 3 ) != 2 && lalloc_cache_reserve( &cache, frame_size, &h ) )
+        {
+            /* the reserved area can be smaller than asked for */
+            if ( h.size < frame_size )
+            {
+                frame_size = h.size;
+            }
+
+            live[count] = h.addr;
+            sizes[count] = frame_size;
+            memset( live[count], ( uint8_t )( ctx->id + i ), frame_size );
+            ctx->errors += !lalloc_cache_commit_h( &cache, &h, frame_size );
+            count++;
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = i % count;
+            uint32_t b;
+
+            for ( b = 1; b < sizes[k]; b++ )
+            {
+                ctx->errors += ( live[k][b] != live[k][0] );
+            }
+
+            ctx->errors += !lalloc_cache_free( &cache, live[k] );
+
+            count--;
+            live[k] = live[count];
+            sizes[k] = sizes[count];
+        }
+    }
+
+    while ( count > 0 )
+    {
+        ctx->errors += !lalloc_cache_free( &cache, live[--count] );
+    }
+
+    lalloc_cache_flush( &cache );
+    ctx->hits = cache.hits;
+
+    return NULL;
+}
+
+/**
+   @brief THREADS ON A SHARED INSTANCE, EACH ONE WITH ITS OWN CACHE. THE FRAMES STAY APART AND NOTHING IS LEAKED.
+ */
+void test_cache_threads()
+{
+    pthread_t threads[CACHE_THREADS];
+    cache_worker_t workers[CACHE_THREADS];
+    LALLOC_DECLARE( test_alloc, CACHE_POOL_SIZE );
+    int w;
+
+    lalloc_init( &test_alloc );
+
+    for ( w = 0; w < CACHE_THREADS; w++ )
+    {
+        workers[w].obj = &test_alloc;
+        workers[w].id = ( uint8_t )w;
+        workers[w].errors = 0;
+        workers[w].hits = 0;
+
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[w], NULL, _cache_worker, &workers[w] ) );
+    }
+
+    for ( w = 0; w < CACHE_THREADS; w++ )
+    {
+        pthread_join( threads[w], NULL );
+
+        TEST_ASSERT_EQUAL( 0, workers[w].errors );
+        TEST_ASSERT_TRUE( workers[w].hits > 0 );
+    }
+
+    _cache_maintain( &test_alloc );
+
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( _cache_free_space(), lalloc_get_free_space( &test_alloc ) );
+}
+#endif
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_cache_hits );
+    RUN_TEST( test_cache_budget );
+#ifdef TEST_MUTEX
+    RUN_TEST( test_cache_threads );
+#endif
+    return 0;
+}
+#endif
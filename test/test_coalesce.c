@@ -0,0 +1,335 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data and functions from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+bool _block_is_free( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+
+#define COALESCE_BLOCKS_MAX     256
+
+/**
+   @brief counts the free blocks of the pool, and how many of them are followed by another free block.
+ */
+void _count_free_blocks( LALLOC_T *obj, LALLOC_IDX_TYPE *free_blocks, LALLOC_IDX_TYPE *pairs )
+{
+    LALLOC_IDX_TYPE idx = 0;
+    bool prev_free = false;
+
+    *free_blocks = 0;
+    *pairs = 0;
+
+    while ( idx != obj->size )
+    {
+        bool is_free = _block_is_free( obj->pool, idx );
+
+        if ( is_free )
+        {
+            ( *free_blocks )++;
+
+            if ( prev_free )
+            {
+                ( *pairs )++;
+            }
+        }
+
+        prev_free = is_free;
+        idx = LALLOC_NEXT_BLOCK_IDX( idx, _block_get_size( obj->pool, idx ) );
+    }
+}
+
+/**
+   @brief FREED BLOCKS ARE ONLY FLAGGED, lalloc_maintain MERGES THEM ONE BLOCK AT A TIME.
+ */
+void test_coalesce_maintain()
+{
+    int i;
+    uint8_t *data[5];
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE free_blocks;
+    LALLOC_IDX_TYPE pairs;
+    LALLOC_IDX_TYPE steps = 0;
+
+    LALLOC_DECLARE( test_alloc, 600 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    /* nothing to merge in a new pool */
+    TEST_ASSERT_EQUAL( false, lalloc_maintain( &test_alloc, 1 ) );
+
+    for ( i = 0; i < 5; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 20 ) );
+    }
+
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[2] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[3] ) );
+
+    /* only drains the deferred frees, if any */
+    TEST_ASSERT_EQUAL( true, lalloc_maintain( &test_alloc, 0 ) );
+
+    /* the three blocks and the rest of the pool are not merged */
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( 4, free_blocks );
+    TEST_ASSERT_EQUAL( 2, pairs );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    while ( lalloc_maintain( &test_alloc, 1 ) )
+    {
+        LALLOC_IDX_TYPE prev_pairs = pairs;
+
+        _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+
+        /* one block per step, at most one merge */
+        TEST_ASSERT_TRUE( prev_pairs - pairs <= 1 );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+        TEST_ASSERT_TRUE( ++steps < 100 );
+    }
+
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( 2, free_blocks );
+    TEST_ASSERT_EQUAL( 0, pairs );
+
+    /* the merged block is reserved as a whole */
+    lalloc_alloc_max( &test_alloc, ( void ** )&data[1], &size, 3 * LALLOC_ALIGN_ROUND_UP( 20 ) + 2 * lalloc_b_overhead_size );
+    TEST_ASSERT_EQUAL( 3 * LALLOC_ALIGN_ROUND_UP( 20 ) + 2 * lalloc_b_overhead_size, size );
+    lalloc_alloc_revert( &test_alloc );
+
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[4] ) );
+
+    while ( lalloc_maintain( &test_alloc, 2 ) )
+    {
+    }
+
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( 1, free_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief lalloc_alloc MERGES BLOCKS ONLY WHEN THE LARGEST FREE BLOCK IS TOO SMALL.
+ */
+void test_coalesce_on_alloc()
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE free_blocks;
+    LALLOC_IDX_TYPE pairs;
+    uint8_t *allocated[COALESCE_BLOCKS_MAX];
+    uint32_t count = 0;
+
+    LALLOC_DECLARE( test_alloc, 1000 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    /* the pool is filled with small blocks */
+    while ( 1 )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+        if ( data == NULL || size < 16 )
+        {
+            lalloc_alloc_revert( &test_alloc );
+            break;
+        }
+
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 16 ) );
+        allocated[count++] = data;
+    }
+
+    while ( count > 0 )
+    {
+        uint32_t k = uint32_random_range( 0, count - 1 );
+
+        TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[k] ) );
+        allocated[k] = allocated[--count];
+    }
+
+    /* the allocation merges blocks until one of them is big enough, not the whole pool */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_NOT_NULL( data );
+    TEST_ASSERT_TRUE( size >= LALLOC_LAZY_COALESCING_MIN_ALLOC );
+    lalloc_alloc_revert( &test_alloc );
+
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_TRUE( pairs > 0 );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* the block is big enough now, nothing else is merged */
+    LALLOC_IDX_TYPE prev_pairs = pairs;
+
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( prev_pairs, pairs );
+
+    /* nothing smaller than the whole pool is enough */
+    lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, free_space );
+    TEST_ASSERT_EQUAL( free_space, size );
+    lalloc_alloc_revert( &test_alloc );
+
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( 1, free_blocks );
+    TEST_ASSERT_EQUAL( false, lalloc_maintain( &test_alloc, 1 ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+}
+
+/**
+   @brief RANDOM TRAFFIC WITH BUDGETED lalloc_maintain CALLS. WHEN IT RETURNS FALSE NO FREE BLOCKS ARE ADJACENT.
+ */
+void test_coalesce_random()
+{
+    int i;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE free_blocks;
+    LALLOC_IDX_TYPE pairs;
+    uint8_t *allocated[COALESCE_BLOCKS_MAX];
+    uint32_t count = 0;
+    lalloc_handle_t h;
+
+    LALLOC_DECLARE( test_alloc, 3000 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 100000; i++ )
+    {
+        switch ( uint32_random_range( 0, 7 ) )
+        {
+            case 0:
+            case 1:
+                lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+                if ( data != NULL && size >= LALLOC_MIN_PAYLOAD_SIZE && count < COALESCE_BLOCKS_MAX )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( LALLOC_MIN_PAYLOAD_SIZE, size < 100 ? size : 100 ) ) );
+                    allocated[count++] = data;
+                }
+                else
+                {
+                    lalloc_alloc_revert( &test_alloc );
+                }
+                break;
+
+            case 2:
+                if ( count < COALESCE_BLOCKS_MAX && lalloc_reserve( &test_alloc, uint32_random_range( 8, 100 ), &h ) )
+                {
+                    if ( h.size >= LALLOC_MIN_PAYLOAD_SIZE )
+                    {
+                        allocated[count++] = h.addr;
+                        TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h, h.size ) );
+                    }
+                    else
+                    {
+                        lalloc_revert_h( &test_alloc, &h );
+                    }
+                }
+                break;
+
+            case 3:
+            case 4:
+                if ( count > 0 )
+                {
+                    uint32_t k = uint32_random_range( 0, count - 1 );
+
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[k] ) );
+                    allocated[k] = allocated[--count];
+                }
+                break;
+
+            case 5:
+                if ( count > 1 )
+                {
+                    void *pair[2] = { allocated[count - 1], allocated[count - 2] };
+
+                    TEST_ASSERT_EQUAL( 2, lalloc_free_batch( &test_alloc, pair, 2 ) );
+                    count -= 2;
+                }
+                break;
+
+            default:
+                if ( !lalloc_maintain( &test_alloc, uint32_random_range( 1, 8 ) ) )
+                {
+                    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+                    TEST_ASSERT_EQUAL( 0, pairs );
+                }
+                break;
+        }
+
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+
+    while ( count > 0 )
+    {
+        TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[--count] ) );
+    }
+
+    while ( lalloc_maintain( &test_alloc, 4 ) )
+    {
+    }
+
+    _count_free_blocks( &test_alloc, &free_blocks, &pairs );
+    TEST_ASSERT_EQUAL( 1, free_blocks );
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_coalesce_maintain );
+    RUN_TEST( test_coalesce_on_alloc );
+    RUN_TEST( test_coalesce_random );
+    return 0;
+}
+#endif
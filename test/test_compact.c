@@ -0,0 +1,386 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data and functions from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+bool _block_is_free( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+
+#define COMPACT_BLOCKS_MAX      128
+
+/* blocks known by the test, from the oldest to the newest one */
+typedef struct
+{
+    uint8_t *addr;
+    LALLOC_IDX_TYPE size;
+    uint8_t id;
+    bool pinned;
+} compact_block_t;
+
+static compact_block_t compact_blocks[COMPACT_BLOCKS_MAX];
+static uint32_t compact_count;
+static uint32_t compact_moved_bytes;
+
+/* relocation callback: the owner of the block updates its address */
+void _compact_relocate( void *old_addr, void *new_addr, LALLOC_IDX_TYPE size )
+{
+    uint32_t i;
+
+    for ( i = 0; i < compact_count; i++ )
+    {
+        if ( compact_blocks[i].addr == old_addr )
+        {
+            TEST_ASSERT_FALSE( compact_blocks[i].pinned );
+            TEST_ASSERT_TRUE( size >= compact_blocks[i].size );
+            TEST_ASSERT_TRUE( ( uint8_t * )new_addr < ( uint8_t * )old_addr );
+
+            compact_blocks[i].addr = new_addr;
+            compact_moved_bytes += size + lalloc_b_overhead_size;
+            return;
+        }
+    }
+
+    TEST_FAIL_MESSAGE( "unknown block relocated" );
+}
+
+/* commits a block filled with a pattern */
+void _compact_add( LALLOC_T *obj, LALLOC_IDX_TYPE size, uint8_t id )
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE len;
+
+    lalloc_alloc( obj, ( void ** )&data, &len );
+    TEST_ASSERT_NOT_NULL( data );
+    TEST_ASSERT_TRUE( len >= size );
+
+    memset( data, id, size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( obj, size ) );
+
+    compact_blocks[compact_count].addr = data;
+    compact_blocks[compact_count].size = size;
+    compact_blocks[compact_count].id = id;
+    compact_blocks[compact_count].pinned = false;
+    compact_count++;
+}
+
+/* frees the nth oldest known block */
+void _compact_remove( LALLOC_T *obj, uint32_t n )
+{
+    TEST_ASSERT_EQUAL( true, lalloc_free( obj, compact_blocks[n].addr ) );
+
+    memmove( &compact_blocks[n], &compact_blocks[n + 1], ( compact_count - n - 1 ) * sizeof( compact_block_t ) );
+    compact_count--;
+}
+
+/* the known blocks keep their data and their order, and the pool is consistent */
+void _compact_check( LALLOC_T *obj )
+{
+    uint32_t i;
+    LALLOC_IDX_TYPE j;
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( obj ) );
+    TEST_ASSERT_EQUAL( compact_count, lalloc_get_alloc_count( obj ) );
+
+    for ( i = 0; i < compact_count; i++ )
+    {
+        uint8_t *data;
+        LALLOC_IDX_TYPE size;
+
+        lalloc_get_n( obj, ( void ** )&data, &size, i );
+        TEST_ASSERT_EQUAL_PTR( compact_blocks[i].addr, data );
+
+        for ( j = 0; j < compact_blocks[i].size; j++ )
+        {
+            TEST_ASSERT_EQUAL( compact_blocks[i].id, data[j] );
+        }
+    }
+}
+
+/* number of free blocks of the pool */
+LALLOC_IDX_TYPE _compact_free_blocks( LALLOC_T *obj )
+{
+    LALLOC_IDX_TYPE idx = 0;
+    LALLOC_IDX_TYPE count = 0;
+
+    while ( idx != obj->size )
+    {
+        count += _block_is_free( obj->pool, idx ) ? 1 : 0;
+        idx = LALLOC_NEXT_BLOCK_IDX( idx, _block_get_size( obj->pool, idx ) );
+    }
+
+    return count;
+}
+
+/**
+   @brief THE BLOCKS SLIDE TO THE START OF THE POOL, EXCEPT THE PINNED ONE.
+ */
+void test_compact_pinned()
+{
+    uint32_t i;
+
+    LALLOC_DECLARE( test_alloc, 600 );
+
+    lalloc_init( &test_alloc );
+    compact_count = 0;
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 6; i++ )
+    {
+        _compact_add( &test_alloc, 20, ( uint8_t )( i + 1 ) );
+    }
+
+    /* frees 1, 3 and 5. Pins 4 */
+    _compact_remove( &test_alloc, 4 );
+    _compact_remove( &test_alloc, 2 );
+    _compact_remove( &test_alloc, 0 );
+
+    uint8_t *pinned = compact_blocks[1].addr;
+
+    TEST_ASSERT_EQUAL( true, lalloc_pin( &test_alloc, pinned ) );
+    TEST_ASSERT_EQUAL( true, lalloc_pin( &test_alloc, pinned ) );
+    compact_blocks[1].pinned = true;
+
+    /* not an allocated block */
+    TEST_ASSERT_EQUAL( false, lalloc_pin( &test_alloc, test_alloc.pool + lalloc_b_overhead_size ) );
+
+    while ( lalloc_compact_step( &test_alloc, 1000, _compact_relocate ) )
+    {
+        _compact_check( &test_alloc );
+    }
+
+    _compact_check( &test_alloc );
+
+    /* block 2 is first, then a free block, the pinned block 4, block 6 and the rest of the pool */
+    TEST_ASSERT_EQUAL_PTR( test_alloc.pool + lalloc_b_overhead_size, compact_blocks[0].addr );
+    TEST_ASSERT_EQUAL_PTR( pinned, compact_blocks[1].addr );
+    TEST_ASSERT_EQUAL_PTR( pinned + LALLOC_ALIGN_ROUND_UP( 20 ) + lalloc_b_overhead_size, compact_blocks[2].addr );
+    TEST_ASSERT_EQUAL( 2, _compact_free_blocks( &test_alloc ) );
+
+    /* once unpinned, everything is packed */
+    TEST_ASSERT_EQUAL( true, lalloc_unpin( &test_alloc, pinned ) );
+    TEST_ASSERT_EQUAL( false, lalloc_unpin( &test_alloc, pinned ) );
+    compact_blocks[1].pinned = false;
+
+    while ( lalloc_compact_step( &test_alloc, 1000, _compact_relocate ) )
+    {
+    }
+
+    _compact_check( &test_alloc );
+    TEST_ASSERT_EQUAL( 1, _compact_free_blocks( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space - 3 * ( LALLOC_ALIGN_ROUND_UP( 20 ) + lalloc_b_overhead_size ), lalloc_get_free_space( &test_alloc ) );
+
+    /* a freed block is unpinned */
+    TEST_ASSERT_EQUAL( true, lalloc_pin( &test_alloc, compact_blocks[0].addr ) );
+    _compact_remove( &test_alloc, 0 );
+    TEST_ASSERT_EQUAL( 2, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->pin_count );
+}
+
+/**
+   @brief EACH CALL MOVES UP TO max_bytes. BIGGER BLOCKS ARE NOT MOVED.
+ */
+void test_compact_budget()
+{
+    uint32_t i;
+    uint32_t calls = 0;
+
+    LALLOC_DECLARE( test_alloc, 1000 );
+
+    lalloc_init( &test_alloc );
+    compact_count = 0;
+
+    _compact_add( &test_alloc, 40, 1 );
+    _compact_add( &test_alloc, 200, 2 );
+
+    for ( i = 0; i < 8; i++ )
+    {
+        _compact_add( &test_alloc, 16, ( uint8_t )( i + 3 ) );
+    }
+
+    _compact_remove( &test_alloc, 0 );
+
+    /* the big block does not fit in the budget, it stays and the small ones are not moved either */
+    LALLOC_IDX_TYPE max_bytes = 100;
+
+    do
+    {
+        compact_moved_bytes = 0;
+        TEST_ASSERT_TRUE( ++calls < 100 );
+    }
+    while ( lalloc_compact_step( &test_alloc, max_bytes, _compact_relocate ) );
+
+    _compact_check( &test_alloc );
+    TEST_ASSERT_EQUAL_PTR( test_alloc.pool + 2 * lalloc_b_overhead_size + LALLOC_ALIGN_ROUND_UP( 40 ), compact_blocks[0].addr );
+
+    /* the budget is enough for the big block, the small ones follow in several calls */
+    max_bytes = 300;
+    calls = 0;
+
+    do
+    {
+        compact_moved_bytes = 0;
+        TEST_ASSERT_TRUE( ++calls < 100 );
+        i = lalloc_compact_step( &test_alloc, max_bytes, _compact_relocate );
+        TEST_ASSERT_TRUE( compact_moved_bytes <= max_bytes );
+        _compact_check( &test_alloc );
+    }
+    while ( i );
+
+    TEST_ASSERT_EQUAL_PTR( test_alloc.pool + lalloc_b_overhead_size, compact_blocks[0].addr );
+    TEST_ASSERT_EQUAL( 1, _compact_free_blocks( &test_alloc ) );
+    TEST_ASSERT_TRUE( calls > 2 );
+}
+
+/**
+   @brief RANDOM TRAFFIC, PINS AND COMPACTION STEPS.
+ */
+void test_compact_random()
+{
+    int i;
+    uint32_t n;
+    uint8_t id = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 3000 );
+
+    lalloc_init( &test_alloc );
+    compact_count = 0;
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 20000; i++ )
+    {
+        n = ( compact_count > 0 ) ? uint32_random_range( 0, compact_count - 1 ) : 0;
+
+        switch ( uint32_random_range( 0, 7 ) )
+        {
+            case 0:
+            case 1:
+                lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+                lalloc_alloc_revert( &test_alloc );
+
+                if ( data != NULL && size >= 8 && compact_count < COMPACT_BLOCKS_MAX )
+                {
+                    _compact_add( &test_alloc, uint32_random_range( 8, size < 120 ? size : 120 ), ++id );
+                }
+                break;
+
+            case 2:
+            case 3:
+                if ( compact_count > 0 )
+                {
+                    _compact_remove( &test_alloc, n );
+                }
+                break;
+
+            case 4:
+                if ( compact_count > 0 && compact_blocks[n].pinned != lalloc_pin( &test_alloc, compact_blocks[n].addr ) )
+                {
+                    compact_blocks[n].pinned = true;
+                }
+                break;
+
+            case 5:
+                if ( compact_count > 0 )
+                {
+                    TEST_ASSERT_EQUAL( compact_blocks[n].pinned, lalloc_unpin( &test_alloc, compact_blocks[n].addr ) );
+                    compact_blocks[n].pinned = false;
+                }
+                break;
+
+            default:
+                lalloc_compact_step( &test_alloc, uint32_random_range( 0, 400 ), _compact_relocate );
+                break;
+        }
+
+        _compact_check( &test_alloc );
+    }
+
+    for ( n = 0; n < compact_count; n++ )
+    {
+        if ( compact_blocks[n].pinned )
+        {
+            TEST_ASSERT_EQUAL( true, lalloc_unpin( &test_alloc, compact_blocks[n].addr ) );
+            compact_blocks[n].pinned = false;
+        }
+    }
+
+    while ( lalloc_compact_step( &test_alloc, 400, _compact_relocate ) )
+    {
+    }
+
+    _compact_check( &test_alloc );
+    TEST_ASSERT_TRUE( _compact_free_blocks( &test_alloc ) <= 1 );
+
+    /* everything is packed at the start of the pool */
+    LALLOC_IDX_TYPE used = 0;
+
+    for ( n = 0; n < compact_count; n++ )
+    {
+        used += _block_get_size( test_alloc.pool, compact_blocks[n].addr - test_alloc.pool - lalloc_b_overhead_size ) + lalloc_b_overhead_size;
+    }
+
+    TEST_ASSERT_EQUAL( free_space - used, lalloc_get_free_space( &test_alloc ) );
+
+    while ( compact_count > 0 )
+    {
+        _compact_remove( &test_alloc, 0 );
+    }
+
+    while ( lalloc_compact_step( &test_alloc, 400, NULL ) )
+    {
+    }
+
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_compact_pinned );
+    RUN_TEST( test_compact_budget );
+    RUN_TEST( test_compact_random );
+    return 0;
+}
+#endif
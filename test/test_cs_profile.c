@@ -0,0 +1,251 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+extern uint32_t test_cycles_step;
+
+#define CS_POOL_SIZE        1000
+
+static lalloc_cs_site_t sites[LALLOC_CS_PROFILE_SITES];
+
+/**
+   @brief returns the call site of a function, NULL if it was not seen.
+ */
+lalloc_cs_site_t *_find_site( uint32_t count, const char *fcn )
+{
+    uint32_t i;
+
+    for ( i = 0; i < count; i++ )
+    {
+        if ( strcmp( sites[i].fcn, fcn ) == 0 )
+        {
+            return &sites[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+   @brief the histogram of each call site must be consistent with its counters.
+ */
+void _check_sites( uint32_t count )
+{
+    uint32_t i;
+    uint8_t b;
+
+    for ( i = 0; i < count; i++ )
+    {
+        uint32_t sum = 0;
+
+        for ( b = 0; b < LALLOC_PROFILE_BINS; b++ )
+        {
+            sum += sites[i].hist[b];
+        }
+
+        TEST_ASSERT_TRUE( sites[i].count > 0 );
+        TEST_ASSERT_EQUAL( sites[i].count, sum );
+        TEST_ASSERT_TRUE( sites[i].line > 0 );
+        TEST_ASSERT_TRUE( sites[i].total >= sites[i].max );
+    }
+}
+
+/**
+   @brief EACH CRITICAL SECTION IS COUNTED IN THE SITE OF ITS FUNCTION.
+ */
+void test_cs_sites()
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint32_t count;
+    uint32_t dropped;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, CS_POOL_SIZE );
+
+    test_cycles_step = 100;
+
+    lalloc_init( &test_alloc );
+    lalloc_cs_reset();
+
+    TEST_ASSERT_EQUAL( 0, lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, &dropped ) );
+    TEST_ASSERT_EQUAL( 0, dropped );
+
+    lalloc_cs_reset();
+
+    for ( i = 0; i < 3; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 40 ) );
+    }
+
+    /* frees the oldest block, both engines can do it */
+    lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+
+    count = lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, &dropped );
+
+    _check_sites( count );
+
+#if LALLOC_CS_PROFILE_SITES >= 4
+    TEST_ASSERT_EQUAL( 0, dropped );
+    TEST_ASSERT_NOT_NULL( _find_site( count, "lalloc_alloc" ) );
+    TEST_ASSERT_EQUAL( 3, _find_site( count, "lalloc_alloc" )->count );
+    TEST_ASSERT_NOT_NULL( _find_site( count, "lalloc_commit" ) );
+    TEST_ASSERT_EQUAL( 3, _find_site( count, "lalloc_commit" )->count );
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+    TEST_ASSERT_EQUAL( 100, _find_site( count, "lalloc_alloc" )->max );
+    TEST_ASSERT_EQUAL( 3, _find_site( count, "lalloc_alloc" )->hist[7] );
+    TEST_ASSERT_TRUE( _find_site( count, "lalloc_alloc" )->total == 300 );
+#endif
+#else
+    /* the sites that do not fit are only counted */
+    TEST_ASSERT_EQUAL( LALLOC_CS_PROFILE_SITES, count );
+    TEST_ASSERT_TRUE( dropped > 0 );
+#endif
+
+    /* lalloc_cs_get is a critical section as well */
+    TEST_ASSERT_EQUAL( count + ( count < LALLOC_CS_PROFILE_SITES ), lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, NULL ) );
+
+    lalloc_cs_reset();
+    TEST_ASSERT_EQUAL( 0, lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, &dropped ) );
+    TEST_ASSERT_EQUAL( 0, dropped );
+}
+
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+/**
+   @brief THE HOLD TIME GOES TO THE LOG2 BIN OF ITS NUMBER OF CYCLES.
+ */
+void test_cs_bins()
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    lalloc_cs_site_t *site;
+    uint32_t count;
+
+    LALLOC_DECLARE( test_alloc, CS_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+    lalloc_cs_reset();
+
+    /* each critical section reads the counter twice, so it takes test_cycles_step */
+    test_cycles_step = 0;
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+    test_cycles_step = 1000;
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+    test_cycles_step = 0x40000000;
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+
+    count = lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, NULL );
+    _check_sites( count );
+
+    site = _find_site( count, "lalloc_alloc" );
+    TEST_ASSERT_NOT_NULL( site );
+    TEST_ASSERT_EQUAL( 3, site->count );
+    TEST_ASSERT_EQUAL( 0x40000000, site->max );
+    TEST_ASSERT_EQUAL( 1, site->hist[0] );
+    TEST_ASSERT_EQUAL( 1, site->hist[10] );     /* [512, 1024) */
+    TEST_ASSERT_EQUAL( 1, site->hist[LALLOC_PROFILE_BINS - 1] );
+}
+#endif
+
+/**
+   @brief RANDOM TRAFFIC: THE SITES STAY CONSISTENT.
+ */
+void test_cs_random()
+{
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint32_t count;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, CS_POOL_SIZE );
+
+    test_cycles_step = 7;
+
+    lalloc_init( &test_alloc );
+    lalloc_cs_reset();
+
+    for ( i = 0; i < 5000; i++ )
+    {
+        if ( uint32_random_range( 0, 9 ) < 5 )
+        {
+            lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL && size > 0 )
+            {
+                TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( 1, size < 50 ? size : 50 ) ) );
+            }
+            else
+            {
+                lalloc_alloc_revert( &test_alloc );
+            }
+        }
+        else
+        {
+            lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL )
+            {
+                TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+            }
+        }
+    }
+
+    count = lalloc_cs_get( sites, LALLOC_CS_PROFILE_SITES, NULL );
+    _check_sites( count );
+    TEST_ASSERT_TRUE( count > 0 );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_cs_sites );
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+    RUN_TEST( test_cs_bins );
+#endif
+    RUN_TEST( test_cs_random );
+    return 0;
+}
+#endif
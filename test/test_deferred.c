@@ -0,0 +1,404 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+
+#define DEFERRED_POOL_SIZE      4096
+#define DEFERRED_FRAMES         200000
+#define DEFERRED_FRAME_MAX      96
+#define DEFERRED_WORKERS        3
+#define DEFERRED_QUEUE_SIZE     16
+
+/* frames handed from the owner of the pool to one worker */
+typedef struct
+{
+    LALLOC_T *obj;
+    uint8_t *frames[DEFERRED_QUEUE_SIZE];
+    uint32_t head;          // written by the owner
+    uint32_t tail;          // written by the worker
+    uint32_t errors;
+    bool done;
+} deferred_worker_t;
+
+/**
+   @brief FREES ARE QUEUED AND THE BLOCKS ARE MOVED TO THE FREE LIST WHEN THE QUEUE IS DRAINED.
+ */
+void test_deferred_single_context()
+{
+    int i;
+    uint8_t *data[4];
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 4; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 20 ) );
+    }
+
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[2] ) );
+
+    /* out of the pool */
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, test_alloc.pool + test_alloc.size ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, test_alloc.pool ) );
+
+    /* the blocks are still allocated */
+    TEST_ASSERT_EQUAL( 4, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_NOT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->deferred );
+
+    lalloc_maintain( &test_alloc, 0 );
+
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->deferred );
+    TEST_ASSERT_EQUAL( 2, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* the two blocks were merged in a single free block */
+    lalloc_alloc( &test_alloc, ( void ** )&data[1], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, free_space - 4 * ( LALLOC_ALIGN_ROUND_UP( 20 ) + lalloc_b_overhead_size ) ) );
+    lalloc_alloc( &test_alloc, ( void ** )&data[2], &size );
+    TEST_ASSERT_EQUAL( 2 * LALLOC_ALIGN_ROUND_UP( 20 ) + lalloc_b_overhead_size, size );
+    lalloc_alloc_revert( &test_alloc );
+
+    /* the readers drain the queue as well */
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[3] ) );
+
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief A BLOCK FREED TWICE IS ONLY QUEUED ONCE, THE ADDRESSES THAT ARE NOT COMMITTED BLOCKS ARE NOT QUEUED, AND THE
+          DRAIN FINDS THE QUEUED BLOCKS WHEN A LINK IS LOST.
+ */
+void test_deferred_double_free()
+{
+    int i;
+    uint8_t *data[3];
+    uint8_t *reserved;
+    uint8_t pool_copy[500];
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 32 ) );
+    }
+
+    /* still queued */
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[1] ) );
+
+    while ( lalloc_maintain( &test_alloc, 4 ) )
+    {
+    }
+
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->deferred );
+    TEST_ASSERT_EQUAL( 2, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* already in the free list */
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[1] ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* nothing is written for an address that is not a committed block */
+    lalloc_alloc( &test_alloc, ( void ** )&reserved, &size );
+    memcpy( pool_copy, test_alloc.pool, test_alloc.size );
+
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[0] + LALLOC_ALIGNMENT ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data[2] + 2 * LALLOC_ALIGNMENT ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, reserved ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, test_alloc.pool + test_alloc.size - 1 ) );
+
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->deferred );
+    TEST_ASSERT_EQUAL_MEMORY( pool_copy, test_alloc.pool, test_alloc.size );
+
+    lalloc_alloc_revert( &test_alloc );
+
+    /* the payload of a queued block is overwritten, as a block freed twice and reused in between would be. The drain
+       cannot follow its link, the block queued before it is found in the allocated list */
+    lalloc_alloc( &test_alloc, ( void ** )&data[1], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 32 ) );
+
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[1] ) );
+    memset( data[1], 0x5A, 32 );
+
+    while ( lalloc_maintain( &test_alloc, 4 ) )
+    {
+    }
+
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->deferred );
+    TEST_ASSERT_EQUAL( 1, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+#if LALLOC_STATS == 1
+    TEST_ASSERT_EQUAL( 1, test_alloc.dyn->stats.free_failures );
+#endif
+
+    /* a committed block can be freed again */
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 32 ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[2] ) );
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+}
+
+/**
+   @brief RANDOM FREES BY ADDRESS, DRAINED BY THE ALLOCATIONS AND lalloc_maintain.
+ */
+void test_deferred_random()
+{
+    int i;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint8_t *allocated[256];
+    uint32_t count = 0;
+
+    LALLOC_DECLARE( test_alloc, 2000 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 100000; i++ )
+    {
+        switch ( uint32_random_range( 0, 4 ) )
+        {
+            case 0:
+            case 1:
+                lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+                if ( data != NULL && size >= LALLOC_MIN_PAYLOAD_SIZE && count < 256 )
+                {
+                    LALLOC_IDX_TYPE frame_size = uint32_random_range( LALLOC_MIN_PAYLOAD_SIZE, size < 100 ? size : 100 );
+
+                    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, frame_size ) );
+                    allocated[count++] = data;
+                }
+                else
+                {
+                    lalloc_alloc_revert( &test_alloc );
+                }
+                break;
+
+            case 2:
+            case 3:
+                if ( count > 0 )
+                {
+                    uint32_t k = uint32_random_range( 0, count - 1 );
+
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[k] ) );
+                    allocated[k] = allocated[--count];
+                }
+                break;
+
+            default:
+                lalloc_maintain( &test_alloc, 0 );
+                TEST_ASSERT_EQUAL( count, test_alloc.dyn->allocated_blocks );
+                break;
+        }
+
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+
+    while ( count > 0 )
+    {
+        lalloc_free( &test_alloc, allocated[--count] );
+    }
+
+    lalloc_maintain( &test_alloc, 0 );
+
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/* fills the frame with a pattern that depends on its size */
+void _deferred_fill( uint8_t *data, LALLOC_IDX_TYPE size )
+{
+    LALLOC_IDX_TYPE i;
+
+    for ( i = 0; i < size; i++ )
+    {
+        data[i] = ( uint8_t )( size + i );
+    }
+}
+
+void *_deferred_worker( void *arg )
+{
+    deferred_worker_t *ctx = ( deferred_worker_t * )arg;
+    uint32_t tail = 0;
+
+    while ( 1 )
+    {
+        if ( tail == __atomic_load_n( &ctx->head, __ATOMIC_ACQUIRE ) )
+        {
+            if ( __atomic_load_n( &ctx->done, __ATOMIC_ACQUIRE ) && tail == __atomic_load_n( &ctx->head, __ATOMIC_ACQUIRE ) )
+            {
+                break;
+            }
+
+            sched_yield();
+            continue;
+        }
+
+        uint8_t *data = ctx->frames[tail % DEFERRED_QUEUE_SIZE];
+        LALLOC_IDX_TYPE size = data[0];
+        LALLOC_IDX_TYPE i;
+
+        /* the size of the frame is in its first byte (see _deferred_fill) */
+        for ( i = 1; i < size; i++ )
+        {
+            if ( data[i] != ( uint8_t )( size + i ) )
+            {
+                ctx->errors++;
+                break;
+            }
+        }
+
+        if ( !lalloc_free( ctx->obj, data ) )
+        {
+            ctx->errors++;
+        }
+
+        __atomic_store_n( &ctx->tail, ++tail, __ATOMIC_RELEASE );
+    }
+
+    return NULL;
+}
+
+/**
+   @brief SEVERAL WORKERS FREE THE FRAMES WITHOUT LOCKS WHILE THE OWNER ALLOCATES AND DRAINS THE QUEUE.
+ */
+void test_deferred_threads()
+{
+    pthread_t threads[DEFERRED_WORKERS];
+    deferred_worker_t workers[DEFERRED_WORKERS];
+    uint32_t seq = 0;
+    int w;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, DEFERRED_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( w = 0; w < DEFERRED_WORKERS; w++ )
+    {
+        memset( &workers[w], 0, sizeof( workers[w] ) );
+        workers[w].obj = ( LALLOC_T * )&test_alloc;
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[w], NULL, _deferred_worker, &workers[w] ) );
+    }
+
+    while ( seq < DEFERRED_FRAMES )
+    {
+        deferred_worker_t *ctx = &workers[seq % DEFERRED_WORKERS];
+
+        if ( ctx->head - __atomic_load_n( &ctx->tail, __ATOMIC_ACQUIRE ) == DEFERRED_QUEUE_SIZE )
+        {
+            /* the worker is busy */
+            sched_yield();
+            continue;
+        }
+
+        /* the frame holds its size in the first byte */
+        LALLOC_IDX_TYPE frame_size = LALLOC_MIN_PAYLOAD_SIZE + 1 + ( seq * 7 ) % ( DEFERRED_FRAME_MAX - LALLOC_MIN_PAYLOAD_SIZE );
+
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+        if ( data == NULL || size < frame_size )
+        {
+            /* no room, the workers will free something */
+            lalloc_alloc_revert( &test_alloc );
+            lalloc_maintain( &test_alloc, 0 );
+            sched_yield();
+            continue;
+        }
+
+        _deferred_fill( data, frame_size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, frame_size ) );
+
+        ctx->frames[ctx->head % DEFERRED_QUEUE_SIZE] = data;
+        __atomic_store_n( &ctx->head, ctx->head + 1, __ATOMIC_RELEASE );
+        seq++;
+    }
+
+    for ( w = 0; w < DEFERRED_WORKERS; w++ )
+    {
+        __atomic_store_n( &workers[w].done, true, __ATOMIC_RELEASE );
+        pthread_join( threads[w], NULL );
+        TEST_ASSERT_EQUAL( 0, workers[w].errors );
+    }
+
+    lalloc_maintain( &test_alloc, 0 );
+
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_deferred_single_context );
+    RUN_TEST( test_deferred_double_free );
+    RUN_TEST( test_deferred_random );
+    RUN_TEST( test_deferred_threads );
+    return 0;
+}
+#endif
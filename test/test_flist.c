@@ -0,0 +1,167 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+/* size class boundaries */
+void test_tlsf_mapping()
+{
+    uint8_t fl;
+    uint8_t sl;
+
+    /* linear classes */
+    _tlsf_mapping( 0, &fl, &sl );
+    TEST_ASSERT_EQUAL( 0, fl );
+    TEST_ASSERT_EQUAL( 0, sl );
+
+    _tlsf_mapping( LALLOC_TLSF_SL_COUNT - 1, &fl, &sl );
+    TEST_ASSERT_EQUAL( 0, fl );
+    TEST_ASSERT_EQUAL( LALLOC_TLSF_SL_COUNT - 1, sl );
+
+    /* first power of two range */
+    _tlsf_mapping( LALLOC_TLSF_SL_COUNT, &fl, &sl );
+    TEST_ASSERT_EQUAL( 1, fl );
+    TEST_ASSERT_EQUAL( 0, sl );
+
+    _tlsf_mapping( 2 * LALLOC_TLSF_SL_COUNT - 1, &fl, &sl );
+    TEST_ASSERT_EQUAL( 1, fl );
+    TEST_ASSERT_EQUAL( LALLOC_TLSF_SL_COUNT - 1, sl );
+
+    _tlsf_mapping( 2 * LALLOC_TLSF_SL_COUNT, &fl, &sl );
+    TEST_ASSERT_EQUAL( 2, fl );
+    TEST_ASSERT_EQUAL( 0, sl );
+
+    /* the biggest size must fit in the index */
+    _tlsf_mapping( LALLOC_IDX_INVALID, &fl, &sl );
+    TEST_ASSERT_EQUAL( LALLOC_TLSF_FL_COUNT - 1, fl );
+    TEST_ASSERT_EQUAL( LALLOC_TLSF_SL_COUNT - 1, sl );
+}
+#endif
+
+/* free blocks of different sizes: flist must point to the largest and the iteration must visit all of them */
+void test_flist_largest()
+{
+    const LALLOC_IDX_TYPE sizes[] = { 4, 40, 8, 100, 12, 24, 16, 60, 4 };
+    const int count = sizeof( sizes ) / sizeof( sizes[0] );
+    uint8_t *addr[count];
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE pool_size = 0;
+    int i;
+
+    for ( i = 0; i < count; i++ )
+    {
+        pool_size += LALLOC_ALIGN_ROUND_UP( sizes[i] ) + LALLOC_BLOCK_HEADER_SIZE;
+    }
+
+    LALLOC_DECLARE( test_alloc, pool_size );
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < count; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&addr[i], &size );
+        TEST_ASSERT_NOT_NULL( addr[i] );
+        TEST_ASSERT_TRUE( lalloc_commit( &test_alloc, sizes[i] ) );
+    }
+
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, test_alloc.dyn->flist );
+    TEST_ASSERT_EQUAL( 0, lalloc_get_free_space( &test_alloc ) );
+
+    /* free the odd ones, so they can't be joined */
+    LALLOC_IDX_TYPE free_sum = 0;
+    LALLOC_IDX_TYPE free_count = 0;
+
+    for ( i = 1; i < count; i += 2 )
+    {
+        TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addr[i] ) );
+        TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+        free_sum += LALLOC_ALIGN_ROUND_UP( sizes[i] );
+        free_count++;
+    }
+
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 100 ), lalloc_get_free_space( &test_alloc ) );
+
+    /* walk the whole index */
+    LALLOC_IDX_TYPE block = test_alloc.dyn->flist;
+    LALLOC_IDX_TYPE sum = 0;
+    LALLOC_IDX_TYPE n = 0;
+
+    while ( block != LALLOC_IDX_INVALID )
+    {
+        sum += _block_get_size( test_alloc.pool, block );
+        n++;
+        block = _flist_next( &test_alloc, block );
+    }
+
+    TEST_ASSERT_EQUAL( free_count, n );
+    TEST_ASSERT_EQUAL( free_sum, sum );
+
+    /* taking the largest one leaves the next one as the largest */
+    lalloc_alloc( &test_alloc, ( void ** )&addr[3], &size );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 100 ), size );
+    TEST_ASSERT_TRUE( lalloc_commit( &test_alloc, size ) );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 60 ), lalloc_get_free_space( &test_alloc ) );
+
+    /* everything is freed, just one block must remain */
+    for ( i = 0; i < count; i += 2 )
+    {
+        TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addr[i] ) );
+        TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+    }
+
+    TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addr[3] ) );
+    TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->flist );
+    TEST_ASSERT_EQUAL( LALLOC_IDX_INVALID, _flist_next( &test_alloc, test_alloc.dyn->flist ) );
+    TEST_ASSERT_EQUAL( test_alloc.size - lalloc_b_overhead_size, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    RUN_TEST( test_tlsf_mapping );
+#endif
+    RUN_TEST( test_flist_largest );
+    return 0;
+}
+#endif
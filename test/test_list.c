@@ -303,6 +303,68 @@ void test_list_join()
 }
 #endif
 
+#if LALLOC_FREE_ANY == 1
+/* frees blocks by addresses within their payloads */
+void test_list_free_any()
+{
+    const int blocks = 8;
+    const LALLOC_IDX_TYPE data_size = 24;
+    uint8_t *addreses[blocks];
+    uint8_t *addr;
+    LALLOC_IDX_TYPE size;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, blocks * ( lalloc_b_overhead_size + data_size ) + 40 );
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < blocks; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&addr, &size );
+        TEST_ASSERT_TRUE( lalloc_commit( &test_alloc, data_size ) );
+        addreses[i] = addr;
+    }
+
+    TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+
+    /* the remaining space is reserved, it can't be freed */
+    lalloc_alloc( &test_alloc, ( void ** )&addr, &size );
+    TEST_ASSERT_NOT_NULL( addr );
+    TEST_ASSERT_FALSE( lalloc_free( &test_alloc, addr + 1 ) );
+    lalloc_alloc_revert( &test_alloc );
+
+    /* the last byte of the payload */
+    TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addreses[1] + data_size - 1 ) );
+    TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+
+    /* the block is free now */
+    TEST_ASSERT_FALSE( lalloc_free( &test_alloc, addreses[1] ) );
+
+    /* the middle of the payload, joined with the previous free block */
+    TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addreses[2] + data_size / 2 ) );
+    TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+
+    /* the first byte */
+    TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addreses[5] ) );
+    TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+
+    TEST_ASSERT_EQUAL( blocks - 3, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* the rest of them, from the end */
+    for ( i = blocks - 1; i >= 0; i-- )
+    {
+        if ( i != 1 && i != 2 && i != 5 )
+        {
+            TEST_ASSERT_TRUE( lalloc_free( &test_alloc, addreses[i] + i ) );
+            TEST_ASSERT_TRUE( lalloc_sanity_check( &test_alloc ) );
+        }
+    }
+
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( test_alloc.size - lalloc_b_overhead_size, lalloc_get_free_space( &test_alloc ) );
+}
+#endif
+
 /*
 TODO:
 test _block_list_find_by_ref
@@ -316,6 +378,9 @@ int main()
     RUN_TEST( test_list_related_2 );
     RUN_TEST( test_list_related_3 );
     RUN_TEST( test_list_join );
+#if LALLOC_FREE_ANY == 1
+    RUN_TEST( test_list_free_any );
+#endif
     return 0;
 }
 #endif
@@ -0,0 +1,272 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <string.h>
+#include <pthread.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+
+#define MUTEX_THREADS           4
+#define MUTEX_POOL_SIZE         2000
+#define MUTEX_ROUNDS            20000
+#define MUTEX_LIVE              8
+#define MUTEX_FRAME_MAX         60
+
+typedef struct
+{
+    LALLOC_T        *obj;           // Instance of the worker, or the shared one.
+    uint8_t         id;
+    uint32_t        errors;
+} mutex_worker_t;
+
+/* the whole frame, up to the alignment, is filled with a tag, so an overlapped frame is detected */
+static void _mutex_fill( uint8_t *data, LALLOC_IDX_TYPE size, uint8_t tag )
+{
+    memset( data, tag, LALLOC_ALIGN_ROUND_UP( size ) );
+}
+
+static bool _mutex_check( const uint8_t *data, LALLOC_IDX_TYPE size )
+{
+    LALLOC_IDX_TYPE i;
+
+    for ( i = 1; i < size; i++ )
+    {
+        if ( data[i] != data[0] )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* FIFO traffic on an instance owned by the worker */
+static void *_mutex_own_worker( void *arg )
+{
+    mutex_worker_t *ctx = ( mutex_worker_t * )arg;
+    LALLOC_IDX_TYPE sizes[MUTEX_LIVE];      // Frame sizes in commit order, a block may be longer than its frame.
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t i;
+
+    for ( i = 0; i < MUTEX_ROUNDS; i++ )
+    {
+        LALLOC_IDX_TYPE frame_size = 1 + ( i * 13 + ctx->id ) % MUTEX_FRAME_MAX;
+        LALLOC_IDX_TYPE size;
+        uint8_t *data;
+
+        lalloc_alloc( ctx->obj, ( void ** )&data, &size );
+
+        if ( count < MUTEX_LIVE && data != NULL && size >= frame_size )
+        {
+            _mutex_fill( data, frame_size, ( uint8_t )i );
+            ctx->errors += !lalloc_commit( ctx->obj, frame_size );
+            sizes[( first + count ) % MUTEX_LIVE] = frame_size;
+            count++;
+            continue;
+        }
+
+        lalloc_alloc_revert( ctx->obj );
+
+        if ( count > 0 )
+        {
+            lalloc_get_first( ctx->obj, ( void ** )&data, &size );
+            ctx->errors += ( data == NULL || size < sizes[first] || !_mutex_check( data, sizes[first] ) );
+            ctx->errors += !lalloc_free( ctx->obj, data );
+            first = ( first + 1 ) % MUTEX_LIVE;
+            count--;
+        }
+    }
+
+    while ( count-- > 0 )
+    {
+        LALLOC_IDX_TYPE size;
+        uint8_t *data;
+
+        lalloc_get_first( ctx->obj, ( void ** )&data, &size );
+        ctx->errors += !lalloc_free( ctx->obj, data );
+    }
+
+    return NULL;
+}
+
+/* reservations and frees by address on the shared instance */
+static void *_mutex_shared_worker( void *arg )
+{
+    mutex_worker_t *ctx = ( mutex_worker_t * )arg;
+    uint8_t *live[MUTEX_LIVE];
+    LALLOC_IDX_TYPE sizes[MUTEX_LIVE];
+    uint32_t count = 0;
+    uint32_t i;
+
+    for ( i = 0; i < MUTEX_ROUNDS; i++ )
+    {
+        LALLOC_IDX_TYPE frame_size = 1 + ( i * 7 + ctx->id ) % MUTEX_FRAME_MAX;
+        lalloc_handle_t h;
+
+        if ( count < MUTEX_LIVE && ( i % 3 ) != 2 && lalloc_reserve( ctx->obj, frame_size, &h ) )
+        {
+            if ( h.size >= frame_size )
+            {
+                live[count] = h.addr;
+                sizes[count] = frame_size;
+                _mutex_fill( live[count], frame_size, ( uint8_t )( ctx->id + i ) );
+                ctx->errors += !lalloc_commit_h( ctx->obj, &h, frame_size );
+                count++;
+            }
+            else
+            {
+                lalloc_revert_h( ctx->obj, &h );
+            }
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = i % count;
+
+            ctx->errors += !_mutex_check( live[k], sizes[k] );
+            ctx->errors += !lalloc_free( ctx->obj, live[k] );
+
+            count--;
+            live[k] = live[count];
+            sizes[k] = sizes[count];
+        }
+    }
+
+    while ( count > 0 )
+    {
+        count--;
+        ctx->errors += !_mutex_check( live[count], sizes[count] );
+        ctx->errors += !lalloc_free( ctx->obj, live[count] );
+    }
+
+    return NULL;
+}
+
+/**
+   @brief EACH THREAD WORKS ON ITS OWN INSTANCE, BUILT WITH lalloc_ctor, WHICH INITIALIZES ITS MUTEX.
+ */
+void test_mutex_own_instances()
+{
+    pthread_t threads[MUTEX_THREADS];
+    mutex_worker_t workers[MUTEX_THREADS];
+    LALLOC_IDX_TYPE free_space;
+    int w;
+
+    for ( w = 0; w < MUTEX_THREADS; w++ )
+    {
+        workers[w].obj = lalloc_ctor( MUTEX_POOL_SIZE );
+        workers[w].id = ( uint8_t )w;
+        workers[w].errors = 0;
+
+        TEST_ASSERT_NOT_NULL( workers[w].obj );
+    }
+
+    free_space = lalloc_get_free_space( workers[0].obj );
+
+    for ( w = 0; w < MUTEX_THREADS; w++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[w], NULL, _mutex_own_worker, &workers[w] ) );
+    }
+
+    for ( w = 0; w < MUTEX_THREADS; w++ )
+    {
+        pthread_join( threads[w], NULL );
+
+        TEST_ASSERT_EQUAL( 0, workers[w].errors );
+
+        while ( lalloc_maintain( workers[w].obj, 4 ) )
+        {
+        }
+
+        TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( workers[w].obj ) );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( workers[w].obj ) );
+        TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( workers[w].obj ) );
+
+        lalloc_dtor( ( void * )workers[w].obj );
+    }
+}
+
+/**
+   @brief THE THREADS SHARE ONE INSTANCE, ITS MUTEX KEEPS THE LISTS CONSISTENT AND THE FRAMES APART.
+ */
+void test_mutex_shared_instance()
+{
+    pthread_t threads[MUTEX_THREADS];
+    mutex_worker_t workers[MUTEX_THREADS];
+    LALLOC_IDX_TYPE free_space;
+    int w;
+
+    LALLOC_DECLARE( test_alloc, MUTEX_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( w = 0; w < MUTEX_THREADS; w++ )
+    {
+        workers[w].obj = ( LALLOC_T * )&test_alloc;
+        workers[w].id = ( uint8_t )( w * 64 );
+        workers[w].errors = 0;
+
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[w], NULL, _mutex_shared_worker, &workers[w] ) );
+    }
+
+    for ( w = 0; w < MUTEX_THREADS; w++ )
+    {
+        pthread_join( threads[w], NULL );
+
+        TEST_ASSERT_EQUAL( 0, workers[w].errors );
+    }
+
+    while ( lalloc_maintain( &test_alloc, 4 ) )
+    {
+    }
+
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+
+    lalloc_deinit( &test_alloc );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_mutex_own_instances );
+    RUN_TEST( test_mutex_shared_instance );
+    return 0;
+}
+#endif
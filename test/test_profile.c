@@ -0,0 +1,312 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+extern uint32_t test_cycles_step;
+
+#define PROFILE_POOL_SIZE       1000
+
+/* operations reported by lalloc_profile_dump */
+static uint32_t dump_counts[LALLOC_OP_COUNT];
+static uint32_t dump_calls;
+
+static void _dump_cb( const char *name, const lalloc_profile_op_t *op )
+{
+    static const char *const names[LALLOC_OP_COUNT] =
+    {
+        "lalloc_alloc", "lalloc_alloc_max", "lalloc_alloc_revert", "lalloc_commit", "lalloc_commit_and_alloc",
+        "lalloc_reserve", "lalloc_commit_h", "lalloc_revert_h", "lalloc_free", "lalloc_free_first",
+        "lalloc_free_last", "lalloc_free_batch", "lalloc_free_first_n", "lalloc_maintain", "lalloc_compact_step"
+    };
+    uint8_t i;
+
+    for ( i = 0; i < LALLOC_OP_COUNT; i++ )
+    {
+        if ( strcmp( name, names[i] ) == 0 )
+        {
+            dump_counts[i] = op->count;
+        }
+    }
+
+    dump_calls++;
+}
+
+/**
+   @brief the histogram of an operation must be consistent with its counters.
+ */
+void _check_op( LALLOC_T *obj, uint8_t op_id, uint32_t count )
+{
+    lalloc_profile_op_t op;
+    uint32_t sum = 0;
+    uint32_t last_bin = 0;
+    uint8_t i;
+
+    lalloc_profile_get( obj, op_id, &op );
+
+    TEST_ASSERT_EQUAL( count, op.count );
+
+    for ( i = 0; i < LALLOC_PROFILE_BINS; i++ )
+    {
+        sum += op.hist[i];
+        last_bin = ( op.hist[i] != 0 ) ? i : last_bin;
+    }
+
+    TEST_ASSERT_EQUAL( count, sum );
+    TEST_ASSERT_TRUE( op.total >= op.max );
+
+    /* the longest call is in the last bin used */
+    if ( count > 0 && last_bin < LALLOC_PROFILE_BINS - 1 )
+    {
+        TEST_ASSERT_EQUAL( last_bin, ( op.max == 0 ) ? 0 : LALLOC_FLS( op.max ) + 1 );
+    }
+}
+
+/**
+   @brief EVERY CALL IS COUNTED ONCE IN THE HISTOGRAM OF ITS OPERATION.
+ */
+void test_profile_counts()
+{
+    uint8_t *data[4];
+    LALLOC_IDX_TYPE size;
+    lalloc_handle_t h;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, PROFILE_POOL_SIZE );
+
+    test_cycles_step = 100;
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < LALLOC_OP_COUNT; i++ )
+    {
+        _check_op( &test_alloc, i, 0 );
+    }
+
+    for ( i = 0; i < 4; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 40 ) );
+    }
+
+    lalloc_alloc_max( &test_alloc, ( void ** )&data[0], &size, 40 );
+    lalloc_alloc_revert( &test_alloc );
+
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 40, &h ) );
+    lalloc_revert_h( &test_alloc, &h );
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 40, &h ) );
+    TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h, 40 ) );
+
+    /* a failed call is timed as well */
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, 40 ) );
+
+    lalloc_get_n( &test_alloc, ( void ** )&data[0], &size, 0 );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    lalloc_get_n( &test_alloc, ( void ** )&data[0], &size, 0 );
+    lalloc_get_n( &test_alloc, ( void ** )&data[1], &size, 1 );
+    TEST_ASSERT_EQUAL( 2, lalloc_free_batch( &test_alloc, ( void ** )data, 2 ) );
+    lalloc_maintain( &test_alloc, 4 );
+
+    _check_op( &test_alloc, LALLOC_OP_ALLOC, 4 );
+    _check_op( &test_alloc, LALLOC_OP_COMMIT, 5 );
+    _check_op( &test_alloc, LALLOC_OP_ALLOC_MAX, 1 );
+    _check_op( &test_alloc, LALLOC_OP_ALLOC_REVERT, 1 );
+    _check_op( &test_alloc, LALLOC_OP_RESERVE, 2 );
+    _check_op( &test_alloc, LALLOC_OP_REVERT_H, 1 );
+    _check_op( &test_alloc, LALLOC_OP_COMMIT_H, 1 );
+    _check_op( &test_alloc, LALLOC_OP_FREE, 1 );
+    _check_op( &test_alloc, LALLOC_OP_FREE_BATCH, 1 );
+    _check_op( &test_alloc, LALLOC_OP_MAINTAIN, 1 );
+    _check_op( &test_alloc, LALLOC_OP_COMMIT_AND_ALLOC, 0 );
+
+#if LALLOC_ALLOW_QUEUED_FREES == 1
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, 40, ( void ** )&data[0], &size ) );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 40 ) );
+
+    TEST_ASSERT_EQUAL( true, lalloc_free_first( &test_alloc ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free_last( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 2, lalloc_free_first_n( &test_alloc, 2 ) );
+
+    _check_op( &test_alloc, LALLOC_OP_COMMIT_AND_ALLOC, 1 );
+    _check_op( &test_alloc, LALLOC_OP_FREE_FIRST, 1 );
+    _check_op( &test_alloc, LALLOC_OP_FREE_LAST, 1 );
+    _check_op( &test_alloc, LALLOC_OP_FREE_FIRST_N, 1 );
+#endif
+
+#if LALLOC_COMPACTION == 1
+    lalloc_compact_step( &test_alloc, 100, NULL );
+    _check_op( &test_alloc, LALLOC_OP_COMPACT_STEP, 1 );
+#endif
+
+    /* lalloc_init clears the histograms */
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < LALLOC_OP_COUNT; i++ )
+    {
+        _check_op( &test_alloc, i, 0 );
+    }
+}
+
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+/**
+   @brief THE LATENCY GOES TO THE LOG2 BIN OF ITS NUMBER OF CYCLES.
+ */
+void test_profile_bins()
+{
+    lalloc_profile_op_t op;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, PROFILE_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    /* each call reads the counter twice, so it takes test_cycles_step */
+    test_cycles_step = 0;
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    test_cycles_step = 100;
+    lalloc_alloc_revert( &test_alloc );
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    test_cycles_step = 128;
+    lalloc_alloc_revert( &test_alloc );
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    test_cycles_step = 0x40000000;
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+    lalloc_profile_get( &test_alloc, LALLOC_OP_ALLOC, &op );
+    TEST_ASSERT_EQUAL( 4, op.count );
+    TEST_ASSERT_EQUAL( 0x40000000, op.max );
+    TEST_ASSERT_TRUE( op.total == 100 + 128 + 0x40000000ULL );
+    TEST_ASSERT_EQUAL( 1, op.hist[0] );
+    TEST_ASSERT_EQUAL( 1, op.hist[7] );         /* [64, 128) */
+    TEST_ASSERT_EQUAL( 1, op.hist[8] );         /* [128, 256) */
+    TEST_ASSERT_EQUAL( 1, op.hist[LALLOC_PROFILE_BINS - 1] );
+
+    lalloc_profile_get( &test_alloc, LALLOC_OP_ALLOC_REVERT, &op );
+    TEST_ASSERT_EQUAL( 2, op.count );
+    TEST_ASSERT_EQUAL( 128, op.max );
+    TEST_ASSERT_EQUAL( 1, op.hist[7] );
+    TEST_ASSERT_EQUAL( 1, op.hist[8] );
+
+    /* an unknown operation reads as never called */
+    lalloc_profile_get( &test_alloc, LALLOC_OP_COUNT, &op );
+    TEST_ASSERT_EQUAL( 0, op.count );
+}
+#endif
+
+/**
+   @brief lalloc_profile_dump REPORTS THE OPERATIONS THAT WERE CALLED, lalloc_profile_reset CLEARS THEM.
+ */
+void test_profile_dump()
+{
+    uint8_t *allocated[64];
+    uint32_t count = 0;
+    uint32_t called = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, PROFILE_POOL_SIZE );
+
+    test_cycles_step = 10;
+
+    lalloc_init( &test_alloc );
+
+    for ( i = 0; i < 5000; i++ )
+    {
+        if ( count < 64 && uint32_random_range( 0, 9 ) < 5 )
+        {
+            lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL && size > 0 )
+            {
+                TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( 1, size < 50 ? size : 50 ) ) );
+                allocated[count++] = data;
+            }
+            else
+            {
+                lalloc_alloc_revert( &test_alloc );
+            }
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = uint32_random_range( 0, count - 1 );
+
+            TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[k] ) );
+            allocated[k] = allocated[--count];
+        }
+    }
+
+    memset( dump_counts, 0, sizeof( dump_counts ) );
+    dump_calls = 0;
+
+    lalloc_profile_dump( &test_alloc, _dump_cb );
+
+    /* only the operations that were called are reported */
+    for ( i = 0; i < LALLOC_OP_COUNT; i++ )
+    {
+        _check_op( &test_alloc, i, dump_counts[i] );
+        called += ( dump_counts[i] > 0 );
+    }
+
+    TEST_ASSERT_EQUAL( called, dump_calls );
+    TEST_ASSERT_TRUE( dump_counts[LALLOC_OP_ALLOC] > 0 );
+    TEST_ASSERT_TRUE( dump_counts[LALLOC_OP_FREE] > 0 );
+    TEST_ASSERT_EQUAL( dump_counts[LALLOC_OP_ALLOC], dump_counts[LALLOC_OP_COMMIT] + dump_counts[LALLOC_OP_ALLOC_REVERT] );
+
+    lalloc_profile_reset( &test_alloc );
+
+    dump_calls = 0;
+    lalloc_profile_dump( &test_alloc, _dump_cb );
+    TEST_ASSERT_EQUAL( 0, dump_calls );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_profile_counts );
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+    RUN_TEST( test_profile_bins );
+#endif
+    RUN_TEST( test_profile_dump );
+    return 0;
+}
+#endif
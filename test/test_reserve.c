@@ -0,0 +1,478 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+
+#define PRODUCERS       4
+
+/**
+   @brief SEVERAL RESERVATIONS AT THE SAME TIME, EACH ONE CAPPED TO ITS MAXIMUM. THE COMMITTED BLOCKS ARE QUEUED
+          IN COMMIT ORDER AND THE POOL IS WHOLE AGAIN AFTER FREEING THEM.
+ */
+void test_reserve_several()
+{
+    int i;
+    lalloc_handle_t h[PRODUCERS];
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 400 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < PRODUCERS; i++ )
+    {
+        TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 40, &h[i] ) );
+        TEST_ASSERT_NOT_NULL( h[i].addr );
+        TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 40 ), h[i].size );
+        memset( h[i].addr, i, h[i].size );
+    }
+
+    /* the rest of the pool is still available */
+    TEST_ASSERT_EQUAL( free_space - PRODUCERS * ( LALLOC_ALIGN_ROUND_UP( 40 ) + lalloc_b_overhead_size ), lalloc_get_free_space( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* the reserved areas are not allocated elements yet */
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 0, lalloc_dest_belongs( &test_alloc, h[0].addr ) );
+    TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, h[0].addr ) );
+
+    /* commits in reverse order, with smaller sizes */
+    for ( i = PRODUCERS - 1; i >= 0; i-- )
+    {
+        TEST_ASSERT_EQUAL( false, lalloc_commit_h( &test_alloc, &h[i], h[i].size + LALLOC_ALIGNMENT ) );
+        TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h[i], 10 + i ) );
+        TEST_ASSERT_NULL( h[i].addr );
+        TEST_ASSERT_EQUAL( false, lalloc_commit_h( &test_alloc, &h[i], 10 ) );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+
+    for ( i = 0; i < PRODUCERS; i++ )
+    {
+        lalloc_get_n( &test_alloc, ( void ** )&data, &size, i );
+        TEST_ASSERT_EQUAL( PRODUCERS - 1 - i, data[0] );
+        TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 10 + PRODUCERS - 1 - i ), size );
+    }
+
+    while ( lalloc_get_alloc_count( &test_alloc ) > 0 )
+    {
+        lalloc_get_n( &test_alloc, ( void ** )&data, &size, 0 );
+        TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief RESERVATIONS LIVE ALONG WITH THE lalloc_alloc ONE, AND THEY CAN BE REVERTED.
+ */
+void test_reserve_with_alloc()
+{
+    lalloc_handle_t h;
+    lalloc_handle_t h2;
+    uint8_t *data;
+    uint8_t *data2;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE size2;
+
+    LALLOC_DECLARE( test_alloc, 300 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    /* two free blocks */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_commit( &test_alloc, 50 );
+    lalloc_alloc( &test_alloc, ( void ** )&data2, &size );
+    lalloc_commit( &test_alloc, 50 );
+    lalloc_free( &test_alloc, data );
+
+    /* the pending lalloc_alloc block is not taken by lalloc_reserve */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 1000, &h ) );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 50 ), h.size );
+    TEST_ASSERT( ( uint8_t * )h.addr + h.size <= data || ( uint8_t * )h.addr >= data + size );
+
+    /* nothing else is left */
+    TEST_ASSERT_EQUAL( false, lalloc_reserve( &test_alloc, 10, &h2 ) );
+    TEST_ASSERT_NULL( h2.addr );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 20 ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    lalloc_revert_h( &test_alloc, &h );
+    TEST_ASSERT_NULL( h.addr );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* reverting twice does nothing */
+    lalloc_revert_h( &test_alloc, &h );
+    TEST_ASSERT_EQUAL( 2, lalloc_get_alloc_count( &test_alloc ) );
+
+    lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+    lalloc_free( &test_alloc, data );
+    lalloc_get_first( &test_alloc, ( void ** )&data, &size2 );
+    lalloc_free( &test_alloc, data );
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief RANDOM TRAFFIC OF SEVERAL PRODUCERS WITH THEIR OWN RESERVATION, AND ONE CONSUMER.
+ */
+void test_reserve_random()
+{
+    int i;
+    int p;
+    lalloc_handle_t h[PRODUCERS];
+    uint8_t tag[PRODUCERS] = {0};
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 3000 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( p = 0; p < PRODUCERS; p++ )
+    {
+        h[p].block = LALLOC_IDX_INVALID;
+        h[p].addr = NULL;
+    }
+
+    for ( i = 0; i < 50000; i++ )
+    {
+        p = uint32_random_range( 0, PRODUCERS );
+
+        if ( p == PRODUCERS )
+        {
+            /* the consumer */
+            lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+
+            if ( data != NULL )
+            {
+                /* the frame holds the producer and its tag in the first and last bytes */
+                TEST_ASSERT_EQUAL( data[0], data[size - 1] );
+                TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+            }
+        }
+        else if ( h[p].addr == NULL )
+        {
+            lalloc_reserve( &test_alloc, uint32_random_range( 1, 200 ), &h[p] );
+        }
+        else
+        {
+            LALLOC_IDX_TYPE frame_size = LALLOC_ALIGN_ROUND_UP( uint32_random_range( 1, h[p].size ) );
+
+            if ( frame_size > h[p].size || uint32_random_range( 0, 9 ) == 0 )
+            {
+                lalloc_revert_h( &test_alloc, &h[p] );
+            }
+            else
+            {
+                data = h[p].addr;
+                data[0] = ( uint8_t )( p << 6 | ( tag[p]++ & 0x3F ) );
+                data[frame_size - 1] = data[0];
+
+                TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h[p], frame_size ) );
+                lalloc_get_last( &test_alloc, ( void ** )&data, &size );
+                TEST_ASSERT( size >= frame_size );
+
+                /* the last byte of the block, in case it was not splitted */
+                data[size - 1] = data[0];
+            }
+        }
+
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+
+    for ( p = 0; p < PRODUCERS; p++ )
+    {
+        lalloc_revert_h( &test_alloc, &h[p] );
+    }
+
+    while ( lalloc_get_alloc_count( &test_alloc ) > 0 )
+    {
+        lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+        lalloc_free( &test_alloc, data );
+    }
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief lalloc_alloc_max ONLY KEEPS THE REQUESTED SIZE, THE REST OF THE BLOCK IS AVAILABLE WHILE THE AREA IS FILLED.
+ */
+void test_alloc_max()
+{
+    lalloc_handle_t h;
+    uint8_t *data;
+    uint8_t *data2;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE size2;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, 100 );
+    TEST_ASSERT_NOT_NULL( data );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 100 ), size );
+    TEST_ASSERT_EQUAL( free_space - size - lalloc_b_overhead_size, lalloc_get_free_space( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    /* the rest of the pool can be reserved by others */
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 1000, &h ) );
+    TEST_ASSERT_EQUAL( free_space - size - lalloc_b_overhead_size, h.size );
+    lalloc_revert_h( &test_alloc, &h );
+
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, size + LALLOC_ALIGNMENT ) );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 30 ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+    lalloc_get_first( &test_alloc, ( void ** )&data2, &size2 );
+    TEST_ASSERT_EQUAL_PTR( data, data2 );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 30 ), size2 );
+
+    LALLOC_IDX_TYPE free_space2 = lalloc_get_free_space( &test_alloc );
+
+    /* a reverted reservation is joined again with the rest of the block */
+    lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, 100 );
+    lalloc_alloc_revert( &test_alloc );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space2, lalloc_get_free_space( &test_alloc ) );
+
+    /* a cap bigger than the largest block */
+    lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, 1000 );
+    TEST_ASSERT_EQUAL( free_space2, size );
+    lalloc_alloc_revert( &test_alloc );
+
+    lalloc_free( &test_alloc, data2 );
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief RANDOM CAPPED RESERVATIONS, COMMITS, REVERTS AND FREES.
+ */
+void test_alloc_max_random()
+{
+    int i;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, 2000 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    for ( i = 0; i < 50000; i++ )
+    {
+        switch ( uint32_random_range( 0, 3 ) )
+        {
+            case 0:
+            case 1:
+                lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, uint32_random_range( 1, 150 ) );
+
+                if ( data != NULL )
+                {
+                    if ( size == 0 || uint32_random_range( 0, 3 ) == 0 )
+                    {
+                        lalloc_alloc_revert( &test_alloc );
+                    }
+                    else
+                    {
+                        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( 1, size ) ) );
+                    }
+                }
+                break;
+
+            case 2:
+                lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+
+                if ( data != NULL )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+                }
+                break;
+
+            default:
+                lalloc_get_last( &test_alloc, ( void ** )&data, &size );
+
+                if ( data != NULL )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+                }
+                break;
+        }
+
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+
+    while ( lalloc_get_alloc_count( &test_alloc ) > 0 )
+    {
+        lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+        lalloc_free( &test_alloc, data );
+    }
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief BACK TO BACK FRAMES WITH lalloc_commit_and_alloc: EACH NEW RESERVATION IS THE REST OF THE PREVIOUS ONE.
+ */
+void test_commit_and_alloc()
+{
+    int i;
+    uint8_t *data;
+    uint8_t *next;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE len;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    /* nothing to commit */
+    TEST_ASSERT_EQUAL( false, lalloc_commit_and_alloc( &test_alloc, 10, ( void ** )&next, &len ) );
+    TEST_ASSERT_NULL( next );
+    TEST_ASSERT_EQUAL( 0, len );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+    /* too big, the reservation is kept */
+    TEST_ASSERT_EQUAL( false, lalloc_commit_and_alloc( &test_alloc, size + LALLOC_ALIGNMENT, ( void ** )&next, &len ) );
+    TEST_ASSERT_NULL( next );
+
+    for ( i = 0; data != NULL && size >= LALLOC_ALIGN_ROUND_UP( 10 ); i++ )
+    {
+        data[0] = ( uint8_t )i;
+
+        TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, 10, ( void ** )&next, &len ) );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+
+        if ( next != NULL )
+        {
+            /* the frames are contiguous */
+            TEST_ASSERT_EQUAL_PTR( data + LALLOC_ALIGN_ROUND_UP( 10 ) + lalloc_b_overhead_size, next );
+            TEST_ASSERT_EQUAL( size - LALLOC_ALIGN_ROUND_UP( 10 ) - lalloc_b_overhead_size, len );
+        }
+
+        data = next;
+        size = len;
+    }
+
+    TEST_ASSERT_EQUAL( i, lalloc_get_alloc_count( &test_alloc ) );
+    lalloc_alloc_revert( &test_alloc );
+
+    for ( i = 0; lalloc_get_alloc_count( &test_alloc ) > 0; i++ )
+    {
+        lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL( ( uint8_t )i, data[0] );
+        lalloc_free( &test_alloc, data );
+    }
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief lalloc_commit_and_alloc FALLS BACK TO THE LARGEST BLOCK WHEN THE COMMITTED BLOCK IS NOT SPLITTED.
+ */
+void test_commit_and_alloc_whole_block()
+{
+    uint8_t *data;
+    uint8_t *data2;
+    uint8_t *next;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE len;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    /* a small free block at the beginning of the pool */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_commit( &test_alloc, 40 );
+    lalloc_alloc( &test_alloc, ( void ** )&data2, &size );
+    lalloc_commit( &test_alloc, 40 );
+    lalloc_free( &test_alloc, data );
+
+    /* the whole last block is committed */
+    lalloc_alloc( &test_alloc, ( void ** )&next, &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, size, ( void ** )&next, &len ) );
+    TEST_ASSERT_EQUAL_PTR( data, next );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( 40 ), len );
+
+    /* the whole first block, nothing is left */
+    TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, len, ( void ** )&next, &len ) );
+    TEST_ASSERT_NULL( next );
+    TEST_ASSERT_EQUAL( 3, lalloc_get_alloc_count( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 0, lalloc_get_free_space( &test_alloc ) );
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_reserve_several );
+    RUN_TEST( test_reserve_with_alloc );
+    RUN_TEST( test_reserve_random );
+    RUN_TEST( test_alloc_max );
+    RUN_TEST( test_alloc_max_random );
+    RUN_TEST( test_commit_and_alloc );
+    RUN_TEST( test_commit_and_alloc_whole_block );
+    return 0;
+}
+#endif
@@ -0,0 +1,288 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#ifdef TEST_MUTEX
+#include <pthread.h>
+#endif
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+
+#define SEQ_POOL_SIZE           1000
+#define SEQ_ROUNDS              20000
+#define SEQ_LIVE                16
+#define SEQ_FRAME_MAX           60
+#define SEQ_READERS             3
+
+/* the published state agrees with itself */
+static bool _seq_status_check( const lalloc_status_t *status )
+{
+    return status->alloc_count == status->stats.used_blocks &&
+           status->free_space <= status->stats.free_bytes &&
+           ( status->free_space == 0 ) == ( status->stats.free_blocks == 0 );
+}
+
+/**
+   @brief EVERY CALL THAT CHANGES THE INSTANCE PUBLISHES ITS STATE, THE READERS GET THE STATE LEFT BY THE LAST ONE.
+ */
+void test_seqlock_status()
+{
+    lalloc_status_t status;
+    uint32_t count = 0;
+    uint32_t i;
+
+    LALLOC_DECLARE( test_alloc, SEQ_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    lalloc_get_status( &test_alloc, &status );
+
+    TEST_ASSERT_EQUAL( 0, status.alloc_count );
+    TEST_ASSERT_EQUAL( LALLOC_ALIGN_ROUND_UP( test_alloc.size - LALLOC_BLOCK_HEADER_SIZE ), status.free_space );
+    TEST_ASSERT_EQUAL( status.free_space, lalloc_get_free_space( &test_alloc ) );
+    TEST_ASSERT_TRUE( lalloc_is_empty( &test_alloc ) );
+    TEST_ASSERT_FALSE( lalloc_is_full( &test_alloc ) );
+
+    for ( i = 0; i < SEQ_ROUNDS; i++ )
+    {
+        LALLOC_IDX_TYPE size;
+        uint8_t *data;
+
+        lalloc_get_status( &test_alloc, &status );
+
+        TEST_ASSERT_TRUE( _seq_status_check( &status ) );
+        TEST_ASSERT_EQUAL( count, status.alloc_count );
+        TEST_ASSERT_EQUAL( count, lalloc_get_alloc_count( &test_alloc ) );
+        TEST_ASSERT_EQUAL( status.free_space, lalloc_get_free_space( &test_alloc ) );
+
+        if ( count < SEQ_LIVE && uint32_random_range( 0, 9 ) < 6 )
+        {
+            lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+            /* the queued frees and the unmerged blocks are only taken into account by lalloc_alloc */
+#if LALLOC_DEFERRED_FREE == 0 && LALLOC_LAZY_COALESCING == 0
+            TEST_ASSERT_EQUAL( status.free_space, size );
+#else
+            TEST_ASSERT_TRUE( size >= status.free_space );
+#endif
+
+            if ( data != NULL && size > 0 )
+            {
+                TEST_ASSERT_TRUE( lalloc_commit( &test_alloc, uint32_random_range( 1, size < SEQ_FRAME_MAX ? size : SEQ_FRAME_MAX ) ) );
+                count++;
+            }
+            else
+            {
+                lalloc_alloc_revert( &test_alloc );
+            }
+        }
+        else if ( count > 0 )
+        {
+            lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+            TEST_ASSERT_TRUE( lalloc_free( &test_alloc, data ) );
+            count--;
+
+#if LALLOC_DEFERRED_FREE == 1
+            /* the block is queued, it is still allocated for the readers until a call drains the queue */
+            lalloc_maintain( &test_alloc, 0 );
+#endif
+        }
+    }
+
+    lalloc_deinit( &test_alloc );
+}
+
+#if LALLOC_TRACE == 1
+static uint32_t seq_expected;
+static uint32_t seq_calls;
+
+/* the trace callback runs within the critical section of the writer, as an ISR that preempts it would */
+static void _seq_trace_cb( void *ctx, const lalloc_trace_event_t *ev )
+{
+    lalloc_status_t status;
+
+    if ( ev->type == LALLOC_EV_COMMIT )
+    {
+        lalloc_get_status( ( LALLOC_T * )ctx, &status );
+
+        /* the commit is not published yet */
+        TEST_ASSERT_EQUAL( seq_expected, status.alloc_count );
+        seq_calls++;
+    }
+}
+
+/**
+   @brief A READER WITHIN THE CRITICAL SECTION OF THE WRITER DOES NOT TAKE IT, AND IT GETS THE PREVIOUS STATE.
+ */
+void test_seqlock_reader_in_critical_section()
+{
+    lalloc_status_t status;
+    LALLOC_IDX_TYPE size;
+    uint8_t *data;
+    uint32_t i;
+
+    LALLOC_DECLARE( test_alloc, SEQ_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+    lalloc_trace_set( &test_alloc, _seq_trace_cb, ( void * )&test_alloc );
+
+    seq_calls = 0;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        seq_expected = i;
+
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+        TEST_ASSERT_TRUE( lalloc_commit( &test_alloc, 10 ) );
+
+        lalloc_get_status( &test_alloc, &status );
+        TEST_ASSERT_EQUAL( i + 1, status.alloc_count );
+    }
+
+    TEST_ASSERT_EQUAL( 4, seq_calls );
+
+    lalloc_trace_set( &test_alloc, NULL, NULL );
+    lalloc_deinit( &test_alloc );
+}
+#endif
+
+#ifdef TEST_MUTEX
+static volatile bool seq_done;
+
+/* FIFO traffic on the shared instance */
+static void *_seq_writer( void *arg )
+{
+    LALLOC_T *obj = ( LALLOC_T * )arg;
+    uint32_t count = 0;
+    uint32_t i;
+
+    for ( i = 0; i < SEQ_ROUNDS * 10; i++ )
+    {
+        LALLOC_IDX_TYPE size;
+        uint8_t *data;
+
+        lalloc_alloc( obj, ( void ** )&data, &size );
+
+        if ( count < SEQ_LIVE && ( i % 3 ) != 2 && data != NULL && size > 0 )
+        {
+            lalloc_commit( obj, 1 + i % ( size < SEQ_FRAME_MAX ? size : SEQ_FRAME_MAX ) );
+            count++;
+            continue;
+        }
+
+        lalloc_alloc_revert( obj );
+
+        if ( count > 0 )
+        {
+            lalloc_get_first( obj, ( void ** )&data, &size );
+            lalloc_free( obj, data );
+            count--;
+        }
+    }
+
+    seq_done = true;
+
+    return NULL;
+}
+
+/* polls the state of the instance, a torn copy would not agree with itself */
+static void *_seq_reader( void *arg )
+{
+    LALLOC_T *obj = ( LALLOC_T * )arg;
+    uintptr_t errors = 0;
+
+    while ( !seq_done )
+    {
+        lalloc_status_t status;
+
+        lalloc_get_status( obj, &status );
+
+        errors += !_seq_status_check( &status );
+        errors += ( status.alloc_count > SEQ_LIVE );
+    }
+
+    return ( void * )errors;
+}
+
+/**
+   @brief THE READERS POLL THE STATE WHILE A WRITER CHANGES THE INSTANCE, EVERY COPY IS CONSISTENT.
+ */
+void test_seqlock_concurrent_readers()
+{
+    pthread_t writer;
+    pthread_t readers[SEQ_READERS];
+    int r;
+
+    LALLOC_DECLARE( test_alloc, SEQ_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    seq_done = false;
+
+    for ( r = 0; r < SEQ_READERS; r++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_create( &readers[r], NULL, _seq_reader, ( void * )&test_alloc ) );
+    }
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &writer, NULL, _seq_writer, ( void * )&test_alloc ) );
+    pthread_join( writer, NULL );
+
+    for ( r = 0; r < SEQ_READERS; r++ )
+    {
+        void *errors;
+
+        pthread_join( readers[r], &errors );
+        TEST_ASSERT_EQUAL( 0, ( uintptr_t )errors );
+    }
+
+    lalloc_deinit( &test_alloc );
+}
+#endif
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_seqlock_status );
+#if LALLOC_TRACE == 1
+    RUN_TEST( test_seqlock_reader_in_critical_section );
+#endif
+#ifdef TEST_MUTEX
+    RUN_TEST( test_seqlock_concurrent_readers );
+#endif
+    return 0;
+}
+#endif
@@ -0,0 +1,305 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#ifdef TEST_MUTEX
+#include <pthread.h>
+#endif
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+
+#define SHARD_COUNT             4
+#define SHARD_SIZE              1000
+#define SHARD_ROUNDS            20000
+#define SHARD_LIVE              8
+#define SHARD_FRAME_MAX         60
+
+__thread uint32_t test_shard_hint;
+
+/* the area of each shard available for a single block */
+static LALLOC_IDX_TYPE _shard_free_space( void )
+{
+    return LALLOC_ALIGN_ROUND_UP( SHARD_SIZE - LALLOC_BLOCK_HEADER_SIZE );
+}
+
+/* the queued frees and the unmerged blocks are settled, as an idle system would do */
+static void _shard_maintain( lalloc_sharded_t *sh )
+{
+    uint8_t i;
+
+    for ( i = 0; i < sh->count; i++ )
+    {
+        while ( lalloc_maintain( sh->shards[i], 4 ) )
+        {
+        }
+    }
+}
+
+static bool _shard_holds( lalloc_t *obj, void *addr )
+{
+    return ( uint8_t * )addr >= obj->pool && ( uint8_t * )addr < obj->pool + obj->size;
+}
+
+/**
+   @brief THE RESERVATIONS GO TO THE SHARD OF THE CALLER, THE COMMITS AND THE FREES GO BY ADDRESS.
+ */
+void test_sharded_routing()
+{
+    lalloc_sharded_t *sh = lalloc_sharded_ctor( SHARD_COUNT, SHARD_SIZE );
+    lalloc_handle_t h;
+    uint8_t *addr[SHARD_COUNT + 1];
+    uint8_t foreign[8];
+    uint32_t i;
+
+    TEST_ASSERT_NOT_NULL( sh );
+    TEST_ASSERT_EQUAL( SHARD_COUNT, sh->count );
+
+    /* the hint wraps around the shards */
+    for ( i = 0; i <= SHARD_COUNT; i++ )
+    {
+        test_shard_hint = i;
+
+        TEST_ASSERT_TRUE( lalloc_sharded_reserve( sh, 10, &h ) );
+        TEST_ASSERT_TRUE( _shard_holds( sh->shards[i % SHARD_COUNT], h.addr ) );
+        TEST_ASSERT_TRUE( h.size >= 10 );
+
+        addr[i] = h.addr;
+        memset( addr[i], i, 10 );
+
+        TEST_ASSERT_TRUE( lalloc_sharded_commit_h( sh, &h, 10 ) );
+    }
+
+    TEST_ASSERT_EQUAL( SHARD_COUNT + 1, lalloc_sharded_get_alloc_count( sh ) );
+    TEST_ASSERT_EQUAL( 2, lalloc_get_alloc_count( sh->shards[0] ) );
+
+    /* an address out of every pool is rejected */
+    TEST_ASSERT_FALSE( lalloc_sharded_free( sh, foreign ) );
+
+    /* frees from any caller */
+    test_shard_hint = 3;
+
+    for ( i = 0; i <= SHARD_COUNT; i++ )
+    {
+        uint32_t b;
+
+        for ( b = 0; b < 10; b++ )
+        {
+            TEST_ASSERT_EQUAL( i, addr[i][b] );
+        }
+
+        TEST_ASSERT_TRUE( lalloc_sharded_free( sh, addr[i] ) );
+    }
+
+    _shard_maintain( sh );
+
+    TEST_ASSERT_EQUAL( 0, lalloc_sharded_get_alloc_count( sh ) );
+
+    /* a reverted reservation goes back to its shard */
+    TEST_ASSERT_TRUE( lalloc_sharded_reserve( sh, 10, &h ) );
+    lalloc_sharded_revert_h( sh, &h );
+
+    _shard_maintain( sh );
+
+    for ( i = 0; i < SHARD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( sh->shards[i] ) );
+        TEST_ASSERT_EQUAL( _shard_free_space(), lalloc_get_free_space( sh->shards[i] ) );
+    }
+
+    lalloc_sharded_dtor( sh );
+}
+
+/**
+   @brief A RESERVATION THAT DOES NOT FIT IN THE SHARD OF THE CALLER GOES TO THE NEXT ONES.
+ */
+void test_sharded_fallback()
+{
+    lalloc_sharded_t *sh = lalloc_sharded_ctor( SHARD_COUNT, SHARD_SIZE );
+    lalloc_handle_t h;
+    uint8_t *whole[SHARD_COUNT];
+    uint32_t i;
+
+    TEST_ASSERT_NOT_NULL( sh );
+
+    test_shard_hint = 1;
+
+    /* each one takes a whole shard, from the shard of the caller on */
+    for ( i = 0; i < SHARD_COUNT; i++ )
+    {
+        TEST_ASSERT_TRUE( lalloc_sharded_reserve( sh, _shard_free_space(), &h ) );
+        TEST_ASSERT_TRUE( _shard_holds( sh->shards[( 1 + i ) % SHARD_COUNT], h.addr ) );
+
+        whole[i] = h.addr;
+
+        TEST_ASSERT_TRUE( lalloc_sharded_commit_h( sh, &h, _shard_free_space() ) );
+    }
+
+    /* every shard is full */
+    TEST_ASSERT_FALSE( lalloc_sharded_reserve( sh, 1, &h ) );
+    TEST_ASSERT_NULL( h.addr );
+    TEST_ASSERT_EQUAL( 0, h.size );
+
+    /* the shard 3 is the only one with space */
+    TEST_ASSERT_TRUE( lalloc_sharded_free( sh, whole[2] ) );
+
+    TEST_ASSERT_TRUE( lalloc_sharded_reserve( sh, 100, &h ) );
+    TEST_ASSERT_TRUE( _shard_holds( sh->shards[3], h.addr ) );
+    TEST_ASSERT_TRUE( lalloc_sharded_commit_h( sh, &h, 100 ) );
+
+    /* a reservation bigger than any shard does not fit */
+    TEST_ASSERT_FALSE( lalloc_sharded_reserve( sh, _shard_free_space(), &h ) );
+
+    TEST_ASSERT_EQUAL( SHARD_COUNT, lalloc_sharded_get_alloc_count( sh ) );
+
+    for ( i = 0; i < SHARD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( sh->shards[i] ) );
+    }
+
+    lalloc_sharded_dtor( sh );
+}
+
+#ifdef TEST_MUTEX
+typedef struct
+{
+    lalloc_sharded_t    *sh;
+    uint8_t             id;
+    uint32_t            errors;
+} shard_worker_t;
+
+/* reservations and frees by address, with a tag per frame */
+static void *_shard_worker( void *arg )
+{
+    shard_worker_t *ctx = ( shard_worker_t * )arg;
+    uint8_t *live[SHARD_LIVE];
+    LALLOC_IDX_TYPE sizes[SHARD_LIVE];
+    uint32_t count = 0;
+    uint32_t i;
+
+    test_shard_hint = ctx->id;
+
+    for ( i = 0; i < SHARD_ROUNDS; i++ )
+    {
+        LALLOC_IDX_TYPE frame_size = 1 + ( i * 7 + ctx->id ) % SHARD_FRAME_MAX;
+        lalloc_handle_t h;
+
+        if ( count < SHARD_LIVE && ( i % 3 ) != 2 && lalloc_sharded_reserve( ctx->sh, frame_size, &h ) )
+        {
+            live[count] = h.addr;
+            sizes[count] = frame_size;
+            memset( live[count], ( uint8_t )( ctx->id + i ), frame_size );
+            ctx->errors += !lalloc_sharded_commit_h( ctx->sh, &h, frame_size );
+            count++;
+        }
+        else if ( count > 0 )
+        {
+            uint32_t k = i % count;
+            uint32_t b;
+
+            for ( b = 1; b < sizes[k]; b++ )
+            {
+                ctx->errors += ( live[k][b] != live[k][0] );
+            }
+
+            ctx->errors += !lalloc_sharded_free( ctx->sh, live[k] );
+
+            count--;
+            live[k] = live[count];
+            sizes[k] = sizes[count];
+        }
+    }
+
+    while ( count > 0 )
+    {
+        ctx->errors += !lalloc_sharded_free( ctx->sh, live[--count] );
+    }
+
+    return NULL;
+}
+
+/**
+   @brief MORE THREADS THAN SHARDS, SO SOME OF THEM SHARE A SHARD. THE FRAMES STAY APART.
+ */
+void test_sharded_threads()
+{
+    pthread_t threads[SHARD_COUNT * 2];
+    shard_worker_t workers[SHARD_COUNT * 2];
+    lalloc_sharded_t *sh = lalloc_sharded_ctor( SHARD_COUNT, SHARD_SIZE );
+    int w;
+
+    TEST_ASSERT_NOT_NULL( sh );
+
+    for ( w = 0; w < SHARD_COUNT * 2; w++ )
+    {
+        workers[w].sh = sh;
+        workers[w].id = ( uint8_t )w;
+        workers[w].errors = 0;
+
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[w], NULL, _shard_worker, &workers[w] ) );
+    }
+
+    for ( w = 0; w < SHARD_COUNT * 2; w++ )
+    {
+        pthread_join( threads[w], NULL );
+
+        TEST_ASSERT_EQUAL( 0, workers[w].errors );
+    }
+
+    _shard_maintain( sh );
+
+    for ( w = 0; w < SHARD_COUNT; w++ )
+    {
+        TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( sh->shards[w] ) );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( sh->shards[w] ) );
+        TEST_ASSERT_EQUAL( _shard_free_space(), lalloc_get_free_space( sh->shards[w] ) );
+    }
+
+    lalloc_sharded_dtor( sh );
+}
+#endif
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_sharded_routing );
+    RUN_TEST( test_sharded_fallback );
+#ifdef TEST_MUTEX
+    RUN_TEST( test_sharded_threads );
+#endif
+    return 0;
+}
+#endif
@@ -0,0 +1,314 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+
+#define SPSC_POOL_SIZE      4096
+#define SPSC_FRAMES         200000
+#define SPSC_FRAME_MIN      4
+#define SPSC_FRAME_MAX      96
+
+typedef struct
+{
+    LALLOC_T *obj;
+    uint32_t errors;
+} spsc_ctx_t;
+
+/* fills the frame with a pattern that depends on its sequence number */
+void _spsc_fill( uint8_t *data, LALLOC_IDX_TYPE size, uint32_t seq )
+{
+    LALLOC_IDX_TYPE i;
+
+    memcpy( data, &seq, sizeof( seq ) );
+
+    for ( i = sizeof( seq ); i < size; i++ )
+    {
+        data[i] = ( uint8_t )( seq + i );
+    }
+}
+
+/* returns true if the frame holds the pattern of seq */
+bool _spsc_check( uint8_t *data, LALLOC_IDX_TYPE size, uint32_t seq )
+{
+    LALLOC_IDX_TYPE i;
+    uint32_t frame_seq;
+
+    memcpy( &frame_seq, data, sizeof( frame_seq ) );
+
+    if ( frame_seq != seq )
+    {
+        return false;
+    }
+
+    for ( i = sizeof( seq ); i < size; i++ )
+    {
+        if ( data[i] != ( uint8_t )( seq + i ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* frame size of the sequence number seq. Both sides compute it */
+LALLOC_IDX_TYPE _spsc_frame_size( uint32_t seq )
+{
+    uint32_t x = seq * 2654435761UL;
+
+    return SPSC_FRAME_MIN + ( x >> 16 ) % ( SPSC_FRAME_MAX - SPSC_FRAME_MIN + 1 );
+}
+
+void *_spsc_producer( void *arg )
+{
+    spsc_ctx_t *ctx = ( spsc_ctx_t * )arg;
+    uint32_t seq;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    for ( seq = 0; seq < SPSC_FRAMES; seq++ )
+    {
+        LALLOC_IDX_TYPE frame_size = _spsc_frame_size( seq );
+
+        while ( 1 )
+        {
+            lalloc_alloc( ctx->obj, ( void ** )&data, &size );
+
+            if ( data != NULL && size >= frame_size )
+            {
+                _spsc_fill( data, frame_size, seq );
+
+                if ( lalloc_commit( ctx->obj, frame_size ) )
+                {
+                    break;
+                }
+            }
+
+            /* no room (or the ring is full), wait for the consumer */
+            lalloc_alloc_revert( ctx->obj );
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void *_spsc_consumer( void *arg )
+{
+    spsc_ctx_t *ctx = ( spsc_ctx_t * )arg;
+    uint32_t seq = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    while ( seq < SPSC_FRAMES )
+    {
+        lalloc_get_first( ctx->obj, ( void ** )&data, &size );
+
+        if ( data == NULL )
+        {
+            sched_yield();
+            continue;
+        }
+
+        /* the block might be bigger than the frame (alignment, or not worth splitting) */
+        if ( size < _spsc_frame_size( seq ) )
+        {
+            ctx->errors++;
+        }
+        else if ( !_spsc_check( data, _spsc_frame_size( seq ), seq ) )
+        {
+            ctx->errors++;
+        }
+
+        if ( !lalloc_free_first( ctx->obj ) )
+        {
+            ctx->errors++;
+        }
+
+        seq++;
+    }
+
+    return NULL;
+}
+
+/**
+   @brief ONE CONTEXT, VALIDATES THE FIFO ORDER THROUGH THE RING WRAP AROUND, AND THAT THE RELEASED BLOCKS
+          GET BACK TO THE FREE LIST ON THE NEXT PRODUCER CALL.
+ */
+void test_spsc_single_context()
+{
+    uint32_t seq = 0;
+    uint32_t first = 0;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, SPSC_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    while ( seq < 10 * LALLOC_ALLOC_RING_SIZE )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+        if ( data != NULL && size >= 8 )
+        {
+            data[0] = ( uint8_t )seq;
+
+            if ( lalloc_commit( &test_alloc, 8 ) )
+            {
+                seq++;
+                continue;
+            }
+        }
+
+        /* the pool or the ring is full: the consumer releases the oldest one */
+        lalloc_alloc_revert( &test_alloc );
+
+        TEST_ASSERT_NOT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+
+        lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL( ( uint8_t )first, data[0] );
+
+        if ( lalloc_get_alloc_count( &test_alloc ) > 1 )
+        {
+            /* only the first element can be freed */
+            lalloc_get_n( &test_alloc, ( void ** )&data, &size, 1 );
+            TEST_ASSERT_EQUAL( ( uint8_t )( first + 1 ), data[0] );
+            TEST_ASSERT_EQUAL( false, lalloc_free( &test_alloc, data ) );
+        }
+
+        TEST_ASSERT_EQUAL( true, lalloc_free_first( &test_alloc ) );
+        first++;
+    }
+
+    /* releases some of them at once */
+    LALLOC_IDX_TYPE count = lalloc_get_alloc_count( &test_alloc );
+
+    TEST_ASSERT( count > 3 );
+    TEST_ASSERT_EQUAL( 2, lalloc_free_first_n( &test_alloc, 2 ) );
+    first += 2;
+
+    lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL( ( uint8_t )first, data[0] );
+
+    void *batch[2] = { data, data };
+
+    TEST_ASSERT_EQUAL( 1, lalloc_free_batch( &test_alloc, batch, 2 ) );
+    first++;
+    TEST_ASSERT_EQUAL( count - 3, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* consumes the rest */
+    while ( lalloc_get_alloc_count( &test_alloc ) > 0 )
+    {
+        lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+        TEST_ASSERT_EQUAL( ( uint8_t )first, data[0] );
+        TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data ) );
+        first++;
+    }
+
+    TEST_ASSERT_EQUAL( seq, first );
+    TEST_ASSERT_EQUAL( false, lalloc_free_first( &test_alloc ) );
+
+    lalloc_get_first( &test_alloc, ( void ** )&data, &size );
+    TEST_ASSERT_EQUAL( NULL, data );
+    TEST_ASSERT_EQUAL( 0, size );
+
+    /* the released blocks are still in the allocated list until the producer runs */
+    TEST_ASSERT_NOT_EQUAL( 0, test_alloc.dyn->allocated_blocks );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+
+    TEST_ASSERT_EQUAL( 0, test_alloc.dyn->allocated_blocks );
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+/**
+   @brief PRODUCER AND CONSUMER THREADS SHARE ONE INSTANCE WITHOUT CRITICAL SECTIONS.
+          EVERY FRAME MUST REACH THE CONSUMER IN ORDER AND UNCORRUPTED, AND THE POOL MUST BE WHOLE AT THE END.
+ */
+void test_spsc_threads()
+{
+    pthread_t producer;
+    pthread_t consumer;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+
+    LALLOC_DECLARE( test_alloc, SPSC_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    LALLOC_IDX_TYPE free_space = lalloc_get_free_space( &test_alloc );
+
+    spsc_ctx_t ctx_p = { &test_alloc, 0 };
+    spsc_ctx_t ctx_c = { &test_alloc, 0 };
+
+    pthread_create( &producer, NULL, _spsc_producer, &ctx_p );
+    pthread_create( &consumer, NULL, _spsc_consumer, &ctx_c );
+
+    pthread_join( producer, NULL );
+    pthread_join( consumer, NULL );
+
+    TEST_ASSERT_EQUAL( 0, ctx_p.errors );
+    TEST_ASSERT_EQUAL( 0, ctx_c.errors );
+    TEST_ASSERT_EQUAL( 0, lalloc_get_alloc_count( &test_alloc ) );
+
+    /* the producer side gets the released blocks back */
+    lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+    lalloc_alloc_revert( &test_alloc );
+
+    TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    TEST_ASSERT_EQUAL( free_space, lalloc_get_free_space( &test_alloc ) );
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_spsc_single_context );
+    RUN_TEST( test_spsc_threads );
+    return 0;
+}
+#endif
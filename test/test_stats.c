@@ -0,0 +1,291 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+/* internal private data and functions from lalloc.c */
+extern const LALLOC_IDX_TYPE lalloc_b_overhead_size;
+LALLOC_IDX_TYPE _block_get_size( uint8_t *pool, LALLOC_IDX_TYPE block_idx );
+
+#define STATS_BLOCKS_MAX        200
+
+/**
+   @brief the statistics must match the ones calculated walking the lists.
+ */
+void _check_stats( LALLOC_T *obj, lalloc_stats_t *stats )
+{
+    LALLOC_IDX_TYPE free_bytes = 0;
+    LALLOC_IDX_TYPE free_blocks = 0;
+    LALLOC_IDX_TYPE largest = 0;
+    uint64_t free_sq_sum = 0;
+    LALLOC_IDX_TYPE used_bytes = 0;
+    LALLOC_IDX_TYPE idx;
+    LALLOC_IDX_TYPE n;
+
+    /* the queued frees are not accounted until they are drained */
+    lalloc_get_alloc_count( obj );
+
+    lalloc_get_stats( obj, stats );
+
+    for ( idx = obj->dyn->flist; idx != LALLOC_IDX_INVALID; idx = _flist_next( obj, idx ) )
+    {
+        LALLOC_IDX_TYPE size = _block_get_size( obj->pool, idx );
+
+        free_bytes += size;
+        free_blocks++;
+        free_sq_sum += ( uint64_t )size * size;
+        largest = ( size > largest ) ? size : largest;
+    }
+
+    idx = obj->dyn->alist;
+
+    for ( n = 0; n < obj->dyn->allocated_blocks; n++ )
+    {
+        used_bytes += _block_get_size( obj->pool, idx );
+        LALLOC_GET_BLOCK_NEXT( obj->pool, idx, idx );
+    }
+
+    TEST_ASSERT_EQUAL( free_bytes, stats->free_bytes );
+    TEST_ASSERT_EQUAL( free_blocks, stats->free_blocks );
+    TEST_ASSERT_TRUE( free_sq_sum == stats->free_sq_sum );
+    TEST_ASSERT_EQUAL( used_bytes, stats->used_bytes );
+    TEST_ASSERT_EQUAL( obj->dyn->allocated_blocks, stats->used_blocks );
+    TEST_ASSERT_TRUE( stats->max_used_bytes >= stats->used_bytes );
+    TEST_ASSERT_TRUE( stats->max_used_blocks >= stats->used_blocks );
+    TEST_ASSERT_TRUE( stats->fragmentation <= 100 );
+
+#if LALLOC_FLIST_POLICY == LALLOC_FLIST_TLSF
+    /* the largest block is the biggest known one of the highest class */
+    TEST_ASSERT_TRUE( stats->largest_free <= largest );
+    TEST_ASSERT_TRUE( stats->largest_free >= largest - largest / LALLOC_TLSF_SL_COUNT );
+#else
+    TEST_ASSERT_EQUAL( largest, stats->largest_free );
+#endif
+}
+
+/**
+   @brief COUNTERS, WATER MARKS AND FRAGMENTATION.
+ */
+void test_stats_basic()
+{
+    int i;
+    uint8_t *data[4];
+    LALLOC_IDX_TYPE size;
+    lalloc_stats_t stats;
+
+    LALLOC_DECLARE( test_alloc, 500 );
+
+    lalloc_init( &test_alloc );
+
+    _check_stats( &test_alloc, &stats );
+
+    LALLOC_IDX_TYPE free_space = stats.free_bytes;
+
+    TEST_ASSERT_EQUAL( 1, stats.free_blocks );
+    TEST_ASSERT_EQUAL( free_space, stats.largest_free );
+    TEST_ASSERT_EQUAL( free_space, stats.min_free_bytes );
+    TEST_ASSERT_EQUAL( 0, stats.fragmentation );
+
+    for ( i = 0; i < 4; i++ )
+    {
+        lalloc_alloc( &test_alloc, ( void ** )&data[i], &size );
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 40 ) );
+    }
+
+    _check_stats( &test_alloc, &stats );
+    TEST_ASSERT_EQUAL( 4 * LALLOC_ALIGN_ROUND_UP( 40 ), stats.used_bytes );
+    TEST_ASSERT_EQUAL( 4, stats.max_used_blocks );
+    TEST_ASSERT_EQUAL( free_space - 4 * ( LALLOC_ALIGN_ROUND_UP( 40 ) + lalloc_b_overhead_size ), stats.min_free_bytes );
+
+    /* free blocks far apart fragment the free space */
+    lalloc_free( &test_alloc, data[0] );
+    lalloc_free( &test_alloc, data[2] );
+
+    _check_stats( &test_alloc, &stats );
+    TEST_ASSERT_EQUAL( 3, stats.free_blocks );
+    TEST_ASSERT_EQUAL( 2, stats.used_blocks );
+    TEST_ASSERT_EQUAL( 4, stats.max_used_blocks );
+    TEST_ASSERT_EQUAL( 4 * LALLOC_ALIGN_ROUND_UP( 40 ), stats.max_used_bytes );
+    TEST_ASSERT_TRUE( stats.fragmentation > 0 );
+
+    /* failures */
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, 20 ) );
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, size + LALLOC_ALIGNMENT ) );
+
+    for ( i = 0; i < 3; i++ )
+    {
+        TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, size ) );
+        lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    }
+
+    TEST_ASSERT_NULL( data[0] );
+
+    _check_stats( &test_alloc, &stats );
+    TEST_ASSERT_EQUAL( 2, stats.commit_failures );
+    TEST_ASSERT_EQUAL( 1, stats.alloc_failures );
+    TEST_ASSERT_EQUAL( 0, stats.free_bytes );
+    TEST_ASSERT_EQUAL( 0, stats.min_free_bytes );
+    TEST_ASSERT_EQUAL( 0, stats.fragmentation );
+
+    /* lalloc_init resets everything */
+    lalloc_init( &test_alloc );
+    _check_stats( &test_alloc, &stats );
+    TEST_ASSERT_EQUAL( 0, stats.max_used_blocks );
+    TEST_ASSERT_EQUAL( 0, stats.commit_failures );
+}
+
+/**
+   @brief RANDOM TRAFFIC, THE STATISTICS ARE COMPARED WITH THE LISTS.
+ */
+void test_stats_random()
+{
+    int i;
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    uint8_t *allocated[STATS_BLOCKS_MAX];
+    uint32_t count = 0;
+    lalloc_stats_t stats;
+    lalloc_handle_t h;
+
+    LALLOC_DECLARE( test_alloc, 3000 );
+
+    lalloc_init( &test_alloc );
+
+    /* empty blocks are never kept: with LALLOC_FREE_ANY their address is the header of the next block */
+    for ( i = 0; i < 50000; i++ )
+    {
+        switch ( uint32_random_range( 0, 8 ) )
+        {
+            case 0:
+            case 1:
+                lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+
+                if ( data != NULL && size > 0 && count < STATS_BLOCKS_MAX )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( 1, size < 100 ? size : 100 ) ) );
+                    allocated[count++] = data;
+                }
+                else
+                {
+                    lalloc_alloc_revert( &test_alloc );
+                }
+                break;
+
+            case 2:
+                lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, uint32_random_range( 8, 100 ) );
+
+                if ( data != NULL && size > 0 && count < STATS_BLOCKS_MAX )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, size ) );
+                    allocated[count++] = data;
+                }
+                else
+                {
+                    lalloc_alloc_revert( &test_alloc );
+                }
+                break;
+
+            case 3:
+                if ( count < STATS_BLOCKS_MAX && lalloc_reserve( &test_alloc, uint32_random_range( 8, 100 ), &h ) )
+                {
+                    if ( h.size > 0 && uint32_random_range( 0, 9 ) < 5 )
+                    {
+                        allocated[count++] = h.addr;
+                        TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h, h.size ) );
+                    }
+                    else
+                    {
+                        lalloc_revert_h( &test_alloc, &h );
+                    }
+                }
+                break;
+
+            case 4:
+            case 5:
+                if ( count > 0 )
+                {
+                    uint32_t k = uint32_random_range( 0, count - 1 );
+
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, allocated[k] ) );
+                    allocated[k] = allocated[--count];
+                }
+                break;
+
+            case 6:
+                if ( count > 1 )
+                {
+                    void *pair[2] = { allocated[count - 1], allocated[count - 2] };
+            
+                    TEST_ASSERT_EQUAL( 2, lalloc_free_batch( &test_alloc, pair, 2 ) );
+                    count -= 2;
+                }
+                break;
+
+            case 7:
+                lalloc_maintain( &test_alloc, 4 );
+                break;
+
+            default:
+#if LALLOC_COMPACTION == 1
+                lalloc_compact_step( &test_alloc, 200, NULL );
+
+                /* the addresses are only used to free the blocks, they are taken again from the allocated list */
+                for ( size = 0; size < count; size++ )
+                {
+                    lalloc_get_n( &test_alloc, ( void ** )&allocated[size], &h.size, size );
+                }
+#endif
+                break;
+        }
+
+        _check_stats( &test_alloc, &stats );
+        TEST_ASSERT_EQUAL( 1, lalloc_sanity_check( &test_alloc ) );
+    }
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_stats_basic );
+    RUN_TEST( test_stats_random );
+    return 0;
+}
+#endif
@@ -0,0 +1,521 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2024, Franco Bucafusco
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <string.h>
+
+#include "unity.h"
+
+#include "lalloc.h"
+#include "lalloc_priv.h"
+#include "lalloc_tools.h"
+#include "random_tools.h"
+#include "lalloc_abstraction.h"
+
+extern uint32_t test_cycles_step;
+
+#define TRACE_POOL_SIZE         1000
+#define TRACE_MAX_EVENTS        8192
+#define TRACE_MAX_LIVE          64
+
+/* events captured by _trace_cb */
+static lalloc_trace_event_t trace_events[TRACE_MAX_EVENTS];
+static uint32_t trace_count;
+
+static uint8_t trace_buf[TRACE_MAX_EVENTS * LALLOC_TRACE_RECORD_MAX];
+
+static void _trace_cb( void *ctx, const lalloc_trace_event_t *ev )
+{
+    ( *( uint32_t * )ctx )++;
+
+    if ( trace_count < TRACE_MAX_EVENTS )
+    {
+        trace_events[trace_count++] = *ev;
+    }
+}
+
+/**
+   @brief checks the type and the arguments of a captured event.
+ */
+void _check_event( uint32_t n, uint8_t type, uint32_t a, uint32_t b )
+{
+    TEST_ASSERT_TRUE( n < trace_count );
+    TEST_ASSERT_EQUAL( type, trace_events[n].type );
+    TEST_ASSERT_EQUAL( a, trace_events[n].a );
+    TEST_ASSERT_EQUAL( b, trace_events[n].b );
+}
+
+/**
+   @brief A RECORD DECODES TO THE EVENT IT WAS ENCODED FROM, SMALL EVENTS TAKE A FEW BYTES.
+ */
+void test_trace_encode()
+{
+    static const lalloc_trace_event_t events[] =
+    {
+        { LALLOC_EV_ALLOC, 0, 0, 0 },
+        { LALLOC_EV_COMMIT, 10, 40, 8 },
+        { LALLOC_EV_FREE, 127, 0, 128 },
+        { LALLOC_EV_ALLOC_MAX, 16384, 0, 0x1FFFFF },
+        { LALLOC_EV_MOVE, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+    };
+    uint8_t buf[LALLOC_TRACE_RECORD_MAX];
+    lalloc_trace_event_t ev;
+    uint8_t len;
+    uint8_t i;
+
+    for ( i = 0; i < sizeof( events ) / sizeof( events[0] ); i++ )
+    {
+        len = lalloc_trace_encode( &events[i], buf );
+
+        TEST_ASSERT_TRUE( len > 0 && len <= LALLOC_TRACE_RECORD_MAX );
+        TEST_ASSERT_EQUAL( len, lalloc_trace_decode( buf, len, &ev ) );
+        TEST_ASSERT_EQUAL( events[i].type, ev.type );
+        TEST_ASSERT_EQUAL( events[i].delta, ev.delta );
+        TEST_ASSERT_EQUAL( events[i].a, ev.a );
+        TEST_ASSERT_EQUAL( events[i].b, ev.b );
+
+        /* a truncated record is rejected */
+        TEST_ASSERT_EQUAL( 0, lalloc_trace_decode( buf, len - 1, &ev ) );
+    }
+
+    TEST_ASSERT_EQUAL( 2, lalloc_trace_encode( &events[0], buf ) );
+    TEST_ASSERT_EQUAL( 4, lalloc_trace_encode( &events[1], buf ) );
+    TEST_ASSERT_EQUAL( 16, lalloc_trace_encode( &events[4], buf ) );
+}
+
+/**
+   @brief EACH OPERATION REPORTS ITS EVENT, WITH THE OFFSETS OF THE BLOCKS IN THE POOL.
+ */
+void test_trace_events()
+{
+    uint8_t *data[3];
+    uint8_t *get;
+    LALLOC_IDX_TYPE size;
+    LALLOC_IDX_TYPE max_size;
+    lalloc_handle_t h;
+    uint32_t calls = 0;
+    uint32_t n = 0;
+
+    LALLOC_DECLARE( test_alloc, TRACE_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    trace_count = 0;
+    test_cycles_step = 7;
+
+    /* nothing is reported before the callback is set */
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    lalloc_alloc_revert( &test_alloc );
+
+    lalloc_trace_set( &test_alloc, _trace_cb, &calls );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &max_size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 40 ) );
+    lalloc_alloc_max( &test_alloc, ( void ** )&data[1], &size, 20 );
+    lalloc_alloc_revert( &test_alloc );
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 30, &h ) );
+    data[1] = h.addr;
+    TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h, 30 ) );
+    TEST_ASSERT_EQUAL( true, lalloc_reserve( &test_alloc, 30, &h ) );
+    data[2] = h.addr;
+    lalloc_revert_h( &test_alloc, &h );
+    lalloc_get_n( &test_alloc, ( void ** )&get, &size, 1 );
+    lalloc_get_last( &test_alloc, ( void ** )&get, &size );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+
+    /* a failed commit is not reported */
+    TEST_ASSERT_EQUAL( false, lalloc_commit( &test_alloc, 40 ) );
+
+    /* drains the deferred frees */
+    TEST_ASSERT_EQUAL( 1, lalloc_get_alloc_count( &test_alloc ) );
+
+    _check_event( n++, LALLOC_EV_ALLOC, max_size, 0 );
+    _check_event( n++, LALLOC_EV_COMMIT, LALLOC_ALIGN_ROUND_UP( 40 ), data[0] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_ALLOC_MAX, 20, LALLOC_ALIGN_ROUND_UP( 20 ) );
+    _check_event( n++, LALLOC_EV_ALLOC_REVERT, 0, 0 );
+    _check_event( n++, LALLOC_EV_RESERVE, LALLOC_ALIGN_ROUND_UP( 30 ), data[1] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_COMMIT_H, LALLOC_ALIGN_ROUND_UP( 30 ), data[1] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_RESERVE, LALLOC_ALIGN_ROUND_UP( 30 ), data[2] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_REVERT_H, 0, data[2] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_GET, 1, 0 );
+    _check_event( n++, LALLOC_EV_GET_LAST, 0, 0 );
+    _check_event( n++, LALLOC_EV_FREE, 0, data[0] - test_alloc.pool );
+
+    TEST_ASSERT_EQUAL( n, trace_count );
+    TEST_ASSERT_EQUAL( n, calls );
+
+#if defined(TEST_PROFILE_FAKE_CYCLES)
+    /* the counter is read once per event */
+    for ( n = 0; n < trace_count; n++ )
+    {
+        TEST_ASSERT_EQUAL( 7, trace_events[n].delta );
+    }
+#endif
+
+#if LALLOC_ALLOW_QUEUED_FREES == 1
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &test_alloc, 10, ( void ** )&data[2], &size ) );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 10 ) );
+    lalloc_get_first( &test_alloc, ( void ** )&get, &size );
+    TEST_ASSERT_EQUAL( true, lalloc_free_first( &test_alloc ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free_last( &test_alloc ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_free_first_n( &test_alloc, 2 ) );
+
+    n = trace_count - 7;
+
+    TEST_ASSERT_EQUAL( LALLOC_EV_ALLOC, trace_events[n++].type );
+    _check_event( n++, LALLOC_EV_COMMIT_AND_ALLOC, LALLOC_ALIGN_ROUND_UP( 10 ), data[0] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_COMMIT, LALLOC_ALIGN_ROUND_UP( 10 ), data[2] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_GET, 0, 0 );
+    _check_event( n++, LALLOC_EV_FREE, 0, data[1] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_FREE, 0, data[2] - test_alloc.pool );
+    _check_event( n++, LALLOC_EV_FREE, 0, data[0] - test_alloc.pool );
+#endif
+
+#if LALLOC_COMPACTION == 1
+    /* the hole of the first block is closed by moving the others down */
+    lalloc_init( &test_alloc );
+    lalloc_trace_set( &test_alloc, _trace_cb, &calls );
+
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 20 ) );
+    lalloc_alloc( &test_alloc, ( void ** )&data[1], &size );
+    TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, 20 ) );
+    TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, data[0] ) );
+    TEST_ASSERT_EQUAL( 1, lalloc_get_alloc_count( &test_alloc ) );
+
+    trace_count = 0;
+
+    while ( lalloc_compact_step( &test_alloc, TRACE_POOL_SIZE, NULL ) )
+    {
+    }
+
+    for ( n = 0; n < trace_count && trace_events[n].type != LALLOC_EV_MOVE; n++ )
+    {
+    }
+
+    _check_event( n, LALLOC_EV_MOVE, data[0] - test_alloc.pool, data[1] - test_alloc.pool );
+#endif
+
+    /* the trace stops */
+    lalloc_trace_set( &test_alloc, NULL, NULL );
+    n = trace_count;
+    lalloc_alloc( &test_alloc, ( void ** )&data[0], &size );
+    lalloc_alloc_revert( &test_alloc );
+    TEST_ASSERT_EQUAL( n, trace_count );
+}
+
+/**
+   @brief finds the open reservation of the replay whose area starts at offset.
+ */
+lalloc_handle_t *_find_handle( lalloc_handle_t *handles, uint32_t count, uint8_t *pool, uint32_t offset )
+{
+    uint32_t i;
+
+    for ( i = 0; i < count; i++ )
+    {
+        if ( handles[i].block != LALLOC_IDX_INVALID && ( uint8_t * )handles[i].addr - pool == offset )
+        {
+            return &handles[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+   @brief A RANDOM WORKLOAD, ENCODED AND REPLAYED ON ANOTHER INSTANCE, PUTS EVERY BLOCK AT THE SAME OFFSET.
+ */
+void test_trace_replay()
+{
+    uint8_t *live[TRACE_MAX_LIVE];
+    lalloc_handle_t handles[4];
+    lalloc_trace_event_t ev;
+    uint32_t count = 0;
+    uint32_t calls = 0;
+    uint32_t len = 0;
+    uint32_t pos = 0;
+    uint32_t events = 0;
+#if LALLOC_DEFERRED_FREE == 1
+    uint32_t run;
+    uint32_t k;
+#endif
+    uint8_t *data;
+    LALLOC_IDX_TYPE size;
+    bool reserved = false;
+    int i;
+
+    LALLOC_DECLARE( test_alloc, TRACE_POOL_SIZE );
+    LALLOC_DECLARE( replay_alloc, TRACE_POOL_SIZE );
+
+    lalloc_init( &test_alloc );
+
+    trace_count = 0;
+    test_cycles_step = 3;
+
+    lalloc_trace_set( &test_alloc, _trace_cb, &calls );
+
+    for ( i = 0; i < 3000 && trace_count < TRACE_MAX_EVENTS - 8; i++ )
+    {
+        uint32_t op = uint32_random_range( 0, 9 );
+
+        if ( reserved )
+        {
+            /* lalloc_alloc or lalloc_commit_and_alloc left a reservation */
+            if ( op < 2 || count == TRACE_MAX_LIVE || size == 0 )
+            {
+                lalloc_alloc_revert( &test_alloc );
+            }
+            else if ( op < 4 && count < TRACE_MAX_LIVE - 1 )
+            {
+                uint8_t *next;
+
+                if ( lalloc_commit_and_alloc( &test_alloc, uint32_random_range( 1, size < 50 ? size : 50 ), ( void ** )&next, &size ) )
+                {
+                    live[count++] = data;
+                    data = next;
+                    continue;
+                }
+
+                lalloc_alloc_revert( &test_alloc );
+            }
+            else
+            {
+                TEST_ASSERT_EQUAL( true, lalloc_commit( &test_alloc, uint32_random_range( 1, size < 50 ? size : 50 ) ) );
+                live[count++] = data;
+            }
+
+            reserved = false;
+        }
+        else if ( op < 4 && count < TRACE_MAX_LIVE )
+        {
+            if ( op < 2 )
+            {
+                lalloc_alloc( &test_alloc, ( void ** )&data, &size );
+            }
+            else
+            {
+                lalloc_alloc_max( &test_alloc, ( void ** )&data, &size, uint32_random_range( 1, 80 ) );
+            }
+
+            reserved = ( data != NULL );
+        }
+        else if ( op < 5 && count < TRACE_MAX_LIVE )
+        {
+            lalloc_handle_t h;
+
+            if ( lalloc_reserve( &test_alloc, uint32_random_range( 1, 60 ), &h ) )
+            {
+                data = h.addr;
+
+                if ( h.size > 0 && uint32_random_range( 0, 9 ) < 8 )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit_h( &test_alloc, &h, uint32_random_range( 1, h.size ) ) );
+                    live[count++] = data;
+                }
+                else
+                {
+                    lalloc_revert_h( &test_alloc, &h );
+                }
+            }
+        }
+        else if ( op < 8 && count > 0 )
+        {
+            uint32_t k = uint32_random_range( 0, count - 1 );
+
+            TEST_ASSERT_EQUAL( true, lalloc_free( &test_alloc, live[k] ) );
+            live[k] = live[--count];
+        }
+        else
+        {
+            lalloc_get_n( &test_alloc, ( void ** )&data, &size, uint32_random_range( 0, 4 ) );
+            lalloc_get_last( &test_alloc, ( void ** )&data, &size );
+        }
+    }
+
+    if ( reserved )
+    {
+        lalloc_alloc_revert( &test_alloc );
+    }
+
+    /* drains the deferred frees */
+    lalloc_get_alloc_count( &test_alloc );
+
+    TEST_ASSERT_EQUAL( calls, trace_count );
+    TEST_ASSERT_TRUE( trace_count > 1000 );
+
+    for ( i = 0; i < ( int )trace_count; i++ )
+    {
+        len += lalloc_trace_encode( &trace_events[i], &trace_buf[len] );
+    }
+
+    /* the records are smaller than the events */
+    TEST_ASSERT_TRUE( len < trace_count * sizeof( lalloc_trace_event_t ) );
+
+    lalloc_init( &replay_alloc );
+
+    for ( i = 0; i < 4; i++ )
+    {
+        handles[i].block = LALLOC_IDX_INVALID;
+    }
+
+    while ( pos < len )
+    {
+        uint8_t n = lalloc_trace_decode( &trace_buf[pos], len - pos, &ev );
+
+        TEST_ASSERT_TRUE( n > 0 );
+        TEST_ASSERT_EQUAL( trace_events[events].type, ev.type );
+        TEST_ASSERT_EQUAL( trace_events[events].delta, ev.delta );
+        TEST_ASSERT_EQUAL( trace_events[events].a, ev.a );
+        TEST_ASSERT_EQUAL( trace_events[events].b, ev.b );
+
+        pos += n;
+        events++;
+    }
+
+    TEST_ASSERT_EQUAL( trace_count, events );
+
+    for ( events = 0; events < trace_count; events++ )
+    {
+        lalloc_handle_t *h;
+
+        ev = trace_events[events];
+
+        switch ( ev.type )
+        {
+            case LALLOC_EV_ALLOC:
+                lalloc_alloc( &replay_alloc, ( void ** )&data, &size );
+                TEST_ASSERT_EQUAL( ev.a, size );
+                break;
+
+            case LALLOC_EV_ALLOC_MAX:
+                lalloc_alloc_max( &replay_alloc, ( void ** )&data, &size, ev.a );
+                TEST_ASSERT_EQUAL( ev.b, size );
+                break;
+
+            case LALLOC_EV_ALLOC_REVERT:
+                lalloc_alloc_revert( &replay_alloc );
+                break;
+
+            case LALLOC_EV_COMMIT:
+            case LALLOC_EV_COMMIT_AND_ALLOC:
+                if ( ev.type == LALLOC_EV_COMMIT )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit( &replay_alloc, ev.a ) );
+                }
+                else
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_commit_and_alloc( &replay_alloc, ev.a, ( void ** )&data, &size ) );
+                }
+
+                /* the committed block is the newest one */
+                lalloc_get_last( &replay_alloc, ( void ** )&data, &size );
+                TEST_ASSERT_EQUAL( ev.b, data - replay_alloc.pool );
+                break;
+
+            case LALLOC_EV_RESERVE:
+                for ( h = handles; h->block != LALLOC_IDX_INVALID; h++ )
+                {
+                }
+
+                TEST_ASSERT_EQUAL( ev.b != 0, lalloc_reserve( &replay_alloc, ev.a, h ) );
+                TEST_ASSERT_EQUAL( ev.b, ( ev.b != 0 ) ? ( uint8_t * )h->addr - replay_alloc.pool : 0 );
+                break;
+
+            case LALLOC_EV_COMMIT_H:
+                h = _find_handle( handles, 4, replay_alloc.pool, ev.b );
+                TEST_ASSERT_NOT_NULL( h );
+                TEST_ASSERT_EQUAL( true, lalloc_commit_h( &replay_alloc, h, ev.a ) );
+                break;
+
+            case LALLOC_EV_REVERT_H:
+                h = _find_handle( handles, 4, replay_alloc.pool, ev.b );
+                TEST_ASSERT_NOT_NULL( h );
+                lalloc_revert_h( &replay_alloc, h );
+                break;
+
+            case LALLOC_EV_FREE:
+#if LALLOC_DEFERRED_FREE == 1
+                /* a drain reports the queue from the newest free, the run is freed backwards to be drained alike */
+                for ( run = events; run + 1 < trace_count && trace_events[run + 1].type == LALLOC_EV_FREE; run++ )
+                {
+                }
+
+                for ( k = run; k + 1 > events; k-- )
+                {
+                    TEST_ASSERT_EQUAL( true, lalloc_free( &replay_alloc, replay_alloc.pool + trace_events[k].b ) );
+                }
+
+                events = run;
+#else
+                TEST_ASSERT_EQUAL( true, lalloc_free( &replay_alloc, replay_alloc.pool + ev.b ) );
+#endif
+                break;
+
+            case LALLOC_EV_GET:
+                lalloc_get_n( &replay_alloc, ( void ** )&data, &size, ev.a );
+                break;
+
+            case LALLOC_EV_GET_LAST:
+                lalloc_get_last( &replay_alloc, ( void ** )&data, &size );
+                break;
+
+            default:
+                TEST_FAIL();
+                break;
+        }
+    }
+
+    /* both instances end with the same blocks */
+    TEST_ASSERT_EQUAL( lalloc_get_alloc_count( &test_alloc ), lalloc_get_alloc_count( &replay_alloc ) );
+    TEST_ASSERT_EQUAL( lalloc_get_free_space( &test_alloc ), lalloc_get_free_space( &replay_alloc ) );
+
+    for ( i = 0; i < ( int )lalloc_get_alloc_count( &test_alloc ); i++ )
+    {
+        uint8_t *replay_data;
+        LALLOC_IDX_TYPE replay_size;
+
+        lalloc_get_n( &test_alloc, ( void ** )&data, &size, i );
+        lalloc_get_n( &replay_alloc, ( void ** )&replay_data, &replay_size, i );
+
+        TEST_ASSERT_EQUAL( data - test_alloc.pool, replay_data - replay_alloc.pool );
+        TEST_ASSERT_EQUAL( size, replay_size );
+    }
+}
+
+#ifndef STM32L475xx
+int main()
+{
+    RUN_TEST( test_trace_encode );
+    RUN_TEST( test_trace_events );
+    RUN_TEST( test_trace_replay );
+    return 0;
+}
+#endif